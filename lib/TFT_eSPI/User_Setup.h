@@ -17,14 +17,10 @@
 #define TFT_BL   48  // LED back-light control pin
 #define TFT_BACKLIGHT_ON HIGH  // Level to turn ON back-light (HIGH or LOW)
 
-// Font definitions
+// Font definitions - the terminal UI only draws the GLCD font (at size 2,
+// through GlyphCache), so the larger fonts, FreeFonts and smooth font
+// support are left out of the build
 #define LOAD_GLCD   // Font 1. Original Adafruit 8 pixel font needs ~1820 bytes in FLASH
-#define LOAD_FONT2  // Font 2. Small 16 pixel high font, needs ~3534 bytes in FLASH, 96 characters
-#define LOAD_FONT4  // Font 4. Medium 26 pixel high font, needs ~5848 bytes in FLASH, 96 characters
-#define LOAD_FONT6  // Font 6. Large 48 pixel high font, needs ~2666 bytes in FLASH, only characters 1234567890:-.apm
-#define LOAD_FONT7  // Font 7. 7 segment 48 pixel high font, needs ~2438 bytes in FLASH, only characters 1234567890:-.
-#define LOAD_FONT8  // Font 8. Large 75 pixel high font needs ~3256 bytes in FLASH, only characters 1234567890:-.
-#define LOAD_GFXFF  // FreeFonts. Include access to the 48 Adafruit_GFX free fonts FF1 to FF48 and custom fonts
 
 // SPI frequency
 #define SPI_FREQUENCY  40000000  // 40MHz for good performance
@@ -43,6 +39,3 @@
 // Touch pressure threshold
 #define MINPRESSURE 10
 #define MAXPRESSURE 1000
-
-// For better terminal display
-#define SMOOTH_FONT
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "BinaryProtocol.h"
+
+uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output) {
+    size_t codeIndex = 0;
+    size_t writeIndex = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] == 0) {
+            output[codeIndex] = code;
+            codeIndex = writeIndex++;
+            code = 1;
+            continue;
+        }
+
+        output[writeIndex++] = input[i];
+        if (++code == 0xFF) {
+            output[codeIndex] = code;
+            codeIndex = writeIndex++;
+            code = 1;
+        }
+    }
+
+    output[codeIndex] = code;
+    return writeIndex;
+}
+
+size_t cobsDecode(const uint8_t* input, size_t length, uint8_t* output) {
+    size_t readIndex = 0;
+    size_t writeIndex = 0;
+
+    while (readIndex < length) {
+        uint8_t code = input[readIndex++];
+        if (code == 0 || readIndex + code - 1 > length) {
+            return 0;
+        }
+
+        for (uint8_t i = 1; i < code; i++) {
+            output[writeIndex++] = input[readIndex++];
+        }
+
+        // A zero is implied between blocks, except after a full block
+        if (code != 0xFF && readIndex < length) {
+            output[writeIndex++] = 0;
+        }
+    }
+
+    return writeIndex;
+}
+
+size_t encodeFrame(uint8_t msgId, uint8_t seq, const void* payload, size_t payloadLength, uint8_t* frame) {
+    if (payloadLength > BINARY_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    uint8_t packet[BINARY_MAX_PACKET];
+    packet[0] = msgId;
+    packet[1] = seq;
+    if (payloadLength > 0) {
+        memcpy(packet + BINARY_HEADER_SIZE, payload, payloadLength);
+    }
+
+    size_t length = BINARY_HEADER_SIZE + payloadLength;
+    uint16_t crc = crc16(packet, length);
+    packet[length++] = crc & 0xFF;
+    packet[length++] = crc >> 8;
+
+    size_t encoded = cobsEncode(packet, length, frame);
+    frame[encoded++] = 0x00;
+    return encoded;
+}
+
+bool decodeFrame(uint8_t* frame, size_t length, BinaryPacket& packet) {
+    size_t decoded = cobsDecode(frame, length, frame);
+    if (decoded < BINARY_HEADER_SIZE + BINARY_CRC_SIZE) {
+        return false;
+    }
+
+    size_t bodyLength = decoded - BINARY_CRC_SIZE;
+    uint16_t received = frame[bodyLength] | (frame[bodyLength + 1] << 8);
+    if (crc16(frame, bodyLength) != received) {
+        return false;
+    }
+
+    packet.msgId = frame[0];
+    packet.seq = frame[1];
+    packet.payload = frame + BINARY_HEADER_SIZE;
+    packet.payloadLength = bodyLength - BINARY_HEADER_SIZE;
+    return true;
+}
@@ -0,0 +1,123 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+
+// Compact binary link protocol, negotiated with a JSON hello:
+//   -> {"cmd":"hello","proto":"cobs1"}
+//   <- {"hello":"cobs1"}
+// After the reply both sides exchange frames of
+//   COBS( msgId | seq | payload | crc16 ) 0x00
+// with the CRC-16/CCITT-FALSE over msgId..payload, little-endian.
+//
+// Sensor streaming (either wire format):
+//   -> {"cmd":"subscribe","max_hz":10,"keyframe_ms":4000}   / MSG_SUBSCRIBE
+//   <- {"subscribed":true,"max_hz":10}                      / MSG_SUBSCRIBED
+// after which the main device pushes only changed sensor fields, at most
+// max_hz times per second, plus a full keyframe ({"kf":true,...}) at least
+// every keyframe_ms. Status is pushed when it changes.
+//
+// Manual commands carry an id the main device acks once it has acted:
+//   -> {"cmd":"manual_pump","pump":3,"id":17}               / MSG_MANUAL
+//   <- {"ack":17}  or  {"ack":17,"error":"busy"}            / MSG_MANUAL_ACK
+// A command that is not acked is retransmitted with the same id, so the
+// main device must run each id once and ack repeats of the last one
+// without running them again.
+#define BINARY_PROTOCOL_NAME "cobs1"
+
+#define BINARY_MAX_PAYLOAD 48
+#define BINARY_HEADER_SIZE 2
+#define BINARY_CRC_SIZE 2
+#define BINARY_MAX_PACKET (BINARY_HEADER_SIZE + BINARY_MAX_PAYLOAD + BINARY_CRC_SIZE)
+#define BINARY_MAX_FRAME (BINARY_MAX_PACKET + BINARY_MAX_PACKET / 254 + 2)
+
+// Message IDs - requests from the display have the top bit clear
+enum BinaryMessageId : uint8_t {
+    MSG_GET_SENSORS = 0x01,
+    MSG_GET_STATUS  = 0x02,
+    MSG_MANUAL      = 0x03,
+    MSG_SUBSCRIBE   = 0x04,
+
+    MSG_SENSORS     = 0x81,
+    MSG_STATUS      = 0x82,
+    MSG_SUBSCRIBED  = 0x83,
+    MSG_SENSOR_UPDATE = 0x84,
+    MSG_MANUAL_ACK  = 0x85
+};
+
+// Manual control identifiers for MSG_MANUAL
+enum BinaryManualControl : uint8_t {
+    CONTROL_LIGHTS = 1,
+    CONTROL_SPRAY  = 2,
+    CONTROL_PUMP   = 3,
+    CONTROL_PROBE  = 4
+};
+
+// Fixed-layout payloads
+struct __attribute__((packed)) ManualPayload {
+    uint8_t control;
+    uint8_t argument;          // Pump number for CONTROL_PUMP
+    uint16_t id;               // Command id to ack - older main firmware reads only the first two bytes
+};
+
+#define MANUAL_RESULT_OK 0
+
+struct __attribute__((packed)) ManualAckPayload {
+    uint16_t id;
+    uint8_t result;            // MANUAL_RESULT_OK, anything else is a refusal
+};
+
+struct __attribute__((packed)) SensorPayload {
+    uint8_t validMask;         // Bit n set when values[n] is valid
+    float values[SENSOR_COUNT];
+};
+
+struct __attribute__((packed)) SubscribePayload {
+    uint8_t maxRateHz;
+    uint16_t keyframeMs;
+};
+
+struct __attribute__((packed)) SubscribedPayload {
+    uint8_t maxRateHz;         // Rate the main device agreed to
+};
+
+// MSG_SENSOR_UPDATE: header followed by one float per set fieldMask bit
+#define UPDATE_FLAG_KEYFRAME 0x01
+
+struct __attribute__((packed)) SensorUpdateHeader {
+    uint8_t flags;
+    uint8_t fieldMask;
+};
+
+#define STATUS_FLAG_OK              0x01
+#define STATUS_FLAG_WIFI_CONNECTED  0x02
+
+struct __attribute__((packed)) StatusPayload {
+    uint8_t flags;
+    uint8_t errorLength;       // Followed by errorLength bytes of error text
+};
+
+// Decoded packet - payload points into the receive buffer
+struct BinaryPacket {
+    uint8_t msgId;
+    uint8_t seq;
+    const uint8_t* payload;
+    size_t payloadLength;
+};
+
+uint16_t crc16(const uint8_t* data, size_t length);
+
+// COBS encode without the trailing delimiter; returns encoded length
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output);
+
+// COBS decode (may be done in place); returns 0 on a malformed frame
+size_t cobsDecode(const uint8_t* input, size_t length, uint8_t* output);
+
+// Builds a complete frame including the 0x00 delimiter; returns its length
+size_t encodeFrame(uint8_t msgId, uint8_t seq, const void* payload, size_t payloadLength, uint8_t* frame);
+
+// Decodes a frame (without delimiter) in place; false on COBS or CRC error
+bool decodeFrame(uint8_t* frame, size_t length, BinaryPacket& packet);
+
+#endif // BINARY_PROTOCOL_H
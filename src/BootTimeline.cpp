@@ -0,0 +1,52 @@
+#include "BootTimeline.h"
+
+static const char* PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "LittleFS mounted", "config loaded", "sensor log ready", "tft.init",
+    "splash", "first frame", "first UART response", "WiFi up"
+};
+
+static EventGroupHandle_t bootEvents = nullptr;
+static volatile uint32_t phaseMicros[BOOT_PHASE_COUNT];
+
+void bootBegin() {
+    bootEvents = xEventGroupCreate();
+}
+
+void bootMark(BootPhase phase) {
+    // Cheap on hot paths once reached - one event group read
+    if (bootReached(phase)) {
+        return;
+    }
+    
+    phaseMicros[phase] = micros();
+    xEventGroupSetBits(bootEvents, BOOT_BIT(phase));
+    Serial.printf("Boot: %s at %.1f ms\n", PHASE_NAMES[phase], phaseMicros[phase] / 1000.0);
+}
+
+void bootWait(EventBits_t bits) {
+    xEventGroupWaitBits(bootEvents, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+bool bootReached(BootPhase phase) {
+    return (xEventGroupGetBits(bootEvents) & BOOT_BIT(phase)) != 0;
+}
+
+uint32_t bootMicros(BootPhase phase) {
+    return bootReached(phase) ? phaseMicros[phase] : 0;
+}
+
+const char* bootPhaseName(BootPhase phase) {
+    return PHASE_NAMES[phase];
+}
+
+void bootReport() {
+    Serial.println("Boot timeline:");
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        BootPhase phase = (BootPhase)i;
+        if (bootReached(phase)) {
+            Serial.printf("  %-20s %8.1f ms\n", PHASE_NAMES[i], phaseMicros[i] / 1000.0);
+        } else {
+            Serial.printf("  %-20s %8s\n", PHASE_NAMES[i], "--");
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// Boot phases - each is stamped once, in micros() since reset, and doubles
+// as an event group bit that later init steps can wait on
+enum BootPhase : uint8_t {
+    BOOT_FS_MOUNTED,
+    BOOT_CONFIG_LOADED,
+    BOOT_LOG_READY,
+    BOOT_TFT_INIT,
+    BOOT_SPLASH,
+    BOOT_FIRST_FRAME,
+    BOOT_FIRST_UART_RESPONSE,
+    BOOT_WIFI_UP,
+    BOOT_PHASE_COUNT
+};
+
+#define BOOT_BIT(phase) ((EventBits_t)1 << (phase))
+
+// Call at the top of setup(), before any task is created
+void bootBegin();
+
+// Records the phase the first time it is reached; later calls are ignored
+void bootMark(BootPhase phase);
+
+// Blocks the calling task until every phase in bits has been reached
+void bootWait(EventBits_t bits);
+
+bool bootReached(BootPhase phase);
+uint32_t bootMicros(BootPhase phase);   // 0 until reached
+const char* bootPhaseName(BootPhase phase);
+
+// Prints every phase reached so far, in boot order
+void bootReport();
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,186 @@
+#include "CommandPipeline.h"
+#include <limits.h>
+#include "BinaryProtocol.h"
+
+// Manual tab buttons, in layout order
+struct ManualControlDef {
+    uint8_t control;
+    uint8_t argument;
+    const char* name;
+};
+
+static const ManualControlDef MANUAL_CONTROLS[MANUAL_CONTROL_COUNT] = {
+#ifdef DEVICE_TYPE_ENVIRONMENT
+    {CONTROL_LIGHTS, 0, MANUAL_1_CMD},
+    {CONTROL_SPRAY, 0, MANUAL_2_CMD}
+#elif DEVICE_TYPE_LIQUID
+    {CONTROL_PUMP, 1, MANUAL_1_CMD},
+    {CONTROL_PUMP, 2, MANUAL_2_CMD},
+    {CONTROL_PUMP, 3, MANUAL_3_CMD},
+    {CONTROL_PUMP, 4, MANUAL_4_CMD},
+    {CONTROL_PUMP, 5, MANUAL_5_CMD},
+    {CONTROL_PROBE, 0, MANUAL_6_CMD}
+#endif
+};
+
+CommandPipeline::CommandPipeline() : dropped(0), consumerTask(nullptr), nextId(1), peerAcks(false),
+    statesChanged(false) {
+    memset(inFlight, 0, sizeof(inFlight));
+    memset(lastSentTouch, 0, sizeof(lastSentTouch));
+    memset(sentBefore, 0, sizeof(sentBefore));
+    memset(&states, 0, sizeof(states));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool CommandPipeline::submit(uint8_t button, uint8_t press, uint32_t touchMicros) {
+    if (button >= MANUAL_CONTROL_COUNT) {
+        return false;
+    }
+
+    CommandRequest request = { button, press, touchMicros };
+    if (!queue.push(request)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (consumerTask) {
+        xTaskNotifyGive(consumerTask);
+    }
+    return true;
+}
+
+bool CommandPipeline::nextFrame(unsigned long now, CommandFrame& frame) {
+    // Retries first - they are older than anything still queued
+    for (uint8_t button = 0; button < MANUAL_CONTROL_COUNT; button++) {
+        InFlight& command = inFlight[button];
+        if (!command.active || (long)(now - command.deadline) < 0) {
+            continue;
+        }
+
+        if (peerAcks && command.attempts <= COMMAND_MAX_RETRIES) {
+            command.deadline = now + ((unsigned long)COMMAND_ACK_TIMEOUT_MS << command.attempts);
+            command.attempts++;
+            command.sentMicros = micros();
+            stats.retries++;
+            describe(button, command.id, frame);
+            return true;
+        }
+
+        // Out of retries - or a peer that never acks, which may well have
+        // run the command
+        command.active = false;
+        if (peerAcks) {
+            stats.timedOut++;
+            setState(button, COMMAND_FAILED, now);
+        } else {
+            stats.unconfirmed++;
+            setState(button, COMMAND_UNCONFIRMED, now);
+        }
+    }
+
+    CommandRequest request;
+    while (queue.peek(request)) {
+        queue.pop();
+        stats.submitted++;
+
+        uint8_t button = request.button;
+        InFlight& command = inFlight[button];
+        states.buttons[button].press = request.press;
+        statesChanged = true;
+
+        // Repeat presses ride on the command already sent for the button
+        bool recent = sentBefore[button] &&
+                      request.touchMicros - lastSentTouch[button] < (uint32_t)COMMAND_COALESCE_MS * 1000;
+        if (command.active || recent) {
+            stats.coalesced++;
+            continue;
+        }
+
+        command.active = true;
+        command.id = nextId++;
+        if (nextId == 0) {
+            nextId = 1;  // 0 is never used, so a zeroed ack can't match
+        }
+        command.attempts = 1;
+        command.touchMicros = request.touchMicros;
+        command.sentMicros = micros();
+        command.deadline = now + COMMAND_ACK_TIMEOUT_MS;
+        lastSentTouch[button] = request.touchMicros;
+        sentBefore[button] = true;
+        stats.sent++;
+
+        setState(button, COMMAND_PENDING, now);
+        describe(button, command.id, frame);
+        return true;
+    }
+
+    return false;
+}
+
+void CommandPipeline::acknowledge(uint16_t id, bool accepted, uint32_t nowMicros) {
+    peerAcks = true;
+
+    for (uint8_t button = 0; button < MANUAL_CONTROL_COUNT; button++) {
+        InFlight& command = inFlight[button];
+        if (!command.active || command.id != id) {
+            continue;
+        }
+
+        command.active = false;
+        touchToAck.record(nowMicros - command.touchMicros);
+        // A retried command's ack can't be matched to one transmission
+        if (command.attempts == 1) {
+            wireRtt.record(nowMicros - command.sentMicros);
+        }
+
+        if (accepted) {
+            stats.acked++;
+        } else {
+            stats.refused++;
+        }
+        setState(button, accepted ? COMMAND_ACKED : COMMAND_FAILED, millis());
+        return;
+    }
+
+    stats.lateAcks++;
+}
+
+unsigned long CommandPipeline::nextWait(unsigned long now) const {
+    unsigned long wait = ULONG_MAX;
+    for (uint8_t button = 0; button < MANUAL_CONTROL_COUNT; button++) {
+        const InFlight& command = inFlight[button];
+        if (!command.active) {
+            continue;
+        }
+        long remaining = (long)(command.deadline - now);
+        wait = min(wait, (unsigned long)max(remaining, 0L));
+    }
+    return wait;
+}
+
+bool CommandPipeline::takeStates(CommandStates& out) {
+    if (!statesChanged) {
+        return false;
+    }
+    out = states;
+    statesChanged = false;
+    return true;
+}
+
+const CommandStats& CommandPipeline::getStats() {
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void CommandPipeline::setState(uint8_t button, CommandState state, unsigned long now) {
+    states.buttons[button].state = state;
+    states.buttons[button].changedAt = now;
+    statesChanged = true;
+}
+
+void CommandPipeline::describe(uint8_t button, uint16_t id, CommandFrame& frame) {
+    frame.id = id;
+    frame.control = MANUAL_CONTROLS[button].control;
+    frame.argument = MANUAL_CONTROLS[button].argument;
+    frame.name = MANUAL_CONTROLS[button].name;
+}
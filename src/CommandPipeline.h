@@ -0,0 +1,123 @@
+#ifndef COMMAND_PIPELINE_H
+#define COMMAND_PIPELINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "DeviceConfig.h"
+#include "SpscQueue.h"
+#include "HdrHistogram.h"
+
+enum CommandState : uint8_t {
+    COMMAND_IDLE,
+    COMMAND_PENDING,           // Queued, or on the wire waiting for the ack
+    COMMAND_ACKED,
+    COMMAND_FAILED,            // Refused, or no ack after every retry
+    COMMAND_UNCONFIRMED        // Sent once to a peer that has never acked
+};
+
+// Per-button result - published by the UART task
+struct CommandStatus {
+    uint8_t state;
+    uint8_t press;             // Tag of the last press the UART task took
+    unsigned long changedAt;   // millis()
+};
+
+struct CommandStates {
+    CommandStatus buttons[MANUAL_CONTROL_COUNT];
+};
+
+// A press on its way from the display task to the UART task
+struct CommandRequest {
+    uint8_t button;
+    uint8_t press;
+    uint32_t touchMicros;      // When the gesture completed
+};
+
+// One transmission of a command - retries repeat the id
+struct CommandFrame {
+    uint16_t id;
+    uint8_t control;           // BinaryManualControl
+    uint8_t argument;
+    const char* name;          // JSON command
+};
+
+struct CommandStats {
+    uint32_t submitted;
+    uint32_t dropped;          // Queue full - the press never left the display
+    uint32_t coalesced;        // Repeat presses merged into an earlier command
+    uint32_t sent;             // Distinct commands put on the wire
+    uint32_t retries;
+    uint32_t acked;
+    uint32_t refused;          // Acked with an error by the main device
+    uint32_t timedOut;
+    uint32_t unconfirmed;
+    uint32_t lateAcks;         // Acks for commands already given up on
+};
+
+// Manual commands from the touch screen to the main device.
+// The display task pushes presses into a bounded lock-free queue and wakes
+// the UART task, which owns everything after that: it gives each command a
+// sequence number, puts it on the wire and waits for the main device to ack
+// that number, retransmitting with a doubling timeout. A button has at most
+// one command in flight; pressing it again while that is pending, or within
+// COMMAND_COALESCE_MS of the press that sent it, is merged instead of
+// repeated. Results go back to the display as per-button states.
+// Retries are only made once the peer has acked something, so main-device
+// firmware without acks still gets every press exactly once.
+class CommandPipeline {
+private:
+    struct InFlight {
+        bool active;
+        uint16_t id;
+        uint8_t attempts;
+        uint32_t touchMicros;
+        uint32_t sentMicros;
+        unsigned long deadline;
+    };
+
+    // Producer side
+    SpscQueue<CommandRequest, COMMAND_QUEUE_SIZE> queue;
+    std::atomic<uint32_t> dropped;
+    TaskHandle_t consumerTask;
+
+    // Consumer side - UART task only
+    InFlight inFlight[MANUAL_CONTROL_COUNT];
+    uint32_t lastSentTouch[MANUAL_CONTROL_COUNT];
+    bool sentBefore[MANUAL_CONTROL_COUNT];
+    uint16_t nextId;
+    bool peerAcks;
+    CommandStates states;
+    bool statesChanged;
+    CommandStats stats;
+    HdrHistogram touchToAck;
+    HdrHistogram wireRtt;      // Transmission to ack, first attempts only
+
+    void setState(uint8_t button, CommandState state, unsigned long now);
+    static void describe(uint8_t button, uint16_t id, CommandFrame& frame);
+
+public:
+    CommandPipeline();
+
+    // Display task - false when the queue is full
+    bool submit(uint8_t button, uint8_t press, uint32_t touchMicros);
+
+    // UART task
+    void setTask(TaskHandle_t handle) { consumerTask = handle; }
+    // Next frame to transmit - a due retry or a new command; false when none
+    bool nextFrame(unsigned long now, CommandFrame& frame);
+    void acknowledge(uint16_t id, bool accepted, uint32_t nowMicros);
+    // The main device went silent - it may come back without ack support
+    void peerLost() { peerAcks = false; }
+    // Milliseconds until the next retry is due
+    unsigned long nextWait(unsigned long now) const;
+    // Copies the button states if they changed since the last call
+    bool takeStates(CommandStates& out);
+
+    const CommandStats& getStats();
+    const HdrHistogram& getTouchToAck() const { return touchToAck; }
+    const HdrHistogram& getWireRtt() const { return wireRtt; }
+};
+
+#endif // COMMAND_PIPELINE_H
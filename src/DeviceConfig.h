@@ -19,10 +19,18 @@
     #define SENSOR_COUNT 3
     #define SENSOR_1_NAME "Temperature"
     #define SENSOR_1_UNIT "°C"
+    #define SENSOR_1_KEY "temp"
     #define SENSOR_2_NAME "Humidity"
     #define SENSOR_2_UNIT "%"
+    #define SENSOR_2_KEY "humidity"
     #define SENSOR_3_NAME "Air Pressure"
     #define SENSOR_3_UNIT "PSI"
+    #define SENSOR_3_KEY "air_pressure"
+    
+    // History quantization - steps per unit, the int16 range must cover the sensor
+    #define SENSOR_1_HISTORY_SCALE 100   // 0.01 °C
+    #define SENSOR_2_HISTORY_SCALE 100   // 0.01 %
+    #define SENSOR_3_HISTORY_SCALE 100   // 0.01 PSI
     
     // Manual control configuration
     #define MANUAL_CONTROL_COUNT 2
@@ -39,10 +47,18 @@
     #define SENSOR_COUNT 3
     #define SENSOR_1_NAME "pH Level"
     #define SENSOR_1_UNIT "pH"
+    #define SENSOR_1_KEY "ph"
     #define SENSOR_2_NAME "EC Level"
     #define SENSOR_2_UNIT "mS/cm"
+    #define SENSOR_2_KEY "ec"
     #define SENSOR_3_NAME "Water Temp"
     #define SENSOR_3_UNIT "°C"
+    #define SENSOR_3_KEY "water_temp"
+    
+    // History quantization - steps per unit, the int16 range must cover the sensor
+    #define SENSOR_1_HISTORY_SCALE 1000  // 0.001 pH
+    #define SENSOR_2_HISTORY_SCALE 1000  // 0.001 mS/cm
+    #define SENSOR_3_HISTORY_SCALE 100   // 0.01 °C
     
     // Manual control configuration
     #define MANUAL_CONTROL_COUNT 6
@@ -63,12 +79,190 @@
 // Common configuration
 #define UART_BAUD_RATE 115200
 #define UART_TIMEOUT_MS 5000
+#define UART_RX_BUFFER_SIZE 1024     // Driver ring buffer
+#define UART_LINE_BUFFER_SIZE 512    // Longest message the framer accepts
+
+// Manual commands (see CommandPipeline.h)
+#define COMMAND_QUEUE_SIZE 8                // Presses queued for the UART task (power of two)
+#define COMMAND_ACK_TIMEOUT_MS 250          // First retransmission; doubles with every retry
+#define COMMAND_MAX_RETRIES 3
+#define COMMAND_COALESCE_MS 500             // Repeat presses of a button within this are merged
+#define COMMAND_RESULT_SHOW_MS 1500         // Acked or failed mark on the button
 
 // Display configuration
 #define DISPLAY_WIDTH 480
 #define DISPLAY_HEIGHT 320
+#ifndef DISPLAY_ROTATION
+    #define DISPLAY_ROTATION 1         // Landscape
+#endif
 #define TAB_COUNT 3
 
+// Display task scheduling
+#ifndef DISPLAY_MAX_FPS
+    #define DISPLAY_MAX_FPS 20         // Render rate cap
+#endif
+// Touch sampling runs on its own task (see TouchInput.h)
+#define TOUCH_POLL_INTERVAL_MS 50          // Idle pen-down check without PENIRQ
+#define TOUCH_SAMPLE_INTERVAL_MS 10        // While the pen is down
+#define TOUCH_Z_THRESHOLD 600              // Minimum pressure for a press
+#define TOUCH_MEDIAN_SAMPLES 5             // Raw reads per filtered sample (odd)
+#define TOUCH_IIR_SHIFT 1                  // Smoothing: new = old + (raw - old) >> shift
+#define TOUCH_TAP_SLOP_PX 12               // Movement still counted as a tap
+#define TOUCH_LONG_PRESS_MS 600
+#define TOUCH_SWIPE_MIN_PX 80              // Horizontal travel of a tab swipe
+#define TOUCH_DRAG_STEP_PX 12              // Vertical travel per drag event (list scrolling)
+#define TOUCH_GESTURE_QUEUE 8
+#define TOUCH_MATRIX_SIZE 6                // Q16 affine calibration, see TouchInput.h
+#define TOUCH_MATRIX_SHIFT 16
+// Default calibration - raw XPT2046 range mapped linearly onto the panel
+#define TOUCH_RAW_X_MIN 300
+#define TOUCH_RAW_X_MAX 3600
+#define TOUCH_RAW_Y_MIN 300
+#define TOUCH_RAW_Y_MAX 3600
+// Define TOUCH_IRQ_PIN (touch controller PENIRQ) to stop polling while idle
+
+// Runtime metrics (enable with -DMETRICS_ENABLED, see Metrics.h)
+#define DIAGNOSTICS_REFRESH_MS 1000         // Diagnostics page update while open
+
+// Off-screen strip compositing (enable with -DDISPLAY_COMPOSITING)
+// RAM use is 2 buffers * DISPLAY_WIDTH * COMPOSITE_STRIP_HEIGHT * 2 bytes
+#ifndef COMPOSITE_STRIP_HEIGHT
+    #define COMPOSITE_STRIP_HEIGHT 40
+#endif
+// Strips in PSRAM free internal RAM but the SPI DMA cannot read them, so
+// they are pushed with blocking writes instead
+#ifndef COMPOSITE_USE_PSRAM
+    #define COMPOSITE_USE_PSRAM 0
+#endif
+// With -DRENDER_PIPELINE (needs DISPLAY_COMPOSITING) the display task only
+// rasterises strips and a panel task on another core pushes them, so the
+// rasteriser can run COMPOSITE_STRIP_BUFFERS - 1 strips ahead of the bus
+#if defined(RENDER_PIPELINE) && !defined(DISPLAY_COMPOSITING)
+    #error "RENDER_PIPELINE needs DISPLAY_COMPOSITING - the pipeline passes composited strips between cores"
+#endif
+#ifndef COMPOSITE_STRIP_BUFFERS
+    #ifdef RENDER_PIPELINE
+        #define COMPOSITE_STRIP_BUFFERS 3
+    #else
+        #define COMPOSITE_STRIP_BUFFERS 2
+    #endif
+#endif
+
+// Glyph cache (see GlyphCache.h) - one 37 KB sheet per text colour pair:
+// main on black, black on main, plus room for status colours. The board has
+// no PSRAM, so sheets land in internal RAM (as they do whenever the panel's
+// DMA is on) and only GLYPH_CACHE_INTERNAL_SHEETS are kept there
+#ifndef GLYPH_CACHE_SHEETS
+    #define GLYPH_CACHE_SHEETS 4
+#endif
+#ifndef GLYPH_CACHE_INTERNAL_SHEETS
+    #define GLYPH_CACHE_INTERNAL_SHEETS 2
+#endif
+
+// Frame arena (see FrameArena.h) - text formatted while drawing one frame
+#ifndef FRAME_ARENA_SIZE
+    #define FRAME_ARENA_SIZE 1024
+#endif
+
+// Heap fragmentation monitor (see HeapMonitor.h)
+#define HEAP_SAMPLE_INTERVAL_MS 10000       // Free heap and largest block
+#define HEAP_HISTORY_INTERVAL_MS 900000     // One history point per 15 minutes
+#define HEAP_HISTORY_SIZE 96                // 24 hours of points
+#define HEAP_STEADY_MIN_POINTS 8            // Two hours before judging the trend
+#define HEAP_STEADY_TOLERANCE 2048          // Largest block drop still counted as steady
+
+// Core map - the WiFi driver and lwIP run on core 0 and the Arduino loop on
+// core 1. Rendering and UART parsing get core 1, the SPI side (panel
+// transfers, touch) shares core 0 with the network tasks, where it outranks
+// everything but the WiFi driver. Override with -DCORE_xxx=n or
+// tskNO_AFFINITY to let the scheduler pick
+#ifndef CORE_DISPLAY
+    #define CORE_DISPLAY 1
+#endif
+#ifndef CORE_UART
+    #define CORE_UART 1
+#endif
+#ifndef CORE_PANEL
+    #define CORE_PANEL 0
+#endif
+#ifndef CORE_TOUCH
+    #define CORE_TOUCH 0
+#endif
+#ifndef CORE_WIFI
+    #define CORE_WIFI 0
+#endif
+#ifndef CORE_TELEMETRY
+    #define CORE_TELEMETRY 0
+#endif
+#ifndef CORE_STORAGE
+    #define CORE_STORAGE 0
+#endif
+
+// Sensor history - memory per sensor is
+// HISTORY_RAW_SAMPLES * 6 + (HISTORY_TIER_1_BUCKETS + HISTORY_TIER_2_BUCKETS) * 6 bytes
+#ifndef HISTORY_RAW_SAMPLES
+    #define HISTORY_RAW_SAMPLES 240       // Latest samples at full rate
+#endif
+#ifndef HISTORY_TIER_1_BUCKETS
+    #define HISTORY_TIER_1_BUCKETS 360    // 1 hour of 10 s buckets
+#endif
+#ifndef HISTORY_TIER_2_BUCKETS
+    #define HISTORY_TIER_2_BUCKETS 360    // 24 hours of 4 min buckets
+#endif
+#define HISTORY_TIER_1_SECONDS 10
+#define HISTORY_TIER_2_SECONDS 240
+#define HISTORY_CHART_MAX_COLUMNS 240
+#define HISTORY_CHART_SECONDS 3600        // Span of the sensors tab charts
+
+// Persistent sensor log (LittleFS, see SensorLog.h)
+#define SENSOR_LOG_INTERVAL 2               // Seconds between logged samples
+#define SENSOR_LOG_SEGMENT_BLOCKS 64        // 32 KB segment files
+#define SENSOR_LOG_PENDING_BLOCKS 4         // Closed blocks buffered in RAM
+#define SENSOR_LOG_FLUSH_INTERVAL 600000    // Write a partial block after 10 minutes
+#ifndef SENSOR_LOG_SPACE_PERCENT
+    #define SENSOR_LOG_SPACE_PERCENT 50     // Share of the free flash for the log
+#endif
+// Rollup levels (28 bytes per slot with 3 sensors, files are pre-sized)
+#define ROLLUP_1M_SLOTS 1440                // 1 minute slots - 1 day
+#define ROLLUP_15M_SLOTS 2880               // 15 minute slots - 30 days
+#define ROLLUP_1H_SLOTS 2160                // 1 hour slots - 90 days
+#define ROLLUP_PENDING_RECORDS 16           // Closed slots buffered per level
+#define ROLLUP_WRITE_BATCH 8                // Slots written per flash update
+#define NTP_SERVER "pool.ntp.org"           // Log timestamps need wall-clock time
+
+// Configuration store - setters are written behind on the storage task
+#define CONFIG_MAX_BYTES 512                // Largest journal payload (JSON schema 0)
+#define CONFIG_WRITE_DEBOUNCE_MS 2000       // Quiet time before a write
+#define CONFIG_WRITE_MAX_DELAY_MS 10000     // Upper bound while changes keep coming
+
+// WiFi connection (see WiFiManager.h)
+#define WIFI_SCAN_MAX 32                    // Scan results shown on the settings tab
+#define WIFI_SCAN_CHANNELS 13               // Scanned one channel per step
+#define WIFI_SCAN_CHANNEL_MS 120            // Active dwell per channel
+#define WIFI_SCAN_MIN_INTERVAL_MS 10000
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000   // Cached AP attempt before a full scan
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define WIFI_BACKOFF_MIN_MS 1000            // Doubles with every failed attempt
+#define WIFI_BACKOFF_MAX_MS 30000
+#define WIFI_PROBE_INTERVAL_MS 1000         // Cached AP probes between full attempts
+#define WIFI_LEASE_REUSE_S 3600             // Cached IP is only reused while this fresh
+#define WIFI_REGISTER_RETRY_MS 60000
+#define WIFI_EVENT_QUEUE 8
+
+// Telemetry uplink (see TelemetryUplink.h) - point TELEMETRY_URL at a local
+// server with -DTELEMETRY_URL=\"http://host:port/path\"
+#ifndef TELEMETRY_URL
+    #define TELEMETRY_URL "https://api.aeroponic.com/devices/telemetry"
+#endif
+#define TELEMETRY_SAMPLE_INTERVAL 10        // Seconds between uplinked samples
+#define TELEMETRY_BATCH_SAMPLES 30          // Samples per batch - 5 minutes
+#define TELEMETRY_BATCH_MAX_AGE_MS 300000   // Cut a partial batch after this long
+#define TELEMETRY_RING_SAMPLES 64           // Samples buffered while a POST is in flight
+#define TELEMETRY_QUEUE_BATCHES 288         // Flash queue bound - a day of batches
+#define TELEMETRY_HTTP_TIMEOUT_MS 5000
+#define TELEMETRY_BACKOFF_MIN_MS 2000       // Doubles with every failed POST
+#define TELEMETRY_BACKOFF_MAX_MS 300000
+
 // Tab definitions
 #define TAB_SENSORS 0
 #define TAB_MANUAL 1
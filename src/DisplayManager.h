@@ -3,6 +3,33 @@
 
 #include <TFT_eSPI.h>
 #include "DeviceConfig.h"
+#include "WidgetSet.h"
+#include "SnapshotChannel.h"
+#include "SensorHistory.h"
+#include "SensorLog.h"
+#include "StorageManager.h"
+#include "TouchInput.h"
+#include "ListView.h"
+#include "FrameArena.h"
+#include "CommandPipeline.h"
+#include "Metrics.h"
+
+class WiFiManager;
+
+#define STATUS_ERROR_MAX 48
+
+// Trend charts next to the sensor readings
+#define CHART_X 300
+#define CHART_WIDTH 170
+#define CHART_HEIGHT 24
+#define CHART_RANGE_COUNT 3        // 1 hour from RAM, 24 hours and 7 days from rollups
+
+// Display task wake-up reasons (task notification bits)
+#define DISPLAY_EVENT_SENSORS  0x01
+#define DISPLAY_EVENT_STATUS   0x02
+#define DISPLAY_EVENT_TOUCH    0x04
+#define DISPLAY_EVENT_NETWORKS 0x08
+#define DISPLAY_EVENT_COMMANDS 0x10
 
 // Sensor data structure
 struct SensorData {
@@ -15,10 +42,23 @@ struct SensorData {
 struct SystemStatus {
     bool mainDeviceConnected;
     bool wifiConnected;
-    String lastError;
+    char lastError[STATUS_ERROR_MAX];
     unsigned long lastUpdate;
 };
 
+// WiFi scan results and this display's own link - published by the WiFi task
+struct NetworkEntry {
+    char ssid[CONFIG_SSID_MAX];
+    int8_t rssi;
+};
+
+struct NetworkList {
+    uint16_t scanId;           // Changes with every new scan
+    uint8_t count;             // Grows while a scan delivers results
+    bool connected;            // The display's WiFi, not the main device's
+    NetworkEntry entries[WIFI_SCAN_MAX];
+};
+
 class DisplayManager {
 private:
     TFT_eSPI tft;
@@ -26,42 +66,149 @@ private:
     // UI state
     uint8_t currentTab;
     uint16_t mainColor;        // Green or Yellow
-    bool touchPressed;
-    unsigned long lastTouchTime;
+    bool dataStale;            // Staleness shown in the last frame
+    bool splashShown;          // Screen holds the splash - only its text needs clearing
+    
+    // Retained widgets for the tab content area
+    WidgetSet ui;
+    GlyphCache glyphs;         // Text for the widgets, tabs and lists
+    FrameArena arena;          // Lines formatted for the frame being drawn
+    uint32_t frameCount;
+    unsigned long lastStatsReport;
+    
+    // Data - published by the UART task, read without locks by the display task
+    SnapshotChannel<SensorData> sensorChannel;
+    SnapshotChannel<SystemStatus> statusChannel;
+    SystemStatus publishedStatus;  // Producer side - last status published
+    SnapshotChannel<NetworkList> networkChannel;
+    
+    // Sensor history - recorded by the UART task, charted on the sensors tab
+    SensorHistory history;
+    HistorySeries chartSeries[SENSOR_COUNT];
+    SensorLog* sensorLog;
+    uint8_t chartRange;            // Index into CHART_RANGES, cycled by tapping a chart
+    uint32_t rollupChartEnd;       // End of the cached rollup series, 0 = stale
+    StorageManager* storageManager;
+    
+    void updateChartSeries();
+    
+    // Event-driven scheduling
+    TaskHandle_t displayTask;
+    uint32_t wakeups;
+    uint32_t renders;
+    uint64_t busyMicros;
+    unsigned long lastActivityReport;
     
-    // Data
-    SensorData sensorData;
-    SystemStatus systemStatus;
+    void notify(uint32_t events);
+    bool isDataStale() const;
+    void reportActivity();
     
-    // Touch handling
-    bool readTouch(int16_t& x, int16_t& y);
-    void handleTouch(int16_t x, int16_t y);
-    void handleManualTabTouch(int16_t x, int16_t y);
+    // Touch handling - gestures come from the touch task, which shares the
+    // SPI bus; busLock is held while this task draws
+    TouchInput touch;
+    SemaphoreHandle_t busLock;
+    uint32_t touchActions;
+    uint64_t touchLatencyTotal;    // Gesture complete to frame committed, micros
+    uint32_t touchLatencyMax;
+    
+    // WiFi network list page on the settings tab
+    WiFiManager* wifiManager;
+    ListView networkList;
+    bool showingNetworks;
+    uint16_t shownScanId;
+    int16_t dragRemainder;         // Drag travel not yet turned into whole rows
+    
+    void openNetworks();
+    void closeNetworks();
+    void refreshNetworkList();
+    void drawNetworksPage();
+    static void formatNetworkRow(uint16_t index, char* text, size_t size, void* context);
+    
+    // Manual commands - presses go to the UART task, results come back
+    CommandPipeline* commands;
+    SnapshotChannel<CommandStates> commandChannel;
+    uint8_t pressTags[MANUAL_CONTROL_COUNT];      // Counts presses handed to the pipeline
+    uint8_t shownCommands[MANUAL_CONTROL_COUNT];  // CommandState drawn on each button
+    
+    CommandState buttonState(uint8_t button, unsigned long now) const;
+    bool commandResultExpired() const;
+    
+#ifdef METRICS_ENABLED
+    // Diagnostics page on the settings tab, refreshed while open
+    bool showingDiagnostics;
+    MetricsSnapshot diagnosticsFrom;   // Rates are shown over [from, to]
+    MetricsSnapshot diagnosticsTo;
+    
+    void openDiagnostics();
+    void drawDiagnosticsPage();
+#endif
+    
+    void handleGesture(const TouchGesture& gesture);
+    void selectTab(uint8_t tab);
+    void handleTouch(int16_t x, int16_t y, uint32_t timestamp);
+    void handleSensorsTabTouch(int16_t x, int16_t y);
+    void handleManualTabTouch(int16_t x, int16_t y, uint32_t timestamp);
     void handleSettingsTabTouch(int16_t x, int16_t y);
     
     // UI rendering
+    void drawSplash();
     void drawBackground();
     void drawTabs();
     void drawTabContent();
+    void clearTabContent();
     void drawSensorsTab();
     void drawManualTab();
     void drawSettingsTab();
     
-    // Terminal-style helpers
-    void drawTerminalText(int16_t x, int16_t y, const String& text, uint16_t color = COLOR_WHITE);
-    void drawButton(int16_t x, int16_t y, int16_t w, int16_t h, const String& text, bool pressed = false);
+    // Terminal-style helpers - text is copied by the widgets, so it may
+    // come from the arena
+    void drawTerminalText(int16_t x, int16_t y, const char* text, uint16_t color = COLOR_WHITE, int16_t w = 0);
+    void drawButton(int16_t x, int16_t y, int16_t w, int16_t h, const char* text, bool pressed = false);
     
 public:
     DisplayManager();
     
+    // Panel init and splash - needs no config, so it runs before storage is up
     void begin();
-    void update();
+    // First real frame - call once the main colour is known
+    void showInterface();
+    // Touch task side - call on the touch task after the first frame
+    void beginTouch();
+    TouchInput& getTouchInput() { return touch; }
+#ifdef RENDER_PIPELINE
+    StripCompositor& getCompositor() { return ui.getCompositor(); }
+#endif
     
-    // Data updates from other components
+    // Handles the events that woke the display task; renders only on change
+    void update(uint32_t events);
+    
+    // Milliseconds until the next scheduled deadline (staleness)
+    uint32_t getWaitTime() const;
+    
+    // Data updates from other components (single producer each)
     void updateSensorData(const SensorData& data);
     void updateSystemStatus(const SystemStatus& status);
+    void updateNetworks(const NetworkList& networks);
+    void updateCommandStates(const CommandStates& states);
     void setMainColor(uint16_t color);
+    SensorHistory& getHistory() { return history; }
+    void setSensorLog(SensorLog* log) { sensorLog = log; }
+    void setStorageManager(StorageManager* storage) { storageManager = storage; }
+    void setWiFiManager(WiFiManager* wifi) { wifiManager = wifi; }
+    void setCommandPipeline(CommandPipeline* pipeline) { commands = pipeline; }
     
     // UI state
     uint8_t getCurrentTab() const { return currentTab; }
-};
\ No newline at end of file
+    const SystemStatus& getSystemStatus() const { return statusChannel.current(); }  // Display task
+    
+    // Render statistics
+    uint32_t getLastFramePixels() const { return ui.getLastFramePixels(); }
+    uint32_t getTotalPixels() const { return ui.getTotalPixels(); }
+    
+    // Touch-to-action latency since the last 10 s stats report, micros
+    uint32_t getTouchActions() const { return touchActions; }
+    uint32_t getTouchLatencyMax() const { return touchLatencyMax; }
+    uint32_t getTouchLatencyAverage() const { return touchActions ? touchLatencyTotal / touchActions : 0; }
+};
+
+#endif // DISPLAY_MANAGER_H
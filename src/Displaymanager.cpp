@@ -1,86 +1,311 @@
 #include "DisplayManager.h"
+#include "BootTimeline.h"
+#include "Layout.h"
+#include "WiFiManager.h"
+#include "Metrics.h"
 
-DisplayManager::DisplayManager() : currentTab(TAB_SENSORS), mainColor(COLOR_GREEN), touchPressed(false), lastTouchTime(0) {
+static const uint32_t CHART_RANGES[CHART_RANGE_COUNT] = {HISTORY_CHART_SECONDS, 86400, 604800};
+static const char* CHART_RANGE_NAMES[CHART_RANGE_COUNT] = {"TREND 1H", "TREND 24H", "TREND 7D"};
+
+DisplayManager::DisplayManager() : currentTab(TAB_SENSORS), mainColor(COLOR_GREEN), dataStale(false), splashShown(false), frameCount(0),
+    lastStatsReport(0), sensorLog(nullptr), chartRange(0), rollupChartEnd(0), storageManager(nullptr), displayTask(nullptr),
+    wakeups(0), renders(0), busyMicros(0), lastActivityReport(0), touchActions(0), touchLatencyTotal(0), touchLatencyMax(0),
+    wifiManager(nullptr), showingNetworks(false), shownScanId(0), dragRemainder(0), commands(nullptr) {
+    busLock = xSemaphoreCreateMutex();
+    
     // Initialize sensor data
+    SensorData sensorData;
     for (int i = 0; i < SENSOR_COUNT; i++) {
         sensorData.values[i] = 0.0;
         sensorData.valid[i] = false;
     }
     sensorData.lastUpdate = 0;
+    sensorChannel.reset(sensorData);
     
     // Initialize system status
+    SystemStatus systemStatus;
     systemStatus.mainDeviceConnected = false;
     systemStatus.wifiConnected = false;
-    systemStatus.lastError = "";
+    systemStatus.lastError[0] = '\0';
     systemStatus.lastUpdate = 0;
+    statusChannel.reset(systemStatus);
+    publishedStatus = systemStatus;
+    
+    NetworkList networks;
+    memset(&networks, 0, sizeof(networks));
+    networkChannel.reset(networks);
+    
+    CommandStates commandStates;
+    memset(&commandStates, 0, sizeof(commandStates));
+    commandChannel.reset(commandStates);
+    memset(pressTags, 0, sizeof(pressTags));
+    memset(shownCommands, 0, sizeof(shownCommands));
+    ui.setGlyphCache(&glyphs);
+    networkList.setGlyphCache(&glyphs);
+    
+#ifdef METRICS_ENABLED
+    showingDiagnostics = false;
+#endif
 }
 
 void DisplayManager::begin() {
+    // Producers notify the task that runs update()
+    displayTask = xTaskGetCurrentTaskHandle();
+    
     tft.init();
-    tft.setRotation(1);  // Landscape orientation
-    tft.fillScreen(COLOR_BLACK);
+    tft.setRotation(DISPLAY_ROTATION);
+    glyphs.begin(tft);
+    bootMark(BOOT_TFT_INIT);
+    
+    // Splash while storage is still mounting - needs nothing from config
+    drawSplash();
+    bootMark(BOOT_SPLASH);
     
+    Serial.printf("Display initialized: %dx%d\n", tft.width(), tft.height());
+    Serial.printf("Sensor history: %u bytes per sensor\n", (uint32_t)SensorHistory::bytesPerSensor());
+}
+
+void DisplayManager::showInterface() {
     // Set text properties for terminal style
     tft.setTextColor(COLOR_WHITE, COLOR_BLACK);
     tft.setTextSize(1);
     
-    Serial.printf("Display initialized: %dx%d\n", tft.width(), tft.height());
+    // Widgets own the content area below the tab bar
+    ui.begin(tft, CONTENT_RECT.y, CONTENT_RECT.h);
     
     // Draw initial UI
     drawBackground();
     drawTabs();
     drawTabContent();
+    bootMark(BOOT_FIRST_FRAME);
 }
 
-void DisplayManager::update() {
-    int16_t x, y;
+void DisplayManager::beginTouch() {
+    touch.begin(tft, busLock, displayTask, DISPLAY_EVENT_TOUCH);
+}
+
+void DisplayManager::update(uint32_t events) {
+    unsigned long startTime = micros();
+    bool changed = false;
+    wakeups++;
+    
+    // The touch task waits for the bus until this frame is on the panel
+    xSemaphoreTake(busLock, portMAX_DELAY);
     
-    // Handle touch input with debouncing
-    if (readTouch(x, y)) {
-        if (!touchPressed && (millis() - lastTouchTime > 200)) {
-            touchPressed = true;
-            lastTouchTime = millis();
-            handleTouch(x, y);
+    // Gestures recognised by the touch task since the last frame
+    uint32_t gestureTimes[TOUCH_GESTURE_QUEUE];
+    uint8_t gestureCount = 0;
+    TouchGesture gesture;
+    while (gestureCount < TOUCH_GESTURE_QUEUE && touch.nextGesture(gesture)) {
+        handleGesture(gesture);
+        gestureTimes[gestureCount++] = gesture.timestamp;
+        changed = true;
+    }
+    
+    // Pick up the latest snapshots published by the UART task
+    changed |= sensorChannel.fetch();
+    changed |= statusChannel.fetch();
+    changed |= commandChannel.fetch();
+    if (networkChannel.fetch()) {
+        if (showingNetworks) {
+            refreshNetworkList();
         }
-    } else {
-        touchPressed = false;
+        changed = true;
     }
     
-    // Redraw tab content (data may have updated)
-    drawTabContent();
+    // Scheduled deadline: an acked or failed mark on a button ran out
+    if (currentTab == TAB_MANUAL && commandResultExpired()) {
+        changed = true;
+    }
+    
+#ifdef METRICS_ENABLED
+    // Scheduled deadline: the diagnostics page is due for new numbers
+    if (showingDiagnostics && millis() - diagnosticsTo.at >= DIAGNOSTICS_REFRESH_MS) {
+        diagnosticsFrom = diagnosticsTo;
+        metrics.snapshot(diagnosticsTo);
+        changed = true;
+    }
+#endif
+    
+    // Scheduled deadline: data crossed the staleness timeout
+    bool stale = isDataStale();
+    if (stale != dataStale) {
+        dataStale = stale;
+        changed = true;
+    }
+    
+    // Redraw tab content - only widgets that changed reach the TFT
+    if (changed) {
+        METRIC_TIMER(renderStart);
+        drawTabContent();
+        renders++;
+        METRIC_RECORD_SINCE(HISTOGRAM_FRAME_RENDER, renderStart);
+        METRIC_COUNT(COUNTER_FRAMES, 1);
+    }
+    xSemaphoreGive(busLock);
+    
+    // Touch-to-action latency - the result of each gesture is now visible
+    unsigned long frameDone = micros();
+    for (uint8_t i = 0; i < gestureCount; i++) {
+        uint32_t latency = frameDone - gestureTimes[i];
+        touchLatencyTotal += latency;
+        touchLatencyMax = max(touchLatencyMax, latency);
+        touchActions++;
+        METRIC_RECORD_SINCE(HISTOGRAM_TOUCH_ACTION, gestureTimes[i]);
+    }
+    
+    busyMicros += micros() - startTime;
+    reportActivity();
+    
+    if (millis() - lastStatsReport >= 10000) {
+        const RenderStats& last = ui.getLastFrameStats();
+        Serial.printf("Render (%s): %u frames, %u px total, last frame %u calls / %u px / %u SPI bytes, commit %u us (max %u us)\n",
+                      ui.isComposited() ? "composited" : "direct", frameCount, ui.getTotalPixels(),
+                      last.drawCalls, last.pixels, last.spiBytes, ui.getLastCommitMicros(), ui.getMaxCommitMicros());
+        ui.resetCommitStats();
+        if (networkList.isOpen()) {
+            const RenderStats& step = networkList.getLastStepStats();
+            Serial.printf("List: %u rows, last step %u calls / %u px / %u SPI bytes\n",
+                          networkList.getCount(), step.drawCalls, step.pixels, step.spiBytes);
+        }
+        if (touchActions > 0) {
+            Serial.printf("Touch: %u actions, latency avg %u us (max %u us), %u samples, %u gestures dropped\n",
+                          touchActions, (uint32_t)(touchLatencyTotal / touchActions), touchLatencyMax,
+                          touch.getSamples(), touch.getDroppedGestures());
+            touchActions = 0;
+            touchLatencyTotal = 0;
+            touchLatencyMax = 0;
+        }
+        if (arena.getOverflows() > 0) {
+            Serial.printf("Frame arena: peak %u of %u B, %u lines truncated\n",
+                          (uint32_t)arena.getPeak(), FRAME_ARENA_SIZE, arena.getOverflows());
+        }
+        lastStatsReport = millis();
+    }
 }
 
-bool DisplayManager::readTouch(int16_t& x, int16_t& y) {
-    uint16_t touchX, touchY;
-    bool touched = tft.getTouch(&touchX, &touchY);
+uint32_t DisplayManager::getWaitTime() const {
+    unsigned long currentTime = millis();
+    uint32_t waitTime = portMAX_DELAY;
     
-    if (touched) {
-        x = touchX;
-        y = touchY;
-        return true;
+    // Wake when fresh data turns stale
+    const SensorData& sensorData = sensorChannel.current();
+    unsigned long dataAge = currentTime - sensorData.lastUpdate;
+    if (sensorData.lastUpdate > 0 && dataAge <= UART_TIMEOUT_MS) {
+        waitTime = min(waitTime, (uint32_t)(UART_TIMEOUT_MS - dataAge + 1));
     }
     
-    return false;
+    // Wake when a command result on the manual tab should be cleared
+    if (currentTab == TAB_MANUAL) {
+        const CommandStates& states = commandChannel.current();
+        for (uint8_t i = 0; i < MANUAL_CONTROL_COUNT; i++) {
+            const CommandStatus& status = states.buttons[i];
+            unsigned long shown = currentTime - status.changedAt;
+            if (shownCommands[i] != COMMAND_IDLE && status.state != COMMAND_PENDING && shown < COMMAND_RESULT_SHOW_MS) {
+                waitTime = min(waitTime, (uint32_t)(COMMAND_RESULT_SHOW_MS - shown));
+            }
+        }
+    }
+    
+#ifdef METRICS_ENABLED
+    if (showingDiagnostics) {
+        unsigned long shown = currentTime - diagnosticsTo.at;
+        waitTime = min(waitTime, (uint32_t)(shown < DIAGNOSTICS_REFRESH_MS ? DIAGNOSTICS_REFRESH_MS - shown : 0));
+    }
+#endif
+    
+    return waitTime;
 }
 
-void DisplayManager::handleTouch(int16_t x, int16_t y) {
-    // Tab bar area (top 40 pixels)
-    if (y < 40) {
+bool DisplayManager::isDataStale() const {
+    const SensorData& sensorData = sensorChannel.current();
+    return (millis() - sensorData.lastUpdate > UART_TIMEOUT_MS) && sensorData.lastUpdate > 0;
+}
+
+void DisplayManager::notify(uint32_t events) {
+    if (displayTask) {
+        xTaskNotify(displayTask, events, eSetBits);
+    }
+}
+
+void DisplayManager::reportActivity() {
+    unsigned long elapsed = millis() - lastActivityReport;
+    if (elapsed < 60000) {
+        return;
+    }
+    
+    Serial.printf("Display: %u wakeups/min, %u renders/min, task busy %.2f%%\n",
+                  (uint32_t)((uint64_t)wakeups * 60000 / elapsed), (uint32_t)((uint64_t)renders * 60000 / elapsed),
+                  busyMicros / (elapsed * 10.0));
+    
+    wakeups = 0;
+    renders = 0;
+    busyMicros = 0;
+    lastActivityReport = millis();
+}
+
+void DisplayManager::handleGesture(const TouchGesture& gesture) {
+    switch (gesture.kind) {
+        case GESTURE_TAP:
+            handleTouch(gesture.x, gesture.y, gesture.timestamp);
+            break;
+        case GESTURE_SWIPE_LEFT:
+            selectTab((currentTab + 1) % TAB_COUNT);
+            break;
+        case GESTURE_SWIPE_RIGHT:
+            selectTab((currentTab + TAB_COUNT - 1) % TAB_COUNT);
+            break;
+        case GESTURE_LONG_PRESS:
+            // Holding a chart returns it to the live hour
+            if (currentTab == TAB_SENSORS && gesture.y >= LAYOUT_TAB_BAR_HEIGHT && gesture.x >= CHART_X && chartRange != 0) {
+                chartRange = 0;
+                Serial.printf("Chart range: %s\n", CHART_RANGE_NAMES[chartRange]);
+            }
+            break;
+        case GESTURE_DRAG:
+            // Finger up moves the list towards its end
+            if (showingNetworks && NETWORK_LAYOUT[NETWORK_LIST].contains(gesture.x, gesture.y)) {
+                dragRemainder -= gesture.dy;
+                int16_t rows = dragRemainder / LIST_ROW_HEIGHT;
+                dragRemainder -= rows * LIST_ROW_HEIGHT;
+                networkList.scrollBy(rows);
+            }
+            break;
+    }
+}
+
+void DisplayManager::selectTab(uint8_t tab) {
+    if (tab >= TAB_COUNT || tab == currentTab) {
+        return;
+    }
+    
+    if (showingNetworks) {
+        closeNetworks();
+    }
+#ifdef METRICS_ENABLED
+    showingDiagnostics = false;
+#endif
+    currentTab = tab;
+    drawTabs();
+    clearTabContent();
+    drawTabContent();
+}
+
+void DisplayManager::handleTouch(int16_t x, int16_t y, uint32_t timestamp) {
+    // Tab bar area
+    if (y < LAYOUT_TAB_BAR_HEIGHT) {
         int tabWidth = DISPLAY_WIDTH / TAB_COUNT;
-        uint8_t newTab = x / tabWidth;
-        
-        if (newTab < TAB_COUNT && newTab != currentTab) {
-            currentTab = newTab;
-            drawTabs();
-            drawTabContent();
-        }
+        selectTab(x / tabWidth);
         return;
     }
     
     // Tab content area
     switch (currentTab) {
+        case TAB_SENSORS:
+            handleSensorsTabTouch(x, y);
+            break;
         case TAB_MANUAL:
-            handleManualTabTouch(x, y);
+            handleManualTabTouch(x, y, timestamp);
             break;
         case TAB_SETTINGS:
             handleSettingsTabTouch(x, y);
@@ -88,65 +313,110 @@ void DisplayManager::handleTouch(int16_t x, int16_t y) {
     }
 }
 
-void DisplayManager::handleManualTabTouch(int16_t x, int16_t y) {
-    // Manual control buttons (simplified layout)
-    int buttonHeight = 50;
-    int buttonSpacing = 10;
-    int startY = 60;
+void DisplayManager::handleSensorsTabTouch(int16_t x, int16_t y) {
+    // Tapping the charts cycles their time range
+    if (x >= CHART_X) {
+        chartRange = (chartRange + 1) % CHART_RANGE_COUNT;
+        rollupChartEnd = 0;
+        Serial.printf("Chart range: %s\n", CHART_RANGE_NAMES[chartRange]);
+    }
+}
+
+void DisplayManager::handleManualTabTouch(int16_t x, int16_t y, uint32_t timestamp) {
+    int8_t button = MANUAL_LAYOUT.hit(x, y);
+    if (button < 0 || !commands) {
+        return;
+    }
     
-    #ifdef DEVICE_TYPE_ENVIRONMENT
-        // Two buttons: Lights and Spray
-        if (y >= startY && y < startY + buttonHeight) {
-            // Lights button
-            // Send command via external callback (to be connected to UARTManager)
-            Serial.println("Manual command: lights");
-        } else if (y >= startY + buttonHeight + buttonSpacing && y < startY + 2 * buttonHeight + buttonSpacing) {
-            // Spray button
-            Serial.println("Manual command: spray");
-        }
-    #elif DEVICE_TYPE_LIQUID
-        // Six buttons: 5 pumps + pH/EC check
-        int buttonIndex = (y - startY) / (buttonHeight + buttonSpacing);
-        if (buttonIndex >= 0 && buttonIndex < MANUAL_CONTROL_COUNT) {
-            if (buttonIndex < 5) {
-                Serial.printf("Manual command: pump %d\n", buttonIndex + 1);
-            } else {
-                Serial.println("Manual command: probe");
-            }
-        }
-    #endif
+    // The button shows pending until the UART task reports this press
+    uint8_t press = pressTags[button] + 1;
+    if (commands->submit(button, press, timestamp)) {
+        pressTags[button] = press;
+    } else {
+        Serial.println("Manual command dropped: queue full");
+    }
 }
 
 void DisplayManager::handleSettingsTabTouch(int16_t x, int16_t y) {
-    // Settings buttons (simplified - will be expanded later)
-    int buttonHeight = 40;
-    int buttonSpacing = 10;
-    int startY = 60;
+    if (showingNetworks) {
+        if (NETWORK_LAYOUT.hit(x, y) == NETWORK_BACK) {
+            closeNetworks();
+            clearTabContent();
+            return;
+        }
+        int32_t row = networkList.hit(x, y);
+        if (row >= 0) {
+            networkList.select(row);
+            Serial.printf("Settings: selected network %s\n", networkChannel.current().entries[row].ssid);
+        }
+        return;
+    }
     
-    int buttonIndex = (y - startY) / (buttonHeight + buttonSpacing);
+#ifdef METRICS_ENABLED
+    if (showingDiagnostics) {
+        if (DIAGNOSTICS_LAYOUT.hit(x, y) == DIAGNOSTICS_BACK) {
+            showingDiagnostics = false;
+            clearTabContent();
+        }
+        return;
+    }
+#endif
     
-    switch (buttonIndex) {
-        case 0:
+    switch (SETTINGS_LAYOUT.hit(x, y)) {
+        case SETTINGS_WIFI:
             Serial.println("Settings: WiFi setup");
+            openNetworks();
             break;
-        case 1:
+        case SETTINGS_COLOR:
             // Toggle color scheme
-            mainColor = (mainColor == COLOR_GREEN) ? COLOR_YELLOW : COLOR_GREEN;
+            setMainColor((mainColor == COLOR_GREEN) ? COLOR_YELLOW : COLOR_GREEN);
             Serial.printf("Color changed to: %s\n", (mainColor == COLOR_GREEN) ? "Green" : "Yellow");
+            if (storageManager) {
+                storageManager->setMainColor(mainColor);  // Written behind, debounced
+            }
+            drawTabs();
             break;
-        case 2:
+        case SETTINGS_REGISTRATION:
             Serial.println("Settings: Device registration");
             break;
+#ifdef METRICS_ENABLED
+        case SETTINGS_DIAGNOSTICS:
+            openDiagnostics();
+            break;
+#endif
     }
 }
 
+// Rows the two splash lines cover: size 2 and size 1 text, centred
+static const int16_t SPLASH_TEXT_TOP = DISPLAY_HEIGHT / 2 - 20;
+static const int16_t SPLASH_TEXT_BOTTOM = DISPLAY_HEIGHT / 2 + 16;
+
+void DisplayManager::drawSplash() {
+    tft.fillScreen(COLOR_BLACK);
+    splashShown = true;
+    tft.setTextSize(2);
+    tft.setTextColor(COLOR_GREEN, COLOR_BLACK);
+    tft.setTextDatum(MC_DATUM);
+    tft.drawString(DEVICE_NAME, DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2 - 12);
+    tft.setTextSize(1);
+    tft.drawString("BOOTING...", DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2 + 12);
+    tft.setTextDatum(TL_DATUM);
+}
+
 void DisplayManager::drawBackground() {
+    // Coming from the splash the screen is already black but for its text -
+    // a full clear would cost another screen of SPI before the first frame
+    if (splashShown) {
+        tft.fillRect(0, SPLASH_TEXT_TOP, DISPLAY_WIDTH, SPLASH_TEXT_BOTTOM - SPLASH_TEXT_TOP, COLOR_BLACK);
+        splashShown = false;
+        return;
+    }
     tft.fillScreen(COLOR_BLACK);
 }
 
 void DisplayManager::drawTabs() {
     int tabWidth = DISPLAY_WIDTH / TAB_COUNT;
-    int tabHeight = 40;
+    int tabHeight = LAYOUT_TAB_BAR_HEIGHT;
     
     const char* tabNames[] = {"SENSORS", "MANUAL", "SETTINGS"};
     
@@ -160,19 +430,20 @@ void DisplayManager::drawTabs() {
         tft.drawRect(x, 0, tabWidth, tabHeight, mainColor);
         
         // Draw tab text (centered)
-        tft.setTextColor(textColor, bgColor);
-        tft.setTextSize(2);
-        int textWidth = strlen(tabNames[i]) * 12;  // Approximate width
-        int textX = x + (tabWidth - textWidth) / 2;
-        int textY = (tabHeight - 16) / 2;
-        tft.setCursor(textX, textY);
-        tft.print(tabNames[i]);
+        int textX = x + (tabWidth - GlyphCache::textWidth(tabNames[i])) / 2;
+        int textY = (tabHeight - TEXT_CHAR_HEIGHT) / 2;
+        if (glyphs.draw(tft, textX, textY, tabNames[i], textColor, bgColor) < 0) {
+            tft.setTextColor(textColor, bgColor);
+            tft.setTextSize(GLYPH_TEXT_SIZE);
+            tft.setCursor(textX, textY);
+            tft.print(tabNames[i]);
+        }
     }
 }
 
 void DisplayManager::drawTabContent() {
-    // Clear content area (below tabs)
-    tft.fillRect(0, 40, DISPLAY_WIDTH, DISPLAY_HEIGHT - 40, COLOR_BLACK);
+    ui.beginFrame();
+    arena.reset();
     
     switch (currentTab) {
         case TAB_SENSORS:
@@ -182,24 +453,40 @@ void DisplayManager::drawTabContent() {
             drawManualTab();
             break;
         case TAB_SETTINGS:
-            drawSettingsTab();
+            if (showingNetworks) {
+                drawNetworksPage();
+#ifdef METRICS_ENABLED
+            } else if (showingDiagnostics) {
+                drawDiagnosticsPage();
+#endif
+            } else {
+                drawSettingsTab();
+            }
             break;
     }
+    
+    ui.commit(tft);
+    frameCount++;
+}
+
+void DisplayManager::clearTabContent() {
+    // Clear content area (below tabs) and drop the retained widgets
+    ui.clearArea(tft, CONTENT_RECT.x, CONTENT_RECT.y, CONTENT_RECT.w, CONTENT_RECT.h, COLOR_BLACK);
 }
 
 void DisplayManager::drawSensorsTab() {
+    const SensorData& sensorData = sensorChannel.current();
+    const SystemStatus& systemStatus = statusChannel.current();
     int startY = 60;
     int lineHeight = 30;
     
     // Draw title
-    drawTerminalText(10, startY, "SENSOR READINGS:", mainColor);
+    drawTerminalText(10, startY, "SENSOR READINGS:", mainColor, CHART_X - 20);
+    drawTerminalText(CHART_X, startY, CHART_RANGE_NAMES[chartRange], mainColor);
     startY += lineHeight + 10;
     
-    // Check if data is stale
-    unsigned long dataAge = millis() - sensorData.lastUpdate;
-    bool dataStale = (dataAge > UART_TIMEOUT_MS);
-    
-    if (dataStale && sensorData.lastUpdate > 0) {
+    // Check if data is stale (tracked by update())
+    if (dataStale) {
         drawTerminalText(10, startY, "WARNING: DATA STALE", COLOR_RED);
         startY += lineHeight;
     }
@@ -208,118 +495,281 @@ void DisplayManager::drawSensorsTab() {
     const char* sensorNames[] = {SENSOR_1_NAME, SENSOR_2_NAME, SENSOR_3_NAME};
     const char* sensorUnits[] = {SENSOR_1_UNIT, SENSOR_2_UNIT, SENSOR_3_UNIT};
     
+    updateChartSeries();
+    
     for (int i = 0; i < SENSOR_COUNT; i++) {
-        String line = String(sensorNames[i]) + ": ";
-        
         if (sensorData.valid[i] && !dataStale) {
-            line += String(sensorData.values[i], 1) + " " + sensorUnits[i];
-            drawTerminalText(10, startY, line, COLOR_WHITE);
+            const char* line = arena.format("%s: %.1f %s", sensorNames[i], sensorData.values[i], sensorUnits[i]);
+            drawTerminalText(10, startY, line, COLOR_WHITE, CHART_X - 20);
         } else {
-            line += "-- " + String(sensorUnits[i]);
-            drawTerminalText(10, startY, line, COLOR_RED);
+            const char* line = arena.format("%s: -- %s", sensorNames[i], sensorUnits[i]);
+            drawTerminalText(10, startY, line, COLOR_RED, CHART_X - 20);
         }
         
+        ui.chart(CHART_X, startY - (CHART_HEIGHT - TEXT_CHAR_HEIGHT) / 2, CHART_WIDTH, CHART_HEIGHT, chartSeries[i], mainColor);
+        
         startY += lineHeight;
     }
     
-    // Connection status
+    // Connection status - tighter lines so an error fits below a stale warning
+    int statusLineHeight = 24;
     startY += 10;
     drawTerminalText(10, startY, "STATUS:", mainColor);
-    startY += lineHeight;
+    startY += statusLineHeight;
     
-    String mainStatus = "Main Device: ";
-    mainStatus += systemStatus.mainDeviceConnected ? "CONNECTED" : "DISCONNECTED";
+    const char* mainStatus = systemStatus.mainDeviceConnected ? "Main Device: CONNECTED" : "Main Device: DISCONNECTED";
     uint16_t mainStatusColor = systemStatus.mainDeviceConnected ? COLOR_WHITE : COLOR_RED;
     drawTerminalText(20, startY, mainStatus, mainStatusColor);
-    startY += lineHeight;
+    startY += statusLineHeight;
+    
+    // The main device's WiFi as it last reported it, and the display's own
+    // link that telemetry and registration use
+    bool displayWifi = networkChannel.current().connected;
+    const char* mainWifi = systemStatus.wifiConnected ? "Main WiFi: UP" : "Main WiFi: DOWN";
+    drawTerminalText(20, startY, mainWifi, systemStatus.wifiConnected ? COLOR_WHITE : COLOR_RED, 220);
+    const char* ownWifi = displayWifi ? "Display WiFi: UP" : "Display WiFi: DOWN";
+    drawTerminalText(240, startY, ownWifi, displayWifi ? COLOR_WHITE : COLOR_RED);
+    startY += statusLineHeight;
     
-    String wifiStatus = "WiFi: ";
-    wifiStatus += systemStatus.wifiConnected ? "CONNECTED" : "DISCONNECTED";
-    uint16_t wifiStatusColor = systemStatus.wifiConnected ? COLOR_WHITE : COLOR_RED;
-    drawTerminalText(20, startY, wifiStatus, wifiStatusColor);
+    if (systemStatus.lastError[0] != '\0') {
+        drawTerminalText(20, startY, arena.format("Error: %s", systemStatus.lastError), COLOR_RED);
+    }
+}
+
+void DisplayManager::updateChartSeries() {
+    // Chart ends are aligned to a column, so charts only scroll once per column
+    if (chartRange == 0) {
+        uint32_t columnMillis = (uint32_t)HISTORY_CHART_SECONDS * 1000 / CHART_WIDTH;
+        uint32_t chartEnd = (millis() / columnMillis + 1) * columnMillis;
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            history.query(i, HISTORY_CHART_SECONDS, chartEnd, CHART_WIDTH, chartSeries[i]);
+        }
+        return;
+    }
+    
+    // Longer ranges come from the rollups on flash - re-read once per column
+    uint32_t span = CHART_RANGES[chartRange];
+    uint32_t columnSeconds = span / CHART_WIDTH;
+    uint32_t now = time(nullptr);
+    uint32_t chartEnd = now >= LOG_MIN_VALID_TIME ? (now / columnSeconds + 1) * columnSeconds : 1;
+    if (chartEnd == rollupChartEnd) {
+        return;
+    }
+    rollupChartEnd = chartEnd;
+    
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (sensorLog && chartEnd > span) {
+            sensorLog->getRollup().query(i, chartEnd - span, chartEnd, CHART_WIDTH, chartSeries[i]);
+        } else {
+            chartSeries[i].columns = 0;  // No wall-clock time yet
+        }
+    }
 }
 
 void DisplayManager::drawManualTab() {
-    int startY = 60;
-    int buttonHeight = 50;
-    int buttonSpacing = 10;
-    int buttonWidth = DISPLAY_WIDTH - 40;
+    drawTerminalText(LAYOUT_TITLE_X, LAYOUT_TITLE_Y, "MANUAL CONTROLS:", mainColor);
     
-    // Draw title
-    drawTerminalText(10, startY, "MANUAL CONTROLS:", mainColor);
-    startY += 40;
-    
-    #ifdef DEVICE_TYPE_ENVIRONMENT
-        drawButton(20, startY, buttonWidth, buttonHeight, MANUAL_1_NAME);
-        startY += buttonHeight + buttonSpacing;
-        drawButton(20, startY, buttonWidth, buttonHeight, MANUAL_2_NAME);
-    #elif DEVICE_TYPE_LIQUID
-        const char* controlNames[] = {
-            MANUAL_1_NAME, MANUAL_2_NAME, MANUAL_3_NAME,
-            MANUAL_4_NAME, MANUAL_5_NAME, MANUAL_6_NAME
-        };
+    const char* controlNames[] = {
+        MANUAL_1_NAME, MANUAL_2_NAME,
+    #ifdef DEVICE_TYPE_LIQUID
+        MANUAL_3_NAME, MANUAL_4_NAME, MANUAL_5_NAME, MANUAL_6_NAME
+    #endif
+    };
+    
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < MANUAL_LAYOUT.size(); i++) {
+        const LayoutRect& r = MANUAL_LAYOUT[i];
+        CommandState state = buttonState(i, now);
+        shownCommands[i] = state;
         
-        for (int i = 0; i < MANUAL_CONTROL_COUNT; i++) {
-            drawButton(20, startY, buttonWidth, buttonHeight, controlNames[i]);
-            startY += buttonHeight + buttonSpacing;
+        // Acked fills the button; the other states are marked in the label
+        const char* suffix = state == COMMAND_PENDING ? " .." :
+                             state == COMMAND_FAILED ? " FAIL" :
+                             state == COMMAND_UNCONFIRMED ? " SENT" : "";
+        const char* label = arena.format("%s%s", controlNames[i], suffix);
+        drawButton(r.x, r.y, r.w, r.h, label, state == COMMAND_ACKED);
+    }
+}
+
+CommandState DisplayManager::buttonState(uint8_t button, unsigned long now) const {
+    const CommandStatus& status = commandChannel.current().buttons[button];
+    
+    // Pressed here, but the UART task hasn't taken the press yet
+    if (status.press != pressTags[button]) {
+        return COMMAND_PENDING;
+    }
+    
+    // Results are shown for a while, then the button goes back to idle
+    if (status.state != COMMAND_PENDING && now - status.changedAt >= COMMAND_RESULT_SHOW_MS) {
+        return COMMAND_IDLE;
+    }
+    return (CommandState)status.state;
+}
+
+bool DisplayManager::commandResultExpired() const {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < MANUAL_CONTROL_COUNT; i++) {
+        if (buttonState(i, now) != shownCommands[i]) {
+            return true;
         }
-    #endif
+    }
+    return false;
 }
 
 void DisplayManager::drawSettingsTab() {
-    int startY = 60;
-    int buttonHeight = 40;
-    int buttonSpacing = 10;
-    int buttonWidth = DISPLAY_WIDTH - 40;
+    drawTerminalText(LAYOUT_TITLE_X, LAYOUT_TITLE_Y, "SETTINGS:", mainColor);
     
-    drawTerminalText(10, startY, "SETTINGS:", mainColor);
-    startY += 40;
+    const LayoutRect& wifi = SETTINGS_LAYOUT[SETTINGS_WIFI];
+    drawButton(wifi.x, wifi.y, wifi.w, wifi.h, "WiFi Setup");
     
-    drawButton(20, startY, buttonWidth, buttonHeight, "WiFi Setup");
-    startY += buttonHeight + buttonSpacing;
+    const char* colorText = (mainColor == COLOR_GREEN) ? "Color: GREEN" : "Color: YELLOW";
+    const LayoutRect& color = SETTINGS_LAYOUT[SETTINGS_COLOR];
+    drawButton(color.x, color.y, color.w, color.h, colorText);
     
-    String colorText = "Color: ";
-    colorText += (mainColor == COLOR_GREEN) ? "GREEN" : "YELLOW";
-    drawButton(20, startY, buttonWidth, buttonHeight, colorText);
-    startY += buttonHeight + buttonSpacing;
+    const LayoutRect& registration = SETTINGS_LAYOUT[SETTINGS_REGISTRATION];
+    drawButton(registration.x, registration.y, registration.w, registration.h, "Device Registration");
     
-    drawButton(20, startY, buttonWidth, buttonHeight, "Device Registration");
+#ifdef METRICS_ENABLED
+    const LayoutRect& diagnostics = SETTINGS_LAYOUT[SETTINGS_DIAGNOSTICS];
+    drawButton(diagnostics.x, diagnostics.y, diagnostics.w, diagnostics.h, "Diagnostics");
+#endif
 }
 
-void DisplayManager::drawTerminalText(int16_t x, int16_t y, const String& text, uint16_t color) {
-    tft.setTextColor(color, COLOR_BLACK);
-    tft.setTextSize(2);
-    tft.setCursor(x, y);
-    tft.print(text);
+void DisplayManager::openNetworks() {
+    showingNetworks = true;
+    dragRemainder = 0;
+    clearTabContent();
+    
+    // Widgets keep the band above the list; the list draws its own rows
+    const LayoutRect& listArea = NETWORK_LAYOUT[NETWORK_LIST];
+    ui.setArea(CONTENT_RECT.y, listArea.y - CONTENT_RECT.y);
+    networkList.begin(tft, listArea, mainColor, COLOR_BLACK);
+    
+    const NetworkList& networks = networkChannel.current();
+    shownScanId = networks.scanId;
+    networkList.setSource(networks.count, formatNetworkRow, this);
+    
+    if (wifiManager) {
+        wifiManager->requestScan();
+    }
+}
+
+void DisplayManager::closeNetworks() {
+    // Callers clear the content area afterwards
+    networkList.close();
+    ui.setArea(CONTENT_RECT.y, CONTENT_RECT.h);
+    showingNetworks = false;
+}
+
+void DisplayManager::refreshNetworkList() {
+    const NetworkList& networks = networkChannel.current();
+    if (networks.scanId != shownScanId) {
+        shownScanId = networks.scanId;
+        networkList.setSource(networks.count, formatNetworkRow, this);
+    } else {
+        networkList.setCount(networks.count);
+    }
+}
+
+void DisplayManager::drawNetworksPage() {
+    const LayoutRect& back = NETWORK_LAYOUT[NETWORK_BACK];
+    drawButton(back.x, back.y, back.w, back.h, "< BACK");
+    
+    const char* title = arena.format("NETWORKS: %u", networkChannel.current().count);
+    drawTerminalText(back.x + back.w + 20, back.y + (back.h - TEXT_CHAR_HEIGHT) / 2, title, mainColor);
 }
 
-void DisplayManager::drawButton(int16_t x, int16_t y, int16_t w, int16_t h, const String& text, bool pressed) {
-    uint16_t bgColor = pressed ? mainColor : COLOR_BLACK;
-    uint16_t borderColor = mainColor;
-    uint16_t textColor = pressed ? COLOR_BLACK : mainColor;
+#ifdef METRICS_ENABLED
+void DisplayManager::openDiagnostics() {
+    showingDiagnostics = true;
+    clearTabContent();
     
-    // Draw button background and border
-    tft.fillRect(x, y, w, h, bgColor);
-    tft.drawRect(x, y, w, h, borderColor);
+    // Rates start over a short first window
+    metrics.snapshot(diagnosticsTo);
+    diagnosticsFrom = diagnosticsTo;
+    diagnosticsFrom.at -= 1;
+}
+
+void DisplayManager::drawDiagnosticsPage() {
+    const LayoutRect& back = DIAGNOSTICS_LAYOUT[DIAGNOSTICS_BACK];
+    drawButton(back.x, back.y, back.w, back.h, "< BACK");
+    drawTerminalText(back.x + back.w + 20, back.y + (back.h - TEXT_CHAR_HEIGHT) / 2, "DIAGNOSTICS", mainColor);
     
-    // Draw button text (centered)
-    tft.setTextColor(textColor, bgColor);
-    tft.setTextSize(2);
-    int textWidth = text.length() * 12;  // Approximate width
-    int textX = x + (w - textWidth) / 2;
-    int textY = y + (h - 16) / 2;
-    tft.setCursor(textX, textY);
-    tft.print(text);
+    // Latencies since boot, rates and CPU over the last refresh
+    const char* lines[DIAGNOSTICS_LINES];
+    const HdrHistogram& render = metrics.getHistogram(HISTOGRAM_FRAME_RENDER);
+    lines[0] = arena.format("Render ms p50 %.1f p99 %.1f max %.1f",
+                            render.percentile(500) / 1000.0f, render.percentile(990) / 1000.0f, render.max() / 1000.0f);
+    const HdrHistogram& parse = metrics.getHistogram(HISTOGRAM_UART_PARSE);
+    lines[1] = arena.format("Parse us p50 %u p99 %u max %u",
+                            parse.percentile(500), parse.percentile(990), parse.max());
+    lines[2] = arena.format("UART %.1f msg/s, %.1f frames/s",
+                            MetricsRegistry::rate(diagnosticsFrom, diagnosticsTo, COUNTER_UART_MESSAGES),
+                            MetricsRegistry::rate(diagnosticsFrom, diagnosticsTo, COUNTER_FRAMES));
+    for (uint8_t i = 0; i < METRIC_TASK_COUNT; i++) {
+        MetricTask task = (MetricTask)i;
+        if (metrics.getStackSize(task) == 0) {
+            lines[3 + i] = arena.format("%-9s not running", MetricsRegistry::taskName(task));
+            continue;
+        }
+        lines[3 + i] = arena.format("%-9s %5.1f%% CPU %6u B free", MetricsRegistry::taskName(task),
+                                    MetricsRegistry::cpuShare(diagnosticsFrom, diagnosticsTo, task), diagnosticsTo.stackFree[i]);
+    }
+    
+    for (uint8_t i = 0; i < DIAGNOSTICS_LINES; i++) {
+        drawTerminalText(LAYOUT_TITLE_X, DIAGNOSTICS_LINE_TOP + i * DIAGNOSTICS_LINE_HEIGHT, lines[i], mainColor,
+                         DISPLAY_WIDTH - 2 * LAYOUT_TITLE_X);
+    }
+}
+#endif
+
+void DisplayManager::formatNetworkRow(uint16_t index, char* text, size_t size, void* context) {
+    DisplayManager* self = (DisplayManager*)context;
+    const NetworkList& networks = self->networkChannel.current();
+    if (index < networks.count) {
+        snprintf(text, size, "%-24.24s %4d dBm", networks.entries[index].ssid, networks.entries[index].rssi);
+    }
+}
+
+void DisplayManager::drawTerminalText(int16_t x, int16_t y, const char* text, uint16_t color, int16_t w) {
+    ui.text(x, y, text, color, w);
+}
+
+void DisplayManager::drawButton(int16_t x, int16_t y, int16_t w, int16_t h, const char* text, bool pressed) {
+    ui.button(x, y, w, h, text, mainColor, pressed);
 }
 
 void DisplayManager::updateSensorData(const SensorData& data) {
-    sensorData = data;
+    sensorChannel.publish(data);
+    notify(DISPLAY_EVENT_SENSORS);
 }
 
 void DisplayManager::updateSystemStatus(const SystemStatus& status) {
-    systemStatus = status;
+    // Only wake the display when something it shows has changed
+    if (status.mainDeviceConnected == publishedStatus.mainDeviceConnected &&
+        status.wifiConnected == publishedStatus.wifiConnected &&
+        strcmp(status.lastError, publishedStatus.lastError) == 0) {
+        return;
+    }
+    
+    publishedStatus = status;
+    statusChannel.publish(status);
+    notify(DISPLAY_EVENT_STATUS);
+}
+
+void DisplayManager::updateNetworks(const NetworkList& networks) {
+    networkChannel.publish(networks);
+    notify(DISPLAY_EVENT_NETWORKS);
+}
+
+void DisplayManager::updateCommandStates(const CommandStates& states) {
+    commandChannel.publish(states);
+    notify(DISPLAY_EVENT_COMMANDS);
 }
 
 void DisplayManager::setMainColor(uint16_t color) {
+    if (color != mainColor) {
+        glyphs.invalidate();  // Sheets of the old colour pairs won't be drawn again
+    }
     mainColor = color;
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Fixed-capacity string held inline in its owner.
+// Never allocates: text past N - 1 characters is dropped, so a value is
+// always NUL-terminated and a full string is simply truncated. Trivially
+// copyable, so it can go through a SnapshotChannel or a config struct.
+// Used instead of Arduino String for anything built repeatedly - a String
+// grows on the heap with every concatenation and frees on every scope exit.
+template <size_t N>
+class FixedString {
+private:
+    static_assert(N > 1 && N <= 0x10000, "FixedString capacity must be 1..65535 characters");
+
+    char text[N];
+    uint16_t used;
+
+public:
+    FixedString() : used(0) { text[0] = '\0'; }
+    FixedString(const char* value) : used(0) {
+        text[0] = '\0';
+        append(value);
+    }
+
+    const char* c_str() const { return text; }
+    size_t length() const { return used; }
+    bool isEmpty() const { return used == 0; }
+    static constexpr size_t capacity() { return N - 1; }
+    // Capacity used up - further appends are dropped
+    bool isFull() const { return used == N - 1; }
+
+    void clear() {
+        used = 0;
+        text[0] = '\0';
+    }
+
+    FixedString& operator=(const char* value) {
+        clear();
+        return append(value);
+    }
+    FixedString& operator+=(const char* value) { return append(value); }
+    FixedString& operator+=(char c) { return append(c); }
+    template <size_t M>
+    FixedString& operator+=(const FixedString<M>& value) { return append(value.c_str(), value.length()); }
+
+    FixedString& append(const char* value) { return append(value, N - 1); }
+
+    // Reads at most maxLength characters of value - pass the source's size
+    // when it is known, so a short array is never scanned past its end
+    FixedString& append(const char* value, size_t maxLength) {
+        if (!value) {
+            return *this;
+        }
+        size_t room = N - 1 - used;
+        size_t n = strnlen(value, maxLength < room ? maxLength : room);
+        memcpy(text + used, value, n);
+        used += n;
+        text[used] = '\0';
+        return *this;
+    }
+
+    FixedString& append(char c) {
+        if (used < N - 1) {
+            text[used++] = c;
+            text[used] = '\0';
+        }
+        return *this;
+    }
+
+    __attribute__((format(printf, 2, 3)))
+    FixedString& appendf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(text + used, N - used, format, args);
+        va_end(args);
+        if (n > 0) {
+            used = (size_t)n < N - 1 - used ? used + n : N - 1;
+        }
+        text[used] = '\0';
+        return *this;
+    }
+
+    bool operator==(const char* value) const { return strcmp(text, value ? value : "") == 0; }
+    bool operator!=(const char* value) const { return !(*this == value); }
+};
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,50 @@
+#include "FrameArena.h"
+#include <stdarg.h>
+
+FrameArena::FrameArena() : used(0), peak(0), overflows(0) {}
+
+void FrameArena::reset() {
+    used = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t align) {
+    size_t start = (used + align - 1) & ~(align - 1);
+    if (start + size > FRAME_ARENA_SIZE) {
+        overflows++;
+        return nullptr;
+    }
+    used = start + size;
+    if (used > peak) {
+        peak = used;
+    }
+    return buffer + start;
+}
+
+const char* FrameArena::format(const char* fmt, ...) {
+    size_t space = FRAME_ARENA_SIZE - used;
+    if (space == 0) {
+        overflows++;
+        return "";
+    }
+
+    char* text = (char*)buffer + used;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(text, space, fmt, args);
+    va_end(args);
+
+    if (n < 0) {
+        text[0] = '\0';
+        n = 0;
+    } else if ((size_t)n >= space) {
+        // Kept what fitted
+        overflows++;
+        n = space - 1;
+    }
+
+    used += n + 1;
+    if (used > peak) {
+        peak = used;
+    }
+    return text;
+}
@@ -0,0 +1,39 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+
+// Per-frame bump allocator for UI text.
+// Lines built while a frame is drawn are carved from a fixed block and all
+// released together by reset() at the start of the next frame, so
+// formatting a line costs a pointer bump and the heap never sees it.
+// Arena text only lives until that reset - widgets copy what they keep.
+// A full arena truncates instead of failing; getOverflows() counts it.
+// Owned and used by the display task only.
+class FrameArena {
+private:
+    uint8_t buffer[FRAME_ARENA_SIZE];
+    size_t used;
+    size_t peak;                   // Largest frame since boot, bytes
+    uint32_t overflows;
+
+public:
+    FrameArena();
+
+    // Frees everything handed out since the last reset
+    void reset();
+
+    // Uninitialised memory, nullptr when the arena is full
+    void* allocate(size_t size, size_t align = sizeof(void*));
+
+    // printf into the arena; never null, truncated when the arena runs out
+    __attribute__((format(printf, 2, 3)))
+    const char* format(const char* fmt, ...);
+
+    size_t getUsed() const { return used; }
+    size_t getPeak() const { return peak; }
+    uint32_t getOverflows() const { return overflows; }
+};
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,187 @@
+#include "GlyphCache.h"
+#include <soc/soc_memory_layout.h>
+
+// Font code of each glyph - the GLCD font is code page 437
+static uint8_t glyphCode(uint8_t glyph) {
+    if (glyph < 95) {
+        return ' ' + glyph;
+    }
+    return glyph == 95 ? 0xF8 : 0xE6;  // Degree, micro
+}
+
+static uint8_t glyphOf(uint32_t codePoint) {
+    if (codePoint >= ' ' && codePoint <= '~') {
+        return codePoint - ' ';
+    }
+    if (codePoint == 0xB0) {
+        return 95;
+    }
+    if (codePoint == 0xB5) {
+        return 96;
+    }
+    return '?' - ' ';
+}
+
+GlyphCache::GlyphCache() : tft(nullptr), useClock(0), renders(0), internalSheets(0) {
+    for (uint8_t i = 0; i < GLYPH_CACHE_SHEETS; i++) {
+        sheets[i].tiles = nullptr;
+        sheets[i].valid = false;
+    }
+}
+
+void GlyphCache::begin(TFT_eSPI& panel) {
+    tft = &panel;
+}
+
+void GlyphCache::invalidate() {
+    // Allocations are kept for the next pairs
+    for (uint8_t i = 0; i < GLYPH_CACHE_SHEETS; i++) {
+        sheets[i].valid = false;
+    }
+}
+
+uint8_t GlyphCache::decode(const char* text, uint8_t* glyphs, uint8_t maxGlyphs) {
+    const uint8_t* s = (const uint8_t*)text;
+    uint8_t count = 0;
+
+    while (*s && count < maxGlyphs) {
+        uint32_t codePoint = *s++;
+        if (codePoint >= 0xC0 && codePoint < 0xE0 && (*s & 0xC0) == 0x80) {
+            codePoint = ((codePoint & 0x1F) << 6) | (*s++ & 0x3F);
+        } else if (codePoint >= 0x80) {
+            // Longer sequences and stray continuation bytes: one '?'
+            while ((*s & 0xC0) == 0x80) {
+                s++;
+            }
+            codePoint = '?';
+        }
+        glyphs[count++] = glyphOf(codePoint);
+    }
+    return count;
+}
+
+int16_t GlyphCache::textWidth(const char* text) {
+    uint8_t glyphs[GLYPH_RUN_MAX];
+    return decode(text, glyphs, GLYPH_RUN_MAX) * GLYPH_WIDTH;
+}
+
+const uint16_t* GlyphCache::sheetFor(uint16_t fgColor, uint16_t bgColor) {
+    useClock++;
+
+    // Unallocated slots only count while internal RAM has room for another sheet
+    bool canAllocate = internalSheets < GLYPH_CACHE_INTERNAL_SHEETS;
+    Sheet* victim = nullptr;
+    for (uint8_t i = 0; i < GLYPH_CACHE_SHEETS; i++) {
+        Sheet& sheet = sheets[i];
+        if (sheet.valid && sheet.fgColor == fgColor && sheet.bgColor == bgColor) {
+            sheet.lastUse = useClock;
+            return (const uint16_t*)sheet.tiles->getPointer();
+        }
+        if (!sheet.tiles && !canAllocate) {
+            continue;
+        }
+        // Prefer an empty sheet, then the least recently used
+        if (!victim) {
+            victim = &sheet;
+        } else if (!sheet.valid) {
+            if (victim->valid) {
+                victim = &sheet;
+            }
+        } else if (victim->valid && sheet.lastUse < victim->lastUse) {
+            victim = &sheet;
+        }
+    }
+
+    if (!tft || !victim) {
+        return nullptr;
+    }
+    if (!victim->tiles) {
+        victim->tiles = new TFT_eSprite(tft);
+        victim->tiles->setColorDepth(16);
+        victim->tiles->setAttribute(PSRAM_ENABLE, 1);
+        if (victim->tiles->createSprite(GLYPH_WIDTH, GLYPH_HEIGHT * GLYPH_COUNT) == nullptr) {
+            Serial.println("GlyphCache: sheet allocation failed, drawing text directly");
+            delete victim->tiles;
+            victim->tiles = nullptr;
+            return nullptr;
+        }
+        
+        // No PSRAM, or the panel's DMA is on - TFT_eSPI then allocates internally
+        if (esp_ptr_dma_capable(victim->tiles->getPointer()) &&
+            ++internalSheets == GLYPH_CACHE_INTERNAL_SHEETS) {
+            Serial.printf("GlyphCache: sheets in internal RAM, keeping %u (%u KB)\n", internalSheets,
+                          (unsigned)internalSheets * GLYPH_WIDTH * GLYPH_HEIGHT * GLYPH_COUNT * 2 / 1024);
+        }
+    }
+
+    // One tile per glyph, stacked, so each tile is contiguous
+    TFT_eSprite& tiles = *victim->tiles;
+    tiles.cp437(true);
+    for (uint8_t glyph = 0; glyph < GLYPH_COUNT; glyph++) {
+        tiles.drawChar(0, glyph * GLYPH_HEIGHT, glyphCode(glyph), fgColor, bgColor, GLYPH_TEXT_SIZE);
+    }
+    victim->fgColor = fgColor;
+    victim->bgColor = bgColor;
+    victim->lastUse = useClock;
+    victim->valid = true;
+    renders++;
+    return (const uint16_t*)tiles.getPointer();
+}
+
+void GlyphCache::copyRow(uint16_t* out, const uint16_t* tiles, const uint8_t* glyphs, uint8_t count, uint8_t y) const {
+    for (uint8_t i = 0; i < count; i++) {
+        memcpy(out + i * GLYPH_WIDTH, tiles + ((uint32_t)glyphs[i] * GLYPH_HEIGHT + y) * GLYPH_WIDTH,
+               GLYPH_WIDTH * sizeof(uint16_t));
+    }
+}
+
+int16_t GlyphCache::draw(TFT_eSPI& panel, int16_t x, int16_t y, const char* text, uint16_t fgColor, uint16_t bgColor) {
+    uint8_t glyphs[GLYPH_RUN_MAX];
+    uint8_t count = decode(text, glyphs, max(0, (DISPLAY_WIDTH - x) / GLYPH_WIDTH));
+    if (count == 0) {
+        return 0;
+    }
+    const uint16_t* tiles = sheetFor(fgColor, bgColor);
+    if (!tiles) {
+        return -1;
+    }
+
+    // Tiles are in panel byte order already
+    int16_t width = count * GLYPH_WIDTH;
+    bool swapBytes = panel.getSwapBytes();
+    panel.setSwapBytes(false);
+    panel.startWrite();
+    panel.setAddrWindow(x, y, width, GLYPH_HEIGHT);
+    for (uint8_t line = 0; line < GLYPH_HEIGHT; line++) {
+        copyRow(row, tiles, glyphs, count, line);
+        panel.pushPixels(row, width);
+    }
+    panel.endWrite();
+    panel.setSwapBytes(swapBytes);
+    return width;
+}
+
+int16_t GlyphCache::draw(TFT_eSprite& strip, int16_t x, int16_t y, const char* text, uint16_t fgColor, uint16_t bgColor) {
+    uint8_t glyphs[GLYPH_RUN_MAX];
+    uint8_t count = decode(text, glyphs, max(0, (strip.width() - x) / GLYPH_WIDTH));
+    if (count == 0) {
+        return 0;
+    }
+    const uint16_t* tiles = sheetFor(fgColor, bgColor);
+    if (!tiles) {
+        return -1;
+    }
+
+    // Sprite memory has the same layout as the tiles; rows outside the
+    // strip belong to its neighbours
+    uint16_t* pixels = (uint16_t*)strip.getPointer();
+    int16_t stride = strip.width();
+    for (uint8_t line = 0; line < GLYPH_HEIGHT; line++) {
+        int16_t py = y + line;
+        if (py < 0 || py >= strip.height()) {
+            continue;
+        }
+        copyRow(pixels + (int32_t)py * stride + x, tiles, glyphs, count, line);
+    }
+    return count * GLYPH_WIDTH;
+}
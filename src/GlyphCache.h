@@ -0,0 +1,67 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <TFT_eSPI.h>
+#include "DeviceConfig.h"
+
+// Terminal font: TFT_eSPI's GLCD font at text size 2
+#define GLYPH_TEXT_SIZE 2
+#define GLYPH_WIDTH (6 * GLYPH_TEXT_SIZE)
+#define GLYPH_HEIGHT (8 * GLYPH_TEXT_SIZE)
+#define GLYPH_COUNT 97                     // ASCII 32..126, degree, micro
+#define GLYPH_RUN_MAX (DISPLAY_WIDTH / GLYPH_WIDTH)
+
+// Pre-rendered glyph sheets, one per foreground/background pair.
+// A sheet is every glyph as a GLYPH_WIDTH x GLYPH_HEIGHT RGB565 tile in
+// panel byte order (37 KB), rendered by TFT_eSPI once when the pair is
+// first drawn. Sheets go to PSRAM when there is some; in internal RAM only
+// GLYPH_CACHE_INTERNAL_SHEETS are allocated and further pairs take the
+// least recently used sheet over. A text run is then copied row by row from the tiles:
+// into a strip's memory, or through a single address window on the panel,
+// where the GLCD font would open one window per font pixel.
+//
+// Text is UTF-8; widths are exact and count code points, not bytes.
+// Only the display task draws, so there is no locking.
+class GlyphCache {
+private:
+    struct Sheet {
+        TFT_eSprite* tiles;
+        uint16_t fgColor;
+        uint16_t bgColor;
+        uint32_t lastUse;
+        bool valid;
+    };
+
+    TFT_eSPI* tft;
+    Sheet sheets[GLYPH_CACHE_SHEETS];
+    uint32_t useClock;
+    uint32_t renders;              // Sheets rendered since boot
+    uint8_t internalSheets;        // Allocated sheets that landed in internal RAM
+    uint16_t row[GLYPH_RUN_MAX * GLYPH_WIDTH];
+
+    const uint16_t* sheetFor(uint16_t fgColor, uint16_t bgColor);
+    void copyRow(uint16_t* out, const uint16_t* tiles, const uint8_t* glyphs, uint8_t count, uint8_t y) const;
+
+public:
+    GlyphCache();
+
+    // After tft.init(); sheets are allocated on first use
+    void begin(TFT_eSPI& panel);
+    // Drops every sheet, e.g. after the main colour changed
+    void invalidate();
+
+    // Glyph indices of a UTF-8 string; unknown characters become '?'
+    static uint8_t decode(const char* text, uint8_t* glyphs, uint8_t maxGlyphs);
+    static int16_t textWidth(const char* text);
+
+    // Opaque text at x, y (top left), clipped to the right edge.
+    // Returns the width drawn, or -1 if no sheet could be allocated, in
+    // which case the caller draws the text itself
+    int16_t draw(TFT_eSPI& panel, int16_t x, int16_t y, const char* text, uint16_t fgColor, uint16_t bgColor);
+    int16_t draw(TFT_eSprite& strip, int16_t x, int16_t y, const char* text, uint16_t fgColor, uint16_t bgColor);
+
+    uint32_t getRenders() const { return renders; }
+    uint8_t getInternalSheets() const { return internalSheets; }
+};
+
+#endif // GLYPH_CACHE_H
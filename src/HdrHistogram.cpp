@@ -0,0 +1,69 @@
+#include "HdrHistogram.h"
+
+uint16_t HdrHistogram::bucketOf(uint32_t value) {
+    if (value < HDR_SUB_BUCKETS) {
+        return value;
+    }
+
+    uint8_t exponent = 31 - __builtin_clz(value);
+    if (exponent > HDR_MAX_EXPONENT) {
+        return HDR_BUCKETS - 1;
+    }
+
+    // Top HDR_SUB_BUCKET_BITS bits below the leading one pick the sub-bucket
+    uint8_t shift = exponent - HDR_SUB_BUCKET_BITS;
+    uint16_t sub = (value >> shift) - HDR_SUB_BUCKETS;
+    return HDR_SUB_BUCKETS * (shift + 1) + sub;
+}
+
+uint32_t HdrHistogram::bucketLimit(uint16_t bucket) {
+    if (bucket < HDR_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    uint8_t shift = bucket / HDR_SUB_BUCKETS - 1;
+    uint32_t sub = bucket % HDR_SUB_BUCKETS;
+    return ((HDR_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void HdrHistogram::record(uint32_t value) {
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t seen = maximum.load(std::memory_order_relaxed);
+    while (value > seen && !maximum.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void HdrHistogram::reset() {
+    for (uint16_t i = 0; i < HDR_BUCKETS; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+uint32_t HdrHistogram::percentile(uint16_t permille) const {
+    uint32_t records = count();
+    if (records == 0) {
+        return 0;
+    }
+
+    // Rank of the value, rounded up - the median of two values is the first
+    uint32_t rank = ((uint64_t)records * permille + 999) / 1000;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < HDR_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The maximum is exact; nothing recorded lies above it, and
+            // the last bucket also holds everything out of range
+            uint32_t limit = bucketLimit(i);
+            return limit < max() && i < HDR_BUCKETS - 1 ? limit : max();
+        }
+    }
+    return max();
+}
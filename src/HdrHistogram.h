@@ -0,0 +1,44 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Log-linear buckets: values below 2^HDR_SUB_BUCKET_BITS are counted
+// exactly, every power of two above that is split into 2^HDR_SUB_BUCKET_BITS
+// linear buckets, so a reported value is within 12.5% of the recorded one.
+// Values from 2^(HDR_MAX_EXPONENT + 1) land in the last bucket.
+#define HDR_SUB_BUCKET_BITS 3
+#define HDR_SUB_BUCKETS (1 << HDR_SUB_BUCKET_BITS)
+#define HDR_MAX_EXPONENT 26                 // 134 s in microseconds
+#define HDR_BUCKETS (HDR_SUB_BUCKETS * (HDR_MAX_EXPONENT - HDR_SUB_BUCKET_BITS + 2))
+
+// HDR-style histogram of uint32 values (microseconds by convention).
+// record() is one relaxed atomic add per bucket and count plus a CAS loop
+// for the maximum, so any task may record without a lock; readers see
+// counts that are at most a few records apart.
+class HdrHistogram {
+private:
+    std::atomic<uint32_t> buckets[HDR_BUCKETS];
+    std::atomic<uint32_t> total;
+    std::atomic<uint32_t> maximum;
+
+public:
+    HdrHistogram() { reset(); }
+
+    static uint16_t bucketOf(uint32_t value);
+    // Largest value that falls into the bucket
+    static uint32_t bucketLimit(uint16_t bucket);
+
+    void record(uint32_t value);
+    // Not atomic with concurrent records - call from the only recorder, or
+    // accept that a record in flight may survive the reset
+    void reset();
+
+    uint32_t count() const { return total.load(std::memory_order_relaxed); }
+    uint32_t max() const { return maximum.load(std::memory_order_relaxed); }
+    // Value at the given rank in per mille (500 = median, 999 = p99.9)
+    uint32_t percentile(uint16_t permille) const;
+};
+
+#endif // HDR_HISTOGRAM_H
@@ -0,0 +1,81 @@
+#include "HeapMonitor.h"
+
+HeapMonitor::HeapMonitor()
+    : head(0), count(0), lowestLargest(UINT32_MAX), lastSample(0), intervalStart(0) {
+    current = {0, UINT32_MAX, UINT32_MAX};
+}
+
+void HeapMonitor::update(unsigned long now) {
+    if (lastSample != 0 && now - lastSample < HEAP_SAMPLE_INTERVAL_MS) {
+        return;
+    }
+    lastSample = now;
+
+    // Internal RAM - small allocations never go to PSRAM, so this is the
+    // heap that String churn fragments
+    uint32_t freeBytes = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    current.freeBytes = min(current.freeBytes, freeBytes);
+    current.largestBlock = min(current.largestBlock, largest);
+    lowestLargest = min(lowestLargest, largest);
+
+    if (now - intervalStart >= HEAP_HISTORY_INTERVAL_MS) {
+        closeInterval(now);
+    }
+}
+
+void HeapMonitor::closeInterval(unsigned long now) {
+    current.minutes = now / 60000;
+    history[head] = current;
+    head = (head + 1) % HEAP_HISTORY_SIZE;
+    if (count < HEAP_HISTORY_SIZE) {
+        count++;
+    }
+
+    const char* trend = count < HEAP_STEADY_MIN_POINTS ? "settling" : isSteady() ? "steady" : "shrinking";
+    Serial.printf("Heap: %u B free, largest block %u B (%u%% fragmented), lowest block %u B, %s\n",
+                  current.freeBytes, current.largestBlock, fragmentation(current), lowestLargest, trend);
+
+    current = {0, UINT32_MAX, UINT32_MAX};
+    intervalStart = now;
+}
+
+const HeapPoint& HeapMonitor::point(uint8_t age) const {
+    return history[(head + HEAP_HISTORY_SIZE - 1 - age) % HEAP_HISTORY_SIZE];
+}
+
+uint8_t HeapMonitor::fragmentation(const HeapPoint& p) {
+    if (p.freeBytes == 0 || p.largestBlock >= p.freeBytes) {
+        return 0;
+    }
+    return 100 - (uint64_t)p.largestBlock * 100 / p.freeBytes;
+}
+
+bool HeapMonitor::isSteady() const {
+    if (count < HEAP_STEADY_MIN_POINTS) {
+        return false;
+    }
+
+    // Worst largest block of each half of the history
+    uint8_t half = count / 2;
+    uint32_t newer = UINT32_MAX;
+    uint32_t older = UINT32_MAX;
+    for (uint8_t age = 0; age < count; age++) {
+        uint32_t largest = point(age).largestBlock;
+        if (age < half) {
+            newer = min(newer, largest);
+        } else {
+            older = min(older, largest);
+        }
+    }
+    return newer + HEAP_STEADY_TOLERANCE >= older;
+}
+
+void HeapMonitor::dump(Print& out) const {
+    for (uint8_t age = count; age > 0; age--) {
+        const HeapPoint& p = point(age - 1);
+        out.printf("%5u min: %6u B free, largest %6u B, %2u%% fragmented\n",
+                   p.minutes, p.freeBytes, p.largestBlock, fragmentation(p));
+    }
+    out.printf("Lowest block %u B, %s\n", lowestLargest, isSteady() ? "steady" : "not steady");
+}
@@ -0,0 +1,59 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+
+// One history point - the worst values seen over its interval
+struct HeapPoint {
+    uint32_t minutes;              // Uptime at the end of the interval
+    uint32_t freeBytes;            // Lowest free internal heap
+    uint32_t largestBlock;         // Smallest "largest free block"
+};
+
+// Internal heap fragmentation over time.
+// Free bytes alone hide fragmentation: a heap churned by short-lived
+// allocations of mixed sizes can keep plenty free while the largest free
+// block - the biggest allocation that can still succeed - shrinks. The
+// monitor samples both every HEAP_SAMPLE_INTERVAL_MS and keeps the worst of
+// each HEAP_HISTORY_INTERVAL_MS as a history point; HEAP_HISTORY_SIZE
+// points cover 24 hours.
+//
+// The heap counts as steady once the largest block in the newer half of
+// the history has not dropped below the older half by more than
+// HEAP_STEADY_TOLERANCE - a leak or ongoing fragmentation keeps it falling.
+// Sampled from the Arduino loop; the walk over the heap takes the heap lock
+// briefly, which is why it isn't done per frame.
+class HeapMonitor {
+private:
+    HeapPoint history[HEAP_HISTORY_SIZE];
+    uint8_t head;                  // Next point to write
+    uint8_t count;
+    HeapPoint current;             // Interval in progress
+    uint32_t lowestLargest;        // Since boot
+    unsigned long lastSample;
+    unsigned long intervalStart;
+
+    const HeapPoint& point(uint8_t age) const;   // 0 = newest
+    void closeInterval(unsigned long now);
+
+public:
+    HeapMonitor();
+
+    // Call periodically; samples when HEAP_SAMPLE_INTERVAL_MS has passed and
+    // reports each closed history point on Serial
+    void update(unsigned long now);
+
+    // 100 - largest block as a share of free heap, 0 = unfragmented
+    static uint8_t fragmentation(const HeapPoint& p);
+
+    uint8_t getCount() const { return count; }
+    uint32_t getLowestLargest() const { return lowestLargest; }
+    // Needs HEAP_STEADY_MIN_POINTS points before it can say so
+    bool isSteady() const;
+
+    // One line per history point, oldest first
+    void dump(Print& out) const;
+};
+
+#endif // HEAP_MONITOR_H
@@ -0,0 +1,184 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+#include "DeviceConfig.h"
+#include "Metrics.h"
+
+// Compile-time screen layout.
+// Every tab's touch targets are one table of rectangles computed from the
+// device profile; the draw functions and hit-testing both read that table,
+// so geometry can't drift apart. Each table also gets a bucket map - one
+// byte per HIT_CELL x HIT_CELL screen cell holding the index of the widget
+// in it - so a touch is resolved with one lookup and one rectangle check.
+// Layouts that leave the screen, overlap, or put two widgets in one bucket
+// are rejected by static_assert.
+
+#define LAYOUT_TAB_BAR_HEIGHT 40
+#define LAYOUT_TITLE_X 10
+#define LAYOUT_TITLE_Y 60
+#define LAYOUT_MARGIN 20              // Left/right and bottom margin of button areas
+#define LAYOUT_BUTTON_TOP 100         // Below the tab title
+#define LAYOUT_BUTTON_SPACING 10
+
+// Bucket size - spacing between widgets must be at least this, so a bucket
+// never touches two widgets
+#define HIT_CELL 8
+#define HIT_COLUMNS (DISPLAY_WIDTH / HIT_CELL)
+#define HIT_ROWS (DISPLAY_HEIGHT / HIT_CELL)
+#define HIT_NONE 0xFF
+
+struct LayoutRect {
+    int16_t x, y, w, h;
+
+    constexpr bool contains(int16_t px, int16_t py) const {
+        return px >= x && px < x + w && py >= y && py < y + h;
+    }
+    constexpr bool overlaps(const LayoutRect& o) const {
+        return x < o.x + o.w && o.x < x + w && y < o.y + o.h && o.y < y + h;
+    }
+    constexpr bool inside(const LayoutRect& o) const {
+        return x >= o.x && y >= o.y && x + w <= o.x + o.w && y + h <= o.y + o.h;
+    }
+};
+
+constexpr LayoutRect CONTENT_RECT = {0, LAYOUT_TAB_BAR_HEIGHT, DISPLAY_WIDTH, DISPLAY_HEIGHT - LAYOUT_TAB_BAR_HEIGHT};
+constexpr LayoutRect BUTTON_AREA = {LAYOUT_MARGIN, LAYOUT_BUTTON_TOP, DISPLAY_WIDTH - 2 * LAYOUT_MARGIN,
+                                    DISPLAY_HEIGHT - LAYOUT_BUTTON_TOP - LAYOUT_MARGIN};
+static_assert(BUTTON_AREA.inside(CONTENT_RECT), "Button area leaves the content area");
+
+template <uint8_t N>
+struct LayoutTable {
+    LayoutRect rects[N];
+    uint8_t cells[HIT_ROWS][HIT_COLUMNS];
+
+    static constexpr uint8_t size() { return N; }
+    constexpr const LayoutRect& operator[](uint8_t i) const { return rects[i]; }
+
+    // Index of the widget under the point, or -1
+    int8_t hit(int16_t px, int16_t py) const {
+        if (px < 0 || py < 0 || px >= DISPLAY_WIDTH || py >= DISPLAY_HEIGHT) {
+            return -1;
+        }
+        uint8_t index = cells[py / HIT_CELL][px / HIT_CELL];
+        return index != HIT_NONE && rects[index].contains(px, py) ? index : -1;
+    }
+};
+
+// Cell `index` of `count` buttons laid out in `columns` columns, filling
+// `area` top-down; rows are as tall as the area allows, up to maxHeight
+constexpr LayoutRect gridCell(const LayoutRect& area, uint8_t count, uint8_t columns, int16_t maxHeight, uint8_t index) {
+    uint8_t rows = (count + columns - 1) / columns;
+    int16_t width = (area.w - (columns - 1) * LAYOUT_BUTTON_SPACING) / columns;
+    int16_t fitHeight = (area.h - (rows - 1) * LAYOUT_BUTTON_SPACING) / rows;
+    int16_t height = fitHeight < maxHeight ? fitHeight : maxHeight;
+    return {(int16_t)(area.x + (index % columns) * (width + LAYOUT_BUTTON_SPACING)),
+            (int16_t)(area.y + (index / columns) * (height + LAYOUT_BUTTON_SPACING)), width, height};
+}
+
+template <uint8_t N>
+constexpr LayoutTable<N> makeTable(const LayoutRect (&rects)[N]) {
+    LayoutTable<N> table = {};
+    for (uint8_t i = 0; i < N; i++) {
+        table.rects[i] = rects[i];
+    }
+    for (int16_t row = 0; row < HIT_ROWS; row++) {
+        for (int16_t col = 0; col < HIT_COLUMNS; col++) {
+            LayoutRect cell = {(int16_t)(col * HIT_CELL), (int16_t)(row * HIT_CELL), HIT_CELL, HIT_CELL};
+            table.cells[row][col] = HIT_NONE;
+            for (uint8_t i = 0; i < N; i++) {
+                if (cell.overlaps(rects[i])) {
+                    table.cells[row][col] = i;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+template <uint8_t N>
+constexpr LayoutTable<N> makeGrid(const LayoutRect& area, uint8_t columns, int16_t maxHeight) {
+    LayoutRect rects[N] = {};
+    for (uint8_t i = 0; i < N; i++) {
+        rects[i] = gridCell(area, N, columns, maxHeight, i);
+    }
+    return makeTable(rects);
+}
+
+// Every widget inside `bounds`, non-empty, and no bucket shared by two widgets
+template <uint8_t N>
+constexpr bool layoutFits(const LayoutTable<N>& table, const LayoutRect& bounds) {
+    for (uint8_t i = 0; i < N; i++) {
+        const LayoutRect& a = table.rects[i];
+        if (a.w <= 0 || a.h <= 0 || !a.inside(bounds)) {
+            return false;
+        }
+        for (uint8_t j = i + 1; j < N; j++) {
+            const LayoutRect& b = table.rects[j];
+            LayoutRect grown = {(int16_t)(a.x - HIT_CELL + 1), (int16_t)(a.y - HIT_CELL + 1),
+                                (int16_t)(a.w + 2 * (HIT_CELL - 1)), (int16_t)(a.h + 2 * (HIT_CELL - 1))};
+            if (grown.overlaps(b)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Manual tab - one column while the buttons fit at full height, else two
+#define MANUAL_BUTTON_HEIGHT 50
+#define MANUAL_COLUMNS ((MANUAL_CONTROL_COUNT * (MANUAL_BUTTON_HEIGHT + LAYOUT_BUTTON_SPACING) - LAYOUT_BUTTON_SPACING) \
+                        <= DISPLAY_HEIGHT - LAYOUT_BUTTON_TOP - LAYOUT_MARGIN ? 1 : 2)
+inline constexpr LayoutTable<MANUAL_CONTROL_COUNT> MANUAL_LAYOUT =
+    makeGrid<MANUAL_CONTROL_COUNT>(BUTTON_AREA, MANUAL_COLUMNS, MANUAL_BUTTON_HEIGHT);
+static_assert(layoutFits(MANUAL_LAYOUT, BUTTON_AREA), "Manual controls do not fit the screen");
+
+// Settings tab
+enum SettingsWidget : uint8_t {
+    SETTINGS_WIFI,
+    SETTINGS_COLOR,
+    SETTINGS_REGISTRATION,
+#ifdef METRICS_ENABLED
+    SETTINGS_DIAGNOSTICS,
+#endif
+    SETTINGS_WIDGET_COUNT
+};
+#define SETTINGS_BUTTON_HEIGHT 40
+inline constexpr LayoutTable<SETTINGS_WIDGET_COUNT> SETTINGS_LAYOUT =
+    makeGrid<SETTINGS_WIDGET_COUNT>(BUTTON_AREA, 1, SETTINGS_BUTTON_HEIGHT);
+static_assert(layoutFits(SETTINGS_LAYOUT, BUTTON_AREA), "Settings buttons do not fit the screen");
+
+// WiFi network list, opened from the settings tab
+#define LIST_ROW_HEIGHT 24
+#define NETWORK_LIST_ROWS 8
+enum NetworkWidget : uint8_t {
+    NETWORK_BACK,
+    NETWORK_LIST,
+    NETWORK_WIDGET_COUNT
+};
+inline constexpr LayoutRect NETWORK_RECTS[NETWORK_WIDGET_COUNT] = {
+    {LAYOUT_MARGIN, LAYOUT_TAB_BAR_HEIGHT + LAYOUT_BUTTON_SPACING, 100, 36},
+    {LAYOUT_MARGIN, LAYOUT_TAB_BAR_HEIGHT + 56, DISPLAY_WIDTH - 2 * LAYOUT_MARGIN, NETWORK_LIST_ROWS * LIST_ROW_HEIGHT}
+};
+inline constexpr LayoutTable<NETWORK_WIDGET_COUNT> NETWORK_LAYOUT = makeTable(NETWORK_RECTS);
+static_assert(layoutFits(NETWORK_LAYOUT, CONTENT_RECT), "Network list does not fit the screen");
+
+#ifdef METRICS_ENABLED
+// Diagnostics page, opened from the settings tab - a back button above
+// lines of text
+#define DIAGNOSTICS_LINE_TOP (LAYOUT_TAB_BAR_HEIGHT + 56)
+#define DIAGNOSTICS_LINE_HEIGHT 20
+#define DIAGNOSTICS_LINES (3 + METRIC_TASK_COUNT)
+enum DiagnosticsWidget : uint8_t {
+    DIAGNOSTICS_BACK,
+    DIAGNOSTICS_WIDGET_COUNT
+};
+inline constexpr LayoutRect DIAGNOSTICS_RECTS[DIAGNOSTICS_WIDGET_COUNT] = {
+    NETWORK_RECTS[NETWORK_BACK]
+};
+inline constexpr LayoutTable<DIAGNOSTICS_WIDGET_COUNT> DIAGNOSTICS_LAYOUT = makeTable(DIAGNOSTICS_RECTS);
+static_assert(DIAGNOSTICS_LINE_TOP + DIAGNOSTICS_LINES * DIAGNOSTICS_LINE_HEIGHT <= DISPLAY_HEIGHT,
+              "Diagnostics lines do not fit the screen");
+#endif
+
+#endif // LAYOUT_H
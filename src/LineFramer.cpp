@@ -0,0 +1,84 @@
+#include "LineFramer.h"
+
+LineFramer::LineFramer(char delimiter, bool trim) : delimiter(delimiter), trimLines(trim) {
+    memset(&stats, 0, sizeof(stats));
+    reset();
+}
+
+void LineFramer::reset() {
+    fill = 0;
+    lineStart = 0;
+    scanPos = 0;
+    discarding = false;
+}
+
+uint8_t* LineFramer::writePtr(size_t& space) {
+    // Move the partial line to the front to make room behind it
+    if (lineStart > 0) {
+        memmove(buffer, buffer + lineStart, fill - lineStart);
+        fill -= lineStart;
+        scanPos -= lineStart;
+        lineStart = 0;
+    }
+
+    // A full buffer without a delimiter cannot become a valid line
+    if (fill == UART_LINE_BUFFER_SIZE) {
+        stats.overflows++;
+        discarding = true;
+        fill = 0;
+        scanPos = 0;
+    }
+
+    space = UART_LINE_BUFFER_SIZE - fill;
+    return (uint8_t*)buffer + fill;
+}
+
+void LineFramer::commit(size_t length) {
+    fill += length;
+    stats.bytesReceived += length;
+}
+
+bool LineFramer::nextLine(char*& line, size_t& length) {
+    while (scanPos < fill) {
+        char* end = (char*)memchr(buffer + scanPos, delimiter, fill - scanPos);
+        if (end == nullptr) {
+            scanPos = fill;
+            return false;
+        }
+
+        size_t pos = end - buffer;
+        size_t start = lineStart;
+        lineStart = pos + 1;
+        scanPos = pos + 1;
+
+        // Tail of a line that overflowed the buffer
+        if (discarding) {
+            discarding = false;
+            continue;
+        }
+
+        if (pos - start > stats.maxLineLength) {
+            stats.maxLineLength = pos - start;
+        }
+
+        // Trim whitespace and CR in place
+        *end = '\0';
+        while (trimLines && start < pos && isspace((unsigned char)buffer[start])) {
+            start++;
+        }
+        while (trimLines && pos > start && isspace((unsigned char)buffer[pos - 1])) {
+            buffer[--pos] = '\0';
+        }
+
+        if (pos == start) {
+            continue;  // Blank line
+        }
+
+        line = buffer + start;
+        length = pos - start;
+        stats.linesFramed++;
+        return true;
+    }
+
+    return false;
+}
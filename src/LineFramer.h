@@ -0,0 +1,50 @@
+#ifndef LINE_FRAMER_H
+#define LINE_FRAMER_H
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+
+// Receive statistics
+struct FramerStats {
+    uint32_t bytesReceived;
+    uint32_t linesFramed;
+    uint32_t maxLineLength;
+    uint32_t overflows;        // Lines dropped because they exceeded the buffer
+};
+
+// Frames delimited messages in a fixed receive buffer.
+// Bytes are read from the UART straight into the buffer and complete lines
+// are handed out as null-terminated views into it, so no copy is made
+// between the driver and the parser. Only the partial tail of the last line
+// is moved back to the start once all complete lines have been consumed.
+class LineFramer {
+private:
+    char buffer[UART_LINE_BUFFER_SIZE];
+    size_t fill;               // Bytes held in the buffer
+    size_t lineStart;          // Start of the next unconsumed line
+    size_t scanPos;            // First byte not yet searched for a delimiter
+    char delimiter;
+    bool trimLines;            // Strip whitespace (text mode only)
+    bool discarding;           // Dropping an oversized line until its delimiter
+
+    FramerStats stats;
+
+public:
+    explicit LineFramer(char delimiter = '\n', bool trim = true);
+
+    // Zero-copy receive: write up to `space` bytes at the returned pointer,
+    // then report how many were written with commit()
+    uint8_t* writePtr(size_t& space);
+    void commit(size_t length);
+
+    // Next complete line, null-terminated (and trimmed) in place.
+    // The view stays valid until the next writePtr() call.
+    bool nextLine(char*& line, size_t& length);
+
+    void setDelimiter(char newDelimiter, bool trim) { delimiter = newDelimiter; trimLines = trim; }
+    void reset();
+
+    const FramerStats& getStats() const { return stats; }
+};
+
+#endif // LINE_FRAMER_H
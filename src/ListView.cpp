@@ -0,0 +1,170 @@
+#include "ListView.h"
+
+ListView::ListView() : tft(nullptr), glyphs(nullptr), area({0, 0, 0, 0}), fgColor(COLOR_GREEN), bgColor(COLOR_BLACK), formatter(nullptr),
+    context(nullptr), count(0), first(0), visibleRows(0), selected(-1), open(false) {
+    memset(&stepStats, 0, sizeof(stepStats));
+    for (uint8_t i = 0; i <= LIST_MAX_VISIBLE_ROWS; i++) {
+        slots[i].index = -1;
+    }
+    invalidateRows();
+}
+
+void ListView::begin(TFT_eSPI& panel, const LayoutRect& listArea, uint16_t fg, uint16_t bg) {
+    tft = &panel;
+    area = listArea;
+    fgColor = fg;
+    bgColor = bg;
+    visibleRows = min(area.h / LIST_ROW_HEIGHT, LIST_MAX_VISIBLE_ROWS);
+    area.h = visibleRows * LIST_ROW_HEIGHT;
+    open = true;
+    invalidateRows();
+}
+
+void ListView::close() {
+    open = false;
+}
+
+void ListView::setSource(uint16_t rows, ListRowFormatter rowFormatter, void* formatterContext) {
+    formatter = rowFormatter;
+    context = formatterContext;
+    count = rows;
+    first = 0;
+    selected = -1;
+    for (uint8_t i = 0; i <= LIST_MAX_VISIBLE_ROWS; i++) {
+        slots[i].index = -1;
+    }
+    draw();
+}
+
+void ListView::setCount(uint16_t rows) {
+    if (rows < count) {
+        // Contents shrank - row numbers no longer match what is cached
+        setSource(rows, formatter, context);
+        return;
+    }
+    
+    uint16_t previous = count;
+    count = rows;
+    memset(&stepStats, 0, sizeof(stepStats));
+    for (uint8_t p = 0; open && p < visibleRows; p++) {
+        uint16_t index = first + p;
+        if (index >= previous && index < count) {
+            drawRow(p);
+        }
+    }
+}
+
+void ListView::draw() {
+    memset(&stepStats, 0, sizeof(stepStats));
+    invalidateRows();
+    for (uint8_t p = 0; open && p < visibleRows; p++) {
+        drawRow(p);
+    }
+}
+
+void ListView::scrollBy(int16_t rows) {
+    int32_t maxFirst = max((int32_t)count - visibleRows, (int32_t)0);
+    int32_t target = constrain((int32_t)first + rows, (int32_t)0, maxFirst);
+    int32_t delta = target - first;
+    if (delta == 0 || !open) {
+        return;
+    }
+    
+    memset(&stepStats, 0, sizeof(stepStats));
+    first = target;
+    
+    for (uint8_t p = 0; p < visibleRows; p++) {
+        drawRow(p);
+    }
+}
+
+void ListView::select(int32_t index) {
+    int32_t previous = selected;
+    selected = index;
+    
+    for (uint8_t p = 0; open && p < visibleRows; p++) {
+        int32_t row = first + p;
+        if (row == previous || row == selected) {
+            drawRow(p);
+        }
+    }
+}
+
+int32_t ListView::hit(int16_t x, int16_t y) const {
+    if (!open || !area.contains(x, y)) {
+        return -1;
+    }
+    int32_t index = first + (y - area.y) / LIST_ROW_HEIGHT;
+    return index < count ? index : -1;
+}
+
+const char* ListView::rowText(uint16_t index) {
+    // Consecutive rows map to distinct slots, so the rows in view never evict each other
+    RowSlot& slot = slots[index % (LIST_MAX_VISIBLE_ROWS + 1)];
+    if (slot.index != index) {
+        slot.text[0] = '\0';
+        if (formatter) {
+            formatter(index, slot.text, sizeof(slot.text), context);
+        }
+        slot.index = index;
+    }
+    return slot.text;
+}
+
+int16_t ListView::rowY(uint8_t position) const {
+    return area.y + position * LIST_ROW_HEIGHT;
+}
+
+void ListView::drawRow(uint8_t position) {
+    uint16_t index = first + position;
+    int16_t y = rowY(position);
+    bool isSelected = (int32_t)index == selected;
+    uint16_t fg = isSelected ? bgColor : fgColor;
+    uint16_t bg = isSelected ? fgColor : bgColor;
+    int16_t textX = area.x + 4;
+    int16_t textY = y + (LIST_ROW_HEIGHT - TEXT_CHAR_HEIGHT) / 2;
+    
+    // Text is drawn opaque, so a row with the same background only needs
+    // the old text's tail cleared
+    int16_t previous = drawnWidth[position];
+    if (previous < 0 || drawnSelected[position] != isSelected) {
+        tft->fillRect(area.x, y, area.w, LIST_ROW_HEIGHT, bg);
+        account(1, (uint32_t)area.w * LIST_ROW_HEIGHT);
+        previous = 0;
+    }
+    
+    int16_t width = 0;
+    if (index < count) {
+        const char* text = rowText(index);
+        width = glyphs ? glyphs->draw(*tft, textX, textY, text, fg, bg) : -1;
+        if (width > 0) {
+            account(1, (uint32_t)width * TEXT_CHAR_HEIGHT);
+        } else if (width < 0) {
+            width = GlyphCache::textWidth(text);
+            tft->setTextColor(fg, bg);
+            tft->setTextSize(GLYPH_TEXT_SIZE);
+            tft->setCursor(textX, textY);
+            tft->print(text);
+            account((width / TEXT_CHAR_WIDTH) * GLCD_WINDOWS_PER_CHAR, (uint32_t)width * TEXT_CHAR_HEIGHT);
+        }
+    }
+    
+    if (previous > width) {
+        tft->fillRect(textX + width, textY, previous - width, TEXT_CHAR_HEIGHT, bg);
+        account(1, (uint32_t)(previous - width) * TEXT_CHAR_HEIGHT);
+    }
+    drawnWidth[position] = width;
+    drawnSelected[position] = isSelected;
+}
+
+void ListView::invalidateRows() {
+    for (uint8_t p = 0; p < LIST_MAX_VISIBLE_ROWS; p++) {
+        drawnWidth[p] = -1;
+    }
+}
+
+void ListView::account(uint32_t drawCalls, uint32_t pixels) {
+    stepStats.drawCalls += drawCalls;
+    stepStats.pixels += pixels;
+    stepStats.spiBytes += drawCalls * SPI_WINDOW_OVERHEAD_BYTES + pixels * 2;
+}
@@ -0,0 +1,87 @@
+#ifndef LIST_VIEW_H
+#define LIST_VIEW_H
+
+#include <TFT_eSPI.h>
+#include "DeviceConfig.h"
+#include "Layout.h"
+#include "WidgetSet.h"
+
+#define LIST_MAX_VISIBLE_ROWS 16
+#define LIST_TEXT_MAX 40
+
+// Fills `text` with the label of row `index`
+typedef void (*ListRowFormatter)(uint16_t index, char* text, size_t size, void* context);
+
+// Virtualized list.
+// Only the rows in view are formatted and drawn, so the cost of a frame or
+// a scroll step depends on the view height, not on the number of entries.
+// Formatted rows live in a small ring of slots indexed by row number and
+// are reused while the row stays in view; a row scrolled out gives its slot
+// to the row scrolled in.
+//
+// A scroll step redraws every row in view: the panel's vertical scroll
+// registers move its native 320-line axis, which is the screen's horizontal
+// in the landscape rotation, and there is no frame memory to blit from. To
+// keep the step cheap a row that keeps its highlight is not filled again;
+// its new text is drawn opaque over the old and only the tail the old text
+// covered beyond it is cleared.
+class ListView {
+private:
+    struct RowSlot {
+        int32_t index;             // Row held by this slot, -1 if free
+        char text[LIST_TEXT_MAX];
+    };
+    
+    TFT_eSPI* tft;
+    GlyphCache* glyphs;            // Row text; owned by the caller
+    LayoutRect area;
+    uint16_t fgColor;
+    uint16_t bgColor;
+    ListRowFormatter formatter;
+    void* context;
+    uint16_t count;
+    uint16_t first;                // Row at the top of the view
+    uint8_t visibleRows;
+    int32_t selected;
+    RowSlot slots[LIST_MAX_VISIBLE_ROWS + 1];
+    int16_t drawnWidth[LIST_MAX_VISIBLE_ROWS];     // Text width on the panel per position, -1 if not drawn
+    bool drawnSelected[LIST_MAX_VISIBLE_ROWS];
+    bool open;
+    
+    // Cost accounting, same model as WidgetSet
+    RenderStats stepStats;
+    
+    const char* rowText(uint16_t index);
+    int16_t rowY(uint8_t position) const;
+    void drawRow(uint8_t position);
+    void invalidateRows();
+    void account(uint32_t drawCalls, uint32_t pixels);
+    
+public:
+    ListView();
+    
+    // Takes over `area` (whole rows of LIST_ROW_HEIGHT) until close()
+    void begin(TFT_eSPI& panel, const LayoutRect& listArea, uint16_t fg, uint16_t bg);
+    void setGlyphCache(GlyphCache* cache) { glyphs = cache; }
+    void close();
+    bool isOpen() const { return open; }
+    
+    // New contents - resets the view to the top and redraws it
+    void setSource(uint16_t rows, ListRowFormatter rowFormatter, void* formatterContext);
+    // Rows appended to the same contents - draws only appended rows in view
+    void setCount(uint16_t rows);
+    
+    void draw();
+    // Positive moves towards the end of the list; clamped to the contents
+    void scrollBy(int16_t rows);
+    void select(int32_t index);
+    
+    // Row under a screen point, or -1
+    int32_t hit(int16_t x, int16_t y) const;
+    
+    uint16_t getCount() const { return count; }
+    uint16_t getFirst() const { return first; }
+    const RenderStats& getLastStepStats() const { return stepStats; }
+};
+
+#endif // LIST_VIEW_H
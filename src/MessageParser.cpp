@@ -0,0 +1,356 @@
+#include "MessageParser.h"
+
+static const float POWERS_OF_TEN[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+static const uint32_t MAX_MANTISSA = 9999999;  // Exact in a float
+static const uint8_t MAX_NESTING = 8;
+
+static void skipWhitespace(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+}
+
+static bool keyEquals(const char* key, size_t length, const char* expected) {
+    return strncmp(key, expected, length) == 0 && expected[length] == '\0';
+}
+
+// Maps a key to its field; the case labels are computed at compile time
+static MessageField lookupField(const char* key, size_t length, uint32_t hash) {
+    switch (hash) {
+        case fieldHash(SENSOR_1_KEY):
+            return keyEquals(key, length, SENSOR_1_KEY) ? FIELD_SENSOR_1 : FIELD_NONE;
+        case fieldHash(SENSOR_2_KEY):
+            return keyEquals(key, length, SENSOR_2_KEY) ? FIELD_SENSOR_2 : FIELD_NONE;
+        case fieldHash(SENSOR_3_KEY):
+            return keyEquals(key, length, SENSOR_3_KEY) ? FIELD_SENSOR_3 : FIELD_NONE;
+        case fieldHash("kf"):
+            return keyEquals(key, length, "kf") ? FIELD_KEYFRAME : FIELD_NONE;
+        case fieldHash("status"):
+            return keyEquals(key, length, "status") ? FIELD_STATUS : FIELD_NONE;
+        case fieldHash("wifi_connected"):
+            return keyEquals(key, length, "wifi_connected") ? FIELD_WIFI : FIELD_NONE;
+        case fieldHash("error"):
+            return keyEquals(key, length, "error") ? FIELD_ERROR : FIELD_NONE;
+        case fieldHash("hello"):
+            return keyEquals(key, length, "hello") ? FIELD_HELLO : FIELD_NONE;
+        case fieldHash("subscribed"):
+            return keyEquals(key, length, "subscribed") ? FIELD_SUBSCRIBED : FIELD_NONE;
+        case fieldHash("max_hz"):
+            return keyEquals(key, length, "max_hz") ? FIELD_MAX_HZ : FIELD_NONE;
+        case fieldHash("ack"):
+            return keyEquals(key, length, "ack") ? FIELD_ACK : FIELD_NONE;
+        default:
+            return FIELD_NONE;
+    }
+}
+
+// Copies a JSON string into `out` (truncating), or skips it if out is null
+static bool parseString(const char*& p, const char* end, char* out, size_t outSize) {
+    if (p >= end || *p != '"') {
+        return false;
+    }
+    p++;
+
+    size_t written = 0;
+    while (p < end && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            if (p >= end) return false;
+            c = *p++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'u':
+                    // Non-ASCII escapes are not displayable in the GLCD font
+                    if (end - p < 4) return false;
+                    p += 4;
+                    c = '?';
+                    break;
+                default: break;  // \" \\ \/
+            }
+        }
+        if (out && written + 1 < outSize) {
+            out[written++] = c;
+        }
+    }
+
+    if (p >= end) {
+        return false;
+    }
+    p++;  // Closing quote
+
+    if (out) {
+        out[written] = '\0';
+    }
+    return true;
+}
+
+// Decimal to float without strtod, which may allocate in newlib.
+// On failure p is left where it was, so the value can still be skipped.
+static bool parseNumber(const char*& p, const char* end, float& value) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p >= end || !isdigit((unsigned char)*p)) {
+        p = start;
+        return false;
+    }
+
+    uint32_t mantissa = 0;
+    int exponent = 0;
+
+    while (p < end && isdigit((unsigned char)*p)) {
+        if (mantissa <= MAX_MANTISSA / 10) {
+            mantissa = mantissa * 10 + (*p - '0');
+        } else {
+            exponent++;
+        }
+        p++;
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isdigit((unsigned char)*p)) {
+            if (mantissa <= MAX_MANTISSA / 10) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+            p++;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int explicitExponent = 0;
+        while (p < end && isdigit((unsigned char)*p)) {
+            explicitExponent = min(explicitExponent * 10 + (*p - '0'), 99);
+            p++;
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    value = mantissa;
+    while (exponent > 0) {
+        int step = min(exponent, 10);
+        value *= POWERS_OF_TEN[step];
+        exponent -= step;
+    }
+    while (exponent < 0) {
+        int step = min(-exponent, 10);
+        value /= POWERS_OF_TEN[step];
+        exponent += step;
+    }
+
+    if (negative) {
+        value = -value;
+    }
+    return true;
+}
+
+static bool parseLiteral(const char*& p, const char* end, const char* literal) {
+    size_t length = strlen(literal);
+    if ((size_t)(end - p) < length || strncmp(p, literal, length) != 0) {
+        return false;
+    }
+    p += length;
+    return true;
+}
+
+// Booleans also accept numbers (0 / non-zero) from simpler peers
+static bool parseBool(const char*& p, const char* end, bool& value) {
+    if (parseLiteral(p, end, "true")) {
+        value = true;
+        return true;
+    }
+    if (parseLiteral(p, end, "false")) {
+        value = false;
+        return true;
+    }
+
+    float number;
+    if (parseNumber(p, end, number)) {
+        value = number != 0.0f;
+        return true;
+    }
+    return false;
+}
+
+// Skips any value, including nested objects and arrays
+static bool skipValue(const char*& p, const char* end) {
+    if (p >= end) {
+        return false;
+    }
+
+    if (*p == '"') {
+        return parseString(p, end, nullptr, 0);
+    }
+
+    if (*p == '{' || *p == '[') {
+        uint8_t depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                if (!parseString(p, end, nullptr, 0)) return false;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                if (++depth > MAX_NESTING) return false;
+            } else if (*p == '}' || *p == ']') {
+                if (--depth == 0) {
+                    p++;
+                    return true;
+                }
+            }
+            p++;
+        }
+        return false;
+    }
+
+    // Number or literal - runs up to the next delimiter
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+        p++;
+    }
+    return p > start;
+}
+
+static bool parseFieldValue(const char*& p, const char* end, MessageField field, ParsedMessage& message) {
+    if (parseLiteral(p, end, "null")) {
+        return true;  // Present but without a value - treated as absent
+    }
+
+    const char* valueStart = p;
+    bool parsed = false;
+    switch (field) {
+        case FIELD_SENSOR_1:
+        case FIELD_SENSOR_2:
+        case FIELD_SENSOR_3: {
+            int index = field == FIELD_SENSOR_1 ? 0 : (field == FIELD_SENSOR_2 ? 1 : 2);
+            parsed = parseNumber(p, end, message.sensorValues[index]);
+            break;
+        }
+        case FIELD_KEYFRAME:
+            parsed = parseBool(p, end, message.keyframe);
+            break;
+        case FIELD_WIFI:
+            parsed = parseBool(p, end, message.wifiConnected);
+            break;
+        case FIELD_SUBSCRIBED:
+            parsed = parseBool(p, end, message.subscribed);
+            break;
+        case FIELD_MAX_HZ: {
+            float rate;
+            parsed = parseNumber(p, end, rate);
+            message.maxRateHz = (int)rate;
+            break;
+        }
+        case FIELD_ACK: {
+            float id;
+            parsed = parseNumber(p, end, id) && id >= 0 && id <= UINT16_MAX;
+            message.ackId = parsed ? (uint16_t)id : 0;
+            break;
+        }
+        case FIELD_STATUS:
+            parsed = parseString(p, end, message.status, sizeof(message.status));
+            break;
+        case FIELD_HELLO:
+            parsed = parseString(p, end, message.hello, sizeof(message.hello));
+            break;
+        case FIELD_ERROR:
+            parsed = parseString(p, end, message.error, sizeof(message.error));
+            break;
+        default:
+            break;
+    }
+
+    if (parsed) {
+        message.fields |= field;
+        return true;
+    }
+
+    // Unexpected type or out of range - ignore the field
+    p = valueStart;
+    return skipValue(p, end);
+}
+
+bool parseMessage(const char* line, size_t length, ParsedMessage& message) {
+    const char* p = line;
+    const char* end = line + length;
+
+    message.fields = FIELD_NONE;
+    message.keyframe = false;
+    message.wifiConnected = false;
+    message.subscribed = false;
+    message.maxRateHz = 0;
+    message.ackId = 0;
+    message.status[0] = '\0';
+    message.hello[0] = '\0';
+    message.error[0] = '\0';
+
+    skipWhitespace(p, end);
+    if (p >= end || *p++ != '{') {
+        return false;
+    }
+
+    skipWhitespace(p, end);
+    if (p < end && *p == '}') {
+        p++;
+    } else {
+        while (true) {
+            // Key - hashed while scanning
+            skipWhitespace(p, end);
+            if (p >= end || *p++ != '"') {
+                return false;
+            }
+            const char* key = p;
+            uint32_t hash = fieldHash("");
+            while (p < end && *p != '"') {
+                hash = (hash ^ (uint8_t)*p) * 16777619u;
+                p++;
+            }
+            if (p >= end) {
+                return false;
+            }
+            size_t keyLength = p - key;
+            p++;
+
+            skipWhitespace(p, end);
+            if (p >= end || *p++ != ':') {
+                return false;
+            }
+            skipWhitespace(p, end);
+
+            MessageField field = lookupField(key, keyLength, hash);
+            bool valueOk = field == FIELD_NONE ? skipValue(p, end) : parseFieldValue(p, end, field, message);
+            if (!valueOk) {
+                return false;
+            }
+
+            skipWhitespace(p, end);
+            if (p >= end) {
+                return false;
+            }
+            if (*p == ',') {
+                p++;
+                continue;
+            }
+            if (*p == '}') {
+                p++;
+                break;
+            }
+            return false;
+        }
+    }
+
+    // Nothing but whitespace may follow the object
+    skipWhitespace(p, end);
+    return p == end;
+}
@@ -0,0 +1,52 @@
+#ifndef MESSAGE_PARSER_H
+#define MESSAGE_PARSER_H
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+
+#define MESSAGE_TEXT_MAX 48
+
+// Fields recognised in a frame from the main device
+enum MessageField : uint16_t {
+    FIELD_NONE       = 0,
+    FIELD_SENSOR_1   = 1 << 0,
+    FIELD_SENSOR_2   = 1 << 1,
+    FIELD_SENSOR_3   = 1 << 2,
+    FIELD_KEYFRAME   = 1 << 3,
+    FIELD_STATUS     = 1 << 4,
+    FIELD_WIFI       = 1 << 5,
+    FIELD_ERROR      = 1 << 6,
+    FIELD_HELLO      = 1 << 7,
+    FIELD_SUBSCRIBED = 1 << 8,
+    FIELD_MAX_HZ     = 1 << 9,
+    FIELD_ACK        = 1 << 10
+};
+
+#define FIELD_SENSORS (FIELD_SENSOR_1 | FIELD_SENSOR_2 | FIELD_SENSOR_3)
+
+// Result of one parse - fixed size, lives on the caller's stack
+struct ParsedMessage {
+    uint16_t fields;           // MessageField bits present in the frame
+    float sensorValues[SENSOR_COUNT];
+    bool keyframe;
+    bool wifiConnected;
+    bool subscribed;
+    int maxRateHz;
+    uint16_t ackId;            // Manual command acknowledged
+    char status[16];
+    char hello[16];
+    char error[MESSAGE_TEXT_MAX];
+};
+
+// FNV-1a, usable both at compile time (switch labels) and while scanning
+constexpr uint32_t fieldHash(const char* key, uint32_t hash = 2166136261u) {
+    return *key == '\0' ? hash : fieldHash(key + 1, (hash ^ (uint8_t)*key) * 16777619u);
+}
+
+// Single pass over a flat JSON object straight into ParsedMessage.
+// Keys are dispatched through a switch on hashes of the device profile's
+// keys, so unknown keys cost one hash and nested values are skipped.
+// Never allocates; the line is only read.
+bool parseMessage(const char* line, size_t length, ParsedMessage& message);
+
+#endif // MESSAGE_PARSER_H
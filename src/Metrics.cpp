@@ -0,0 +1,102 @@
+#include "Metrics.h"
+
+#ifdef METRICS_ENABLED
+
+#include <ArduinoJson.h>
+
+MetricsRegistry metrics;
+
+static const char* TASK_NAMES[METRIC_TASK_COUNT] = {
+    "display", "panel", "touch", "uart", "wifi", "telemetry", "storage", "loop"
+};
+
+static const char* COUNTER_NAMES[COUNTER_COUNT] = {
+    "uart_messages", "frames"
+};
+
+static const char* HISTOGRAM_NAMES[HISTOGRAM_COUNT] = {
+    "frame_render_us", "uart_parse_us", "touch_action_us"
+};
+
+MetricsRegistry::MetricsRegistry() {
+    for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+    for (uint8_t i = 0; i < METRIC_TASK_COUNT; i++) {
+        busyMicros[i].store(0, std::memory_order_relaxed);
+        tasks[i] = nullptr;
+        stackSizes[i] = 0;
+    }
+}
+
+void MetricsRegistry::registerTask(MetricTask task, TaskHandle_t handle, uint32_t stackSize) {
+    tasks[task] = handle;
+    stackSizes[task] = stackSize;
+}
+
+void MetricsRegistry::snapshot(MetricsSnapshot& out) const {
+    out.at = millis();
+    for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+        out.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    for (uint8_t i = 0; i < METRIC_TASK_COUNT; i++) {
+        out.busyMicros[i] = busyMicros[i].load(std::memory_order_relaxed);
+        // Bytes on ESP-IDF, where stacks are sized in bytes
+        out.stackFree[i] = tasks[i] ? uxTaskGetStackHighWaterMark(tasks[i]) : 0;
+    }
+}
+
+const char* MetricsRegistry::taskName(MetricTask task) {
+    return TASK_NAMES[task];
+}
+
+float MetricsRegistry::rate(const MetricsSnapshot& from, const MetricsSnapshot& to, MetricCounter counter) {
+    unsigned long elapsed = to.at - from.at;
+    return elapsed > 0 ? (to.counters[counter] - from.counters[counter]) * 1000.0f / elapsed : 0.0f;
+}
+
+float MetricsRegistry::cpuShare(const MetricsSnapshot& from, const MetricsSnapshot& to, MetricTask task) {
+    unsigned long elapsed = to.at - from.at;
+    return elapsed > 0 ? (to.busyMicros[task] - from.busyMicros[task]) / (elapsed * 10.0f) : 0.0f;
+}
+
+void MetricsRegistry::dumpJson(Print& out, MetricsSnapshot& previous) {
+    MetricsSnapshot now;
+    snapshot(now);
+
+    JsonDocument doc;
+    doc["uptime_ms"] = now.at;
+    doc["window_ms"] = now.at - previous.at;
+
+    for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+        JsonObject counter = doc["counters"][COUNTER_NAMES[i]].to<JsonObject>();
+        counter["total"] = now.counters[i];
+        counter["per_s"] = rate(previous, now, (MetricCounter)i);
+    }
+
+    // Histograms cover the time since boot
+    for (uint8_t i = 0; i < HISTOGRAM_COUNT; i++) {
+        const HdrHistogram& histogram = histograms[i];
+        JsonObject entry = doc["histograms"][HISTOGRAM_NAMES[i]].to<JsonObject>();
+        entry["count"] = histogram.count();
+        entry["p50"] = histogram.percentile(500);
+        entry["p90"] = histogram.percentile(900);
+        entry["p99"] = histogram.percentile(990);
+        entry["p999"] = histogram.percentile(999);
+        entry["max"] = histogram.max();
+    }
+
+    for (uint8_t i = 0; i < METRIC_TASK_COUNT; i++) {
+        if (!tasks[i]) continue;
+        JsonObject task = doc["tasks"][TASK_NAMES[i]].to<JsonObject>();
+        task["cpu_pct"] = cpuShare(previous, now, (MetricTask)i);
+        task["stack_size"] = stackSizes[i];
+        task["stack_free"] = now.stackFree[i];
+    }
+
+    serializeJson(doc, out);
+    out.println();
+    previous = now;
+}
+
+#endif // METRICS_ENABLED
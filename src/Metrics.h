@@ -0,0 +1,121 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+
+// Runtime metrics - build with -DMETRICS_ENABLED to get the registry, the
+// diagnostics page on the settings tab and the `metrics` command on the
+// debug serial. Without it every METRIC_ macro expands to nothing, so the
+// instrumented code compiles exactly as if it weren't there.
+
+enum MetricCounter : uint8_t {
+    COUNTER_UART_MESSAGES,     // Frames or lines parsed from the main device
+    COUNTER_FRAMES,            // Frames rendered by the display task
+    COUNTER_COUNT
+};
+
+enum MetricHistogram : uint8_t {
+    HISTOGRAM_FRAME_RENDER,    // Widget declaration and commit, micros
+    HISTOGRAM_UART_PARSE,      // One message parsed and applied, micros
+    HISTOGRAM_TOUCH_ACTION,    // Gesture recognised to its frame committed, micros
+    HISTOGRAM_COUNT
+};
+
+enum MetricTask : uint8_t {
+    METRIC_TASK_DISPLAY,
+    METRIC_TASK_PANEL,         // Strip transfers, with RENDER_PIPELINE only
+    METRIC_TASK_TOUCH,
+    METRIC_TASK_UART,
+    METRIC_TASK_WIFI,
+    METRIC_TASK_TELEMETRY,
+    METRIC_TASK_STORAGE,
+    METRIC_TASK_LOOP,          // Arduino loop - sensor log flushes
+    METRIC_TASK_COUNT
+};
+
+#ifdef METRICS_ENABLED
+
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "HdrHistogram.h"
+
+// Point-in-time copy of the counters; rates come from two of them
+struct MetricsSnapshot {
+    unsigned long at;                       // millis()
+    uint32_t counters[COUNTER_COUNT];
+    uint32_t busyMicros[METRIC_TASK_COUNT];
+    uint32_t stackFree[METRIC_TASK_COUNT];  // Bytes never touched, 0 = not registered
+};
+
+// Lock-free registry - any task may count or record at any time.
+// Task CPU share is busy time: each task adds the time from waking up to
+// going back to sleep. The Arduino core's FreeRTOS is built without
+// run-time stats, so the scheduler's own per-task counters aren't there.
+class MetricsRegistry {
+private:
+    std::atomic<uint32_t> counters[COUNTER_COUNT];
+    std::atomic<uint32_t> busyMicros[METRIC_TASK_COUNT];
+    HdrHistogram histograms[HISTOGRAM_COUNT];
+    TaskHandle_t tasks[METRIC_TASK_COUNT];
+    uint32_t stackSizes[METRIC_TASK_COUNT];
+
+public:
+    MetricsRegistry();
+
+    void count(MetricCounter counter, uint32_t n = 1) {
+        counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+    void record(MetricHistogram histogram, uint32_t value) { histograms[histogram].record(value); }
+    void addBusy(MetricTask task, uint32_t micros) {
+        busyMicros[task].fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    // Call from setup() once the task exists
+    void registerTask(MetricTask task, TaskHandle_t handle, uint32_t stackSize);
+
+    void snapshot(MetricsSnapshot& out) const;
+    const HdrHistogram& getHistogram(MetricHistogram histogram) const { return histograms[histogram]; }
+    uint32_t getStackSize(MetricTask task) const { return stackSizes[task]; }
+
+    static const char* taskName(MetricTask task);
+    // Per second, between two snapshots
+    static float rate(const MetricsSnapshot& from, const MetricsSnapshot& to, MetricCounter counter);
+    // Percent of one core, between two snapshots
+    static float cpuShare(const MetricsSnapshot& from, const MetricsSnapshot& to, MetricTask task);
+
+    // Everything as one JSON line; rates are since `previous`, which is updated
+    void dumpJson(Print& out, MetricsSnapshot& previous);
+};
+
+extern MetricsRegistry metrics;
+
+// Adds the time until the end of the enclosing scope to a task's busy time
+class MetricBusyScope {
+private:
+    MetricTask task;
+    uint32_t start;
+
+public:
+    explicit MetricBusyScope(MetricTask busyTask) : task(busyTask), start(micros()) {}
+    ~MetricBusyScope() { metrics.addBusy(task, micros() - start); }
+};
+
+#define METRIC_COUNT(counter, n) metrics.count(counter, n)
+#define METRIC_TIMER(name) uint32_t name = micros()
+#define METRIC_RECORD_SINCE(histogram, name) metrics.record(histogram, micros() - (name))
+#define METRIC_BUSY(task) MetricBusyScope metricBusyScope(task)
+#define METRIC_TASK(task, handle, stackSize) metrics.registerTask(task, handle, stackSize)
+
+#else
+
+#define METRIC_COUNT(counter, n) do {} while (0)
+#define METRIC_TIMER(name) do {} while (0)
+#define METRIC_RECORD_SINCE(histogram, name) do {} while (0)
+#define METRIC_BUSY(task) do {} while (0)
+#define METRIC_TASK(task, handle, stackSize) do {} while (0)
+
+#endif // METRICS_ENABLED
+
+#endif // METRICS_H
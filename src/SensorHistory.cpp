@@ -0,0 +1,177 @@
+#include "SensorHistory.h"
+
+const uint16_t SensorHistory::TIER_SECONDS[HISTORY_TIER_COUNT] = {HISTORY_TIER_1_SECONDS, HISTORY_TIER_2_SECONDS};
+const uint16_t SensorHistory::TIER_CAPACITY[HISTORY_TIER_COUNT] = {HISTORY_TIER_1_BUCKETS, HISTORY_TIER_2_BUCKETS};
+const float SensorHistory::SCALE[SENSOR_COUNT] = {SENSOR_1_HISTORY_SCALE, SENSOR_2_HISTORY_SCALE, SENSOR_3_HISTORY_SCALE};
+
+SensorHistory::SensorHistory() {
+    lock = xSemaphoreCreateMutex();
+    
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        SensorTrack& track = tracks[i];
+        track.rawHead = 0;
+        track.rawCount = 0;
+        
+        for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+            HistoryBucket* buckets = tierBuckets(track, tier);
+            for (uint16_t j = 0; j < TIER_CAPACITY[tier]; j++) {
+                buckets[j].minValue = buckets[j].maxValue = buckets[j].avgValue = HISTORY_EMPTY;
+            }
+            track.tiers[tier].started = false;
+        }
+    }
+}
+
+HistoryBucket* SensorHistory::tierBuckets(SensorTrack& track, uint8_t tier) {
+    return tier == 0 ? track.tier1 : track.tier2;
+}
+
+int16_t SensorHistory::quantize(uint8_t sensor, float value) {
+    // HISTORY_EMPTY is reserved, so the range is clamped one above it
+    float scaled = value * SCALE[sensor];
+    if (scaled >= INT16_MAX) return INT16_MAX;
+    if (scaled <= INT16_MIN + 1) return INT16_MIN + 1;
+    return (int16_t)lroundf(scaled);
+}
+
+void SensorHistory::record(const float* values, uint8_t fieldMask, uint32_t time) {
+    if (!lock || xSemaphoreTake(lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    
+    uint32_t seconds = time / 1000;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (!(fieldMask & (1 << i))) continue;
+        
+        SensorTrack& track = tracks[i];
+        int16_t value = quantize(i, values[i]);
+        
+        track.rawValue[track.rawHead] = value;
+        track.rawTime[track.rawHead] = time;
+        track.rawHead = (track.rawHead + 1) % HISTORY_RAW_SAMPLES;
+        if (track.rawCount < HISTORY_RAW_SAMPLES) {
+            track.rawCount++;
+        }
+        
+        for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+            recordTier(track, tier, seconds, value);
+        }
+    }
+    
+    xSemaphoreGive(lock);
+}
+
+void SensorHistory::recordTier(SensorTrack& track, uint8_t tier, uint32_t seconds, int16_t value) {
+    TierState& state = track.tiers[tier];
+    HistoryBucket* buckets = tierBuckets(track, tier);
+    uint16_t capacity = TIER_CAPACITY[tier];
+    uint32_t slot = seconds / TIER_SECONDS[tier];
+    
+    if (!state.started || slot > state.slot) {
+        // Slots skipped without samples become gaps
+        if (state.started) {
+            uint32_t skipped = min(slot - state.slot - 1, (uint32_t)capacity);
+            for (uint32_t j = 1; j <= skipped; j++) {
+                HistoryBucket& gap = buckets[(state.slot + j) % capacity];
+                gap.minValue = gap.maxValue = gap.avgValue = HISTORY_EMPTY;
+            }
+        }
+        state.slot = slot;
+        state.sum = 0;
+        state.count = 0;
+        state.minValue = INT16_MAX;
+        state.maxValue = INT16_MIN;
+        state.started = true;
+    }
+    
+    // The open bucket is kept current so queries see the latest samples
+    state.sum += value;
+    state.count++;
+    state.minValue = min(state.minValue, value);
+    state.maxValue = max(state.maxValue, value);
+    
+    HistoryBucket& bucket = buckets[state.slot % capacity];
+    bucket.minValue = state.minValue;
+    bucket.maxValue = state.maxValue;
+    bucket.avgValue = state.sum / state.count;
+}
+
+void SensorHistory::mergeColumn(HistorySeries& series, uint16_t column, int16_t minValue, int16_t maxValue) {
+    if (series.minValue[column] == HISTORY_EMPTY) {
+        series.minValue[column] = minValue;
+        series.maxValue[column] = maxValue;
+    } else {
+        series.minValue[column] = min(series.minValue[column], minValue);
+        series.maxValue[column] = max(series.maxValue[column], maxValue);
+    }
+}
+
+void SensorHistory::query(uint8_t sensor, uint32_t spanSeconds, uint32_t end, uint16_t columns, HistorySeries& series) {
+    series.columns = min(columns, (uint16_t)HISTORY_CHART_MAX_COLUMNS);
+    for (uint16_t c = 0; c < series.columns; c++) {
+        series.minValue[c] = series.maxValue[c] = HISTORY_EMPTY;
+    }
+    
+    if (sensor >= SENSOR_COUNT || series.columns == 0 || !lock || xSemaphoreTake(lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    
+    SensorTrack& track = tracks[sensor];
+    uint32_t span = spanSeconds * 1000;
+    uint32_t start = end - span;
+    
+    // Finest source that reaches back to the start of the span
+    bool rawCovers = track.rawCount < HISTORY_RAW_SAMPLES ||
+                     (int32_t)(track.rawTime[track.rawHead] - start) <= 0;
+    
+    if (rawCovers) {
+        queryRaw(track, start, span, series);
+    } else {
+        uint8_t tier = 0;
+        while (tier + 1 < HISTORY_TIER_COUNT &&
+               (uint32_t)TIER_SECONDS[tier] * TIER_CAPACITY[tier] < spanSeconds) {
+            tier++;
+        }
+        queryTier(track, tier, start, span, series);
+    }
+    
+    xSemaphoreGive(lock);
+}
+
+void SensorHistory::queryRaw(const SensorTrack& track, uint32_t start, uint32_t span, HistorySeries& series) const {
+    uint16_t oldest = (track.rawHead + HISTORY_RAW_SAMPLES - track.rawCount) % HISTORY_RAW_SAMPLES;
+    
+    for (uint16_t i = 0; i < track.rawCount; i++) {
+        uint16_t index = (oldest + i) % HISTORY_RAW_SAMPLES;
+        uint32_t offset = track.rawTime[index] - start;
+        if (offset >= span) continue;
+        
+        uint16_t column = (uint64_t)offset * series.columns / span;
+        mergeColumn(series, column, track.rawValue[index], track.rawValue[index]);
+    }
+}
+
+void SensorHistory::queryTier(SensorTrack& track, uint8_t tier, uint32_t start, uint32_t span, HistorySeries& series) {
+    const TierState& state = track.tiers[tier];
+    if (!state.started) {
+        return;
+    }
+    
+    const HistoryBucket* buckets = tierBuckets(track, tier);
+    uint16_t capacity = TIER_CAPACITY[tier];
+    uint32_t bucketMillis = (uint32_t)TIER_SECONDS[tier] * 1000;
+    uint32_t retained = min(state.slot + 1, (uint32_t)capacity);
+    
+    for (uint32_t j = 0; j < retained; j++) {
+        uint32_t slot = state.slot - (retained - 1) + j;
+        const HistoryBucket& bucket = buckets[slot % capacity];
+        if (bucket.avgValue == HISTORY_EMPTY) continue;
+        
+        // Buckets are placed by their start time
+        uint32_t offset = slot * bucketMillis - start;
+        if (offset >= span) continue;
+        
+        uint16_t column = (uint64_t)offset * series.columns / span;
+        mergeColumn(series, column, bucket.minValue, bucket.maxValue);
+    }
+}
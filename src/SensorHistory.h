@@ -0,0 +1,86 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "DeviceConfig.h"
+
+#define HISTORY_EMPTY INT16_MIN      // Quantized value of a missing sample
+#define HISTORY_TIER_COUNT 2
+
+// Aggregate of all samples that fell into one time slot
+struct HistoryBucket {
+    int16_t minValue;
+    int16_t maxValue;
+    int16_t avgValue;
+};
+
+// Decimated series for a chart - one min/max pair per pixel column,
+// in quantized units (value * SENSOR_n_HISTORY_SCALE)
+struct HistorySeries {
+    uint16_t columns;
+    int16_t minValue[HISTORY_CHART_MAX_COLUMNS];
+    int16_t maxValue[HISTORY_CHART_MAX_COLUMNS];
+};
+
+// Fixed-memory sensor history.
+// Every sample goes into a raw ring (quantized int16 + timestamp) and into
+// min/max/avg buckets at two coarser resolutions. Queries pick the finest
+// source that still covers the requested span, so a one-hour chart reads
+// at most a few hundred entries regardless of the sample rate.
+// Written by the UART task, read by the display task under a mutex.
+class SensorHistory {
+private:
+    // Open bucket accumulator of one tier
+    struct TierState {
+        uint32_t slot;             // Time slot of the newest bucket
+        int32_t sum;
+        uint16_t count;
+        int16_t minValue;
+        int16_t maxValue;
+        bool started;
+    };
+    
+    struct SensorTrack {
+        int16_t rawValue[HISTORY_RAW_SAMPLES];
+        uint32_t rawTime[HISTORY_RAW_SAMPLES];   // millis()
+        uint16_t rawHead;          // Next slot to write
+        uint16_t rawCount;
+        
+        HistoryBucket tier1[HISTORY_TIER_1_BUCKETS];
+        HistoryBucket tier2[HISTORY_TIER_2_BUCKETS];
+        TierState tiers[HISTORY_TIER_COUNT];
+    };
+    
+    SensorTrack tracks[SENSOR_COUNT];
+    SemaphoreHandle_t lock;
+    
+    static const uint16_t TIER_SECONDS[HISTORY_TIER_COUNT];
+    static const uint16_t TIER_CAPACITY[HISTORY_TIER_COUNT];
+    static const float SCALE[SENSOR_COUNT];
+    
+    static HistoryBucket* tierBuckets(SensorTrack& track, uint8_t tier);
+    static void mergeColumn(HistorySeries& series, uint16_t column, int16_t minValue, int16_t maxValue);
+    
+    void recordTier(SensorTrack& track, uint8_t tier, uint32_t seconds, int16_t value);
+    void queryRaw(const SensorTrack& track, uint32_t start, uint32_t span, HistorySeries& series) const;
+    void queryTier(SensorTrack& track, uint8_t tier, uint32_t start, uint32_t span, HistorySeries& series);
+    
+public:
+    SensorHistory();
+    
+    // Adds the sensors set in fieldMask (bit i = sensor i)
+    void record(const float* values, uint8_t fieldMask, uint32_t time);
+    
+    // Min/max per column over [end - spanSeconds, end); columns are equal
+    // slices of time, not of samples. Empty columns hold HISTORY_EMPTY
+    void query(uint8_t sensor, uint32_t spanSeconds, uint32_t end, uint16_t columns, HistorySeries& series);
+    
+    // Quantization shared with the on-flash rollups
+    static int16_t quantize(uint8_t sensor, float value);
+    static float toValue(uint8_t sensor, int16_t quantized) { return quantized / SCALE[sensor]; }
+    static size_t bytesPerSensor() { return sizeof(SensorTrack); }
+};
+
+#endif // SENSOR_HISTORY_H
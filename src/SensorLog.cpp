@@ -0,0 +1,448 @@
+#include "SensorLog.h"
+#include "BinaryProtocol.h"
+
+// Worst case: 4 + 32 timestamp bits, mask, and per value 2 + 5 + 5 + 32 bits
+static const uint32_t MAX_RECORD_BITS = 36 + 1 + SENSOR_COUNT + SENSOR_COUNT * 44;
+static const uint8_t NO_WINDOW = 0xFF;
+
+// MSB-first bit packing into a zeroed payload
+static void writeBits(uint8_t* buffer, uint32_t& position, uint32_t value, uint8_t count) {
+    for (int8_t i = count - 1; i >= 0; i--) {
+        if ((value >> i) & 1) {
+            buffer[position >> 3] |= 0x80 >> (position & 7);
+        }
+        position++;
+    }
+}
+
+static uint32_t readBits(const uint8_t* buffer, uint32_t& position, uint8_t count) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        value = (value << 1) | ((buffer[position >> 3] >> (7 - (position & 7))) & 1);
+        position++;
+    }
+    return value;
+}
+
+SensorLog::SensorLog() : openBits(0), openedAt(0), lastAppendTime(0), pendingHead(0), pendingCount(0),
+    firstSegment(0), lastSegment(0), tailBlocks(0), maxSegments(2), hasSegments(false), ready(false) {
+    lock = xSemaphoreCreateMutex();
+    memset(&openHeader, 0, sizeof(openHeader));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SensorLog::begin(size_t totalSpace, size_t usedSpace) {
+    if (!LittleFS.exists(LOG_DIRECTORY) && !LittleFS.mkdir(LOG_DIRECTORY)) {
+        Serial.println("Sensor log: failed to create " LOG_DIRECTORY);
+        return false;
+    }
+
+    // Rollup files are fixed-size and come out of the space before the log budget
+    bool rollupCreated = false;
+    if (!rollup.begin(rollupCreated)) {
+        Serial.println("Sensor log: rollups unavailable");
+    } else if (rollupCreated) {
+        usedSpace += SensorRollup::fileBytes();
+    }
+
+    // Only names and sizes are read here - no segment contents
+    File directory = LittleFS.open(LOG_DIRECTORY);
+    if (!directory || !directory.isDirectory()) {
+        Serial.println("Sensor log: failed to open " LOG_DIRECTORY);
+        return false;
+    }
+
+    size_t logBytes = 0;
+    for (File entry = directory.openNextFile(); entry; entry = directory.openNextFile()) {
+        // name() is the full path on some LittleFS versions - parse the basename
+        const char* name = strrchr(entry.name(), '/');
+        name = name ? name + 1 : entry.name();
+        char* suffix;
+        uint32_t sequence = strtoul(name, &suffix, 16);
+        if (strcmp(suffix, ".seg") == 0) {
+            logBytes += entry.size();
+            if (!hasSegments || sequence < firstSegment) firstSegment = sequence;
+            if (!hasSegments || sequence > lastSegment) lastSegment = sequence;
+            hasSegments = true;
+        }
+        entry.close();
+    }
+    directory.close();
+
+    // Budget is a share of the space not used by anything but the log
+    size_t available = totalSpace > usedSpace ? totalSpace - usedSpace : 0;
+    size_t budget = (available + logBytes) * SENSOR_LOG_SPACE_PERCENT / 100;
+    maxSegments = max(budget / ((size_t)SENSOR_LOG_SEGMENT_BLOCKS * LOG_BLOCK_SIZE), (size_t)2);
+
+    recoverTail();
+    ready = true;
+
+    // New rollup files start empty - fill them once from the existing log
+    if (rollupCreated && hasSegments) {
+        unsigned long startTime = millis();
+        readRange(0, UINT32_MAX, rebuildVisitor, &rollup);
+        rollup.flush(true);
+        Serial.printf("Rollup: rebuilt from the log in %lu ms\n", millis() - startTime);
+    }
+
+    Serial.printf("Sensor log: %u segments (%u KB), budget %u segments of %u KB\n",
+                  getSegmentCount(), (uint32_t)(logBytes / 1024), maxSegments,
+                  (uint32_t)(SENSOR_LOG_SEGMENT_BLOCKS * LOG_BLOCK_SIZE / 1024));
+    return true;
+}
+
+void SensorLog::recoverTail() {
+    if (!hasSegments) {
+        return;
+    }
+
+    char path[24];
+    segmentPath(lastSegment, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    size_t size = file ? file.size() : 0;
+    tailBlocks = size / LOG_BLOCK_SIZE;
+
+    // Walk back to the newest intact block; its time keeps appends monotonic
+    uint8_t block[LOG_BLOCK_SIZE];
+    bool intact = size % LOG_BLOCK_SIZE == 0;
+    for (int32_t i = (int32_t)tailBlocks - 1; i >= 0; i--) {
+        if (file.seek(i * LOG_BLOCK_SIZE) && file.read(block, LOG_BLOCK_SIZE) == LOG_BLOCK_SIZE && validBlock(block)) {
+            LogBlockHeader header;
+            memcpy(&header, block, sizeof(header));
+            lastAppendTime = header.lastTime;
+            break;
+        }
+        intact = false;
+    }
+    if (file) {
+        file.close();
+    }
+
+    // Never append behind a damaged block - continue in a fresh segment
+    if (!intact) {
+        Serial.printf("Sensor log: tail segment %s damaged, starting a new one\n", path);
+        tailBlocks = SENSOR_LOG_SEGMENT_BLOCKS;
+    }
+}
+
+void SensorLog::rebuildVisitor(const LogRecord& record, void* context) {
+    SensorRollup* target = (SensorRollup*)context;
+    target->add(record.time, record.values, record.validMask);
+    target->flush();
+}
+
+void SensorLog::segmentPath(uint32_t sequence, char* path, size_t size) {
+    snprintf(path, size, LOG_DIRECTORY "/%08lx.seg", (unsigned long)sequence);
+}
+
+void SensorLog::resetCodec(LogCodecState& state, uint32_t time) {
+    state.lastTime = time;
+    state.lastDelta = 0;
+    state.validMask = 0;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        state.lastBits[i] = 0;
+        state.leading[i] = NO_WINDOW;
+        state.trailing[i] = 0;
+    }
+}
+
+void SensorLog::append(uint32_t time, const float* values, uint8_t validMask) {
+    // Unset clock, nothing to log, or faster than the log interval
+    if (time < LOG_MIN_VALID_TIME || validMask == 0 ||
+        (lastAppendTime && time < lastAppendTime + SENSOR_LOG_INTERVAL)) {
+        return;
+    }
+
+    if (!lock || xSemaphoreTake(lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+
+    if (openHeader.count > 0 && openBits + MAX_RECORD_BITS > LOG_PAYLOAD_BITS) {
+        closeBlock();
+    }
+    if (openHeader.count == 0) {
+        openNewBlock(time);
+    }
+
+    encodeRecord(time, values, validMask);
+    openHeader.count++;
+    openHeader.lastTime = time;
+    lastAppendTime = time;
+    stats.samplesLogged++;
+
+    xSemaphoreGive(lock);
+
+    rollup.add(time, values, validMask);
+}
+
+void SensorLog::openNewBlock(uint32_t time) {
+    memset(openBlock, 0, sizeof(openBlock));
+    openHeader.magic = LOG_BLOCK_MAGIC;
+    openHeader.count = 0;
+    openHeader.firstTime = time;
+    openHeader.lastTime = time;
+    openBits = 0;
+    openedAt = millis();
+    resetCodec(encoder, time);
+}
+
+void SensorLog::encodeRecord(uint32_t time, const float* values, uint8_t validMask) {
+    uint8_t* payload = openBlock + sizeof(LogBlockHeader);
+
+    // Timestamp: delta-of-delta, regular intervals cost one bit
+    int32_t delta = time - encoder.lastTime;
+    int32_t dod = delta - encoder.lastDelta;
+    if (dod == 0) {
+        writeBits(payload, openBits, 0x0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        writeBits(payload, openBits, 0x2, 2);
+        writeBits(payload, openBits, dod + 63, 7);
+    } else if (dod >= -255 && dod <= 256) {
+        writeBits(payload, openBits, 0x6, 3);
+        writeBits(payload, openBits, dod + 255, 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        writeBits(payload, openBits, 0xE, 4);
+        writeBits(payload, openBits, dod + 2047, 12);
+    } else {
+        writeBits(payload, openBits, 0xF, 4);
+        writeBits(payload, openBits, (uint32_t)dod, 32);
+    }
+    encoder.lastTime = time;
+    encoder.lastDelta = delta;
+
+    // Valid mask only when it changed
+    if (validMask == encoder.validMask) {
+        writeBits(payload, openBits, 0, 1);
+    } else {
+        writeBits(payload, openBits, 1, 1);
+        writeBits(payload, openBits, validMask, SENSOR_COUNT);
+        encoder.validMask = validMask;
+    }
+
+    // Values: XOR with the previous value of the same sensor
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (!(validMask & (1 << i))) continue;
+
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        uint32_t xorBits = bits ^ encoder.lastBits[i];
+        encoder.lastBits[i] = bits;
+
+        if (xorBits == 0) {
+            writeBits(payload, openBits, 0x0, 1);
+            continue;
+        }
+
+        uint8_t leading = __builtin_clz(xorBits);
+        uint8_t trailing = __builtin_ctz(xorBits);
+
+        if (encoder.leading[i] != NO_WINDOW && leading >= encoder.leading[i] && trailing >= encoder.trailing[i]) {
+            // Fits the previous window - reuse it
+            uint8_t length = 32 - encoder.leading[i] - encoder.trailing[i];
+            writeBits(payload, openBits, 0x2, 2);
+            writeBits(payload, openBits, xorBits >> encoder.trailing[i], length);
+        } else {
+            uint8_t length = 32 - leading - trailing;
+            writeBits(payload, openBits, 0x3, 2);
+            writeBits(payload, openBits, leading, 5);
+            writeBits(payload, openBits, length - 1, 5);
+            writeBits(payload, openBits, xorBits >> trailing, length);
+            encoder.leading[i] = leading;
+            encoder.trailing[i] = trailing;
+        }
+    }
+}
+
+void SensorLog::closeBlock() {
+    if (openHeader.count == 0) {
+        return;
+    }
+
+    openHeader.bits = openBits;
+    openHeader.crc = 0;
+    memcpy(openBlock, &openHeader, sizeof(openHeader));
+    openHeader.crc = crc16(openBlock, LOG_BLOCK_SIZE);
+    memcpy(openBlock, &openHeader, sizeof(openHeader));
+
+    // A full queue means flush() is stuck; keep the blocks it is working on
+    if (pendingCount < SENSOR_LOG_PENDING_BLOCKS) {
+        uint8_t index = (pendingHead + pendingCount) % SENSOR_LOG_PENDING_BLOCKS;
+        memcpy(pending[index], openBlock, LOG_BLOCK_SIZE);
+        pendingCount++;
+    } else {
+        stats.droppedBlocks++;
+    }
+
+    openHeader.count = 0;
+}
+
+void SensorLog::flush() {
+    if (!ready || !lock) {
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (openHeader.count > 0 && millis() - openedAt >= SENSOR_LOG_FLUSH_INTERVAL) {
+        closeBlock();
+    }
+    xSemaphoreGive(lock);
+
+    // Copy out under the lock, write to flash without it
+    uint8_t block[LOG_BLOCK_SIZE];
+    while (true) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool hasBlock = pendingCount > 0;
+        if (hasBlock) {
+            memcpy(block, pending[pendingHead], LOG_BLOCK_SIZE);
+        }
+        xSemaphoreGive(lock);
+
+        if (!hasBlock || !writeBlock(block)) {
+            break;  // A failed block stays queued for the next flush
+        }
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        pendingHead = (pendingHead + 1) % SENSOR_LOG_PENDING_BLOCKS;
+        pendingCount--;
+        xSemaphoreGive(lock);
+    }
+
+    rollup.flush();
+}
+
+bool SensorLog::writeBlock(const uint8_t* block) {
+    char path[24];
+
+    if (!hasSegments || tailBlocks >= SENSOR_LOG_SEGMENT_BLOCKS) {
+        lastSegment = hasSegments ? lastSegment + 1 : 0;
+        if (!hasSegments) {
+            firstSegment = 0;
+        }
+        hasSegments = true;
+        tailBlocks = 0;
+
+        // Rotate out the oldest segments to stay inside the budget
+        while (lastSegment - firstSegment + 1 > maxSegments) {
+            segmentPath(firstSegment++, path, sizeof(path));
+            LittleFS.remove(path);
+        }
+    }
+
+    segmentPath(lastSegment, path, sizeof(path));
+    File file = LittleFS.open(path, "a");
+    if (!file) {
+        Serial.printf("Sensor log: failed to open %s\n", path);
+        return false;
+    }
+
+    size_t written = file.write(block, LOG_BLOCK_SIZE);
+    file.close();
+    if (written != LOG_BLOCK_SIZE) {
+        // A short write leaves a torn block - move on to a fresh segment
+        Serial.printf("Sensor log: short write to %s\n", path);
+        tailBlocks = SENSOR_LOG_SEGMENT_BLOCKS;
+        return false;
+    }
+
+    tailBlocks++;
+    stats.blocksWritten++;
+    stats.bytesWritten += LOG_BLOCK_SIZE;
+    return true;
+}
+
+bool SensorLog::validBlock(uint8_t* block) {
+    LogBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    if (header.magic != LOG_BLOCK_MAGIC || header.bits > LOG_PAYLOAD_BITS || header.count == 0) {
+        return false;
+    }
+
+    LogBlockHeader check = header;
+    check.crc = 0;
+    memcpy(block, &check, sizeof(check));
+    bool valid = crc16(block, LOG_BLOCK_SIZE) == header.crc;
+    memcpy(block, &header, sizeof(header));
+    return valid;
+}
+
+void SensorLog::readRange(uint32_t from, uint32_t to, LogVisitor visit, void* context) {
+    if (!hasSegments) {
+        return;
+    }
+
+    char path[24];
+    uint8_t block[LOG_BLOCK_SIZE];
+
+    for (uint32_t sequence = firstSegment; sequence <= lastSegment; sequence++) {
+        segmentPath(sequence, path, sizeof(path));
+        File file = LittleFS.open(path, "r");
+        if (!file) continue;
+
+        while (file.read(block, LOG_BLOCK_SIZE) == LOG_BLOCK_SIZE) {
+            if (!validBlock(block)) continue;
+
+            LogBlockHeader header;
+            memcpy(&header, block, sizeof(header));
+            if (header.lastTime < from) continue;
+            if (header.firstTime > to) {
+                file.close();
+                return;
+            }
+            decodeBlock(block, from, to, visit, context);
+        }
+        file.close();
+    }
+}
+
+void SensorLog::decodeBlock(const uint8_t* block, uint32_t from, uint32_t to, LogVisitor visit, void* context) {
+    LogBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    const uint8_t* payload = block + sizeof(LogBlockHeader);
+
+    LogCodecState decoder;
+    resetCodec(decoder, header.firstTime);
+
+    LogRecord record;
+    uint32_t position = 0;
+
+    for (uint16_t n = 0; n < header.count && position < header.bits; n++) {
+        int32_t dod;
+        if (readBits(payload, position, 1) == 0) {
+            dod = 0;
+        } else if (readBits(payload, position, 1) == 0) {
+            dod = (int32_t)readBits(payload, position, 7) - 63;
+        } else if (readBits(payload, position, 1) == 0) {
+            dod = (int32_t)readBits(payload, position, 9) - 255;
+        } else if (readBits(payload, position, 1) == 0) {
+            dod = (int32_t)readBits(payload, position, 12) - 2047;
+        } else {
+            dod = (int32_t)readBits(payload, position, 32);
+        }
+        decoder.lastDelta += dod;
+        decoder.lastTime += decoder.lastDelta;
+
+        if (readBits(payload, position, 1)) {
+            decoder.validMask = readBits(payload, position, SENSOR_COUNT);
+        }
+
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+            if (!(decoder.validMask & (1 << i))) continue;
+
+            if (readBits(payload, position, 1)) {
+                if (readBits(payload, position, 1)) {
+                    decoder.leading[i] = readBits(payload, position, 5);
+                    decoder.trailing[i] = 32 - decoder.leading[i] - (readBits(payload, position, 5) + 1);
+                }
+                uint8_t length = 32 - decoder.leading[i] - decoder.trailing[i];
+                decoder.lastBits[i] ^= readBits(payload, position, length) << decoder.trailing[i];
+            }
+            memcpy(&record.values[i], &decoder.lastBits[i], sizeof(float));
+        }
+
+        if (decoder.lastTime >= from && decoder.lastTime <= to) {
+            record.time = decoder.lastTime;
+            record.validMask = decoder.validMask;
+            visit(record, context);
+        }
+    }
+}
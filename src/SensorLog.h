@@ -0,0 +1,124 @@
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "DeviceConfig.h"
+#include "SensorRollup.h"
+
+#define LOG_DIRECTORY "/log"
+#define LOG_BLOCK_SIZE 512
+#define LOG_BLOCK_MAGIC 0x4C53              // "SL"
+#define LOG_MIN_VALID_TIME 1700000000UL     // Wall clock has been set by NTP
+
+// Every block is self-contained: the codec state restarts at its first
+// record, so a reader or the power-loss recovery never needs an earlier block
+struct LogBlockHeader {
+    uint16_t magic;
+    uint16_t count;            // Records in the block
+    uint32_t firstTime;        // Unix seconds
+    uint32_t lastTime;
+    uint16_t bits;             // Payload length in bits
+    uint16_t crc;              // CRC-16 of the whole block with crc = 0
+} __attribute__((packed));
+
+#define LOG_PAYLOAD_BITS ((LOG_BLOCK_SIZE - sizeof(LogBlockHeader)) * 8)
+
+// One decoded sample set
+struct LogRecord {
+    uint32_t time;
+    float values[SENSOR_COUNT];
+    uint8_t validMask;         // Bit i = sensor i present
+};
+
+typedef void (*LogVisitor)(const LogRecord& record, void* context);
+
+// Gorilla-style codec state, reset at the start of every block
+struct LogCodecState {
+    uint32_t lastTime;
+    int32_t lastDelta;
+    uint32_t lastBits[SENSOR_COUNT];
+    uint8_t leading[SENSOR_COUNT];     // XOR window of the previous value
+    uint8_t trailing[SENSOR_COUNT];
+    uint8_t validMask;
+};
+
+struct SensorLogStats {
+    uint32_t samplesLogged;
+    uint32_t blocksWritten;
+    uint32_t bytesWritten;
+    uint32_t droppedBlocks;    // Pending queue overflowed before a flush
+};
+
+// Append-only compressed sensor log in fixed-size segment files on LittleFS.
+// Timestamps use delta-of-delta and values XOR against the previous value,
+// packed into 512-byte blocks. append() only encodes into RAM; full blocks
+// are queued and written by flush() from a background task, so flash sees
+// one block write every few minutes instead of one per sample.
+class SensorLog {
+private:
+    // Block being filled - producer side
+    uint8_t openBlock[LOG_BLOCK_SIZE];
+    LogBlockHeader openHeader;
+    uint32_t openBits;
+    unsigned long openedAt;
+    LogCodecState encoder;
+    uint32_t lastAppendTime;
+
+    // Closed blocks waiting for flush()
+    uint8_t pending[SENSOR_LOG_PENDING_BLOCKS][LOG_BLOCK_SIZE];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+    SemaphoreHandle_t lock;
+
+    // Segment files - flush side
+    uint32_t firstSegment;
+    uint32_t lastSegment;
+    uint16_t tailBlocks;       // Blocks in the tail segment
+    uint16_t maxSegments;
+    bool hasSegments;
+    bool ready;
+
+    SensorLogStats stats;
+
+    // Aggregates kept alongside the log for long-span queries
+    SensorRollup rollup;
+
+    static void rebuildVisitor(const LogRecord& record, void* context);
+    static void segmentPath(uint32_t sequence, char* path, size_t size);
+    static void resetCodec(LogCodecState& state, uint32_t time);
+    static bool validBlock(uint8_t* block);
+    static void decodeBlock(const uint8_t* block, uint32_t from, uint32_t to, LogVisitor visit, void* context);
+
+    void openNewBlock(uint32_t time);
+    void closeBlock();
+    void encodeRecord(uint32_t time, const float* values, uint8_t validMask);
+    bool writeBlock(const uint8_t* block);
+    void recoverTail();
+
+public:
+    SensorLog();
+
+    // Scans /log for segments; the budget is a share of the free flash
+    bool begin(size_t totalSpace, size_t usedSpace);
+
+    // Producer side - never touches flash
+    void append(uint32_t time, const float* values, uint8_t validMask);
+
+    // Background side - writes queued blocks; closes the open block after
+    // SENSOR_LOG_FLUSH_INTERVAL so at most that much is lost on power loss
+    void flush();
+
+    // Visits flushed records in [from, to]; call from the flushing task
+    void readRange(uint32_t from, uint32_t to, LogVisitor visit, void* context);
+
+    // Long-span chart queries - see SensorRollup::query()
+    SensorRollup& getRollup() { return rollup; }
+
+    const SensorLogStats& getStats() const { return stats; }
+    uint32_t getSegmentCount() const { return hasSegments ? lastSegment - firstSegment + 1 : 0; }
+};
+
+#endif // SENSOR_LOG_H
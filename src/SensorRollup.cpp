@@ -0,0 +1,329 @@
+#include "SensorRollup.h"
+#include "SensorLog.h"
+
+const uint16_t SensorRollup::LEVEL_SECONDS[ROLLUP_LEVEL_COUNT] = {60, 900, 3600};
+const uint16_t SensorRollup::LEVEL_SLOTS[ROLLUP_LEVEL_COUNT] = {ROLLUP_1M_SLOTS, ROLLUP_15M_SLOTS, ROLLUP_1H_SLOTS};
+
+SensorRollup::SensorRollup() : ready(false), recordsWritten(0), droppedRecords(0) {
+    lock = xSemaphoreCreateMutex();
+    
+    for (uint8_t i = 0; i < ROLLUP_LEVEL_COUNT; i++) {
+        levels[i].accumulator.open = false;
+        levels[i].pendingHead = 0;
+        levels[i].pendingCount = 0;
+        levels[i].pendingSince = 0;
+        levels[i].merged = false;
+    }
+}
+
+void SensorRollup::levelPath(uint8_t level, char* path, size_t size) {
+    snprintf(path, size, LOG_DIRECTORY "/r%u.bin", LEVEL_SECONDS[level]);
+}
+
+bool SensorRollup::begin(bool& created) {
+    created = false;
+    char path[24];
+    
+    for (uint8_t i = 0; i < ROLLUP_LEVEL_COUNT; i++) {
+        levelPath(i, path, sizeof(path));
+        
+        File file = LittleFS.open(path, "r");
+        size_t size = file ? file.size() : 0;
+        if (file) {
+            file.close();
+        }
+        
+        // A missing or resized level starts over
+        if (size != (size_t)LEVEL_SLOTS[i] * sizeof(RollupRecord)) {
+            if (!createLevelFile(i)) {
+                return false;
+            }
+            created = true;
+        }
+    }
+    
+    ready = true;
+    return true;
+}
+
+bool SensorRollup::createLevelFile(uint8_t level) {
+    char path[24];
+    levelPath(level, path, sizeof(path));
+    
+    // Pre-sized so every slot can later be rewritten in place
+    File file = LittleFS.open(path, "w");
+    if (!file) {
+        Serial.printf("Rollup: failed to create %s\n", path);
+        return false;
+    }
+    
+    RollupRecord empty[ROLLUP_READ_CHUNK];
+    memset(empty, 0, sizeof(empty));
+    for (uint16_t slot = 0; slot < LEVEL_SLOTS[level]; slot += ROLLUP_READ_CHUNK) {
+        uint16_t count = min((uint16_t)ROLLUP_READ_CHUNK, (uint16_t)(LEVEL_SLOTS[level] - slot));
+        if (file.write((const uint8_t*)empty, count * sizeof(RollupRecord)) != count * sizeof(RollupRecord)) {
+            Serial.printf("Rollup: failed to size %s\n", path);
+            file.close();
+            return false;
+        }
+    }
+    
+    file.close();
+    Serial.printf("Rollup: created %s (%u slots)\n", path, LEVEL_SLOTS[level]);
+    return true;
+}
+
+void SensorRollup::toRecord(const Accumulator& accumulator, RollupRecord& record) {
+    record.slot = accumulator.slot;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        RollupStats& stats = record.sensors[i];
+        stats.count = accumulator.count[i];
+        if (stats.count > 0) {
+            stats.minValue = accumulator.minValue[i];
+            stats.maxValue = accumulator.maxValue[i];
+            stats.avgValue = accumulator.sum[i] / accumulator.count[i];
+        } else {
+            stats.minValue = stats.maxValue = stats.avgValue = HISTORY_EMPTY;
+        }
+    }
+}
+
+void SensorRollup::mergeRecord(RollupRecord& into, const RollupRecord& from) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        RollupStats& a = into.sensors[i];
+        const RollupStats& b = from.sensors[i];
+        if (b.count == 0) continue;
+        if (a.count == 0) {
+            a = b;
+            continue;
+        }
+        
+        uint32_t count = (uint32_t)a.count + b.count;
+        a.avgValue = ((int32_t)a.avgValue * a.count + (int32_t)b.avgValue * b.count) / (int32_t)count;
+        a.minValue = min(a.minValue, b.minValue);
+        a.maxValue = max(a.maxValue, b.maxValue);
+        a.count = min(count, (uint32_t)UINT16_MAX);
+    }
+}
+
+void SensorRollup::add(uint32_t time, const float* values, uint8_t validMask) {
+    if (!ready || !lock || xSemaphoreTake(lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    
+    for (uint8_t l = 0; l < ROLLUP_LEVEL_COUNT; l++) {
+        Level& level = levels[l];
+        Accumulator& accumulator = level.accumulator;
+        uint32_t slot = time / LEVEL_SECONDS[l];
+        
+        // Slot finished - queue it for flush()
+        if (accumulator.open && slot != accumulator.slot) {
+            if (level.pendingCount < ROLLUP_PENDING_RECORDS) {
+                uint8_t index = (level.pendingHead + level.pendingCount) % ROLLUP_PENDING_RECORDS;
+                toRecord(accumulator, level.pending[index]);
+                if (level.pendingCount++ == 0) {
+                    level.pendingSince = millis();
+                }
+            } else {
+                droppedRecords++;
+            }
+            accumulator.open = false;
+        }
+        
+        if (!accumulator.open) {
+            accumulator.slot = slot;
+            accumulator.open = true;
+            for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+                accumulator.sum[i] = 0;
+                accumulator.count[i] = 0;
+                accumulator.minValue[i] = INT16_MAX;
+                accumulator.maxValue[i] = INT16_MIN;
+            }
+        }
+        
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+            if (!(validMask & (1 << i)) || accumulator.count[i] == UINT16_MAX) continue;
+            int16_t value = SensorHistory::quantize(i, values[i]);
+            accumulator.sum[i] += value;
+            accumulator.count[i]++;
+            accumulator.minValue[i] = min(accumulator.minValue[i], value);
+            accumulator.maxValue[i] = max(accumulator.maxValue[i], value);
+        }
+    }
+    
+    xSemaphoreGive(lock);
+}
+
+void SensorRollup::flush(bool force) {
+    if (!ready || !lock) {
+        return;
+    }
+    
+    for (uint8_t l = 0; l < ROLLUP_LEVEL_COUNT; l++) {
+        Level& level = levels[l];
+        RollupRecord records[ROLLUP_PENDING_RECORDS];
+        
+        // Copy out under the lock, write without it
+        xSemaphoreTake(lock, portMAX_DELAY);
+        uint8_t count = level.pendingCount;
+        bool due = force || count >= ROLLUP_WRITE_BATCH ||
+                   (count > 0 && millis() - level.pendingSince >= SENSOR_LOG_FLUSH_INTERVAL);
+        if (due) {
+            for (uint8_t i = 0; i < count; i++) {
+                records[i] = level.pending[(level.pendingHead + i) % ROLLUP_PENDING_RECORDS];
+            }
+        }
+        xSemaphoreGive(lock);
+        
+        if (!due || count == 0 || !writeRecords(l, records, count)) {
+            continue;
+        }
+        
+        // Records added meanwhile stay queued behind the written ones
+        xSemaphoreTake(lock, portMAX_DELAY);
+        level.pendingHead = (level.pendingHead + count) % ROLLUP_PENDING_RECORDS;
+        level.pendingCount -= count;
+        level.pendingSince = millis();
+        xSemaphoreGive(lock);
+    }
+}
+
+bool SensorRollup::writeRecords(uint8_t level, RollupRecord* records, uint8_t count) {
+    char path[24];
+    levelPath(level, path, sizeof(path));
+    
+    File file = LittleFS.open(path, "r+");
+    if (!file) {
+        Serial.printf("Rollup: failed to open %s\n", path);
+        return false;
+    }
+    
+    bool ok = true;
+    for (uint8_t i = 0; i < count && ok; i++) {
+        size_t position = (size_t)(records[i].slot % LEVEL_SLOTS[level]) * sizeof(RollupRecord);
+        
+        // The first slot after boot may already hold samples from before it
+        if (!levels[level].merged) {
+            RollupRecord existing;
+            if (file.seek(position) && file.read((uint8_t*)&existing, sizeof(existing)) == sizeof(existing) &&
+                existing.slot == records[i].slot) {
+                mergeRecord(records[i], existing);
+            }
+            levels[level].merged = true;
+        }
+        
+        ok = file.seek(position) && file.write((const uint8_t*)&records[i], sizeof(RollupRecord)) == sizeof(RollupRecord);
+    }
+    file.close();
+    
+    if (!ok) {
+        Serial.printf("Rollup: write to %s failed\n", path);
+        return false;
+    }
+    recordsWritten += count;
+    return true;
+}
+
+void SensorRollup::mergeColumn(HistorySeries& series, const RollupRecord& record, uint8_t sensor,
+                               uint32_t levelSeconds, uint32_t from, uint32_t span) {
+    const RollupStats& stats = record.sensors[sensor];
+    if (stats.count == 0) {
+        return;
+    }
+    
+    // A slot straddling the start of the span lands in the first column
+    uint32_t start = record.slot * levelSeconds;
+    if (start + levelSeconds <= from) {
+        return;
+    }
+    uint32_t offset = start > from ? start - from : 0;
+    if (offset >= span) {
+        return;
+    }
+    
+    uint16_t column = (uint64_t)offset * series.columns / span;
+    if (series.minValue[column] == HISTORY_EMPTY) {
+        series.minValue[column] = stats.minValue;
+        series.maxValue[column] = stats.maxValue;
+    } else {
+        series.minValue[column] = min(series.minValue[column], stats.minValue);
+        series.maxValue[column] = max(series.maxValue[column], stats.maxValue);
+    }
+}
+
+uint8_t SensorRollup::query(uint8_t sensor, uint32_t from, uint32_t to, uint16_t columns, HistorySeries& series) {
+    series.columns = min(columns, (uint16_t)HISTORY_CHART_MAX_COLUMNS);
+    for (uint16_t c = 0; c < series.columns; c++) {
+        series.minValue[c] = series.maxValue[c] = HISTORY_EMPTY;
+    }
+    if (!ready || sensor >= SENSOR_COUNT || to <= from || series.columns == 0) {
+        return 0;
+    }
+    
+    uint32_t span = to - from;
+    
+    // Coarsest level with at least one slot per column, then coarser
+    // still if the finer level no longer retains the start of the span
+    uint8_t l = ROLLUP_LEVEL_COUNT - 1;
+    while (l > 0 && span / LEVEL_SECONDS[l] < series.columns) {
+        l--;
+    }
+    while (l + 1 < ROLLUP_LEVEL_COUNT && span > (uint32_t)LEVEL_SECONDS[l] * LEVEL_SLOTS[l]) {
+        l++;
+    }
+    uint32_t seconds = LEVEL_SECONDS[l];
+    uint16_t capacity = LEVEL_SLOTS[l];
+    
+    // Slots not yet on flash, including the one still being aggregated
+    RollupRecord unwritten[ROLLUP_PENDING_RECORDS + 1];
+    uint8_t unwrittenCount = 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    const Level& level = levels[l];
+    for (uint8_t i = 0; i < level.pendingCount; i++) {
+        unwritten[unwrittenCount++] = level.pending[(level.pendingHead + i) % ROLLUP_PENDING_RECORDS];
+    }
+    if (level.accumulator.open) {
+        toRecord(level.accumulator, unwritten[unwrittenCount++]);
+    }
+    xSemaphoreGive(lock);
+    
+    // One contiguous read per ring segment, O(slots in span)
+    uint32_t firstSlot = from / seconds;
+    uint32_t lastSlot = (to - 1) / seconds;
+    if (lastSlot - firstSlot + 1 > capacity) {
+        firstSlot = lastSlot - capacity + 1;
+    }
+    
+    char path[24];
+    levelPath(l, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    
+    RollupRecord chunk[ROLLUP_READ_CHUNK];
+    uint32_t slot = firstSlot;
+    while (file && slot <= lastSlot) {
+        uint16_t position = slot % capacity;
+        uint16_t count = min((uint32_t)ROLLUP_READ_CHUNK, lastSlot - slot + 1);
+        count = min(count, (uint16_t)(capacity - position));
+        
+        if (!file.seek((size_t)position * sizeof(RollupRecord)) ||
+            file.read((uint8_t*)chunk, count * sizeof(RollupRecord)) != count * sizeof(RollupRecord)) {
+            break;
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            // Entries left over from an earlier lap of the ring are skipped
+            if (chunk[i].slot == slot + i) {
+                mergeColumn(series, chunk[i], sensor, seconds, from, span);
+            }
+        }
+        slot += count;
+    }
+    if (file) {
+        file.close();
+    }
+    
+    for (uint8_t i = 0; i < unwrittenCount; i++) {
+        mergeColumn(series, unwritten[i], sensor, seconds, from, span);
+    }
+    
+    return l;
+}
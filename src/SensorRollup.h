@@ -0,0 +1,96 @@
+#ifndef SENSOR_ROLLUP_H
+#define SENSOR_ROLLUP_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "DeviceConfig.h"
+#include "SensorHistory.h"
+
+#define ROLLUP_LEVEL_COUNT 3
+#define ROLLUP_READ_CHUNK 8            // Records per file read
+
+// Aggregate of one sensor over one slot, quantized like SensorHistory
+struct RollupStats {
+    int16_t minValue;
+    int16_t maxValue;
+    int16_t avgValue;
+    uint16_t count;            // 0 = no samples
+};
+
+// One slot of one level - slot = unix time / level seconds
+struct RollupRecord {
+    uint32_t slot;
+    RollupStats sensors[SENSOR_COUNT];
+};
+
+// 1 minute, 15 minute and 1 hour rollups of the sensor log.
+// Each level is a fixed-size file used as a ring indexed by slot, so a
+// query seeks straight to its first slot and reads only the slots in the
+// span. Slots are aggregated in RAM as samples are logged and written in
+// batches by flush(); queries merge the unwritten slots from RAM.
+class SensorRollup {
+private:
+    struct Accumulator {
+        uint32_t slot;
+        int32_t sum[SENSOR_COUNT];
+        int16_t minValue[SENSOR_COUNT];
+        int16_t maxValue[SENSOR_COUNT];
+        uint16_t count[SENSOR_COUNT];
+        bool open;
+    };
+
+    struct Level {
+        Accumulator accumulator;
+        RollupRecord pending[ROLLUP_PENDING_RECORDS];
+        uint8_t pendingHead;
+        uint8_t pendingCount;
+        unsigned long pendingSince;    // millis() when the queue became non-empty
+        bool merged;                   // Slot open at boot merged with flash
+    };
+
+    Level levels[ROLLUP_LEVEL_COUNT];
+    SemaphoreHandle_t lock;
+    bool ready;
+    uint32_t recordsWritten;
+    uint32_t droppedRecords;
+
+    static const uint16_t LEVEL_SECONDS[ROLLUP_LEVEL_COUNT];
+    static const uint16_t LEVEL_SLOTS[ROLLUP_LEVEL_COUNT];
+
+    static void levelPath(uint8_t level, char* path, size_t size);
+    static void toRecord(const Accumulator& accumulator, RollupRecord& record);
+    static void mergeRecord(RollupRecord& into, const RollupRecord& from);
+    static void mergeColumn(HistorySeries& series, const RollupRecord& record, uint8_t sensor,
+                            uint32_t levelSeconds, uint32_t from, uint32_t span);
+
+    bool createLevelFile(uint8_t level);
+    bool writeRecords(uint8_t level, RollupRecord* records, uint8_t count);
+
+public:
+    SensorRollup();
+
+    // Opens the level files, creating missing ones (created is then set)
+    bool begin(bool& created);
+
+    // Producer side - RAM only
+    void add(uint32_t time, const float* values, uint8_t validMask);
+
+    // Writes a level's closed slots once ROLLUP_WRITE_BATCH are queued or
+    // the oldest has waited SENSOR_LOG_FLUSH_INTERVAL; force writes all
+    void flush(bool force = false);
+
+    // Min/max per column over [from, to) from the coarsest level that still
+    // has at least one slot per column; returns the level used
+    uint8_t query(uint8_t sensor, uint32_t from, uint32_t to, uint16_t columns, HistorySeries& series);
+
+    static uint32_t levelSeconds(uint8_t level) { return LEVEL_SECONDS[level]; }
+    static size_t fileBytes() {
+        return ((size_t)ROLLUP_1M_SLOTS + ROLLUP_15M_SLOTS + ROLLUP_1H_SLOTS) * sizeof(RollupRecord);
+    }
+    uint32_t getRecordsWritten() const { return recordsWritten; }
+    uint32_t getDroppedRecords() const { return droppedRecords; }
+};
+
+#endif // SENSOR_ROLLUP_H
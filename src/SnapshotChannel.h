@@ -0,0 +1,61 @@
+#ifndef SNAPSHOT_CHANNEL_H
+#define SNAPSHOT_CHANNEL_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Single-producer / single-consumer triple buffer.
+// The writer fills its private buffer and swaps it with the shared middle
+// buffer; the reader swaps the middle buffer with its own only when a new
+// snapshot was published. Neither side ever blocks or sees a torn value,
+// and the reader always gets the most recent complete snapshot.
+// T must be trivially copyable (no String or heap members).
+template <typename T>
+class SnapshotChannel {
+private:
+    static const uint8_t INDEX_MASK = 0x03;
+    static const uint8_t FRESH_BIT = 0x04;
+
+    T buffers[3];
+    std::atomic<uint8_t> shared;   // Middle buffer index | FRESH_BIT
+    uint8_t writeIndex;            // Owned by the producer
+    uint8_t readIndex;             // Owned by the consumer
+
+public:
+    SnapshotChannel() : shared(1), writeIndex(0), readIndex(2) {}
+
+    // Sets every buffer; only call before both tasks are running
+    void reset(const T& value) {
+        for (int i = 0; i < 3; i++) {
+            buffers[i] = value;
+        }
+        shared.store(1);
+        writeIndex = 0;
+        readIndex = 2;
+    }
+
+    // Producer side
+    void publish(const T& value) {
+        buffers[writeIndex] = value;
+        uint8_t previous = shared.exchange(writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+        writeIndex = previous & INDEX_MASK;
+    }
+
+    // Consumer side - picks up the latest snapshot; true if it is new
+    bool fetch() {
+        if (!(shared.load(std::memory_order_relaxed) & FRESH_BIT)) {
+            return false;
+        }
+        uint8_t previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    // Consumer side - stable until the next fetch()
+    const T& current() const { return buffers[readIndex]; }
+
+    // Either side - true while a snapshot is waiting to be fetched
+    bool hasFresh() const { return shared.load(std::memory_order_relaxed) & FRESH_BIT; }
+};
+
+#endif // SNAPSHOT_CHANNEL_H
@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Bounded single-producer / single-consumer ring.
+// The producer only writes tail and the consumer only writes head, so a
+// push or pop is one slot copy and one release store - no locks, and
+// neither side ever blocks. A full queue refuses the push.
+// N must be a power of two, so the 8-bit indices wrap cleanly;
+// T must be trivially copyable.
+template <typename T, uint8_t N>
+class SpscQueue {
+private:
+    static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two up to 128");
+    static const uint8_t MASK = N - 1;
+
+    T slots[N];
+    std::atomic<uint8_t> head;     // Next slot to pop - written by the consumer
+    std::atomic<uint8_t> tail;     // Next slot to fill - written by the producer
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer side - false when the queue is full
+    bool push(const T& value) {
+        uint8_t t = tail.load(std::memory_order_relaxed);
+        if ((uint8_t)(t - head.load(std::memory_order_acquire)) >= N) {
+            return false;
+        }
+        slots[t & MASK] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side - the oldest entry without removing it
+    bool peek(T& value) const {
+        uint8_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[h & MASK];
+        return true;
+    }
+
+    // Consumer side - drops the entry peek() returned
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Either side - a snapshot, exact only on the consumer
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif // SPSC_QUEUE_H
@@ -1,12 +1,40 @@
 #include "StorageManager.h"
+#include "BinaryProtocol.h"
+#include "BootTimeline.h"
+#include "Metrics.h"
+#include "TouchInput.h"
 
 const char* StorageManager::CONFIG_FILE_PATH = "/config.json";
+const char* StorageManager::JOURNAL_PATHS[2] = {"/config.0", "/config.1"};
+const char* StorageManager::JOURNAL_TEMP_PATH = "/config.tmp";
 
-StorageManager::StorageManager() {
+static const uint32_t JOURNAL_MAGIC = 0x42474643;       // "CFGB" - binary record
+static const uint32_t JSON_JOURNAL_MAGIC = 0x434F4E46;  // "CONF" - JSON payload, schema 0
+
+// Record layouts of older schemas, as they are on flash
+struct DisplayConfigV1 {
+    char wifiSSID[CONFIG_SSID_MAX];
+    char wifiPassword[CONFIG_PASSWORD_MAX];
+    char deviceName[CONFIG_NAME_MAX];
+    char userToken[CONFIG_TOKEN_MAX];
+    uint16_t mainColor;
+    bool registered;
+    bool wifiConfigured;
+};
+static_assert(sizeof(DisplayConfigV1) == 264, "Schema 1 layout is frozen");
+
+// Schema 3 only appended the WiFi lease, so a schema 2 record is its prefix
+static const size_t CONFIG_V2_SIZE = 288;
+static_assert(offsetof(DisplayConfig, wifiLease) == CONFIG_V2_SIZE, "Schema 2 layout is frozen");
+
+StorageManager::StorageManager() : loadMicros(0), writerTask(nullptr), dirty(false), journalSequence(0), flashWrites(0) {
+    configLock = xSemaphoreCreateMutex();
     setDefaultConfig();
 }
 
 bool StorageManager::begin() {
+    unsigned long start = micros();
+    
     if (!LittleFS.begin(true)) {  // format on failure
         Serial.println("LittleFS mount failed, formatting...");
         if (!LittleFS.format()) {
@@ -20,27 +48,161 @@ bool StorageManager::begin() {
     }
     
     Serial.println("LittleFS mounted successfully");
+    bootMark(BOOT_FS_MOUNTED);
     
     // Load existing configuration or create default
     if (!readConfigFile()) {
         Serial.println("No valid config found, creating default");
-        writeConfigFile();
+        markDirty();
     }
     
+    loadMicros = micros() - start;
+    Serial.printf("Config loaded in %lu us\n", loadMicros);
+    bootMark(BOOT_CONFIG_LOADED);
     return true;
 }
 
 void StorageManager::setDefaultConfig() {
-    config.wifiSSID = "";
-    config.wifiPassword = "";
-    config.deviceName = DEVICE_NAME;
-    config.userToken = "";
+    // Zeroed so unused field bytes in the flash record are deterministic
+    memset(&config, 0, sizeof(config));
+    strlcpy(config.deviceName, DEVICE_NAME, sizeof(config.deviceName));
+    TouchInput::defaultCalibration(config.touchMatrix);
     config.mainColor = COLOR_GREEN;  // Default to classic green
     config.registered = false;
     config.wifiConfigured = false;
 }
 
-bool StorageManager::readConfigFile() {
+DisplayConfig StorageManager::getConfig() const {
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    DisplayConfig copy = config;
+    xSemaphoreGive(configLock);
+    return copy;
+}
+
+// Setters call this with configLock held
+void StorageManager::markDirty() {
+    dirty = true;
+    if (writerTask) {
+        xTaskNotifyGive(writerTask);
+    }
+}
+
+void StorageManager::processWrites() {
+    // Sleep until a setter marks the config dirty
+    if (!dirty) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    
+    // Debounce - every further change restarts the window, up to a bound
+    unsigned long firstChange = millis();
+    while (millis() - firstChange < CONFIG_WRITE_MAX_DELAY_MS &&
+           ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_WRITE_DEBOUNCE_MS)) > 0) {
+    }
+    
+    if (!writeConfigFile()) {
+        // Keep the change and retry after another debounce period
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_WRITE_DEBOUNCE_MS));
+    }
+}
+
+bool StorageManager::readJournal(const char* path, DisplayConfig& record, uint32_t& sequence, bool& migrated) {
+    if (!LittleFS.exists(path)) {
+        return false;
+    }
+    
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return false;
+    }
+    
+    // Magic and sequence are shared by both layouts; JSON journals have no schema field
+    ConfigJournalHeader header;
+    uint8_t payload[CONFIG_MAX_BYTES];
+    const size_t common = offsetof(ConfigJournalHeader, schema);
+    bool valid = file.read((uint8_t*)&header, common) == common;
+    if (valid && header.magic == JSON_JOURNAL_MAGIC) {
+        header.schema = 0;
+        valid = file.read((uint8_t*)&header.length, 4) == 4;
+    } else {
+        valid = valid && header.magic == JOURNAL_MAGIC &&
+                file.read((uint8_t*)&header.schema, 6) == 6;
+    }
+    valid = valid && header.length <= sizeof(payload) &&
+            file.read(payload, header.length) == header.length &&
+            crc16(payload, header.length) == header.crc;
+    file.close();
+    
+    if (!valid) {
+        Serial.printf("Config journal %s is damaged, ignoring it\n", path);
+        return false;
+    }
+    
+    if (!migrateRecord(header.schema, payload, header.length, record)) {
+        Serial.printf("Config journal %s has unreadable schema %u\n", path, header.schema);
+        return false;
+    }
+    
+    sequence = header.sequence;
+    migrated = header.schema != CONFIG_SCHEMA_VERSION;
+    return true;
+}
+
+// Turns a payload of any known schema into the current record
+bool StorageManager::migrateRecord(uint16_t schema, const uint8_t* payload, size_t length, DisplayConfig& record) {
+    switch (schema) {
+        case 0: {
+            // JSON journal written before the binary record
+            JsonDocument doc;
+            if (deserializeJson(doc, (const char*)payload, length)) {
+                return false;
+            }
+            loadFromJson(doc, record);
+            return true;
+        }
+        case 1: {
+            // No touch calibration yet - start from the default matrix
+            DisplayConfigV1 v1;
+            if (length != sizeof(v1)) {
+                return false;
+            }
+            memcpy(&v1, payload, sizeof(v1));
+            memset(&record, 0, sizeof(record));
+            memcpy(record.wifiSSID, v1.wifiSSID, sizeof(v1.wifiSSID));
+            memcpy(record.wifiPassword, v1.wifiPassword, sizeof(v1.wifiPassword));
+            memcpy(record.deviceName, v1.deviceName, sizeof(v1.deviceName));
+            memcpy(record.userToken, v1.userToken, sizeof(v1.userToken));
+            record.mainColor = v1.mainColor;
+            record.registered = v1.registered;
+            record.wifiConfigured = v1.wifiConfigured;
+            TouchInput::defaultCalibration(record.touchMatrix);
+            break;
+        }
+        case 2:
+            // No WiFi lease yet - the first connect does a full scan
+            if (length != CONFIG_V2_SIZE) {
+                return false;
+            }
+            memset(&record, 0, sizeof(record));
+            memcpy(&record, payload, CONFIG_V2_SIZE);
+            break;
+        case CONFIG_SCHEMA_VERSION:
+            if (length != sizeof(DisplayConfig)) {
+                return false;
+            }
+            memcpy(&record, payload, sizeof(DisplayConfig));
+            break;
+        default:
+            return false;
+    }
+    
+    record.wifiSSID[CONFIG_SSID_MAX - 1] = '\0';
+    record.wifiPassword[CONFIG_PASSWORD_MAX - 1] = '\0';
+    record.deviceName[CONFIG_NAME_MAX - 1] = '\0';
+    record.userToken[CONFIG_TOKEN_MAX - 1] = '\0';
+    return true;
+}
+
+bool StorageManager::readLegacyConfig(DisplayConfig& record) {
     if (!LittleFS.exists(CONFIG_FILE_PATH)) {
         return false;
     }
@@ -59,72 +221,167 @@ bool StorageManager::readConfigFile() {
         Serial.printf("Config JSON parse error: %s\n", error.c_str());
         return false;
     }
+    loadFromJson(doc, record);
+    return true;
+}
+
+bool StorageManager::readConfigFile() {
+    // Newest valid journal copy wins; the other is the fallback
+    DisplayConfig record;
+    bool found = false;
+    bool migrated = false;
+    for (uint8_t i = 0; i < 2; i++) {
+        DisplayConfig candidate;
+        uint32_t sequence;
+        bool candidateMigrated;
+        if (readJournal(JOURNAL_PATHS[i], candidate, sequence, candidateMigrated) &&
+            (!found || sequence > journalSequence)) {
+            record = candidate;
+            journalSequence = sequence;
+            migrated = candidateMigrated;
+            found = true;
+        }
+    }
+    
+    // Pre-journal devices - moved into the journal on the next write
+    bool legacy = !found && readLegacyConfig(record);
+    if (!found && !legacy) {
+        return false;
+    }
     
-    // Load configuration values
-    config.wifiSSID = doc["wifi_ssid"] | "";
-    config.wifiPassword = doc["wifi_password"] | "";
-    config.deviceName = doc["device_name"] | DEVICE_NAME;
-    config.userToken = doc["user_token"] | "";
-    config.mainColor = doc["main_color"] | COLOR_GREEN;
-    config.registered = doc["registered"] | false;
-    config.wifiConfigured = doc["wifi_configured"] | false;
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    config = record;
+    if (migrated || legacy) {
+        markDirty();
+    }
+    xSemaphoreGive(configLock);
     
-    Serial.println("Configuration loaded successfully");
+    if (legacy) {
+        Serial.println("Configuration loaded from /config.json, migrating to journal");
+    } else {
+        Serial.printf("Configuration loaded successfully (journal %u%s)\n", journalSequence,
+                      migrated ? ", migrating to current schema" : "");
+    }
     return true;
 }
 
+void StorageManager::loadFromJson(JsonDocument& doc, DisplayConfig& record) {
+    memset(&record, 0, sizeof(record));
+    strlcpy(record.wifiSSID, doc["wifi_ssid"] | "", sizeof(record.wifiSSID));
+    strlcpy(record.wifiPassword, doc["wifi_password"] | "", sizeof(record.wifiPassword));
+    strlcpy(record.deviceName, doc["device_name"] | DEVICE_NAME, sizeof(record.deviceName));
+    strlcpy(record.userToken, doc["user_token"] | "", sizeof(record.userToken));
+    record.mainColor = doc["main_color"] | COLOR_GREEN;
+    record.registered = doc["registered"] | false;
+    record.wifiConfigured = doc["wifi_configured"] | false;
+    TouchInput::defaultCalibration(record.touchMatrix);
+}
+
 bool StorageManager::writeConfigFile() {
-    JsonDocument doc;
+    METRIC_BUSY(METRIC_TASK_STORAGE);
+    DisplayConfig record;
     
-    doc["wifi_ssid"] = config.wifiSSID;
-    doc["wifi_password"] = config.wifiPassword;
-    doc["device_name"] = config.deviceName;
-    doc["user_token"] = config.userToken;
-    doc["main_color"] = config.mainColor;
-    doc["registered"] = config.registered;
-    doc["wifi_configured"] = config.wifiConfigured;
+    // Snapshot under the lock; flash I/O happens without it
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    if (!dirty) {
+        xSemaphoreGive(configLock);
+        return true;
+    }
+    record = config;
+    dirty = false;
+    xSemaphoreGive(configLock);
     
-    File file = LittleFS.open(CONFIG_FILE_PATH, "w");
+    ConfigJournalHeader header;
+    header.magic = JOURNAL_MAGIC;
+    header.sequence = journalSequence + 1;
+    header.schema = CONFIG_SCHEMA_VERSION;
+    header.length = sizeof(record);
+    header.crc = crc16((const uint8_t*)&record, sizeof(record));
+    
+    // Complete copy in a temp file, then an atomic rename over the older
+    // slot - a power cut leaves either the old or the new copy intact
+    File file = LittleFS.open(JOURNAL_TEMP_PATH, "w");
     if (!file) {
         Serial.println("Failed to open config file for writing");
+        dirty = true;
         return false;
     }
     
-    if (serializeJson(doc, file) == 0) {
+    bool written = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                   file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    file.close();
+    
+    const char* slot = JOURNAL_PATHS[header.sequence % 2];
+    if (!written || !LittleFS.rename(JOURNAL_TEMP_PATH, slot)) {
         Serial.println("Failed to write config file");
-        file.close();
+        dirty = true;
         return false;
     }
     
-    file.close();
-    Serial.println("Configuration saved successfully");
+    journalSequence = header.sequence;
+    flashWrites++;
+    Serial.printf("Configuration saved successfully (journal %u, %u flash writes since boot)\n",
+                  journalSequence, flashWrites.load());
     return true;
 }
 
-void StorageManager::setWiFiCredentials(const String& ssid, const String& password) {
-    config.wifiSSID = ssid;
-    config.wifiPassword = password;
-    config.wifiConfigured = !ssid.isEmpty();
-    writeConfigFile();
+void StorageManager::setWiFiCredentials(const char* ssid, const char* password) {
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    if (strncmp(config.wifiSSID, ssid, sizeof(config.wifiSSID) - 1) != 0) {
+        memset(&config.wifiLease, 0, sizeof(config.wifiLease));  // Cached for the old network
+    }
+    strlcpy(config.wifiSSID, ssid, sizeof(config.wifiSSID));
+    strlcpy(config.wifiPassword, password, sizeof(config.wifiPassword));
+    config.wifiConfigured = ssid[0] != '\0';
+    markDirty();
+    xSemaphoreGive(configLock);
 }
 
-void StorageManager::setRegistrationData(const String& deviceName, const String& userToken) {
-    config.deviceName = deviceName;
-    config.userToken = userToken;
-    writeConfigFile();
+void StorageManager::setWiFiLease(const WiFiLease& lease) {
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    // Reconnects to the same AP hand back the same lease - skip the flash write
+    if (memcmp(&config.wifiLease, &lease, sizeof(lease)) != 0) {
+        config.wifiLease = lease;
+        markDirty();
+    }
+    xSemaphoreGive(configLock);
+}
+
+void StorageManager::setRegistrationData(const char* deviceName, const char* userToken) {
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    strlcpy(config.deviceName, deviceName, sizeof(config.deviceName));
+    strlcpy(config.userToken, userToken, sizeof(config.userToken));
+    markDirty();
+    xSemaphoreGive(configLock);
 }
 
 void StorageManager::setRegistered(bool registered) {
-    config.registered = registered;
-    writeConfigFile();
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    if (config.registered != registered) {
+        config.registered = registered;
+        markDirty();
+    }
+    xSemaphoreGive(configLock);
 }
 
 void StorageManager::setMainColor(uint16_t color) {
-    config.mainColor = color;
-    writeConfigFile();
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    // Re-selecting the current color from the settings page is no change
+    if (config.mainColor != color) {
+        config.mainColor = color;
+        markDirty();
+    }
+    xSemaphoreGive(configLock);
+}
+
+void StorageManager::setTouchCalibration(const int32_t matrix[TOUCH_MATRIX_SIZE]) {
+    xSemaphoreTake(configLock, portMAX_DELAY);
+    memcpy(config.touchMatrix, matrix, sizeof(config.touchMatrix));
+    markDirty();
+    xSemaphoreGive(configLock);
 }
 
 bool StorageManager::formatFileSystem() {
     Serial.println("Formatting file system...");
     return LittleFS.format();
-}
\ No newline at end of file
+}
@@ -3,52 +3,118 @@
 
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
 #include "DeviceConfig.h"
 
-// Configuration structure
+// Field sizes include the terminator
+#define CONFIG_SSID_MAX 33
+#define CONFIG_PASSWORD_MAX 65
+#define CONFIG_NAME_MAX 33
+#define CONFIG_TOKEN_MAX 129
+
+// Last association, so a reconnect can skip the channel scan and DHCP
+struct WiFiLease {
+    uint8_t bssid[6];
+    uint8_t channel;            // 0 = nothing cached
+    uint8_t reserved;
+    uint32_t ip;                // Addresses as IPAddress stores them
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t acquiredAt;        // UTC of the DHCP lease, 0 if the clock wasn't set
+};
+
+// Configuration structure - also the on-flash record of CONFIG_SCHEMA_VERSION,
+// so any layout change needs a version bump and a migration
 struct DisplayConfig {
-    String wifiSSID;
-    String wifiPassword;
-    String deviceName;
-    String userToken;
+    char wifiSSID[CONFIG_SSID_MAX];
+    char wifiPassword[CONFIG_PASSWORD_MAX];
+    char deviceName[CONFIG_NAME_MAX];
+    char userToken[CONFIG_TOKEN_MAX];
     uint16_t mainColor;         // COLOR_GREEN or COLOR_YELLOW
     bool registered;
     bool wifiConfigured;
+    int32_t touchMatrix[TOUCH_MATRIX_SIZE];  // Q16 calibration, since schema 2
+    WiFiLease wifiLease;                     // Since schema 3
 };
 
+#define CONFIG_SCHEMA_VERSION 3
+static_assert(sizeof(DisplayConfig) == 316, "DisplayConfig layout changed - bump CONFIG_SCHEMA_VERSION");
+
+// Header in front of every journal copy of the config
+struct ConfigJournalHeader {
+    uint32_t magic;
+    uint32_t sequence;          // Newest valid copy wins on boot
+    uint16_t schema;            // Payload layout version
+    uint16_t length;            // Payload bytes after the header
+    uint16_t crc;               // CRC-16 of the payload
+} __attribute__((packed));
+
 class StorageManager {
 private:
     DisplayConfig config;
     static const char* CONFIG_FILE_PATH;
+    static const char* JOURNAL_PATHS[2];
+    static const char* JOURNAL_TEMP_PATH;
+    unsigned long loadMicros;
+    
+    // Write-behind state - setters only mark the config dirty. dirty is
+    // cleared with the snapshot under configLock but also read by the
+    // storage task and set again after a failed write, so it is atomic
+    SemaphoreHandle_t configLock;
+    TaskHandle_t writerTask;
+    std::atomic<bool> dirty;
+    uint32_t journalSequence;
+    std::atomic<uint32_t> flashWrites;
     
     // File operations
     bool writeConfigFile();
     bool readConfigFile();
+    bool readJournal(const char* path, DisplayConfig& record, uint32_t& sequence, bool& migrated);
+    bool migrateRecord(uint16_t schema, const uint8_t* payload, size_t length, DisplayConfig& record);
+    bool readLegacyConfig(DisplayConfig& record);
+    static void loadFromJson(JsonDocument& doc, DisplayConfig& record);
     void setDefaultConfig();
+    void markDirty();
     
 public:
     StorageManager();
     
     bool begin();
     
-    // Configuration access
-    const DisplayConfig& getConfig() const { return config; }
+    // Storage task body - waits for changes, debounces, then writes
+    void setWriterTask(TaskHandle_t task) { writerTask = task; }
+    void processWrites();
+    
+    // Configuration access - a consistent copy, safe from any task
+    DisplayConfig getConfig() const;
     
     // WiFi configuration
-    void setWiFiCredentials(const String& ssid, const String& password);
+    void setWiFiCredentials(const char* ssid, const char* password);
+    void setWiFiLease(const WiFiLease& lease);
     bool hasWiFiCredentials() const { return config.wifiConfigured; }
     
     // Device registration
-    void setRegistrationData(const String& deviceName, const String& userToken);
+    void setRegistrationData(const char* deviceName, const char* userToken);
     void setRegistered(bool registered);
     bool isRegistered() const { return config.registered; }
     
     // Display settings
     void setMainColor(uint16_t color);
     uint16_t getMainColor() const { return config.mainColor; }
+    void setTouchCalibration(const int32_t matrix[TOUCH_MATRIX_SIZE]);
+    
+    // Flash writes of the config since boot, time begin() spent loading it
+    uint32_t getFlashWrites() const { return flashWrites; }
+    unsigned long getLoadMicros() const { return loadMicros; }
     
     // File system utilities
     bool formatFileSystem();
     size_t getTotalSpace() const { return LittleFS.totalBytes(); }
     size_t getUsedSpace() const { return LittleFS.usedBytes(); }
-};
\ No newline at end of file
+};
+
+#endif // STORAGE_MANAGER_H
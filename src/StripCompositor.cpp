@@ -0,0 +1,213 @@
+#include "StripCompositor.h"
+#include <soc/soc_memory_layout.h>
+#include "Metrics.h"
+
+#if COMPOSITE_STRIP_BUFFERS < 2
+    #error "COMPOSITE_STRIP_BUFFERS must be at least 2"
+#endif
+
+#define STRIP_FRAME_END 0xFF
+
+StripCompositor::StripCompositor() : current(0), ready(false), inFrame(false), dma(false) {
+    for (int i = 0; i < COMPOSITE_STRIP_BUFFERS; i++) {
+        strips[i] = nullptr;
+    }
+
+#ifdef RENDER_PIPELINE
+    // Created up front - the panel task blocks on the queue from setup()
+    panel = nullptr;
+    jobs = xQueueCreate(COMPOSITE_STRIP_BUFFERS + 1, sizeof(StripJob));
+    freeStrips = xQueueCreate(COMPOSITE_STRIP_BUFFERS, sizeof(uint8_t));
+    frameDone = xSemaphoreCreateBinary();
+    onBus = STRIP_FRAME_END;
+    transferring = false;
+#endif
+}
+
+bool StripCompositor::begin(TFT_eSPI& tft) {
+#ifdef RENDER_PIPELINE
+    if (!jobs || !freeStrips || !frameDone) {
+        Serial.println("Compositor: pipeline queues missing, using direct rendering");
+        return false;
+    }
+#endif
+
+    // TFT_eSPI puts sprites in PSRAM only while DMA is off, so DMA comes
+    // first unless the strips are meant for PSRAM
+#if COMPOSITE_USE_PSRAM
+    dma = false;
+#else
+    if (!tft.initDMA()) {
+        Serial.println("Compositor: DMA init failed, using direct rendering");
+        return false;
+    }
+    dma = true;
+#endif
+
+    for (int i = 0; i < COMPOSITE_STRIP_BUFFERS; i++) {
+        strips[i] = new TFT_eSprite(&tft);
+        strips[i]->setColorDepth(16);
+        strips[i]->setAttribute(PSRAM_ENABLE, COMPOSITE_USE_PSRAM);
+
+        if (strips[i]->createSprite(DISPLAY_WIDTH, COMPOSITE_STRIP_HEIGHT) == nullptr) {
+            Serial.println("Compositor: strip allocation failed, using direct rendering");
+            releaseStrips();
+            if (dma) {
+                tft.deInitDMA();
+                dma = false;
+            }
+            return false;
+        }
+
+        // malloc may still hand out PSRAM for large blocks
+        if (dma && !esp_ptr_dma_capable(strips[i]->getPointer())) {
+            Serial.println("Compositor: strip not in DMA-capable RAM, pushing without DMA");
+            tft.deInitDMA();
+            dma = false;
+        }
+    }
+
+#ifdef RENDER_PIPELINE
+    panel = &tft;
+    for (uint8_t i = 0; i < COMPOSITE_STRIP_BUFFERS; i++) {
+        xQueueSend(freeStrips, &i, 0);
+    }
+#endif
+
+    ready = true;
+    Serial.printf("Compositor: %d x %dx%d strips (%u bytes), %s%s\n", COMPOSITE_STRIP_BUFFERS, DISPLAY_WIDTH,
+                  COMPOSITE_STRIP_HEIGHT, (unsigned)COMPOSITE_STRIP_BUFFERS * DISPLAY_WIDTH * COMPOSITE_STRIP_HEIGHT * 2u,
+                  dma ? "DMA" : "blocking push",
+#ifdef RENDER_PIPELINE
+                  ", pipelined"
+#else
+                  ""
+#endif
+                  );
+    return true;
+}
+
+void StripCompositor::releaseStrips() {
+    for (int i = 0; i < COMPOSITE_STRIP_BUFFERS; i++) {
+        if (strips[i]) {
+            strips[i]->deleteSprite();
+            delete strips[i];
+            strips[i] = nullptr;
+        }
+    }
+}
+
+void StripCompositor::transfer(TFT_eSPI& tft, uint8_t buffer, int16_t y, int16_t h) {
+    uint16_t* pixels = (uint16_t*)strips[buffer]->getPointer();
+    if (dma) {
+        tft.pushImageDMA(0, y, DISPLAY_WIDTH, h, pixels);
+        return;
+    }
+
+    // Strips hold panel byte order, like pushSprite()
+    bool swap = tft.getSwapBytes();
+    tft.setSwapBytes(false);
+    tft.pushImage(0, y, DISPLAY_WIDTH, h, pixels);
+    tft.setSwapBytes(swap);
+}
+
+void StripCompositor::waitTransfer(TFT_eSPI& tft) {
+    if (dma) {
+        tft.dmaWait();
+    }
+}
+
+#ifdef RENDER_PIPELINE
+
+TFT_eSprite& StripCompositor::beginStrip(TFT_eSPI& tft) {
+    inFrame = true;
+
+    // Blocks only while every buffer is queued or on the bus
+    xQueueReceive(freeStrips, &current, portMAX_DELAY);
+    TFT_eSprite& strip = *strips[current];
+    strip.fillSprite(COLOR_BLACK);
+    return strip;
+}
+
+void StripCompositor::pushStrip(TFT_eSPI& tft, int16_t y, int16_t h) {
+    StripJob job = { current, y, h };
+    xQueueSend(jobs, &job, portMAX_DELAY);
+}
+
+void StripCompositor::endFrame(TFT_eSPI& tft) {
+    if (!inFrame) {
+        return;
+    }
+
+    StripJob job = { STRIP_FRAME_END, 0, 0 };
+    xQueueSend(jobs, &job, portMAX_DELAY);
+    xSemaphoreTake(frameDone, portMAX_DELAY);
+    inFrame = false;
+}
+
+void StripCompositor::processTransfers() {
+    StripJob job;
+    if (xQueueReceive(jobs, &job, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    METRIC_BUSY(METRIC_TASK_PANEL);
+
+    // SPI transactions belong to the task that opened them, so the panel
+    // task holds the bus from the first strip to the end of the frame
+    if (!transferring) {
+        panel->startWrite();
+        transferring = true;
+    }
+
+    // Only one transfer in flight: wait for the previous strip and hand
+    // its buffer back before queuing the next
+    if (onBus != STRIP_FRAME_END) {
+        waitTransfer(*panel);
+        xQueueSend(freeStrips, &onBus, 0);
+        onBus = STRIP_FRAME_END;
+    }
+
+    if (job.buffer == STRIP_FRAME_END) {
+        panel->endWrite();
+        transferring = false;
+        xSemaphoreGive(frameDone);
+        return;
+    }
+
+    transfer(*panel, job.buffer, job.y, job.h);
+    onBus = job.buffer;
+}
+
+#else
+
+TFT_eSprite& StripCompositor::beginStrip(TFT_eSPI& tft) {
+    if (!inFrame) {
+        tft.startWrite();
+        inFrame = true;
+    }
+
+    // The other buffer may still be on the bus - this one is free because
+    // pushStrip() waited for it before queuing its successor
+    TFT_eSprite& strip = *strips[current];
+    strip.fillSprite(COLOR_BLACK);
+    return strip;
+}
+
+void StripCompositor::pushStrip(TFT_eSPI& tft, int16_t y, int16_t h) {
+    // Only one transfer in flight: wait for the previous strip, then queue
+    waitTransfer(tft);
+    transfer(tft, current, y, h);
+    current = (current + 1) % COMPOSITE_STRIP_BUFFERS;
+}
+
+void StripCompositor::endFrame(TFT_eSPI& tft) {
+    if (!inFrame) {
+        return;
+    }
+
+    waitTransfer(tft);
+    tft.endWrite();
+    inFrame = false;
+}
+
+#endif // RENDER_PIPELINE
@@ -0,0 +1,74 @@
+#ifndef STRIP_COMPOSITOR_H
+#define STRIP_COMPOSITOR_H
+
+#include <TFT_eSPI.h>
+#include "DeviceConfig.h"
+
+#ifdef RENDER_PIPELINE
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#endif
+
+// Off-screen strips pushed to the panel with DMA.
+// While one strip is on the bus the next one is rendered into another
+// buffer, so a frame never appears half-built on the panel. Strips the DMA
+// cannot read (PSRAM) are pushed with blocking writes instead.
+//
+// With RENDER_PIPELINE the transfers run on a panel task: the renderer
+// takes free buffers and queues them, the panel task pushes them in order
+// and hands each buffer back once its DMA is done. endFrame() still waits
+// until the whole frame is on the panel, so the bus lock and the touch
+// reads see the same frame boundaries as without the pipeline.
+class StripCompositor {
+private:
+    TFT_eSprite* strips[COMPOSITE_STRIP_BUFFERS];
+    uint8_t current;           // Strip being rendered
+    bool ready;
+    bool inFrame;
+    bool dma;                  // Every strip is in DMA-capable RAM
+
+    void releaseStrips();
+    // Starts pushing one strip; with DMA it is on the bus until waitTransfer()
+    void transfer(TFT_eSPI& tft, uint8_t buffer, int16_t y, int16_t h);
+    void waitTransfer(TFT_eSPI& tft);
+
+#ifdef RENDER_PIPELINE
+    struct StripJob {
+        uint8_t buffer;        // STRIP_FRAME_END closes the frame
+        int16_t y, h;
+    };
+
+    TFT_eSPI* panel;
+    QueueHandle_t jobs;        // Renderer -> panel task, in push order
+    QueueHandle_t freeStrips;  // Panel task -> renderer, buffer indices
+    // Given when a frame is on the panel. Not a task notification: the
+    // display task's notification value carries its DISPLAY_EVENT_* bits
+    SemaphoreHandle_t frameDone;
+    uint8_t onBus;             // Panel task: buffer of the transfer in flight
+    bool transferring;         // Panel task: bus held since the first strip
+#endif
+
+public:
+    StripCompositor();
+
+    bool begin(TFT_eSPI& tft);
+    bool isReady() const { return ready; }
+    bool usesDMA() const { return dma; }
+
+    // Returns a cleared strip to render rows starting at y into
+    TFT_eSprite& beginStrip(TFT_eSPI& tft);
+
+    // Queues the current strip for DMA and switches to another buffer
+    void pushStrip(TFT_eSPI& tft, int16_t y, int16_t h);
+
+    // Waits for the last transfer so the bus is free for other users
+    void endFrame(TFT_eSPI& tft);
+
+#ifdef RENDER_PIPELINE
+    // Panel task body: blocks until a strip is queued, then pushes it
+    void processTransfers();
+#endif
+};
+
+#endif // STRIP_COMPOSITOR_H
@@ -0,0 +1,402 @@
+#include "TelemetryUplink.h"
+#include <limits.h>
+#include "SensorLog.h"
+#include "Metrics.h"
+
+static const char* SENSOR_KEYS[SENSOR_COUNT] = {SENSOR_1_KEY, SENSOR_2_KEY, SENSOR_3_KEY};
+
+// Just enough of a CBOR (RFC 8949) writer for a batch. Callers size the
+// buffer for the worst case, so there are no bounds checks per item.
+struct CborWriter {
+    uint8_t* out;
+    size_t length;
+
+    void head(uint8_t major, uint32_t value) {
+        major <<= 5;
+        if (value < 24) {
+            out[length++] = major | value;
+        } else if (value <= 0xFF) {
+            out[length++] = major | 24;
+            out[length++] = value;
+        } else if (value <= 0xFFFF) {
+            out[length++] = major | 25;
+            out[length++] = value >> 8;
+            out[length++] = value;
+        } else {
+            out[length++] = major | 26;
+            out[length++] = value >> 24;
+            out[length++] = value >> 16;
+            out[length++] = value >> 8;
+            out[length++] = value;
+        }
+    }
+    void unsignedInt(uint32_t value) { head(0, value); }
+    void text(const char* value) {
+        size_t size = strlen(value);
+        head(3, size);
+        memcpy(out + length, value, size);
+        length += size;
+    }
+    void array(uint32_t count) { head(4, count); }
+    void map(uint32_t count) { head(5, count); }
+    void null() { out[length++] = 0xF6; }
+    void float32(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out[length++] = 0xFA;
+        out[length++] = bits >> 24;
+        out[length++] = bits >> 16;
+        out[length++] = bits >> 8;
+        out[length++] = bits;
+    }
+};
+
+TelemetryUplink::TelemetryUplink() : ringHead(0), ringCount(0), lastSampleTime(0), oldestSampleAt(0), task(nullptr),
+    nextSequence(0), reservedSequence(0), queueFirst(0), queueEnd(0), queuedFiles(0), queueReady(false),
+    httpOpen(false), online(false), backoff(0), retryAt(0) {
+    lock = xSemaphoreCreateMutex();
+    deviceName[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TelemetryUplink::queuePath(uint32_t sequence, char* path, size_t size) {
+    snprintf(path, size, TELEMETRY_DIRECTORY "/%08lx.cbr", (unsigned long)sequence);
+}
+
+bool TelemetryUplink::begin(const char* device) {
+    strlcpy(deviceName, device, sizeof(deviceName));
+
+    if (!LittleFS.exists(TELEMETRY_DIRECTORY) && !LittleFS.mkdir(TELEMETRY_DIRECTORY)) {
+        Serial.println("Telemetry: failed to create " TELEMETRY_DIRECTORY ", sending without a queue");
+        return false;
+    }
+
+    // Only names are read here - queued batches stay on flash until sent
+    File directory = LittleFS.open(TELEMETRY_DIRECTORY);
+    if (!directory || !directory.isDirectory()) {
+        Serial.println("Telemetry: failed to open " TELEMETRY_DIRECTORY);
+        return false;
+    }
+    for (File entry = directory.openNextFile(); entry; entry = directory.openNextFile()) {
+        // name() is the full path on some LittleFS versions - parse the basename
+        const char* name = strrchr(entry.name(), '/');
+        name = name ? name + 1 : entry.name();
+        char* suffix;
+        uint32_t sequence = strtoul(name, &suffix, 16);
+        if (strcmp(suffix, ".cbr") == 0) {
+            if (queuedFiles == 0 || sequence < queueFirst) queueFirst = sequence;
+            if (queuedFiles == 0 || sequence >= queueEnd) queueEnd = sequence + 1;
+            queuedFiles++;
+        }
+        entry.close();
+    }
+    directory.close();
+
+    // Numbers up to the persisted reservation may have been sent before the
+    // reset - continue above it so the server never sees one twice
+    File file = LittleFS.open(TELEMETRY_SEQUENCE_PATH, "r");
+    if (file) {
+        if (file.read((uint8_t*)&nextSequence, sizeof(nextSequence)) != sizeof(nextSequence)) {
+            nextSequence = 0;
+        }
+        file.close();
+    }
+    if (queuedFiles > 0 && queueEnd > nextSequence) {
+        nextSequence = queueEnd;
+    }
+    reservedSequence = nextSequence;  // First batch reserves a new block
+
+    queueReady = true;
+    Serial.printf("Telemetry: %u batches queued, next sequence %lu, uplink to %s\n", queuedFiles,
+                  (unsigned long)nextSequence, TELEMETRY_URL);
+    return true;
+}
+
+void TelemetryUplink::append(uint32_t time, const float* values, uint8_t validMask) {
+    // Unset clock, nothing to send, or faster than the uplink interval
+    if (time < LOG_MIN_VALID_TIME || validMask == 0 ||
+        (lastSampleTime && time < lastSampleTime + TELEMETRY_SAMPLE_INTERVAL)) {
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (ringCount == TELEMETRY_RING_SAMPLES) {
+        // Uplink task is stuck in a slow POST - the log on flash still has these
+        ringHead = (ringHead + 1) % TELEMETRY_RING_SAMPLES;
+        ringCount--;
+        stats.samplesDropped++;
+    }
+    TelemetrySample& sample = ring[(ringHead + ringCount) % TELEMETRY_RING_SAMPLES];
+    sample.time = time;
+    memcpy(sample.values, values, sizeof(sample.values));
+    sample.validMask = validMask;
+    if (ringCount++ == 0) {
+        oldestSampleAt = millis();
+    }
+    lastSampleTime = time;
+    bool full = ringCount >= TELEMETRY_BATCH_SAMPLES;
+    xSemaphoreGive(lock);
+
+    if (full && task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void TelemetryUplink::setOnline(bool up) {
+    online = up;
+    if (up && task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+bool TelemetryUplink::batchDue() const {
+    return ringCount >= TELEMETRY_BATCH_SAMPLES ||
+           (ringCount > 0 && millis() - oldestSampleAt >= TELEMETRY_BATCH_MAX_AGE_MS);
+}
+
+bool TelemetryUplink::sendDue() const {
+    return online && (backoff == 0 || (long)(millis() - retryAt) >= 0);
+}
+
+TickType_t TelemetryUplink::nextWait() const {
+    if (batchDue() || (queuedFiles > 0 && sendDue())) {
+        return 0;
+    }
+
+    unsigned long now = millis();
+    unsigned long wait = ULONG_MAX;
+    if (ringCount > 0) {
+        wait = oldestSampleAt + TELEMETRY_BATCH_MAX_AGE_MS - now;
+    }
+    if (queuedFiles > 0 && online && retryAt - now < wait) {
+        wait = retryAt - now;
+    }
+    return wait == ULONG_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait);
+}
+
+void TelemetryUplink::process() {
+    // Sleep until a batch fills or ages out, WiFi comes up, or a retry is due
+    ulTaskNotifyTake(pdTRUE, nextWait());
+    METRIC_BUSY(METRIC_TASK_TELEMETRY);
+
+    if (!online && httpOpen) {
+        // The socket died with the link
+        http.end();
+        httpOpen = false;
+    }
+
+    if (batchDue()) {
+        uint32_t sequence = takeSequence();
+        size_t length = encodeBatch(sequence);
+
+        // Queued batches go first - a new one only skips the queue when it's empty
+        PostResult result = POST_RETRY;
+        if (queuedFiles == 0 && sendDue()) {
+            result = post(batch, length, sequence);
+        }
+        if (result == POST_RETRY) {
+            enqueue(sequence, batch, length);
+        }
+    }
+
+    drainQueue();
+}
+
+uint32_t TelemetryUplink::takeSequence() {
+    if (nextSequence >= reservedSequence) {
+        // Persist the end of a new block - one flash write per block of batches.
+        // Written aside and renamed, so a reset never leaves a torn number.
+        reservedSequence = nextSequence + TELEMETRY_SEQUENCE_BLOCK;
+        File file = LittleFS.open(TELEMETRY_SEQUENCE_PATH ".tmp", "w");
+        if (file) {
+            bool written = file.write((const uint8_t*)&reservedSequence, sizeof(reservedSequence)) ==
+                           sizeof(reservedSequence);
+            file.close();
+            if (written) {
+                LittleFS.rename(TELEMETRY_SEQUENCE_PATH ".tmp", TELEMETRY_SEQUENCE_PATH);
+            }
+        }
+    }
+    return nextSequence++;
+}
+
+// Takes up to a batch of samples out of the ring and encodes them into `batch`
+size_t TelemetryUplink::encodeBatch(uint32_t sequence) {
+    TelemetrySample samples[TELEMETRY_BATCH_SAMPLES];
+    uint8_t count = 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    while (ringCount > 0 && count < TELEMETRY_BATCH_SAMPLES) {
+        samples[count++] = ring[ringHead];
+        ringHead = (ringHead + 1) % TELEMETRY_RING_SAMPLES;
+        ringCount--;
+    }
+    oldestSampleAt = millis();
+    xSemaphoreGive(lock);
+
+    // {"dev", "type", "seq", "t0", "keys": [...], "s": [[dt, v1, v2, ...], ...]}
+    // Missing sensors are null, times are seconds after t0
+    CborWriter writer = {batch, 0};
+    writer.map(6);
+    writer.text("dev");
+    writer.text(deviceName);
+    writer.text("type");
+    writer.text(DEVICE_TYPE_STR);
+    writer.text("seq");
+    writer.unsignedInt(sequence);
+    writer.text("t0");
+    writer.unsignedInt(samples[0].time);
+    writer.text("keys");
+    writer.array(SENSOR_COUNT);
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        writer.text(SENSOR_KEYS[i]);
+    }
+    writer.text("s");
+    writer.array(count);
+    for (uint8_t n = 0; n < count; n++) {
+        writer.array(1 + SENSOR_COUNT);
+        writer.unsignedInt(samples[n].time - samples[0].time);
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if (samples[n].validMask & (1 << i)) {
+                writer.float32(samples[n].values[i]);
+            } else {
+                writer.null();
+            }
+        }
+    }
+
+    stats.samplesBatched += count;
+    return writer.length;
+}
+
+PostResult TelemetryUplink::post(const uint8_t* body, size_t length, uint32_t sequence) {
+    unsigned long start = millis();
+
+    if (!httpOpen) {
+        // One connection for every batch - reused while the server keeps it alive
+        http.setReuse(true);
+        http.setTimeout(TELEMETRY_HTTP_TIMEOUT_MS);
+        if (!http.begin(TELEMETRY_URL)) {
+            postFailed(-1);
+            return POST_RETRY;
+        }
+        http.addHeader("Content-Type", "application/cbor");
+        httpOpen = true;
+    }
+
+    int code = http.POST((uint8_t*)body, length);
+    if (code > 0) {
+        http.getString();  // Read the response out so the connection stays usable
+    } else {
+        http.end();
+        httpOpen = false;
+    }
+
+    if (code >= 200 && code < 300) {
+        backoff = 0;
+        stats.batchesSent++;
+        stats.bytesSent += length;
+        stats.lastPostMillis = millis() - start;
+        Serial.printf("Telemetry: batch %lu sent, %u bytes in %lu ms\n", (unsigned long)sequence, (unsigned)length,
+                      (unsigned long)stats.lastPostMillis);
+        return POST_SENT;
+    }
+    if (code >= 400 && code < 500 && code != 408 && code != 429) {
+        // Retrying a batch the server can't accept would block the queue forever
+        Serial.printf("Telemetry: batch %lu refused (HTTP %d), dropped\n", (unsigned long)sequence, code);
+        stats.batchesDropped++;
+        return POST_REJECTED;
+    }
+
+    postFailed(code);
+    return POST_RETRY;
+}
+
+void TelemetryUplink::postFailed(int code) {
+    backoff = backoff == 0 ? TELEMETRY_BACKOFF_MIN_MS : min(backoff * 2, (unsigned long)TELEMETRY_BACKOFF_MAX_MS);
+    retryAt = millis() + backoff;
+    stats.postFailures++;
+    Serial.printf("Telemetry: POST failed (%d), retry in %lu ms\n", code, backoff);
+}
+
+bool TelemetryUplink::enqueue(uint32_t sequence, const uint8_t* body, size_t length) {
+    if (!queueReady) {
+        stats.batchesDropped++;
+        return false;
+    }
+
+    while (queuedFiles >= TELEMETRY_QUEUE_BATCHES) {
+        evictOldest();
+    }
+
+    char path[24];
+    queuePath(sequence, path, sizeof(path));
+    File file = LittleFS.open(path, "w");
+    size_t written = file ? file.write(body, length) : 0;
+    if (file) {
+        file.close();
+    }
+    if (written != length) {
+        Serial.printf("Telemetry: failed to queue batch %lu\n", (unsigned long)sequence);
+        LittleFS.remove(path);
+        stats.batchesDropped++;
+        return false;
+    }
+
+    if (queuedFiles++ == 0) {
+        queueFirst = sequence;
+    }
+    queueEnd = sequence + 1;
+    stats.batchesQueued++;
+    return true;
+}
+
+void TelemetryUplink::evictOldest() {
+    char path[24];
+    for (; queueFirst < queueEnd; queueFirst++) {
+        queuePath(queueFirst, path, sizeof(path));
+        if (LittleFS.exists(path)) {
+            LittleFS.remove(path);
+            queueFirst++;
+            queuedFiles--;
+            stats.batchesDropped++;
+            return;
+        }
+    }
+    queuedFiles = 0;  // Count was off - the range is empty
+}
+
+// Sends queued batches oldest first until one fails or a new batch is due
+void TelemetryUplink::drainQueue() {
+    char path[24];
+
+    while (queuedFiles > 0 && queueFirst < queueEnd && sendDue() && !batchDue()) {
+        queuePath(queueFirst, path, sizeof(path));
+        if (!LittleFS.exists(path)) {
+            queueFirst++;  // Gap left by a reboot
+            continue;
+        }
+
+        File file = LittleFS.open(path, "r");
+        size_t length = file ? file.read(batch, sizeof(batch)) : 0;
+        if (file) {
+            file.close();
+        }
+
+        // An unreadable file is as good as a refused batch
+        if (length == 0) {
+            stats.batchesDropped++;
+        }
+        if (length == 0 || post(batch, length, queueFirst) != POST_RETRY) {
+            LittleFS.remove(path);
+            queueFirst++;
+            queuedFiles--;
+        } else {
+            return;
+        }
+    }
+
+    if (queuedFiles == 0 || queueFirst >= queueEnd) {
+        queuedFiles = 0;
+    }
+}
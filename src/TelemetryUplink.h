@@ -0,0 +1,119 @@
+#ifndef TELEMETRY_UPLINK_H
+#define TELEMETRY_UPLINK_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "DeviceConfig.h"
+#include "StorageManager.h"
+
+#define TELEMETRY_DIRECTORY "/tlm"
+#define TELEMETRY_SEQUENCE_PATH TELEMETRY_DIRECTORY "/seq"
+#define TELEMETRY_SEQUENCE_BLOCK 256        // Sequence numbers reserved per flash write
+
+// Worst case CBOR batch: header, then per sample an array header, a 5 byte
+// time offset and a float32 or null per sensor
+#define TELEMETRY_BATCH_MAX_BYTES (160 + TELEMETRY_BATCH_SAMPLES * (6 + 5 * SENSOR_COUNT))
+
+struct TelemetrySample {
+    uint32_t time;
+    float values[SENSOR_COUNT];
+    uint8_t validMask;
+};
+
+enum PostResult : uint8_t {
+    POST_SENT,
+    POST_RETRY,                // Network or server error - keep the batch
+    POST_REJECTED              // Server refused the batch itself - drop it
+};
+
+struct TelemetryStats {
+    uint32_t samplesBatched;
+    uint32_t batchesSent;
+    uint32_t bytesSent;
+    uint32_t batchesQueued;    // Written to the flash queue while offline
+    uint32_t batchesDropped;   // Evicted from a full queue or refused by the server
+    uint32_t samplesDropped;   // Sample ring overflowed before a batch was cut
+    uint32_t postFailures;
+    uint32_t lastPostMillis;   // Duration of the last successful POST
+};
+
+// Batched sensor uplink. Samples are taken at TELEMETRY_SAMPLE_INTERVAL
+// into a RAM ring; the uplink task cuts them into CBOR batches and POSTs
+// them over one kept-alive connection to TELEMETRY_URL. A batch that can't
+// be sent - offline, server error, or older batches still waiting - goes to
+// a bounded queue of files on LittleFS, which drains oldest first, so the
+// server sees batches in sequence order. Every batch carries a sequence
+// number that survives reboots; delivery is at-least-once and the server
+// drops repeats by (device, seq).
+class TelemetryUplink {
+private:
+    // Samples not yet in a batch - producer side
+    TelemetrySample ring[TELEMETRY_RING_SAMPLES];
+    uint8_t ringHead;
+    uint8_t ringCount;
+    uint32_t lastSampleTime;
+    unsigned long oldestSampleAt;
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+
+    // Batch encoding - uplink task only
+    uint8_t batch[TELEMETRY_BATCH_MAX_BYTES];
+    char deviceName[CONFIG_NAME_MAX];
+    uint32_t nextSequence;
+    uint32_t reservedSequence;  // Sequence numbers below this are persisted as used
+
+    // Flash queue: one file per batch, named by sequence. Sequences in
+    // [queueFirst, queueEnd) may have gaps - a reboot skips to a new block
+    uint32_t queueFirst;
+    uint32_t queueEnd;
+    uint32_t queuedFiles;
+    bool queueReady;
+
+    // Connection
+    HTTPClient http;
+    bool httpOpen;
+    std::atomic<bool> online;
+    unsigned long backoff;
+    unsigned long retryAt;
+
+    TelemetryStats stats;
+
+    static void queuePath(uint32_t sequence, char* path, size_t size);
+
+    bool batchDue() const;
+    bool sendDue() const;
+    TickType_t nextWait() const;
+    size_t encodeBatch(uint32_t sequence);
+    uint32_t takeSequence();
+    PostResult post(const uint8_t* body, size_t length, uint32_t sequence);
+    void postFailed(int code);
+    bool enqueue(uint32_t sequence, const uint8_t* body, size_t length);
+    void evictOldest();
+    void drainQueue();
+
+public:
+    TelemetryUplink();
+
+    // Scans the flash queue and restores the sequence; call once LittleFS is up
+    bool begin(const char* device);
+
+    // Producer side - never touches flash or the network
+    void append(uint32_t time, const float* values, uint8_t validMask);
+
+    // Uplink task body - blocks until a batch is due, WiFi comes up or a retry is due
+    void setTask(TaskHandle_t handle) { task = handle; }
+    void process();
+
+    // WiFi task - link state; coming up retries the queue at once
+    void setOnline(bool up);
+
+    const TelemetryStats& getStats() const { return stats; }
+    uint32_t getQueuedBatches() const { return queuedFiles; }
+};
+
+#endif // TELEMETRY_UPLINK_H
@@ -0,0 +1,202 @@
+#include "TouchInput.h"
+#include "Metrics.h"
+
+#ifdef TOUCH_IRQ_PIN
+static TaskHandle_t touchIrqTask = nullptr;
+
+static void IRAM_ATTR onTouchInterrupt() {
+    BaseType_t woken = pdFALSE;
+    if (touchIrqTask) {
+        vTaskNotifyGiveFromISR(touchIrqTask, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+TouchInput::TouchInput() : tft(nullptr), busLock(nullptr), touchTask(nullptr), displayTask(nullptr), displayEvent(0),
+    penDown(false), moved(false), longPressSent(false), filteredX(0), filteredY(0), startX(0), startY(0), lastX(0),
+    lastY(0), dragY(0), downTime(0), samples(0), droppedGestures(0) {
+    gestures = xQueueCreate(TOUCH_GESTURE_QUEUE, sizeof(TouchGesture));
+    defaultCalibration(matrix);
+}
+
+void TouchInput::begin(TFT_eSPI& panel, SemaphoreHandle_t lock, TaskHandle_t display, uint32_t event) {
+    // Must run on the task that calls process()
+    tft = &panel;
+    busLock = lock;
+    displayTask = display;
+    displayEvent = event;
+    touchTask = xTaskGetCurrentTaskHandle();
+    
+#ifdef TOUCH_IRQ_PIN
+    touchIrqTask = touchTask;
+    pinMode(TOUCH_IRQ_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN), onTouchInterrupt, FALLING);
+#endif
+    
+    Serial.printf("Touch: %s, %u ms samples, matrix %ld %ld %ld / %ld %ld %ld\n",
+#ifdef TOUCH_IRQ_PIN
+                  "PENIRQ",
+#else
+                  "polled",
+#endif
+                  TOUCH_SAMPLE_INTERVAL_MS, (long)matrix[0], (long)matrix[1], (long)matrix[2],
+                  (long)matrix[3], (long)matrix[4], (long)matrix[5]);
+}
+
+void TouchInput::defaultCalibration(int32_t calibration[TOUCH_MATRIX_SIZE]) {
+    int32_t scaleX = ((int32_t)DISPLAY_WIDTH << TOUCH_MATRIX_SHIFT) / (TOUCH_RAW_X_MAX - TOUCH_RAW_X_MIN);
+    int32_t scaleY = ((int32_t)DISPLAY_HEIGHT << TOUCH_MATRIX_SHIFT) / (TOUCH_RAW_Y_MAX - TOUCH_RAW_Y_MIN);
+    calibration[0] = scaleX;
+    calibration[1] = 0;
+    calibration[2] = -scaleX * TOUCH_RAW_X_MIN;
+    calibration[3] = 0;
+    calibration[4] = scaleY;
+    calibration[5] = -scaleY * TOUCH_RAW_Y_MIN;
+}
+
+void TouchInput::setCalibration(const int32_t calibration[TOUCH_MATRIX_SIZE]) {
+    // An all-zero matrix maps every press to one corner - keep the default
+    if (calibration[0] == 0 && calibration[1] == 0 && calibration[3] == 0 && calibration[4] == 0) {
+        return;
+    }
+    memcpy(matrix, calibration, sizeof(matrix));
+}
+
+bool TouchInput::readRaw(uint16_t& rawX, uint16_t& rawY) {
+    uint16_t xs[TOUCH_MEDIAN_SAMPLES];
+    uint16_t ys[TOUCH_MEDIAN_SAMPLES];
+    
+    // Between frames only - the panel and the controller share the bus
+    xSemaphoreTake(busLock, portMAX_DELAY);
+    bool pressed = tft->getTouchRawZ() >= TOUCH_Z_THRESHOLD;
+    for (uint8_t i = 0; pressed && i < TOUCH_MEDIAN_SAMPLES; i++) {
+        tft->getTouchRaw(&xs[i], &ys[i]);
+    }
+    // Lifting the pen mid-burst leaves the tail of the burst unreliable
+    pressed = pressed && tft->getTouchRawZ() >= TOUCH_Z_THRESHOLD;
+    xSemaphoreGive(busLock);
+    
+    if (!pressed) {
+        return false;
+    }
+    
+    // Median rejects single-read spikes; insertion sort of 5 values
+    for (uint8_t i = 1; i < TOUCH_MEDIAN_SAMPLES; i++) {
+        for (uint8_t j = i; j > 0 && xs[j - 1] > xs[j]; j--) {
+            uint16_t t = xs[j]; xs[j] = xs[j - 1]; xs[j - 1] = t;
+        }
+        for (uint8_t j = i; j > 0 && ys[j - 1] > ys[j]; j--) {
+            uint16_t t = ys[j]; ys[j] = ys[j - 1]; ys[j - 1] = t;
+        }
+    }
+    rawX = xs[TOUCH_MEDIAN_SAMPLES / 2];
+    rawY = ys[TOUCH_MEDIAN_SAMPLES / 2];
+    return true;
+}
+
+void TouchInput::process() {
+    if (penDown) {
+        vTaskDelay(pdMS_TO_TICKS(TOUCH_SAMPLE_INTERVAL_MS));
+    } else {
+#ifdef TOUCH_IRQ_PIN
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#else
+        vTaskDelay(pdMS_TO_TICKS(TOUCH_POLL_INTERVAL_MS));
+#endif
+    }
+    METRIC_BUSY(METRIC_TASK_TOUCH);
+    
+    uint16_t rawX, rawY;
+    if (!readRaw(rawX, rawY)) {
+        if (penDown) {
+            onPenUp();
+        }
+#ifdef TOUCH_IRQ_PIN
+        // Edges caused by our own conversions and the release are not presses
+        ulTaskNotifyTake(pdTRUE, 0);
+#endif
+        return;
+    }
+    samples++;
+    
+    int32_t x = (matrix[0] * rawX + matrix[1] * rawY + matrix[2]) >> TOUCH_MATRIX_SHIFT;
+    int32_t y = (matrix[3] * rawX + matrix[4] * rawY + matrix[5]) >> TOUCH_MATRIX_SHIFT;
+    x = constrain(x, 0, DISPLAY_WIDTH - 1);
+    y = constrain(y, 0, DISPLAY_HEIGHT - 1);
+    
+    // IIR in 1/16 pixel so small steps are not lost to truncation;
+    // restarted at every pen-down so the first sample has no lag
+    if (!penDown) {
+        filteredX = x << 4;
+        filteredY = y << 4;
+        onPenDown(x, y);
+        return;
+    }
+    filteredX += ((x << 4) - filteredX) >> TOUCH_IIR_SHIFT;
+    filteredY += ((y << 4) - filteredY) >> TOUCH_IIR_SHIFT;
+    onPenMove(filteredX >> 4, filteredY >> 4);
+}
+
+void TouchInput::onPenDown(int16_t x, int16_t y) {
+    penDown = true;
+    moved = false;
+    longPressSent = false;
+    startX = lastX = x;
+    startY = lastY = dragY = y;
+    downTime = millis();
+}
+
+void TouchInput::onPenMove(int16_t x, int16_t y) {
+    lastX = x;
+    lastY = y;
+    
+    if (abs(x - startX) > TOUCH_TAP_SLOP_PX || abs(y - startY) > TOUCH_TAP_SLOP_PX) {
+        moved = true;
+    }
+    
+    if (!moved && !longPressSent && millis() - downTime >= TOUCH_LONG_PRESS_MS) {
+        longPressSent = true;
+        emit(GESTURE_LONG_PRESS);
+    }
+    
+    // Mostly vertical travel scrolls while the pen is still down
+    if (moved && !longPressSent && abs(y - startY) > abs(x - startX) && abs(y - dragY) >= TOUCH_DRAG_STEP_PX) {
+        emit(GESTURE_DRAG, y - dragY);
+        dragY = y;
+    }
+}
+
+void TouchInput::onPenUp() {
+    penDown = false;
+    
+    int16_t dx = lastX - startX;
+    int16_t dy = lastY - startY;
+    
+    if (longPressSent) {
+        return;
+    }
+    
+    // Mostly horizontal travel - a swipe between tabs
+    if (abs(dx) >= TOUCH_SWIPE_MIN_PX && abs(dx) > 2 * abs(dy)) {
+        emit(dx < 0 ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT);
+    } else if (!moved) {
+        emit(GESTURE_TAP);
+    }
+}
+
+void TouchInput::emit(GestureKind kind, int16_t dy) {
+    TouchGesture gesture;
+    gesture.kind = kind;
+    gesture.x = startX;
+    gesture.y = startY;
+    gesture.dy = dy;
+    gesture.timestamp = micros();
+    
+    if (xQueueSend(gestures, &gesture, 0) != pdTRUE) {
+        droppedGestures++;
+    }
+    if (displayTask) {
+        xTaskNotify(displayTask, displayEvent, eSetBits);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef TOUCH_INPUT_H
+#define TOUCH_INPUT_H
+
+#include <TFT_eSPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "DeviceConfig.h"
+
+// Calibration matrix, Q16 fixed point:
+//   x = (m[0] * rawX + m[1] * rawY + m[2]) >> 16
+//   y = (m[3] * rawX + m[4] * rawY + m[5]) >> 16
+// An affine map covers offset, scale, rotation and swapped axes.
+// Stored in DisplayConfig::touchMatrix.
+
+enum GestureKind : uint8_t {
+    GESTURE_TAP,
+    GESTURE_LONG_PRESS,        // Fires once while the pen is still down
+    GESTURE_SWIPE_LEFT,
+    GESTURE_SWIPE_RIGHT,
+    GESTURE_DRAG               // Vertical travel while the pen is down, in dy
+};
+
+struct TouchGesture {
+    GestureKind kind;
+    int16_t x, y;              // Where the pen went down
+    int16_t dy;                // GESTURE_DRAG only
+    uint32_t timestamp;        // micros() of the sample that completed the gesture
+};
+
+// Touch sampling on its own task.
+// The task sleeps until PENIRQ (or the idle poll interval), then samples
+// every TOUCH_SAMPLE_INTERVAL_MS while the pen is down. Each sample is the
+// median of a burst of raw reads, smoothed by an IIR filter and mapped to
+// screen coordinates with the calibration matrix. A gesture recogniser turns
+// the pen track into taps, long presses, swipes and vertical drags, which are
+// queued for the display task. The touch controller shares the SPI bus with
+// the panel, so every read holds the bus lock that the display task holds
+// while drawing.
+class TouchInput {
+private:
+    TFT_eSPI* tft;
+    SemaphoreHandle_t busLock;
+    QueueHandle_t gestures;
+    TaskHandle_t touchTask;
+    TaskHandle_t displayTask;
+    uint32_t displayEvent;
+    int32_t matrix[TOUCH_MATRIX_SIZE];
+    
+    // Pen track
+    bool penDown;
+    bool moved;                // Left the tap slop - no tap or long press
+    bool longPressSent;
+    int32_t filteredX, filteredY;
+    int16_t startX, startY;
+    int16_t lastX, lastY;
+    int16_t dragY;             // Position of the last drag event
+    unsigned long downTime;
+    uint32_t samples;
+    uint32_t droppedGestures;
+    
+    bool readRaw(uint16_t& rawX, uint16_t& rawY);
+    void onPenDown(int16_t x, int16_t y);
+    void onPenMove(int16_t x, int16_t y);
+    void onPenUp();
+    void emit(GestureKind kind, int16_t dy = 0);
+    
+public:
+    TouchInput();
+    
+    void begin(TFT_eSPI& panel, SemaphoreHandle_t lock, TaskHandle_t display, uint32_t event);
+    void setCalibration(const int32_t calibration[TOUCH_MATRIX_SIZE]);
+    static void defaultCalibration(int32_t calibration[TOUCH_MATRIX_SIZE]);
+    
+    // Touch task body - blocks until the pen is down or the next sample is due
+    void process();
+    
+    // Display task side - false once the queue is empty
+    bool nextGesture(TouchGesture& gesture) { return xQueueReceive(gestures, &gesture, 0) == pdTRUE; }
+    
+    uint32_t getSamples() const { return samples; }
+    uint32_t getDroppedGestures() const { return droppedGestures; }
+};
+
+#endif // TOUCH_INPUT_H
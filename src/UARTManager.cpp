@@ -1,11 +1,41 @@
 #include "UARTManager.h"
+#include "BootTimeline.h"
+#include "Metrics.h"
 
-UARTManager::UARTManager() : serial(&Serial2), lastSensorRequest(0), lastStatusRequest(0), lastResponse(0), displayManager(nullptr) {
+UARTManager::UARTManager() : serial(&Serial2), lastSensorRequest(0), lastStatusRequest(0), lastResponse(0),
+    rxTask(nullptr), lastStatsReport(0), lastStatsBytes(0), protocol(PROTOCOL_JSON), helloAttempts(0), lastHello(0),
+    txSeq(0), corruptFrames(0), parseErrors(0), txBytes(0), lastStatsTxBytes(0), subscribed(false), subscribeAttempts(0),
+    lastSubscribe(0), lastKeyframe(0), displayManager(nullptr), sensorLog(nullptr), telemetry(nullptr),
+    commands(nullptr) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        sensorState.values[i] = 0.0;
+        sensorState.valid[i] = false;
+    }
+    sensorState.lastUpdate = 0;
+    
+    linkStatus.mainDeviceConnected = false;
+    linkStatus.wifiConnected = false;
+    linkStatus.lastError[0] = '\0';
+    linkStatus.lastUpdate = 0;
 }
 
 void UARTManager::begin() {
+    // Must run on the task that calls processMessages()
+    rxTask = xTaskGetCurrentTaskHandle();
+    if (commands) {
+        commands->setTask(rxTask);
+    }
+    
+    serial->setRxBufferSize(UART_RX_BUFFER_SIZE);
     serial->begin(UART_BAUD_RATE, SERIAL_8N1, 16, 17);  // RX=16, TX=17 for ESP32-S3
-    serial->setTimeout(100);  // 100ms timeout for serial reads
+    
+    // Wake the UART task on FIFO threshold and on the RX idle timeout that
+    // follows each message, instead of polling
+    serial->onReceive([this]() {
+        if (rxTask) {
+            xTaskNotifyGive(rxTask);
+        }
+    }, false);
     
     Serial.println("UART Manager initialized");
 }
@@ -13,170 +43,450 @@ void UARTManager::begin() {
 void UARTManager::processMessages() {
     unsigned long currentTime = millis();
     
-    // Send periodic requests
-    if (currentTime - lastSensorRequest >= SENSOR_REQUEST_INTERVAL) {
-        requestSensorData();
-        lastSensorRequest = currentTime;
+    // Offer the binary protocol; old main-device firmware ignores the hello
+    if (protocol == PROTOCOL_JSON && helloAttempts < MAX_HELLO_ATTEMPTS &&
+        (helloAttempts == 0 || currentTime - lastHello >= HELLO_INTERVAL)) {
+        sendHello();
     }
     
+    // A silent binary link may be a peer that rebooted into old firmware
+    if (protocol == PROTOCOL_BINARY && !isMainDeviceConnected()) {
+        Serial.println("Binary link silent, falling back to JSON");
+        setProtocol(PROTOCOL_JSON);
+        framer.reset();
+        helloAttempts = 0;
+        subscribed = false;
+        subscribeAttempts = 0;
+        if (commands) {
+            commands->peerLost();
+        }
+    }
+    
+    // Ask the main device to push changes instead of being polled
+    if (!subscribed && subscribeAttempts < MAX_SUBSCRIBE_ATTEMPTS &&
+        (subscribeAttempts == 0 || currentTime - lastSubscribe >= SUBSCRIBE_INTERVAL)) {
+        sendSubscribe();
+    }
+    
+    // Missing keyframes mean the peer dropped the subscription
+    if (subscribed && currentTime - lastKeyframe > 2 * KEYFRAME_INTERVAL) {
+        Serial.println("Sensor stream lapsed, falling back to polling");
+        subscribed = false;
+        subscribeAttempts = 0;
+    }
+    
+    // The stream carries sensors only - status is always polled
     if (currentTime - lastStatusRequest >= STATUS_REQUEST_INTERVAL) {
         requestStatus();
         lastStatusRequest = currentTime;
     }
+    unsigned long waitTime = STATUS_REQUEST_INTERVAL - (currentTime - lastStatusRequest);
     
-    // Process incoming messages
-    while (serial->available()) {
-        String message = serial->readStringUntil('\n');
-        message.trim();
-        
-        if (message.length() > 0) {
-            processIncomingMessage(message);
-            lastResponse = currentTime;
+    if (!subscribed) {
+        if (currentTime - lastSensorRequest >= SENSOR_REQUEST_INTERVAL) {
+            requestSensorData();
+            lastSensorRequest = currentTime;
         }
+        waitTime = min(waitTime, SENSOR_REQUEST_INTERVAL - (currentTime - lastSensorRequest));
+    } else {
+        waitTime = min(waitTime, KEYFRAME_INTERVAL);
     }
     
-    // Update connection status based on last response time
+    if (commands) {
+        waitTime = min(waitTime, commands->nextWait(currentTime));
+    }
+    
+    // Sleep until data arrives, a button is pressed or the next deadline
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitTime));
+    METRIC_BUSY(METRIC_TASK_UART);
+    
+    readAvailable();
+    processCommands();
+    
+    currentTime = millis();
+    reportStats(currentTime);
+    
+    // Tell the display when the link comes up or goes down; WiFi and the
+    // last error stay as the main device last reported them
+    bool connected = isMainDeviceConnected();
+    if (connected != linkStatus.mainDeviceConnected) {
+        linkStatus.mainDeviceConnected = connected;
+        linkStatus.lastUpdate = currentTime;
+        publishStatus();
+    }
+}
+
+void UARTManager::publishStatus() {
     if (displayManager) {
-        SystemStatus status;
-        status.mainDeviceConnected = isMainDeviceConnected();
-        status.wifiConnected = WiFi.status() == WL_CONNECTED;
-        status.lastUpdate = currentTime;
-        status.lastError = "";
+        displayManager->updateSystemStatus(linkStatus);
+    }
+}
+
+void UARTManager::readAvailable() {
+    int available;
+    
+    while ((available = serial->available()) > 0) {
+        // Read straight into the framer's buffer
+        size_t space;
+        uint8_t* dest = framer.writePtr(space);
+        size_t count = serial->read(dest, min((size_t)available, space));
+        framer.commit(count);
         
-        displayManager->updateSystemStatus(status);
+        char* line;
+        size_t length;
+        while (framer.nextLine(line, length)) {
+            METRIC_TIMER(parseStart);
+            if (protocol == PROTOCOL_BINARY) {
+                // Corrupted frames are dropped before any parsing
+                if (processBinaryFrame((uint8_t*)line, length)) {
+                    lastResponse = millis();
+                    bootMark(BOOT_FIRST_UART_RESPONSE);
+                }
+            } else {
+                processIncomingMessage(line, length);
+                lastResponse = millis();
+                bootMark(BOOT_FIRST_UART_RESPONSE);
+            }
+            METRIC_RECORD_SINCE(HISTOGRAM_UART_PARSE, parseStart);
+            METRIC_COUNT(COUNTER_UART_MESSAGES, 1);
+        }
+    }
+}
+
+void UARTManager::reportStats(unsigned long currentTime) {
+    unsigned long elapsed = currentTime - lastStatsReport;
+    if (elapsed < STATS_REPORT_INTERVAL) {
+        return;
     }
+    
+    const FramerStats& stats = framer.getStats();
+    uint32_t rxPerSecond = (uint64_t)(stats.bytesReceived - lastStatsBytes) * 1000 / elapsed;
+    uint32_t txPerSecond = (uint64_t)(txBytes - lastStatsTxBytes) * 1000 / elapsed;
+    Serial.printf("UART (%s, %s): rx %u B/s, tx %u B/s, %u frames, max frame %u, %u overflows, %u corrupt, %u unparsable\n",
+                  protocol == PROTOCOL_BINARY ? "binary" : "json", subscribed ? "streaming" : "polling",
+                  rxPerSecond, txPerSecond, stats.linesFramed, stats.maxLineLength, stats.overflows, corruptFrames, parseErrors);
+    
+    reportCommandStats();
+    
+    lastStatsBytes = stats.bytesReceived;
+    lastStatsTxBytes = txBytes;
+    lastStatsReport = currentTime;
 }
 
-void UARTManager::processIncomingMessage(const String& message) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, message);
+void UARTManager::reportCommandStats() {
+    if (!commands) return;
     
-    if (error) {
-        Serial.printf("JSON parse error: %s\n", error.c_str());
+    const CommandStats& stats = commands->getStats();
+    if (stats.submitted == 0 && stats.dropped == 0) {
         return;
     }
     
-    // Check if this is sensor data or status data
-    #ifdef DEVICE_TYPE_ENVIRONMENT
-        if (doc.containsKey("temp") || doc.containsKey("humidity") || doc.containsKey("air_pressure")) {
-            parseSensorData(doc);
+    // Cumulative since boot
+    Serial.printf("Commands: %u sent, %u retries, %u coalesced, %u acked, %u refused, %u timed out, %u unconfirmed, %u dropped, %u late acks\n",
+                  stats.sent, stats.retries, stats.coalesced, stats.acked, stats.refused, stats.timedOut,
+                  stats.unconfirmed, stats.dropped, stats.lateAcks);
+    const HdrHistogram& touchToAck = commands->getTouchToAck();
+    if (touchToAck.count() > 0) {
+        Serial.printf("Commands: touch to ack p50 %u us, p90 %u us, p99 %u us, max %u us; wire %u us p50\n",
+                      touchToAck.percentile(500), touchToAck.percentile(900), touchToAck.percentile(990),
+                      touchToAck.max(), commands->getWireRtt().percentile(500));
+    }
+}
+
+void UARTManager::processIncomingMessage(char* message, size_t length) {
+    // Single pass over the framer's buffer into a stack result - no heap
+    ParsedMessage parsed;
+    if (!parseMessage(message, length, parsed)) {
+        parseErrors++;
+        Serial.println("Message parse error");
+        return;
+    }
+    
+    // Acknowledged manual command
+    if (parsed.fields & FIELD_ACK) {
+        if (commands) {
+            commands->acknowledge(parsed.ackId, !(parsed.fields & FIELD_ERROR), micros());
         }
-    #elif DEVICE_TYPE_LIQUID
-        if (doc.containsKey("ph") || doc.containsKey("ec") || doc.containsKey("water_temp")) {
-            parseSensorData(doc);
+        return;
+    }
+    
+    // Reply to our hello - switch the link to binary frames
+    if (parsed.fields & FIELD_HELLO) {
+        if (strcmp(parsed.hello, BINARY_PROTOCOL_NAME) == 0) {
+            setProtocol(PROTOCOL_BINARY);
         }
-    #endif
+        return;
+    }
+    
+    // Subscription accepted - stop polling for sensor data
+    if (parsed.fields & FIELD_SUBSCRIBED) {
+        subscribed = parsed.subscribed;
+        if (subscribed) {
+            lastKeyframe = millis();
+            Serial.printf("Sensor stream active at up to %d Hz\n",
+                          (parsed.fields & FIELD_MAX_HZ) ? parsed.maxRateHz : (int)STREAM_MAX_RATE_HZ);
+        }
+        return;
+    }
     
-    if (doc.containsKey("status")) {
-        parseStatusData(doc);
+    // Check if this is sensor data or status data
+    if (parsed.fields & (FIELD_SENSORS | FIELD_KEYFRAME)) {
+        parseSensorData(parsed);
+    }
+    
+    if (parsed.fields & FIELD_STATUS) {
+        parseStatusData(parsed);
     }
 }
 
-void UARTManager::parseSensorData(JsonDocument& doc) {
-    if (!displayManager) return;
+void UARTManager::parseSensorData(const ParsedMessage& parsed) {
+    // Sensor field bits line up with the sensor index
+    uint8_t fieldMask = parsed.fields & FIELD_SENSORS;
+    
+    // Polled replies and keyframes carry every valid field, deltas only changes
+    bool fullUpdate = !subscribed || parsed.keyframe;
+    applySensorUpdate(parsed.sensorValues, fieldMask, fullUpdate);
+}
+
+void UARTManager::applySensorUpdate(const float* values, uint8_t fieldMask, bool fullUpdate) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (fieldMask & (1 << i)) {
+            sensorState.values[i] = values[i];
+            sensorState.valid[i] = true;
+        } else if (fullUpdate) {
+            sensorState.valid[i] = false;
+        }
+    }
     
-    SensorData data;
-    data.lastUpdate = millis();
+    sensorState.lastUpdate = millis();
+    if (fullUpdate) {
+        lastKeyframe = sensorState.lastUpdate;
+    }
     
-    #ifdef DEVICE_TYPE_ENVIRONMENT
-        // Environment sensors: temperature, humidity, air_pressure
-        data.values[0] = doc["temp"] | 0.0;
-        data.values[1] = doc["humidity"] | 0.0;
-        data.values[2] = doc["air_pressure"] | 0.0;
-        
-        data.valid[0] = doc.containsKey("temp");
-        data.valid[1] = doc.containsKey("humidity");
-        data.valid[2] = doc.containsKey("air_pressure");
-        
-    #elif DEVICE_TYPE_LIQUID
-        // Liquid sensors: ph, ec, water_temp
-        data.values[0] = doc["ph"] | 0.0;
-        data.values[1] = doc["ec"] | 0.0;
-        data.values[2] = doc["water_temp"] | 0.0;
-        
-        data.valid[0] = doc.containsKey("ph");
-        data.valid[1] = doc.containsKey("ec");
-        data.valid[2] = doc.containsKey("water_temp");
-    #endif
+    // The log and the uplink sample the merged state at their own intervals
+    if (sensorLog || telemetry) {
+        uint8_t validMask = 0;
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if (sensorState.valid[i]) validMask |= 1 << i;
+        }
+        uint32_t now = time(nullptr);
+        if (sensorLog) {
+            sensorLog->append(now, sensorState.values, validMask);
+        }
+        if (telemetry) {
+            telemetry->append(now, sensorState.values, validMask);
+        }
+    }
     
-    displayManager->updateSensorData(data);
+    if (displayManager) {
+        // Only fields carried by this message are new samples
+        displayManager->getHistory().record(values, fieldMask, sensorState.lastUpdate);
+        displayManager->updateSensorData(sensorState);
+    }
+}
+
+void UARTManager::parseStatusData(const ParsedMessage& parsed) {
+    linkStatus.mainDeviceConnected = true;  // We received a response
+    linkStatus.wifiConnected = parsed.wifiConnected;
+    linkStatus.lastUpdate = millis();
+    strlcpy(linkStatus.lastError, parsed.error, sizeof(linkStatus.lastError));
     
-    Serial.println("Sensor data updated");
+    publishStatus();
 }
 
-void UARTManager::parseStatusData(JsonDocument& doc) {
-    if (!displayManager) return;
+void UARTManager::setProtocol(LinkProtocol newProtocol) {
+    protocol = newProtocol;
     
-    SystemStatus status;
-    status.mainDeviceConnected = true;  // We received a response
-    status.wifiConnected = doc["wifi_connected"] | false;
-    status.lastUpdate = millis();
+    if (protocol == PROTOCOL_BINARY) {
+        framer.setDelimiter(0x00, false);
+        Serial.println("UART link switched to binary protocol");
+    } else {
+        framer.setDelimiter('\n', true);
+    }
+}
+
+void UARTManager::sendHello() {
+    TxLine message;
+    message.appendf("{\"cmd\":\"hello\",\"proto\":\"%s\"}\n", BINARY_PROTOCOL_NAME);
+    write((const uint8_t*)message.c_str(), message.length());
     
-    if (doc.containsKey("error")) {
-        status.lastError = doc["error"].as<String>();
+    helloAttempts++;
+    lastHello = millis();
+}
+
+void UARTManager::sendSubscribe() {
+    if (protocol == PROTOCOL_BINARY) {
+        SubscribePayload payload = { STREAM_MAX_RATE_HZ, (uint16_t)KEYFRAME_INTERVAL };
+        sendPacket(MSG_SUBSCRIBE, &payload, sizeof(payload));
     } else {
-        status.lastError = "";
+        TxLine message;
+        message.appendf("{\"cmd\":\"subscribe\",\"max_hz\":%u,\"keyframe_ms\":%lu}\n",
+                        STREAM_MAX_RATE_HZ, KEYFRAME_INTERVAL);
+        write((const uint8_t*)message.c_str(), message.length());
+    }
+    
+    subscribeAttempts++;
+    lastSubscribe = millis();
+}
+
+void UARTManager::write(const uint8_t* data, size_t length) {
+    serial->write(data, length);
+    txBytes += length;
+}
+
+void UARTManager::sendPacket(uint8_t msgId, const void* payload, size_t length) {
+    uint8_t frame[BINARY_MAX_FRAME];
+    size_t frameLength = encodeFrame(msgId, txSeq++, payload, length, frame);
+    
+    if (frameLength > 0) {
+        write(frame, frameLength);
+    }
+}
+
+void UARTManager::processCommands() {
+    if (!commands) return;
+    
+    // New presses and due retries
+    CommandFrame frame;
+    while (commands->nextFrame(millis(), frame)) {
+        sendManualFrame(frame);
     }
     
-    displayManager->updateSystemStatus(status);
+    CommandStates states;
+    if (displayManager && commands->takeStates(states)) {
+        displayManager->updateCommandStates(states);
+    }
 }
 
-void UARTManager::sendCommand(const String& cmd) {
-    JsonDocument doc;
-    doc["cmd"] = cmd;
+void UARTManager::sendManualFrame(const CommandFrame& frame) {
+    if (protocol == PROTOCOL_BINARY) {
+        ManualPayload payload = { frame.control, frame.argument, frame.id };
+        sendPacket(MSG_MANUAL, &payload, sizeof(payload));
+        return;
+    }
     
-    String message;
-    serializeJson(doc, message);
+    TxLine message;
+    message.appendf("{\"cmd\":\"%s\"", frame.name);
+    if (frame.control == CONTROL_PUMP) {
+        message.appendf(",\"pump\":%u", frame.argument);
+    }
+    message.appendf(",\"id\":%u}", frame.id);
     
-    serial->println(message);
     Serial.printf("Sent command: %s\n", message.c_str());
+    message += '\n';
+    write((const uint8_t*)message.c_str(), message.length());
 }
 
-void UARTManager::sendCommand(const String& cmd, int value) {
-    JsonDocument doc;
-    doc["cmd"] = cmd;
+bool UARTManager::processBinaryFrame(uint8_t* frame, size_t length) {
+    BinaryPacket packet;
+    if (!decodeFrame(frame, length, packet)) {
+        corruptFrames++;
+        return false;
+    }
     
-    #ifdef DEVICE_TYPE_LIQUID
-        if (cmd == "manual_pump") {
-            doc["pump"] = value;
+    switch (packet.msgId) {
+        case MSG_SENSORS: {
+            if (packet.payloadLength < sizeof(SensorPayload)) break;
+            
+            SensorPayload payload;
+            memcpy(&payload, packet.payload, sizeof(payload));
+            
+            float values[SENSOR_COUNT];
+            memcpy(values, payload.values, sizeof(values));
+            applySensorUpdate(values, payload.validMask, true);
+            break;
+        }
+        
+        case MSG_SENSOR_UPDATE: {
+            if (packet.payloadLength < sizeof(SensorUpdateHeader)) break;
+            
+            SensorUpdateHeader header;
+            memcpy(&header, packet.payload, sizeof(header));
+            
+            // One float per changed field, in sensor order
+            float values[SENSOR_COUNT] = {};
+            size_t offset = sizeof(header);
+            for (int i = 0; i < SENSOR_COUNT; i++) {
+                if (!(header.fieldMask & (1 << i))) continue;
+                if (offset + sizeof(float) > packet.payloadLength) return true;
+                memcpy(&values[i], packet.payload + offset, sizeof(float));
+                offset += sizeof(float);
+            }
+            applySensorUpdate(values, header.fieldMask, header.flags & UPDATE_FLAG_KEYFRAME);
+            break;
         }
-    #endif
+        
+        case MSG_SUBSCRIBED: {
+            if (packet.payloadLength < sizeof(SubscribedPayload)) break;
+            
+            SubscribedPayload payload;
+            memcpy(&payload, packet.payload, sizeof(payload));
+            subscribed = true;
+            lastKeyframe = millis();
+            Serial.printf("Sensor stream active at up to %d Hz\n", payload.maxRateHz);
+            break;
+        }
+        
+        case MSG_STATUS: {
+            if (packet.payloadLength < sizeof(StatusPayload)) break;
+            
+            StatusPayload payload;
+            memcpy(&payload, packet.payload, sizeof(payload));
+            
+            size_t errorLength = min((size_t)payload.errorLength, packet.payloadLength - sizeof(payload));
+            errorLength = min(errorLength, sizeof(linkStatus.lastError) - 1);
+            memcpy(linkStatus.lastError, packet.payload + sizeof(payload), errorLength);
+            linkStatus.lastError[errorLength] = '\0';
+            
+            linkStatus.mainDeviceConnected = true;
+            linkStatus.wifiConnected = payload.flags & STATUS_FLAG_WIFI_CONNECTED;
+            linkStatus.lastUpdate = millis();
+            publishStatus();
+            break;
+        }
+        
+        case MSG_MANUAL_ACK: {
+            if (packet.payloadLength < sizeof(ManualAckPayload)) break;
+            
+            ManualAckPayload payload;
+            memcpy(&payload, packet.payload, sizeof(payload));
+            if (commands) {
+                commands->acknowledge(payload.id, payload.result == MANUAL_RESULT_OK, micros());
+            }
+            break;
+        }
+        
+        default:
+            Serial.printf("Unknown binary message 0x%02X\n", packet.msgId);
+            break;
+    }
     
-    String message;
-    serializeJson(doc, message);
+    return true;
+}
+
+void UARTManager::sendCommand(const char* cmd) {
+    TxLine message;
+    message.appendf("{\"cmd\":\"%s\"}", cmd);
     
-    serial->println(message);
     Serial.printf("Sent command: %s\n", message.c_str());
+    message += '\n';
+    write((const uint8_t*)message.c_str(), message.length());
 }
 
 void UARTManager::requestSensorData() {
-    sendCommand("get_sensors");
+    if (protocol == PROTOCOL_BINARY) {
+        sendPacket(MSG_GET_SENSORS, nullptr, 0);
+    } else {
+        sendCommand("get_sensors");
+    }
 }
 
 void UARTManager::requestStatus() {
-    sendCommand("get_status");
-}
-
-void UARTManager::sendManualCommand(const String& command) {
-    #ifdef DEVICE_TYPE_ENVIRONMENT
-        if (command == "lights") {
-            sendCommand("manual_lights");
-        } else if (command == "spray") {
-            sendCommand("manual_spray");
-        }
-    #elif DEVICE_TYPE_LIQUID
-        if (command == "probe") {
-            sendCommand("manual_probe");
-        }
-    #endif
-}
-
-void UARTManager::sendManualCommand(const String& command, int pumpNumber) {
-    #ifdef DEVICE_TYPE_LIQUID
-        if (command == "pump" && pumpNumber >= 1 && pumpNumber <= 5) {
-            sendCommand("manual_pump", pumpNumber);
-        }
-    #endif
+    if (protocol == PROTOCOL_BINARY) {
+        sendPacket(MSG_GET_STATUS, nullptr, 0);
+    } else {
+        sendCommand("get_status");
+    }
 }
 
 bool UARTManager::isMainDeviceConnected() const {
@@ -2,9 +2,26 @@
 #define UART_MANAGER_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include "DeviceConfig.h"
 #include "DisplayManager.h"
+#include "LineFramer.h"
+#include "BinaryProtocol.h"
+#include "MessageParser.h"
+#include "SensorLog.h"
+#include "TelemetryUplink.h"
+#include "CommandPipeline.h"
+#include "FixedString.h"
+
+// Outgoing JSON lines are built in place - command names are fixed
+// identifiers, so nothing needs escaping
+#define UART_TX_LINE_MAX 64
+typedef FixedString<UART_TX_LINE_MAX> TxLine;
+
+// Wire format negotiated with the main device
+enum LinkProtocol : uint8_t {
+    PROTOCOL_JSON,
+    PROTOCOL_BINARY
+};
 
 class UARTManager {
 private:
@@ -13,21 +30,75 @@ private:
     unsigned long lastStatusRequest;
     unsigned long lastResponse;
     
+    // Event-driven receive
+    LineFramer framer;
+    TaskHandle_t rxTask;
+    unsigned long lastStatsReport;
+    uint32_t lastStatsBytes;
+    
+    // Protocol negotiation
+    LinkProtocol protocol;
+    uint8_t helloAttempts;
+    unsigned long lastHello;
+    uint8_t txSeq;
+    uint32_t corruptFrames;
+    uint32_t parseErrors;
+    uint32_t txBytes;
+    uint32_t lastStatsTxBytes;
+    
+    // Status as last handed to the display
+    SystemStatus linkStatus;
+    
+    // Sensor streaming - polling is the fallback
+    SensorData sensorState;
+    bool subscribed;
+    uint8_t subscribeAttempts;
+    unsigned long lastSubscribe;
+    unsigned long lastKeyframe;
+    
     // Request intervals
     static const unsigned long SENSOR_REQUEST_INTERVAL = 2000;  // 2 seconds
     static const unsigned long STATUS_REQUEST_INTERVAL = 5000;  // 5 seconds
+    static const unsigned long STATS_REPORT_INTERVAL = 10000;   // 10 seconds
+    static const unsigned long HELLO_INTERVAL = 5000;           // 5 seconds
+    static const uint8_t MAX_HELLO_ATTEMPTS = 3;
+    static const unsigned long SUBSCRIBE_INTERVAL = 5000;       // 5 seconds
+    static const uint8_t MAX_SUBSCRIBE_ATTEMPTS = 3;
+    static const uint8_t STREAM_MAX_RATE_HZ = 10;
+    static const unsigned long KEYFRAME_INTERVAL = 4000;        // Below UART_TIMEOUT_MS
+    
+    // Receive path
+    void readAvailable();
+    void reportStats(unsigned long currentTime);
+    void setProtocol(LinkProtocol newProtocol);
+    
+    // Binary protocol
+    void sendHello();
+    void sendSubscribe();
+    void write(const uint8_t* data, size_t length);
+    void sendPacket(uint8_t msgId, const void* payload, size_t length);
+    void sendManualFrame(const CommandFrame& frame);
+    bool processBinaryFrame(uint8_t* frame, size_t length);
     
     // JSON processing
-    void processIncomingMessage(const String& message);
-    void sendCommand(const String& cmd);
-    void sendCommand(const String& cmd, int value);
+    void processIncomingMessage(char* message, size_t length);
+    void sendCommand(const char* cmd);
     
     // Data parsing
-    void parseSensorData(JsonDocument& doc);
-    void parseStatusData(JsonDocument& doc);
+    void parseSensorData(const ParsedMessage& parsed);
+    void parseStatusData(const ParsedMessage& parsed);
+    void publishStatus();
+    void applySensorUpdate(const float* values, uint8_t fieldMask, bool fullUpdate);
+    
+    // Manual commands - transmissions and acks, results to the display
+    void processCommands();
+    void reportCommandStats();
     
     // External references
     DisplayManager* displayManager;
+    SensorLog* sensorLog;
+    TelemetryUplink* telemetry;
+    CommandPipeline* commands;
     
 public:
     UARTManager();
@@ -35,13 +106,20 @@ public:
     void begin();
     void processMessages();
     void setDisplayManager(DisplayManager* dm) { displayManager = dm; }
+    void setSensorLog(SensorLog* log) { sensorLog = log; }
+    void setTelemetry(TelemetryUplink* uplink) { telemetry = uplink; }
+    void setCommandPipeline(CommandPipeline* pipeline) { commands = pipeline; }
     
     // Command sending
     void requestSensorData();
     void requestStatus();
-    void sendManualCommand(const String& command);
-    void sendManualCommand(const String& command, int pumpNumber);
     
     // Connection status
     bool isMainDeviceConnected() const;
-};
\ No newline at end of file
+    const FramerStats& getRxStats() const { return framer.getStats(); }
+    LinkProtocol getProtocol() const { return protocol; }
+    bool isStreaming() const { return subscribed; }
+    const SensorData& getSensorState() const { return sensorState; }
+};
+
+#endif // UART_MANAGER_H
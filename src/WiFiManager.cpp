@@ -1,140 +1,411 @@
 #include "WiFiManager.h"
 #include <HTTPClient.h>
+#include <limits.h>
+#include "BootTimeline.h"
+#include "SensorLog.h"
+#include "Metrics.h"
 
-WiFiManager::WiFiManager() : lastConnectionAttempt(0), lastScanTime(0), connectionAttempts(0) {
+WiFiManager* WiFiManager::instance = nullptr;
+
+WiFiManager::WiFiManager() : state(WIFI_STATE_IDLE), fastAttempt(false), cachedIP(false), failedAttempts(0),
+    deadline(0), fullScanAt(0), attemptStart(0), disconnectedAt(0), lastReconnectMillis(0), registerAt(0), leaseMillis(0),
+    leaseStampPending(false), storageManager(nullptr), scanChannel(0), scanInFlight(false), scanPending(false),
+    scanStart(0), lastScanTime(0), displayManager(nullptr), telemetry(nullptr) {
     credentials.valid = false;
     registration.registered = false;
+    memset(&lease, 0, sizeof(lease));
+    memset(&scanResults, 0, sizeof(scanResults));
+    eventQueue = xQueueCreate(WIFI_EVENT_QUEUE, sizeof(WiFiMessage));
+    instance = this;
 }
 
 void WiFiManager::begin() {
+    // The state machine owns reconnects; the driver must not retry on its own
+    // or keep its own copy of the credentials in flash
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.onEvent(onWiFiEvent);
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
     
     Serial.println("WiFi Manager initialized");
+    
+    if (credentials.valid) {
+        scheduleConnect(0);
+    }
+}
+
+// Runs on the WiFi driver's event task - only forwards to the WiFi task
+void WiFiManager::onWiFiEvent(arduino_event_t* event) {
+    WiFiMessage message = {};
+    switch (event->event_id) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            message.type = WIFI_MSG_GOT_IP;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            message.type = WIFI_MSG_DISCONNECTED;
+            message.reason = event->event_info.wifi_sta_disconnected.reason;
+            break;
+        case ARDUINO_EVENT_WIFI_SCAN_DONE:
+            message.type = WIFI_MSG_SCAN_DONE;
+            break;
+        default:
+            return;
+    }
+    if (instance) {
+        xQueueSend(instance->eventQueue, &message, 0);
+    }
+}
+
+void WiFiManager::requestScan() {
+    WiFiMessage message = {WIFI_MSG_SCAN_REQUEST, 0};
+    xQueueSend(eventQueue, &message, 0);
 }
 
 void WiFiManager::handleConnection() {
-    unsigned long currentTime = millis();
-    
-    if (!credentials.valid) {
-        // No credentials configured
-        return;
+    WiFiMessage message;
+    bool received = xQueueReceive(eventQueue, &message, nextWait()) == pdTRUE;
+    METRIC_BUSY(METRIC_TASK_WIFI);
+    if (received) {
+        do {
+            handleMessage(message);
+        } while (xQueueReceive(eventQueue, &message, 0) == pdTRUE);
     }
+    handleTimers();
+}
+
+// Time until the next timer is due - forever while only events can move us
+TickType_t WiFiManager::nextWait() const {
+    unsigned long now = millis();
+    unsigned long wait = ULONG_MAX;
     
-    if (WiFi.status() == WL_CONNECTED) {
-        // Already connected, check registration status
+    if (state == WIFI_STATE_CONNECTING || state == WIFI_STATE_BACKOFF) {
+        wait = (long)(deadline - now) > 0 ? deadline - now : 0;
+    } else if (state == WIFI_STATE_CONNECTED) {
         if (!registration.registered && !registration.userToken.isEmpty()) {
-            if (registerWithServer()) {
-                registration.registered = true;
-                Serial.println("Device registered successfully");
-            }
+            wait = (long)(registerAt - now) > 0 ? registerAt - now : 0;
         }
-        return;
+        if (leaseStampPending && wait > 1000) {
+            wait = 1000;  // Poll for the NTP clock
+        }
+    }
+    
+    if (scanPending && !scanInFlight && state != WIFI_STATE_CONNECTING) {
+        wait = 0;
+    }
+    return wait == ULONG_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait);
+}
+
+void WiFiManager::handleMessage(const WiFiMessage& message) {
+    switch (message.type) {
+        case WIFI_MSG_GOT_IP:
+            if (state == WIFI_STATE_CONNECTING) {
+                onConnected();
+            }
+            break;
+        
+        case WIFI_MSG_DISCONNECTED:
+            // Our own disconnect() and begin() report ASSOC_LEAVE - the state
+            // machine has already moved on
+            if (message.reason == WIFI_REASON_ASSOC_LEAVE) {
+                break;
+            }
+            if (state == WIFI_STATE_CONNECTED) {
+                Serial.printf("WiFi lost (reason %u), reconnecting\n", message.reason);
+                disconnectedAt = millis();
+                leaseStampPending = false;
+                publishLink(false);
+                failedAttempts = 0;
+                fullScanAt = disconnectedAt;
+                scheduleConnect(0);
+            } else if (state == WIFI_STATE_CONNECTING) {
+                attemptFailed(message.reason);
+            }
+            break;
+        
+        case WIFI_MSG_SCAN_DONE:
+            collectScan();
+            break;
+        
+        case WIFI_MSG_SCAN_REQUEST:
+            // Results of a recent scan are still on the display
+            if (scanChannel == 0 && !scanPending &&
+                (lastScanTime == 0 || millis() - lastScanTime >= WIFI_SCAN_MIN_INTERVAL_MS)) {
+                scanPending = true;
+            }
+            break;
+    }
+}
+
+void WiFiManager::handleTimers() {
+    unsigned long now = millis();
+    
+    switch (state) {
+        case WIFI_STATE_CONNECTING:
+            if ((long)(now - deadline) >= 0) {
+                WiFi.disconnect();
+                attemptFailed(0);
+            }
+            break;
+        
+        case WIFI_STATE_BACKOFF:
+            // A channel step in flight finishes first - they're short
+            if ((long)(now - deadline) >= 0 && !scanInFlight) {
+                startConnect(true);
+            }
+            break;
+        
+        case WIFI_STATE_CONNECTED:
+            if (leaseStampPending) {
+                stampLease();
+            }
+            if (!registration.registered && !registration.userToken.isEmpty() && (long)(now - registerAt) >= 0) {
+                if (registerWithServer()) {
+                    registration.registered = true;
+                    Serial.println("Device registered successfully");
+                } else {
+                    registerAt = millis() + WIFI_REGISTER_RETRY_MS;
+                }
+            }
+            break;
+        
+        case WIFI_STATE_IDLE:
+            break;
     }
     
-    // Handle disconnection
-    if (WiFi.status() != WL_CONNECTED && (currentTime - lastConnectionAttempt >= RECONNECT_INTERVAL)) {
-        if (connectionAttempts < MAX_CONNECTION_ATTEMPTS) {
-            connectToNetwork();
-            lastConnectionAttempt = currentTime;
-            connectionAttempts++;
-        } else {
-            // Reset attempts after extended delay
-            if (currentTime - lastConnectionAttempt >= RECONNECT_INTERVAL * 3) {
-                connectionAttempts = 0;
+    // Scan steps pause while an attempt is in flight
+    if (state != WIFI_STATE_CONNECTING && !scanInFlight) {
+        if (scanPending) {
+            scanPending = false;
+            scanChannel = 1;
+            scanStart = millis();
+            scanResults.scanId++;
+            scanResults.count = 0;
+            Serial.println("Scanning for WiFi networks...");
+            if (displayManager) {
+                displayManager->updateNetworks(scanResults);
             }
         }
+        if (scanChannel != 0) {
+            startScanStep();
+        }
     }
 }
 
-bool WiFiManager::connectToNetwork() {
-    if (!credentials.valid) {
+bool WiFiManager::leaseUsable(bool withIP) const {
+    if (lease.channel == 0) {
         return false;
     }
+    if (!withIP) {
+        return true;
+    }
     
-    Serial.printf("Connecting to WiFi: %s\n", credentials.ssid.c_str());
-    
-    WiFi.begin(credentials.ssid.c_str(), credentials.password.c_str());
+    // A static IP skips DHCP, so it must still be ours - only while the lease
+    // is recent. The RTC keeps UTC across soft resets, so this also covers
+    // reboots; after a power cycle the clock is unset and DHCP runs.
+    uint32_t now = time(nullptr);
+    return lease.ip != 0 && lease.acquiredAt >= LOG_MIN_VALID_TIME && now >= lease.acquiredAt &&
+           now - lease.acquiredAt < WIFI_LEASE_REUSE_S;
+}
+
+void WiFiManager::startConnect(bool useLease) {
+    fastAttempt = useLease && leaseUsable(false);
+    cachedIP = fastAttempt && leaseUsable(true);
     
-    // Wait for connection with timeout
-    unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - startTime < CONNECTION_TIMEOUT)) {
-        delay(500);
-        Serial.print(".");
+    if (cachedIP) {
+        WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet), IPAddress(lease.dns));
+    } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
     }
     
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.printf("\nWiFi connected! IP: %s\n", WiFi.localIP().toString().c_str());
-        connectionAttempts = 0;
-        return true;
+    if (fastAttempt) {
+        // Straight to the cached AP - no scan across all channels
+        Serial.printf("Connecting to WiFi: %s (cached AP, channel %u%s)\n", credentials.ssid.c_str(), lease.channel,
+                      cachedIP ? ", cached IP" : "");
+        WiFi.begin(credentials.ssid.c_str(), credentials.password.c_str(), lease.channel, lease.bssid);
     } else {
-        Serial.println("\nWiFi connection failed");
-        return false;
+        Serial.printf("Connecting to WiFi: %s\n", credentials.ssid.c_str());
+        WiFi.begin(credentials.ssid.c_str(), credentials.password.c_str());
     }
+    
+    state = WIFI_STATE_CONNECTING;
+    attemptStart = millis();
+    deadline = attemptStart + (fastAttempt ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS);
 }
 
-void WiFiManager::handleDisconnection() {
-    Serial.println("WiFi disconnected");
-    WiFi.disconnect();
+void WiFiManager::scheduleConnect(unsigned long delayMs) {
+    state = WIFI_STATE_BACKOFF;
+    deadline = millis() + delayMs;
 }
 
-int WiFiManager::scanNetworks() {
-    unsigned long currentTime = millis();
+void WiFiManager::attemptFailed(uint8_t reason) {
+    unsigned long now = millis();
     
-    // Don't scan too frequently
-    if (currentTime - lastScanTime < 10000) {  // 10 second minimum between scans
-        return WiFi.scanComplete();
+    if (!fastAttempt) {
+        failedAttempts++;
+        unsigned long backoff = WIFI_BACKOFF_MIN_MS << (failedAttempts < 6 ? failedAttempts - 1 : 5);
+        if (backoff > WIFI_BACKOFF_MAX_MS) {
+            backoff = WIFI_BACKOFF_MAX_MS;
+        }
+        fullScanAt = now + backoff;
+    } else if ((long)(now - fullScanAt) >= 0) {
+        // The AP may have moved channel or been replaced - scan for it
+        Serial.printf("Cached AP unreachable (reason %u), full scan\n", reason);
+        startConnect(false);
+        return;
+    }
+    
+    // A rebooting AP comes back on its old BSSID and channel, and probing one
+    // channel is cheap - keep probing it between the backed-off full scans
+    unsigned long retry = fullScanAt - now;
+    if (leaseUsable(false) && retry > WIFI_PROBE_INTERVAL_MS) {
+        retry = WIFI_PROBE_INTERVAL_MS;
+    }
+    if (!fastAttempt) {
+        Serial.printf("WiFi connection failed (reason %u), retry in %lu ms\n", reason, retry);
     }
+    scheduleConnect(retry);
+}
+
+void WiFiManager::onConnected() {
+    unsigned long now = millis();
+    state = WIFI_STATE_CONNECTED;
+    failedAttempts = 0;
     
-    Serial.println("Scanning for WiFi networks...");
-    WiFi.scanDelete();  // Clear previous scan results
+    Serial.printf("WiFi connected! IP: %s (%lu ms, %s)\n", WiFi.localIP().toString().c_str(), now - attemptStart,
+                  cachedIP ? "cached AP and IP" : fastAttempt ? "cached AP" : "full scan");
+    if (disconnectedAt != 0) {
+        lastReconnectMillis = now - disconnectedAt;
+        disconnectedAt = 0;
+        Serial.printf("WiFi reconnected %lu ms after the link was lost\n", lastReconnectMillis);
+    }
+    bootMark(BOOT_WIFI_UP);
     
-    int networkCount = WiFi.scanNetworks();
-    lastScanTime = currentTime;
+    // Wall-clock time for the sensor log (UTC, synced in the background)
+    configTime(0, 0, NTP_SERVER);
     
-    if (networkCount > 0) {
-        Serial.printf("Found %d networks:\n", networkCount);
-        for (int i = 0; i < networkCount; i++) {
-            Serial.printf("  %d: %s (%d dBm)\n", i, WiFi.SSID(i).c_str(), WiFi.RSSI(i));
-        }
-    } else {
-        Serial.println("No networks found");
+    saveLease();
+    registerAt = now;
+    publishLink(true);
+}
+
+void WiFiManager::publishLink(bool connected) {
+    if (telemetry) {
+        telemetry->setOnline(connected);
+    }
+    scanResults.connected = connected;
+    if (displayManager) {
+        displayManager->updateNetworks(scanResults);
     }
+}
+
+void WiFiManager::saveLease() {
+    WiFiLease fresh = {};
+    memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+    fresh.channel = WiFi.channel();
+    fresh.ip = WiFi.localIP();
+    fresh.gateway = WiFi.gatewayIP();
+    fresh.subnet = WiFi.subnetMask();
+    fresh.dns = WiFi.dnsIP();
     
-    return networkCount;
+    if (cachedIP) {
+        // No DHCP exchange happened - the lease is as old as it was
+        fresh.acquiredAt = lease.acquiredAt;
+    } else {
+        leaseMillis = millis();
+        leaseStampPending = true;
+    }
+    lease = fresh;
+    stampLease();
+}
+
+// Dates a DHCP lease once NTP has set the clock
+void WiFiManager::stampLease() {
+    if (leaseStampPending) {
+        uint32_t now = time(nullptr);
+        if (now < LOG_MIN_VALID_TIME) {
+            // Saved undated for now - the BSSID and channel are still useful
+            if (storageManager && lease.acquiredAt == 0) {
+                storageManager->setWiFiLease(lease);
+            }
+            return;
+        }
+        lease.acquiredAt = now - (millis() - leaseMillis) / 1000;
+        leaseStampPending = false;
+    }
+    if (storageManager) {
+        storageManager->setWiFiLease(lease);
+    }
 }
 
-String WiFiManager::getScannedSSID(int index) {
-    if (index >= 0 && index < WiFi.scanComplete()) {
-        return WiFi.SSID(index);
+void WiFiManager::startScanStep() {
+    // One channel at a time, so results reach the display as they come in
+    scanInFlight = true;
+    if (WiFi.scanNetworks(true, false, false, WIFI_SCAN_CHANNEL_MS, scanChannel) == WIFI_SCAN_FAILED) {
+        Serial.println("WiFi scan failed");
+        scanInFlight = false;
+        scanChannel = 0;
     }
-    return "";
 }
 
-int WiFiManager::getScannedRSSI(int index) {
-    if (index >= 0 && index < WiFi.scanComplete()) {
-        return WiFi.RSSI(index);
+void WiFiManager::collectScan() {
+    if (!scanInFlight) {
+        return;
+    }
+    scanInFlight = false;
+    
+    int found = WiFi.scanComplete();
+    uint8_t before = scanResults.count;
+    for (int i = 0; i < found && scanResults.count < WIFI_SCAN_MAX; i++) {
+        String ssid = WiFi.SSID(i);
+        if (ssid.isEmpty()) {
+            continue;  // Hidden network
+        }
+        
+        // Same network on another AP or channel - rows already shown stay put
+        bool seen = false;
+        for (uint8_t j = 0; j < scanResults.count && !seen; j++) {
+            seen = strncmp(scanResults.entries[j].ssid, ssid.c_str(), sizeof(scanResults.entries[j].ssid) - 1) == 0;
+        }
+        if (!seen) {
+            NetworkEntry& entry = scanResults.entries[scanResults.count++];
+            strlcpy(entry.ssid, ssid.c_str(), sizeof(entry.ssid));
+            entry.rssi = WiFi.RSSI(i);
+        }
+    }
+    WiFi.scanDelete();
+    
+    if (scanResults.count != before && displayManager) {
+        displayManager->updateNetworks(scanResults);
+    }
+    
+    if (++scanChannel > WIFI_SCAN_CHANNELS) {
+        scanChannel = 0;
+        lastScanTime = millis();
+        Serial.printf("Found %u networks in %lu ms\n", scanResults.count, lastScanTime - scanStart);
     }
-    return -999;
 }
 
-void WiFiManager::setCredentials(const String& ssid, const String& password) {
+void WiFiManager::setCredentials(const char* ssid, const char* password) {
+    if (credentials.valid && credentials.ssid != ssid) {
+        memset(&lease, 0, sizeof(lease));  // Cached for the old network
+    }
     credentials.ssid = ssid;
     credentials.password = password;
-    credentials.valid = !ssid.isEmpty();
+    credentials.valid = !credentials.ssid.isEmpty();
     
     if (credentials.valid) {
-        Serial.printf("WiFi credentials set for: %s\n", ssid.c_str());
-        connectionAttempts = 0;  // Reset connection attempts
+        Serial.printf("WiFi credentials set for: %s\n", credentials.ssid.c_str());
+        failedAttempts = 0;  // Reset connection attempts
     }
 }
 
-void WiFiManager::setRegistrationData(const String& deviceName, const String& userToken) {
+void WiFiManager::setRegistrationData(const char* deviceName, const char* userToken) {
     registration.deviceName = deviceName;
     registration.userToken = userToken;
     registration.registered = false;  // Will be set to true after successful registration
     
-    Serial.printf("Registration data set - Device: %s\n", deviceName.c_str());
+    Serial.printf("Registration data set - Device: %s\n", registration.deviceName.c_str());
 }
 
 bool WiFiManager::registerWithServer() {
@@ -149,12 +420,16 @@ bool WiFiManager::registerWithServer() {
     
     http.begin(serverUrl);
     http.addHeader("Content-Type", "application/json");
-    http.addHeader("Authorization", "Bearer " + registration.userToken);
+    static const char bearer[] = "Bearer ";
+    FixedString<sizeof(bearer) - 1 + CONFIG_TOKEN_MAX> authorization;
+    authorization.append(bearer, sizeof(bearer) - 1);
+    authorization += registration.userToken;
+    http.addHeader("Authorization", authorization.c_str());
     
     JsonDocument doc;
-    doc["device_name"] = registration.deviceName;
+    doc["device_name"] = registration.deviceName.c_str();
     doc["device_type"] = DEVICE_TYPE_STR;
-    doc["user_token"] = registration.userToken;
+    doc["user_token"] = registration.userToken.c_str();
     doc["firmware_version"] = "1.0.0";
     doc["hardware_info"] = "ESP32-S3 4.3\" Display";
     
@@ -174,4 +449,4 @@ bool WiFiManager::registerWithServer() {
         http.end();
         return false;
     }
-}
\ No newline at end of file
+}
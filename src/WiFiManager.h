@@ -3,63 +3,133 @@
 
 #include <WiFi.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "DeviceConfig.h"
+#include "DisplayManager.h"
+#include "StorageManager.h"
+#include "TelemetryUplink.h"
+#include "FixedString.h"
 
-// Network credentials structure
+// Network credentials structure - sized like the stored config
 struct NetworkCredentials {
-    String ssid;
-    String password;
+    FixedString<CONFIG_SSID_MAX> ssid;
+    FixedString<CONFIG_PASSWORD_MAX> password;
     bool valid;
 };
 
 // Registration data structure
 struct RegistrationData {
-    String deviceName;
-    String userToken;
+    FixedString<CONFIG_NAME_MAX> deviceName;
+    FixedString<CONFIG_TOKEN_MAX> userToken;
     bool registered;
 };
 
+// Connection state machine - moved on by WiFi events and timers, the task
+// never waits on the radio
+enum WiFiState : uint8_t {
+    WIFI_STATE_IDLE,            // No credentials
+    WIFI_STATE_CONNECTING,      // Association or DHCP in flight
+    WIFI_STATE_CONNECTED,
+    WIFI_STATE_BACKOFF          // Next attempt is due at the deadline
+};
+
+// Messages to the WiFi task - from the WiFi event callback and requestScan()
+enum WiFiMessageType : uint8_t {
+    WIFI_MSG_GOT_IP,
+    WIFI_MSG_DISCONNECTED,
+    WIFI_MSG_SCAN_DONE,
+    WIFI_MSG_SCAN_REQUEST
+};
+
+struct WiFiMessage {
+    uint8_t type;
+    uint8_t reason;             // Disconnect reason
+};
+
 class WiFiManager {
 private:
     NetworkCredentials credentials;
     RegistrationData registration;
     
-    unsigned long lastConnectionAttempt;
+    // Events are queued by the WiFi driver's callback and handled here
+    static WiFiManager* instance;
+    static void onWiFiEvent(arduino_event_t* event);
+    QueueHandle_t eventQueue;
+    
+    WiFiState state;
+    bool fastAttempt;           // Current attempt targets the cached AP
+    bool cachedIP;              // ...and skips DHCP
+    uint8_t failedAttempts;
+    unsigned long deadline;     // Attempt timeout or end of backoff
+    unsigned long fullScanAt;   // Earliest next all-channel attempt
+    unsigned long attemptStart;
+    unsigned long disconnectedAt;
+    unsigned long lastReconnectMillis;
+    unsigned long registerAt;
+    
+    // Fast-reconnect cache, persisted through the storage manager
+    WiFiLease lease;
+    unsigned long leaseMillis;  // When DHCP handed out the lease
+    bool leaseStampPending;     // Waiting for NTP to date it
+    StorageManager* storageManager;
+    
+    // Scans run one channel per step; each step publishes what it found
+    uint8_t scanChannel;        // 0 = no scan
+    bool scanInFlight;
+    bool scanPending;
+    unsigned long scanStart;
     unsigned long lastScanTime;
-    int connectionAttempts;
+    NetworkList scanResults;
+    DisplayManager* displayManager;
+    TelemetryUplink* telemetry;
     
-    // Connection management
-    static const unsigned long CONNECTION_TIMEOUT = 15000;
-    static const unsigned long RECONNECT_INTERVAL = 30000;
-    static const int MAX_CONNECTION_ATTEMPTS = 3;
+    // State machine
+    void handleMessage(const WiFiMessage& message);
+    void handleTimers();
+    TickType_t nextWait() const;
+    void startConnect(bool useLease);
+    void scheduleConnect(unsigned long delayMs);
+    void attemptFailed(uint8_t reason);
+    void onConnected();
+    void publishLink(bool connected);
+    bool leaseUsable(bool withIP) const;
+    void saveLease();
+    void stampLease();
     
-    // Network operations
-    bool connectToNetwork();
-    void handleDisconnection();
+    // Scanning
+    void startScanStep();
+    void collectScan();
     
     // Device registration
     bool registerWithServer();
-    
+
 public:
     WiFiManager();
     
     void begin();
-    void handleConnection();
+    void handleConnection();  // WiFi task body - blocks until an event or timer
     
     // Network scanning for display
-    int scanNetworks();
-    String getScannedSSID(int index);
-    int getScannedRSSI(int index);
+    void setDisplayManager(DisplayManager* dm) { displayManager = dm; }
+    void setTelemetry(TelemetryUplink* uplink) { telemetry = uplink; }
+    void requestScan();  // Any task
     
     // Credential management
-    void setCredentials(const String& ssid, const String& password);
+    void setStorageManager(StorageManager* sm) { storageManager = sm; }
+    void setCredentials(const char* ssid, const char* password);
+    void setLease(const WiFiLease& cached) { lease = cached; }
     bool hasValidCredentials() const { return credentials.valid; }
     
     // Registration management
-    void setRegistrationData(const String& deviceName, const String& userToken);
+    void setRegistrationData(const char* deviceName, const char* userToken);
     bool isRegistered() const { return registration.registered; }
     
     // Status
+    WiFiState getState() const { return state; }
     bool isConnected() const { return WiFi.status() == WL_CONNECTED; }
     String getLocalIP() const { return WiFi.localIP().toString(); }
-};
\ No newline at end of file
+    unsigned long getLastReconnectMillis() const { return lastReconnectMillis; }  // Link loss to IP
+};
+
+#endif // WIFI_MANAGER_H
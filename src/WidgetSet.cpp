@@ -0,0 +1,337 @@
+#include "WidgetSet.h"
+
+WidgetSet::WidgetSet() : widgetCount(0), cursor(0), damageCount(0), areaTop(0), areaHeight(DISPLAY_HEIGHT),
+    glyphs(nullptr), lastCommitMicros(0), maxCommitMicros(0) {
+    memset(&frameStats, 0, sizeof(frameStats));
+    memset(&lastFrameStats, 0, sizeof(lastFrameStats));
+    memset(&totalStats, 0, sizeof(totalStats));
+    reset();
+}
+
+void WidgetSet::begin(TFT_eSPI& tft, int16_t top, int16_t height) {
+    areaTop = top;
+    areaHeight = height;
+    
+#ifdef DISPLAY_COMPOSITING
+    compositor.begin(tft);
+#else
+    (void)tft;
+#endif
+}
+
+bool WidgetSet::isComposited() const {
+#ifdef DISPLAY_COMPOSITING
+    return compositor.isReady();
+#else
+    return false;
+#endif
+}
+
+void WidgetSet::beginFrame() {
+    cursor = 0;
+    damageCount = 0;
+    memset(&frameStats, 0, sizeof(frameStats));
+}
+
+void WidgetSet::commit(TFT_eSPI& tft) {
+    unsigned long startTime = micros();
+    
+    // Widgets not declared this frame disappear
+    for (uint8_t i = cursor; i < widgetCount; i++) {
+        addDamage(widgets[i]);
+        widgets[i].kind = WIDGET_NONE;
+    }
+    widgetCount = cursor;
+
+    // Unchanged widgets under a vacated area must be repainted too
+    for (uint8_t i = 0; i < damageCount; i++) {
+        const DamageRect& rect = damage[i];
+        for (uint8_t j = 0; j < widgetCount; j++) {
+            const Widget& widget = widgets[j];
+            if (widget.x < rect.x + rect.w && rect.x < widget.x + widget.w &&
+                widget.y < rect.y + rect.h && rect.y < widget.y + widget.h) {
+                widgets[j].dirty = true;
+            }
+        }
+    }
+
+#ifdef DISPLAY_COMPOSITING
+    // Over a freshly cleared area there is nothing to erase - strips would
+    // only push the clear a second time, so widgets go straight to the panel
+    if (compositor.isReady() && !areaCleared) {
+        commitComposited(tft);
+    } else {
+        commitDirect(tft);
+    }
+#else
+    commitDirect(tft);
+#endif
+    areaCleared = false;
+
+    lastFrameStats = frameStats;
+    totalStats.drawCalls += frameStats.drawCalls;
+    totalStats.pixels += frameStats.pixels;
+    totalStats.spiBytes += frameStats.spiBytes;
+    
+    lastCommitMicros = micros() - startTime;
+    if (lastCommitMicros > maxCommitMicros) {
+        maxCommitMicros = lastCommitMicros;
+    }
+}
+
+void WidgetSet::commitDirect(TFT_eSPI& tft) {
+    // Clear vacated areas first so redrawn widgets are not overwritten
+    for (uint8_t i = 0; i < damageCount; i++) {
+        const DamageRect& rect = damage[i];
+        tft.fillRect(rect.x, rect.y, rect.w, rect.h, COLOR_BLACK);
+        account(1, (uint32_t)rect.w * rect.h);
+    }
+
+    for (uint8_t i = 0; i < widgetCount; i++) {
+        if (widgets[i].dirty) {
+            renderWidget(tft, widgets[i]);
+            widgets[i].dirty = false;
+        }
+    }
+}
+
+#ifdef DISPLAY_COMPOSITING
+void WidgetSet::commitComposited(TFT_eSPI& tft) {
+    int16_t areaEnd = areaTop + areaHeight;
+    
+    for (int16_t stripY = areaTop; stripY < areaEnd; stripY += COMPOSITE_STRIP_HEIGHT) {
+        int16_t stripH = min((int16_t)COMPOSITE_STRIP_HEIGHT, (int16_t)(areaEnd - stripY));
+        int16_t stripEnd = stripY + stripH;
+        
+        // Skip strips without damage or dirty widgets
+        bool needed = false;
+        for (uint8_t i = 0; i < damageCount && !needed; i++) {
+            needed = damage[i].y < stripEnd && stripY < damage[i].y + damage[i].h;
+        }
+        for (uint8_t i = 0; i < widgetCount && !needed; i++) {
+            needed = widgets[i].dirty && widgets[i].y < stripEnd && stripY < widgets[i].y + widgets[i].h;
+        }
+        if (!needed) {
+            continue;
+        }
+        
+        // The strip starts black, so every widget crossing it is redrawn.
+        // Rendering into RAM costs no bus traffic, so it is not accounted
+        RenderStats busStats = frameStats;
+        TFT_eSprite& strip = compositor.beginStrip(tft);
+        for (uint8_t i = 0; i < widgetCount; i++) {
+            if (widgets[i].y < stripEnd && stripY < widgets[i].y + widgets[i].h) {
+                renderWidget(strip, widgets[i], stripY);
+            }
+        }
+        frameStats = busStats;
+        compositor.pushStrip(tft, stripY, stripH);
+        account(1, (uint32_t)DISPLAY_WIDTH * stripH);
+    }
+    compositor.endFrame(tft);
+    
+    for (uint8_t i = 0; i < widgetCount; i++) {
+        widgets[i].dirty = false;
+    }
+}
+#endif
+
+void WidgetSet::resetCommitStats() {
+    maxCommitMicros = 0;
+}
+
+void WidgetSet::text(int16_t x, int16_t y, const char* text, uint16_t color, int16_t w) {
+    if (w <= 0) {
+        w = DISPLAY_WIDTH - x;
+    }
+    declare(WIDGET_TEXT, x, y, w, TEXT_CHAR_HEIGHT, color, COLOR_BLACK, text);
+}
+
+void WidgetSet::button(int16_t x, int16_t y, int16_t w, int16_t h, const char* text, uint16_t mainColor, bool pressed) {
+    uint16_t bgColor = pressed ? mainColor : COLOR_BLACK;
+    uint16_t textColor = pressed ? COLOR_BLACK : mainColor;
+    declare(WIDGET_BUTTON, x, y, w, h, textColor, bgColor, text);
+}
+
+void WidgetSet::chart(int16_t x, int16_t y, int16_t w, int16_t h, const HistorySeries& series, uint16_t color) {
+    // FNV-1a over the columns - an unchanged series is not redrawn
+    uint32_t hash = 2166136261u;
+    for (uint16_t c = 0; c < series.columns; c++) {
+        hash = (hash ^ (uint16_t)series.minValue[c]) * 16777619u;
+        hash = (hash ^ (uint16_t)series.maxValue[c]) * 16777619u;
+    }
+    
+    Widget* widget = declare(WIDGET_CHART, x, y, w, h, color, COLOR_BLACK, "", hash);
+    if (widget) {
+        widget->series = &series;
+    }
+}
+
+void WidgetSet::reset() {
+    for (uint8_t i = 0; i < MAX_WIDGETS; i++) {
+        widgets[i].kind = WIDGET_NONE;
+        widgets[i].series = nullptr;
+        widgets[i].dirty = false;
+    }
+    widgetCount = 0;
+    cursor = 0;
+    damageCount = 0;
+    areaCleared = true;
+}
+
+void WidgetSet::clearArea(TFT_eSPI& tft, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    tft.fillRect(x, y, w, h, color);
+    totalStats.drawCalls++;
+    totalStats.pixels += (uint32_t)w * h;
+    totalStats.spiBytes += SPI_WINDOW_OVERHEAD_BYTES + (uint32_t)w * h * 2;
+    reset();
+}
+
+Widget* WidgetSet::declare(WidgetKind kind, int16_t x, int16_t y, int16_t w, int16_t h,
+                           uint16_t fgColor, uint16_t bgColor, const char* text, uint32_t contentHash) {
+    if (cursor >= MAX_WIDGETS) {
+        Serial.println("WidgetSet: too many widgets");
+        return nullptr;
+    }
+
+    Widget& widget = widgets[cursor++];
+    bool moved = widget.kind != kind || widget.x != x || widget.y != y || widget.w != w || widget.h != h;
+
+    if (!moved && widget.fgColor == fgColor && widget.bgColor == bgColor && widget.contentHash == contentHash &&
+        strncmp(widget.text, text, WIDGET_TEXT_MAX) == 0) {
+        return &widget;  // Unchanged - nothing to push
+    }
+
+    if (moved && widget.kind != WIDGET_NONE) {
+        addDamage(widget);
+    }
+
+    widget.kind = kind;
+    widget.x = x;
+    widget.y = y;
+    widget.w = w;
+    widget.h = h;
+    widget.fgColor = fgColor;
+    widget.bgColor = bgColor;
+    strncpy(widget.text, text, WIDGET_TEXT_MAX - 1);
+    widget.text[WIDGET_TEXT_MAX - 1] = '\0';
+    widget.series = nullptr;
+    widget.contentHash = contentHash;
+    widget.dirty = true;
+    return &widget;
+}
+
+void WidgetSet::addDamage(const Widget& widget) {
+    if (widget.kind == WIDGET_NONE || damageCount >= MAX_WIDGETS) {
+        return;
+    }
+
+    DamageRect& rect = damage[damageCount++];
+    rect.x = widget.x;
+    rect.y = widget.y;
+    rect.w = widget.w;
+    rect.h = widget.h;
+}
+
+void WidgetSet::account(uint32_t drawCalls, uint32_t pixels) {
+    frameStats.drawCalls += drawCalls;
+    frameStats.pixels += pixels;
+    frameStats.spiBytes += drawCalls * SPI_WINDOW_OVERHEAD_BYTES + pixels * 2;
+}
+
+template <typename Gfx>
+int16_t WidgetSet::renderText(Gfx& gfx, int16_t x, int16_t y, const Widget& widget) {
+    // One window per run from the cache; the GLCD font opens one per font pixel
+    int16_t width = glyphs ? glyphs->draw(gfx, x, y, widget.text, widget.fgColor, widget.bgColor) : -1;
+    if (width >= 0) {
+        if (width > 0) {
+            account(1, (uint32_t)width * TEXT_CHAR_HEIGHT);
+        }
+        return width;
+    }
+
+    width = GlyphCache::textWidth(widget.text);
+    gfx.setTextColor(widget.fgColor, widget.bgColor);
+    gfx.setTextSize(GLYPH_TEXT_SIZE);
+    gfx.setCursor(x, y);
+    gfx.print(widget.text);
+    account((width / TEXT_CHAR_WIDTH) * GLCD_WINDOWS_PER_CHAR, (uint32_t)width * TEXT_CHAR_HEIGHT);
+    return width;
+}
+
+template <typename Gfx>
+void WidgetSet::renderWidget(Gfx& gfx, const Widget& widget, int16_t yOffset) {
+    int16_t y = widget.y - yOffset;
+
+    switch (widget.kind) {
+        case WIDGET_TEXT: {
+            // Opaque text followed by a fill of the remaining span, so the
+            // previous content is overwritten without a visible clear
+            int16_t textWidth = renderText(gfx, widget.x, y, widget);
+            if (textWidth < widget.w) {
+                gfx.fillRect(widget.x + textWidth, y, widget.w - textWidth, widget.h, widget.bgColor);
+                account(1, (uint32_t)(widget.w - textWidth) * widget.h);
+            }
+            break;
+        }
+
+        case WIDGET_BUTTON: {
+            gfx.fillRect(widget.x, y, widget.w, widget.h, widget.bgColor);
+            gfx.drawRect(widget.x, y, widget.w, widget.h, widget.bgColor == COLOR_BLACK ? widget.fgColor : widget.bgColor);
+            account(1, (uint32_t)widget.w * widget.h);
+            account(4, 2 * (uint32_t)(widget.w + widget.h) - 4);  // Corners are drawn once
+
+            // Centered label
+            int16_t textX = widget.x + (widget.w - GlyphCache::textWidth(widget.text)) / 2;
+            int16_t textY = y + (widget.h - TEXT_CHAR_HEIGHT) / 2;
+            renderText(gfx, textX, textY, widget);
+            break;
+        }
+
+        case WIDGET_CHART:
+            renderChart(gfx, widget, y);
+            break;
+
+        default:
+            break;
+    }
+}
+
+template <typename Gfx>
+void WidgetSet::renderChart(Gfx& gfx, const Widget& widget, int16_t y) {
+    gfx.fillRect(widget.x, y, widget.w, widget.h, widget.bgColor);
+    account(1, (uint32_t)widget.w * widget.h);
+    
+    const HistorySeries* series = widget.series;
+    if (!series) {
+        return;
+    }
+    uint16_t columns = min(series->columns, (uint16_t)widget.w);
+    
+    // Scale to the visible range
+    int16_t low = INT16_MAX;
+    int16_t high = INT16_MIN;
+    for (uint16_t c = 0; c < columns; c++) {
+        if (series->minValue[c] == HISTORY_EMPTY) continue;
+        low = min(low, series->minValue[c]);
+        high = max(high, series->maxValue[c]);
+    }
+    if (low > high) {
+        return;  // No samples in the span
+    }
+    int32_t range = max((int32_t)high - low, (int32_t)1);
+    int16_t bottom = y + widget.h - 1;
+    
+    // One vertical run per column covers the min..max spread
+    for (uint16_t c = 0; c < columns; c++) {
+        if (series->minValue[c] == HISTORY_EMPTY) continue;
+        int16_t top = bottom - ((int32_t)series->maxValue[c] - low) * (widget.h - 1) / range;
+        int16_t length = bottom - ((int32_t)series->minValue[c] - low) * (widget.h - 1) / range - top + 1;
+        if (high == low) {
+            top = y + widget.h / 2;
+            length = 1;
+        }
+        gfx.drawFastVLine(widget.x + c, top, length, widget.fgColor);
+        account(1, length);
+    }
+}
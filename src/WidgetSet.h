@@ -0,0 +1,132 @@
+#ifndef WIDGET_SET_H
+#define WIDGET_SET_H
+
+#include <TFT_eSPI.h>
+#include "DeviceConfig.h"
+#include "StripCompositor.h"
+#include "GlyphCache.h"
+#include "SensorHistory.h"
+
+// Retained widget limits
+#define MAX_WIDGETS 24
+#define WIDGET_TEXT_MAX 40
+
+// Terminal font metrics at text size 2
+#define TEXT_CHAR_WIDTH GLYPH_WIDTH
+#define TEXT_CHAR_HEIGHT GLYPH_HEIGHT
+
+// SPI cost model: every address window costs CASET + RASET + RAMWR with
+// parameters before any pixel data, and TFT_eSPI draws a scaled GLCD glyph
+// with background as one fillRect per 6x8 font cell
+#define SPI_WINDOW_OVERHEAD_BYTES 11
+#define GLCD_WINDOWS_PER_CHAR 48
+
+enum WidgetKind : uint8_t {
+    WIDGET_NONE,
+    WIDGET_TEXT,
+    WIDGET_BUTTON,
+    WIDGET_CHART
+};
+
+// A single retained widget - the last content pushed to the TFT
+struct Widget {
+    WidgetKind kind;
+    int16_t x, y, w, h;
+    uint16_t fgColor;
+    uint16_t bgColor;
+    char text[WIDGET_TEXT_MAX];
+    const HistorySeries* series;   // Chart data, owned by the caller
+    uint32_t contentHash;          // Chart data fingerprint
+    bool dirty;
+};
+
+// Render cost counters
+struct RenderStats {
+    uint32_t drawCalls;        // Address windows opened on the panel
+    uint32_t pixels;           // Pixels written
+    uint32_t spiBytes;         // Bytes that cross the SPI bus
+};
+
+struct DamageRect {
+    int16_t x, y, w, h;
+};
+
+// Retained widget set with per-widget damage tracking.
+// Tab draw functions declare their widgets in the same order every frame;
+// each declaration is compared against the retained slot and only widgets
+// whose content or geometry changed are pushed to the TFT on commit().
+class WidgetSet {
+private:
+    Widget widgets[MAX_WIDGETS];
+    DamageRect damage[MAX_WIDGETS];
+    uint8_t widgetCount;       // Widgets retained from the previous frame
+    uint8_t cursor;            // Next slot to be declared this frame
+    uint8_t damageCount;
+    bool areaCleared;          // Nothing drawn in the area since reset()
+    
+    // Area owned by the widget set (strips are aligned to its top)
+    int16_t areaTop;
+    int16_t areaHeight;
+    
+#ifdef DISPLAY_COMPOSITING
+    StripCompositor compositor;
+#endif
+    GlyphCache* glyphs;        // Text runs; owned by the caller
+
+    // Cost accounting
+    RenderStats frameStats;
+    RenderStats lastFrameStats;
+    RenderStats totalStats;
+    uint32_t lastCommitMicros;
+    uint32_t maxCommitMicros;
+
+    Widget* declare(WidgetKind kind, int16_t x, int16_t y, int16_t w, int16_t h,
+                    uint16_t fgColor, uint16_t bgColor, const char* text, uint32_t contentHash = 0);
+    void addDamage(const Widget& widget);
+    void account(uint32_t drawCalls, uint32_t pixels);
+    // Gfx is the panel or a strip - the glyph cache writes strips directly
+    template <typename Gfx> int16_t renderText(Gfx& gfx, int16_t x, int16_t y, const Widget& widget);
+    template <typename Gfx> void renderWidget(Gfx& gfx, const Widget& widget, int16_t yOffset = 0);
+    template <typename Gfx> void renderChart(Gfx& gfx, const Widget& widget, int16_t y);
+    void commitDirect(TFT_eSPI& tft);
+#ifdef DISPLAY_COMPOSITING
+    void commitComposited(TFT_eSPI& tft);
+#endif
+
+public:
+    WidgetSet();
+
+    void begin(TFT_eSPI& tft, int16_t top, int16_t height);
+    void setGlyphCache(GlyphCache* cache) { glyphs = cache; }
+    // Narrows the owned band, e.g. while a ListView draws below it
+    void setArea(int16_t top, int16_t height) { areaTop = top; areaHeight = height; }
+    
+    // Frame lifecycle
+    void beginFrame();
+    void commit(TFT_eSPI& tft);
+
+    // Widget declarations (call between beginFrame and commit)
+    void text(int16_t x, int16_t y, const char* text, uint16_t color, int16_t w = 0);
+    void button(int16_t x, int16_t y, int16_t w, int16_t h, const char* text, uint16_t mainColor, bool pressed = false);
+    // Min/max bars per column, auto-scaled; series must live until commit()
+    void chart(int16_t x, int16_t y, int16_t w, int16_t h, const HistorySeries& series, uint16_t color);
+
+    // Forget all retained widgets after the area behind them was cleared
+    void reset();
+    void clearArea(TFT_eSPI& tft, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+    // Statistics
+    const RenderStats& getLastFrameStats() const { return lastFrameStats; }
+    const RenderStats& getTotalStats() const { return totalStats; }
+    uint32_t getLastFramePixels() const { return lastFrameStats.pixels; }
+    uint32_t getTotalPixels() const { return totalStats.pixels; }
+    uint32_t getLastCommitMicros() const { return lastCommitMicros; }
+    uint32_t getMaxCommitMicros() const { return maxCommitMicros; }
+    void resetCommitStats();
+    bool isComposited() const;
+#ifdef DISPLAY_COMPOSITING
+    StripCompositor& getCompositor() { return compositor; }
+#endif
+};
+
+#endif // WIDGET_SET_H
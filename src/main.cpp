@@ -6,83 +6,174 @@
 #include "UARTManager.h"
 #include "WiFiManager.h"
 #include "StorageManager.h"
+#include "SensorLog.h"
+#include "TelemetryUplink.h"
+#include "CommandPipeline.h"
+#include "BootTimeline.h"
+#include "Metrics.h"
+#include "HeapMonitor.h"
 
 // Task handles
 TaskHandle_t displayTaskHandle = nullptr;
 TaskHandle_t uartTaskHandle = nullptr;
 TaskHandle_t wifiTaskHandle = nullptr;
+TaskHandle_t storageTaskHandle = nullptr;
+TaskHandle_t touchTaskHandle = nullptr;
+TaskHandle_t telemetryTaskHandle = nullptr;
+TaskHandle_t panelTaskHandle = nullptr;
 
 // Global managers
 DisplayManager* displayManager = nullptr;
 UARTManager* uartManager = nullptr;
 WiFiManager* wifiManager = nullptr;
 StorageManager* storageManager = nullptr;
+SensorLog* sensorLog = nullptr;
+TelemetryUplink* telemetry = nullptr;
+CommandPipeline* commandPipeline = nullptr;
+HeapMonitor heapMonitor;
 
 // Task priorities from reference patterns
 #define PRIORITY_HIGH       15
 #define PRIORITY_MEDIUM     10
 #define PRIORITY_LOW        5
 
+#define STACK_SIZE_NETWORK  8192   // TLS handshakes
+#define STACK_SIZE_LARGE    6144
 #define STACK_SIZE_NORMAL   4096
 #define STACK_SIZE_MINIMAL  2048
 
+#define BOOT_REPORT_DELAY_MS 30000   // Timeline summary once the slow phases had a chance
+
 // Display task - handles UI updates and touch input
 void displayTask(void* pvParameters) {
-    displayManager = new DisplayManager();
+    // Splash goes up while the storage task is still mounting LittleFS
+    displayManager->begin();
     
-    // Load color scheme from storage
-    uint16_t savedColor = storageManager->getMainColor();
-    displayManager->setMainColor(savedColor);
+    // Color scheme comes from storage, the charts read the log's rollups
+    bootWait(BOOT_BIT(BOOT_CONFIG_LOADED) | BOOT_BIT(BOOT_LOG_READY));
+    displayManager->setMainColor(storageManager->getMainColor());
+    displayManager->showInterface();
     
-    displayManager->begin();
+    const unsigned long minFrameTime = 1000 / DISPLAY_MAX_FPS;
+    
+    while (true) {
+        // Sleep until new data, touch or the next scheduled deadline
+        uint32_t events = 0;
+        uint32_t waitTime = displayManager->getWaitTime();
+        xTaskNotifyWait(0, UINT32_MAX, &events, waitTime == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(waitTime));
+        
+        unsigned long frameStart = millis();
+        {
+            METRIC_BUSY(METRIC_TASK_DISPLAY);
+            displayManager->update(events);
+        }
+        
+        // Cap the render rate - events arriving meanwhile stay pending
+        unsigned long frameTime = millis() - frameStart;
+        if (frameTime < minFrameTime) {
+            vTaskDelay(pdMS_TO_TICKS(minFrameTime - frameTime));
+        }
+    }
+}
+
+// Touch task - samples the touch controller between frames
+void touchTask(void* pvParameters) {
+    // Calibration comes from config; the bus lock guards the first frame's SPI traffic
+    bootWait(BOOT_BIT(BOOT_FIRST_FRAME));
+    DisplayConfig config = storageManager->getConfig();
+    displayManager->getTouchInput().setCalibration(config.touchMatrix);
+    displayManager->beginTouch();
     
     while (true) {
-        displayManager->update();
-        vTaskDelay(pdMS_TO_TICKS(50)); // 20 FPS update rate
+        // Blocks until PENIRQ, the idle poll or the next sample while pressed
+        displayManager->getTouchInput().process();
     }
 }
 
-// UART communication task - handles JSON protocol with main device
+#ifdef RENDER_PIPELINE
+// Panel task - pushes the strips the display task rasterises on the other
+// core, so the renderer never waits on SPI setup or DMA completion
+void panelTask(void* pvParameters) {
+    while (true) {
+        // Blocks until a strip or the end of a frame is queued
+        displayManager->getCompositor().processTransfers();
+    }
+}
+#endif
+
+// UART communication task - handles the main device link and manual commands
 void uartTask(void* pvParameters) {
-    uartManager = new UARTManager();
-    uartManager->setDisplayManager(displayManager);
+    // Received samples are appended to the log
+    bootWait(BOOT_BIT(BOOT_LOG_READY));
     uartManager->begin();
     
     while (true) {
+        // Blocks until data arrives or a request is due
         uartManager->processMessages();
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
 // WiFi management task - handles network connections and OTA
 void wifiTask(void* pvParameters) {
-    wifiManager = new WiFiManager();
-    
     // Load WiFi credentials from storage
-    const DisplayConfig& config = storageManager->getConfig();
+    bootWait(BOOT_BIT(BOOT_CONFIG_LOADED));
+    DisplayConfig config = storageManager->getConfig();
     if (config.wifiConfigured) {
         wifiManager->setCredentials(config.wifiSSID, config.wifiPassword);
+        wifiManager->setLease(config.wifiLease);
     }
     
     // Load registration data
-    if (!config.userToken.isEmpty()) {
+    if (config.userToken[0] != '\0') {
         wifiManager->setRegistrationData(config.deviceName, config.userToken);
     }
     
     wifiManager->begin();
     
     while (true) {
+        // Blocks until a WiFi event arrives or a timer is due
         wifiManager->handleConnection();
-        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+}
+
+// Telemetry task - batches samples and uplinks them, queueing on flash
+// while offline
+void telemetryTask(void* pvParameters) {
+    telemetry->setTask(xTaskGetCurrentTaskHandle());
+    
+    // Queue and sequence live on the filesystem the storage task mounts
+    bootWait(BOOT_BIT(BOOT_LOG_READY));
+    telemetry->begin(storageManager->getConfig().deviceName);
+    
+    while (true) {
+        // Blocks until a batch is due, WiFi comes up or a retry is due
+        telemetry->process();
+    }
+}
+
+// Storage task - mounts the file system, then writes configuration
+// changes behind the callers
+void storageTask(void* pvParameters) {
+    storageManager->setWriterTask(xTaskGetCurrentTaskHandle());
+    if (!storageManager->begin()) {
+        // Don't hold the UI on the splash - run on the default config
+        Serial.println("Storage unavailable, using default configuration");
+        bootMark(BOOT_CONFIG_LOADED);
+    }
+    
+    // Sensor log lives next to the config on the same filesystem
+    sensorLog->begin(storageManager->getTotalSpace(), storageManager->getUsedSpace());
+    bootMark(BOOT_LOG_READY);
+    
+    while (true) {
+        // Blocks until a setter marks the config dirty
+        storageManager->processWrites();
     }
 }
 
 void setup() {
     Serial.begin(115200);
-    
-    // Initialize storage first
-    storageManager = new StorageManager();
-    storageManager->begin();
+    bootBegin();
     
     // Print device type for debugging
     #ifdef DEVICE_TYPE_ENVIRONMENT
@@ -94,38 +185,161 @@ void setup() {
         while(1) delay(1000);
     #endif
     
-    // Create FreeRTOS tasks - no core assignment, let scheduler handle
-    xTaskCreate(
+    // Construct every manager before any task can use one - the slow
+    // parts (mount, tft.init, WiFi) happen in begin() on the tasks, which
+    // wait on the boot phases they depend on
+    storageManager = new StorageManager();
+    sensorLog = new SensorLog();
+    displayManager = new DisplayManager();
+    displayManager->setSensorLog(sensorLog);
+    displayManager->setStorageManager(storageManager);
+    uartManager = new UARTManager();
+    uartManager->setDisplayManager(displayManager);
+    uartManager->setSensorLog(sensorLog);
+    telemetry = new TelemetryUplink();
+    uartManager->setTelemetry(telemetry);
+    commandPipeline = new CommandPipeline();
+    uartManager->setCommandPipeline(commandPipeline);
+    displayManager->setCommandPipeline(commandPipeline);
+    wifiManager = new WiFiManager();
+    wifiManager->setDisplayManager(displayManager);
+    wifiManager->setStorageManager(storageManager);
+    wifiManager->setTelemetry(telemetry);
+    displayManager->setWiFiManager(wifiManager);
+    
+    // Create FreeRTOS tasks on the cores from the core map in DeviceConfig.h.
+    // Display first so the splash is not queued behind the mount
+    xTaskCreatePinnedToCore(
         displayTask,
         "DisplayTask",
         STACK_SIZE_NORMAL,
         nullptr,
         PRIORITY_HIGH,
-        &displayTaskHandle
+        &displayTaskHandle,
+        CORE_DISPLAY
     );
     
-    xTaskCreate(
+    xTaskCreatePinnedToCore(
+        touchTask,
+        "TouchTask",
+        STACK_SIZE_NORMAL,
+        nullptr,
+        PRIORITY_HIGH,
+        &touchTaskHandle,
+        CORE_TOUCH
+    );
+    
+    xTaskCreatePinnedToCore(
         uartTask,
         "UARTTask",
         STACK_SIZE_NORMAL,
         nullptr,
         PRIORITY_MEDIUM,
-        &uartTaskHandle
+        &uartTaskHandle,
+        CORE_UART
     );
     
-    xTaskCreate(
+    xTaskCreatePinnedToCore(
         wifiTask,
         "WiFiTask",
-        STACK_SIZE_MINIMAL,
+        STACK_SIZE_NORMAL,  // HTTPClient for registration
+        nullptr,
+        PRIORITY_LOW,
+        &wifiTaskHandle,
+        CORE_WIFI
+    );
+    
+    xTaskCreatePinnedToCore(
+        telemetryTask,
+        "TelemetryTask",
+        STACK_SIZE_NETWORK,
+        nullptr,
+        PRIORITY_LOW,
+        &telemetryTaskHandle,
+        CORE_TELEMETRY
+    );
+    
+    xTaskCreatePinnedToCore(
+        storageTask,
+        "StorageTask",
+        STACK_SIZE_LARGE,
         nullptr,
         PRIORITY_LOW,
-        &wifiTaskHandle
+        &storageTaskHandle,
+        CORE_STORAGE
     );
     
+#ifdef RENDER_PIPELINE
+    // Same priority as the display task it feeds, next to touch on the SPI side
+    xTaskCreatePinnedToCore(
+        panelTask,
+        "PanelTask",
+        STACK_SIZE_MINIMAL,
+        nullptr,
+        PRIORITY_HIGH,
+        &panelTaskHandle,
+        CORE_PANEL
+    );
+    METRIC_TASK(METRIC_TASK_PANEL, panelTaskHandle, STACK_SIZE_MINIMAL);
+#endif
+    
+    METRIC_TASK(METRIC_TASK_DISPLAY, displayTaskHandle, STACK_SIZE_NORMAL);
+    METRIC_TASK(METRIC_TASK_TOUCH, touchTaskHandle, STACK_SIZE_NORMAL);
+    METRIC_TASK(METRIC_TASK_UART, uartTaskHandle, STACK_SIZE_NORMAL);
+    METRIC_TASK(METRIC_TASK_WIFI, wifiTaskHandle, STACK_SIZE_NORMAL);
+    METRIC_TASK(METRIC_TASK_TELEMETRY, telemetryTaskHandle, STACK_SIZE_NETWORK);
+    METRIC_TASK(METRIC_TASK_STORAGE, storageTaskHandle, STACK_SIZE_LARGE);
+    METRIC_TASK(METRIC_TASK_LOOP, xTaskGetCurrentTaskHandle(), CONFIG_ARDUINO_LOOP_STACK_SIZE);
+    
     Serial.println("AeroDisplay tasks started");
 }
 
+#ifdef METRICS_ENABLED
+// Debug serial commands, one per line: `metrics` dumps the registry as JSON,
+// `heap` the fragmentation history
+static void pollDebugCommands() {
+    static char line[16];
+    static uint8_t length = 0;
+    static MetricsSnapshot previous = {};
+    
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (length < sizeof(line) - 1) {
+                line[length++] = c;
+            }
+            continue;
+        }
+        line[length] = '\0';
+        if (strcmp(line, "metrics") == 0) {
+            metrics.dumpJson(Serial, previous);
+        } else if (strcmp(line, "heap") == 0) {
+            heapMonitor.dump(Serial);
+        }
+        length = 0;
+    }
+}
+#endif
+
 void loop() {
-    // FreeRTOS handles everything, keep loop empty
-    vTaskDelay(portMAX_DELAY);
+    static bool bootReported = false;
+    bootWait(BOOT_BIT(BOOT_LOG_READY));
+    
+    if (!bootReported && millis() >= BOOT_REPORT_DELAY_MS) {
+        bootReport();
+        bootReported = true;
+    }
+    
+    #ifdef METRICS_ENABLED
+        pollDebugCommands();
+    #endif
+    
+    heapMonitor.update(millis());
+    
+    // Lowest priority - writes queued sensor log blocks to flash
+    {
+        METRIC_BUSY(METRIC_TASK_LOOP);
+        sensorLog->flush();
+    }
+    vTaskDelay(pdMS_TO_TICKS(1000));
 }
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "ArduinoHost.h"
+#include "HostKernel.h"
+#include <stdarg.h>
+#include <atomic>
+#include <filesystem>
+
+#define CONSOLE_CAPTURE_MAX 65536
+
+static std::atomic<uint64_t> clockMicros(1000000);
+static std::function<bool()> idleHook;
+static bool inIdleHook = false;
+static std::string console;
+static bool echoConsole = getenv("HOST_ECHO_SERIAL") != nullptr;
+static uint32_t heapFree = 240000;
+static uint32_t heapLargest = 110000;
+static bool psramPresent = false;
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+EspClass ESP;
+
+void hostResetClock(uint64_t startMicros) {
+    clockMicros = startMicros;
+}
+
+void hostAdvanceMicros(uint64_t us) {
+    clockMicros += us;
+}
+
+void hostAdvanceMillis(uint32_t ms) {
+    clockMicros += (uint64_t)ms * 1000;
+}
+
+uint64_t hostMicros() {
+    return clockMicros;
+}
+
+void hostSetIdleHook(std::function<bool()> hook) {
+    idleHook = hook;
+}
+
+bool hostRunIdleHook() {
+    if (!idleHook || inIdleHook) {
+        return false;
+    }
+    inIdleHook = true;
+    bool worked = idleHook();
+    inIdleHook = false;
+    return worked;
+}
+
+const std::string& hostConsole() {
+    return console;
+}
+
+bool hostConsoleContains(const char* text) {
+    return console.find(text) != std::string::npos;
+}
+
+void hostClearConsole() {
+    console.clear();
+}
+
+void hostSetHeap(uint32_t freeBytes, uint32_t largestBlock) {
+    heapFree = freeBytes;
+    heapLargest = largestBlock;
+}
+
+void hostSetPsram(bool present) {
+    psramPresent = present;
+}
+
+std::string hostTempDirectory(const char* name) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "arduino-host" / name;
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path.string();
+}
+
+unsigned long millis() {
+    return clockMicros / 1000;
+}
+
+unsigned long micros() {
+    return (unsigned long)clockMicros;
+}
+
+void delay(uint32_t ms) {
+    hostAdvanceMillis(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+    hostAdvanceMicros(us);
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+}
+
+int digitalRead(uint8_t pin) {
+    return HIGH;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {
+}
+
+void detachInterrupt(uint8_t pin) {
+}
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t count = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, count);
+        dst[count] = '\0';
+    }
+    return length;
+}
+#endif
+
+String::String(double value, unsigned int decimals) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    text = buffer;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written])) {
+        written++;
+    }
+    return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+    // Stack buffer first, so logging does not show up in allocation counts
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    if ((size_t)length < sizeof(buffer)) {
+        return write((const uint8_t*)buffer, length);
+    }
+
+    std::string text(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&text[0], text.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)text.data(), length);
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = read();
+        if (c < 0) {
+            break;
+        }
+        buffer[count++] = c;
+    }
+    return count;
+}
+
+int HardwareSerial::read() {
+    if (rx.empty()) {
+        return -1;
+    }
+    uint8_t c = rx.front();
+    rx.pop_front();
+    return c;
+}
+
+size_t HardwareSerial::read(uint8_t* buffer, size_t size) {
+    size_t count = min(size, rx.size());
+    std::copy(rx.begin(), rx.begin() + count, buffer);
+    rx.erase(rx.begin(), rx.begin() + count);
+    return count;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (port != 0) {
+        tx.append((const char*)buffer, size);
+        return size;
+    }
+
+    console.append((const char*)buffer, size);
+    if (console.size() > CONSOLE_CAPTURE_MAX) {
+        console.erase(0, console.size() - CONSOLE_CAPTURE_MAX / 2);
+    }
+    if (echoConsole) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::inject(const uint8_t* data, size_t length) {
+    rx.insert(rx.end(), data, data + length);
+    if (onReceiveCallback && length > 0) {
+        onReceiveCallback();
+    }
+}
+
+size_t HardwareSerial::takeOutput(uint8_t* buffer, size_t size) {
+    size_t count = min(size, tx.size());
+    memcpy(buffer, tx.data(), count);
+    tx.erase(0, count);
+    return count;
+}
+
+std::string HardwareSerial::takeOutput() {
+    std::string output;
+    output.swap(tx);
+    return output;
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return heapFree;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return heapLargest;
+}
+
+uint32_t EspClass::getPsramSize() {
+    return psramPresent ? 8 * 1024 * 1024 : 0;
+}
+
+uint32_t EspClass::getFreePsram() {
+    return getPsramSize();
+}
+
+void EspClass::restart() {
+    exit(0);
+}
+
+bool psramFound() {
+    return psramPresent;
+}
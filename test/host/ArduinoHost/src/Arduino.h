@@ -0,0 +1,173 @@
+#ifndef ARDUINO_HOST_ARDUINO_H
+#define ARDUINO_HOST_ARDUINO_H
+
+// Host stand-in for the Arduino-ESP32 core - just the API the firmware
+// uses, so src/ builds unchanged for the native test environments.
+// Host-only controls (virtual clock, console capture, the far end of the
+// UART) are declared in ArduinoHost.h.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <deque>
+
+using std::min;
+using std::max;
+using std::abs;
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// glibc only has strlcpy from 2.38; the other host libcs have it already
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+class String {
+private:
+    std::string text;
+
+public:
+    String(const char* s = "") : text(s ? s : "") {}
+    String(const std::string& s) : text(s) {}
+    explicit String(char c) : text(1, c) {}
+    explicit String(int value) : text(std::to_string(value)) {}
+    explicit String(unsigned int value) : text(std::to_string(value)) {}
+    explicit String(long value) : text(std::to_string(value)) {}
+    explicit String(unsigned long value) : text(std::to_string(value)) {}
+    explicit String(double value, unsigned int decimals = 2);
+
+    const char* c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.size(); }
+    bool isEmpty() const { return text.empty(); }
+    char operator[](unsigned int index) const { return index < text.size() ? text[index] : 0; }
+
+    String& operator+=(const String& s) { text += s.text; return *this; }
+    String& operator+=(const char* s) { text += s; return *this; }
+    String& operator+=(char c) { text += c; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+    friend String operator+(const String& a, const char* b) { return String(a.text + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.text); }
+    bool operator==(const String& s) const { return text == s.text; }
+    bool operator==(const char* s) const { return text == s; }
+    bool operator!=(const String& s) const { return text != s.text; }
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned int value) { return printf("%u", value); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value, int decimals = 2) { return printf("%.*f", decimals, value); }
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& value) { return print(value) + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    size_t readBytes(uint8_t* buffer, size_t length);
+    size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+};
+
+// UART. Serial is the debug console; its output is captured (see
+// ArduinoHost.h). Any other port is a wire to a peer played by the test:
+// the firmware's writes wait in takeOutput() and inject() delivers bytes
+// and runs the receive callback like the driver's RX event.
+class HardwareSerial : public Stream {
+private:
+    int port;
+    std::deque<uint8_t> rx;
+    std::string tx;
+    std::function<void()> onReceiveCallback;
+
+public:
+    explicit HardwareSerial(int uartNumber) : port(uartNumber) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {}
+    void end() {}
+    size_t setRxBufferSize(size_t size) { return size; }
+    void onReceive(std::function<void()> callback, bool onlyOnTimeout = false) { onReceiveCallback = callback; }
+    operator bool() const { return true; }
+
+    int available() override { return rx.size(); }
+    int read() override;
+    int peek() override { return rx.empty() ? -1 : rx.front(); }
+    size_t read(uint8_t* buffer, size_t size);
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() {}
+
+    // Host only - the peer's end of the wire
+    void inject(const uint8_t* data, size_t length);
+    void inject(const char* text) { inject((const uint8_t*)text, strlen(text)); }
+    size_t takeOutput(uint8_t* buffer, size_t size);
+    std::string takeOutput();
+    size_t pendingOutput() const { return tx.size(); }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// Heap figures for HeapMonitor - set with hostSetHeap()
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getPsramSize();
+    uint32_t getFreePsram();
+    void restart();
+};
+
+extern EspClass ESP;
+
+bool psramFound();
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t count, size_t size);
+
+#endif // ARDUINO_HOST_ARDUINO_H
@@ -0,0 +1,48 @@
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+// Controls for the host stand-ins - tests only, the firmware never
+// includes this.
+//
+// Time is virtual: millis() and micros() stand still unless a test moves
+// them or a blocking call (delay, vTaskDelay, a task or queue wait with a
+// timeout) has to wait, in which case the wait takes its full timeout.
+// Everything runs on the test's thread, one task at a time: a test plays
+// several tasks by switching the current task handle, and a wait that
+// cannot be satisfied first runs the idle hook, which may play the other
+// side (a peer, the panel task) before the wait gives up, and runs again
+// once a timeout has passed.
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Virtual clock
+void hostResetClock(uint64_t startMicros = 1000000);
+void hostAdvanceMicros(uint64_t us);
+void hostAdvanceMillis(uint32_t ms);
+uint64_t hostMicros();
+
+// Tasks - the thread starts out as a task of its own
+TaskHandle_t hostCreateTask(const char* name);
+void hostSetCurrentTask(TaskHandle_t task);
+// Pending notification value of a task, without taking it
+uint32_t hostPeekNotification(TaskHandle_t task);
+
+// Called when a wait cannot be satisfied; returns true if it did anything,
+// in which case the wait checks again. Not called recursively.
+void hostSetIdleHook(std::function<bool()> hook);
+
+// Debug console (Serial) - captured, echoed to stdout with HOST_ECHO_SERIAL=1
+const std::string& hostConsole();
+bool hostConsoleContains(const char* text);
+void hostClearConsole();
+
+// Heap figures reported by ESP; PSRAM off by default like the board
+void hostSetHeap(uint32_t freeBytes, uint32_t largestBlock);
+void hostSetPsram(bool present);
+
+// A fresh, empty directory under the system temp directory
+std::string hostTempDirectory(const char* name);
+
+#endif // ARDUINO_HOST_H
@@ -0,0 +1,276 @@
+#include "HostKernel.h"
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+#include <vector>
+
+struct HostTask {
+    std::string name;
+    uint32_t stackDepth;
+    uint32_t notifyValue;
+    bool notifyPending;
+};
+
+// Items are copied in and out like the real queue; a semaphore is a queue
+// of zero-sized items
+struct HostQueue {
+    size_t capacity;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+struct HostEventGroup {
+    EventBits_t bits;
+};
+
+static HostTask* threadTask() {
+    thread_local HostTask task = {"main", 8192, 0, false};
+    return &task;
+}
+
+static thread_local HostTask* currentTask = nullptr;
+
+TaskHandle_t hostCreateTask(const char* name) {
+    return new HostTask{name, 4096, 0, false};
+}
+
+void hostSetCurrentTask(TaskHandle_t task) {
+    currentTask = task;
+}
+
+uint32_t hostPeekNotification(TaskHandle_t task) {
+    return task->notifyValue;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* created) {
+    HostTask* task = hostCreateTask(name);
+    task->stackDepth = stackDepth;
+    if (created) {
+        *created = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+    return xTaskCreate(function, name, stackDepth, parameters, priority, created);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return currentTask ? currentTask : threadTask();
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : xTaskGetCurrentTaskHandle())->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    // Host stacks are not watched - report half the stack as never touched
+    return (task ? task : xTaskGetCurrentTaskHandle())->stackDepth / 2;
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+BaseType_t xPortGetCoreID() {
+    return 0;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    hostWait(ticks, [] { return false; });
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    task->notifyValue++;
+    task->notifyPending = true;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    xTaskNotifyGive(task);
+    if (woken) {
+        *woken = pdTRUE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    HostTask* task = xTaskGetCurrentTaskHandle();
+    if (!hostWait(ticks, [task] { return task->notifyValue != 0; })) {
+        return 0;
+    }
+
+    uint32_t value = task->notifyValue;
+    task->notifyValue = clearOnExit ? 0 : value - 1;
+    task->notifyPending = false;
+    return value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    switch (action) {
+        case eSetBits:
+            task->notifyValue |= value;
+            break;
+        case eIncrement:
+            task->notifyValue++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notifyValue = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (task->notifyPending) {
+                return pdFAIL;
+            }
+            task->notifyValue = value;
+            break;
+        case eNoAction:
+            break;
+    }
+    task->notifyPending = true;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken) {
+    if (woken) {
+        *woken = pdTRUE;
+    }
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+    HostTask* task = xTaskGetCurrentTaskHandle();
+    if (!task->notifyPending) {
+        task->notifyValue &= ~clearOnEntry;
+    }
+    if (!hostWait(ticks, [task] { return task->notifyPending; })) {
+        return pdFALSE;
+    }
+
+    if (value) {
+        *value = task->notifyValue;
+    }
+    task->notifyValue &= ~clearOnExit;
+    task->notifyPending = false;
+    return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new HostQueue{length, itemSize, {}};
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    if (!hostWait(ticks, [queue] { return queue->items.size() < queue->capacity; })) {
+        return pdFALSE;
+    }
+    const uint8_t* bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return xQueueSend(queue, item, ticks);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    if (!hostWait(ticks, [queue] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (queue->itemSize > 0) {
+        memcpy(item, queue->items.front().data(), queue->itemSize);
+    }
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks) {
+    if (!hostWait(ticks, [queue] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    queue->items.clear();
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    HostQueue* semaphore = new HostQueue{maxCount, 0, {}};
+    semaphore->items.resize(initialCount);
+    return semaphore;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xQueueReceive(semaphore, nullptr, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return xQueueSend(semaphore, nullptr, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* woken) {
+    return xSemaphoreGive(semaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    return semaphore->items.size();
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup{0};
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    group->bits |= bits;
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks) {
+    auto satisfied = [group, bits, waitForAll] {
+        return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool ready = hostWait(ticks, satisfied);
+    EventBits_t value = group->bits;
+    if (ready && clearOnExit) {
+        group->bits &= ~bits;
+    }
+    return value;
+}
@@ -0,0 +1,50 @@
+#include <HTTPClient.h>
+
+static HostHttpServer httpServer;
+static uint32_t httpConnections = 0;
+
+void hostSetHttpServer(HostHttpServer server) {
+    httpServer = server;
+    httpConnections = 0;
+}
+
+uint32_t hostHttpConnections() {
+    return httpConnections;
+}
+
+bool HTTPClient::begin(const String& target) {
+    url = target.c_str();
+    headers.clear();
+    begun = !url.empty();
+    return begun;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+    headers.emplace_back(name.c_str(), value.c_str());
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+    if (!begun) {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+    if (!httpServer) {
+        connected = false;
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    HostHttpRequest request = {url, "POST", headers, std::string((const char*)payload, size), connected};
+    if (!connected) {
+        httpConnections++;
+    }
+    response.clear();
+    int code = httpServer(request, response);
+    // A transport error drops the socket; a response keeps it if asked to
+    connected = code > 0 && reuse;
+    return code;
+}
+
+void HTTPClient::end() {
+    // A kept-alive socket survives for the next begin() to the same server
+    connected = connected && reuse;
+    begun = false;
+}
@@ -0,0 +1,55 @@
+#ifndef ARDUINO_HOST_HTTPCLIENT_H
+#define ARDUINO_HOST_HTTPCLIENT_H
+
+// Host stand-in for HTTPClient. Requests go to a server played by the
+// test (hostSetHttpServer); with none set every request fails like a
+// refused connection.
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTP_CODE_OK 200
+
+struct HostHttpRequest {
+    std::string url;
+    std::string method;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    bool reused;               // Sent on a connection kept alive from an earlier request
+};
+
+// Returns the status code, or a negative HTTPC_ERROR_* for a transport failure
+typedef std::function<int(const HostHttpRequest& request, std::string& response)> HostHttpServer;
+
+class HTTPClient {
+private:
+    std::string url;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string response;
+    bool reuse;
+    bool connected;
+    bool begun;
+    uint16_t timeout;
+
+public:
+    HTTPClient() : reuse(true), connected(false), begun(false), timeout(5000) {}
+
+    void setReuse(bool keepAlive) { reuse = keepAlive; }
+    void setTimeout(uint16_t ms) { timeout = ms; }
+    bool begin(const String& target);
+    void addHeader(const String& name, const String& value);
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload) { return POST((uint8_t*)payload.c_str(), payload.length()); }
+    String getString() { return String(response); }
+    void end();
+};
+
+// Host only
+void hostSetHttpServer(HostHttpServer server);
+// Connections opened to the server since the last hostSetHttpServer()
+uint32_t hostHttpConnections();
+
+#endif // ARDUINO_HOST_HTTPCLIENT_H
@@ -0,0 +1,73 @@
+#include "ArduinoHost.h"
+#include <esp_heap_caps.h>
+#include <soc/soc_memory_layout.h>
+#include <map>
+
+// External blocks by start address
+static std::map<const uint8_t*, size_t> externalBlocks;
+
+static void* rememberExternal(void* ptr, size_t size) {
+    if (ptr) {
+        externalBlocks[(const uint8_t*)ptr] = size;
+    }
+    return ptr;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return psramFound() ? rememberExternal(malloc(size), size) : nullptr;
+    }
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t count, size_t size, uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return psramFound() ? rememberExternal(calloc(count, size), count * size) : nullptr;
+    }
+    return calloc(count, size);
+}
+
+void heap_caps_free(void* ptr) {
+    externalBlocks.erase((const uint8_t*)ptr);
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return ESP.getFreePsram();
+    }
+    return ESP.getFreeHeap();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return ESP.getFreePsram();
+    }
+    return ESP.getMaxAllocHeap();
+}
+
+void* ps_malloc(size_t size) {
+    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+}
+
+void* ps_calloc(size_t count, size_t size) {
+    return heap_caps_calloc(count, size, MALLOC_CAP_SPIRAM);
+}
+
+bool esp_ptr_external_ram(const void* p) {
+    const uint8_t* address = (const uint8_t*)p;
+    auto block = externalBlocks.upper_bound(address);
+    if (block == externalBlocks.begin()) {
+        return false;
+    }
+    --block;
+    return address < block->first + block->second;
+}
+
+bool esp_ptr_internal(const void* p) {
+    return !esp_ptr_external_ram(p);
+}
+
+bool esp_ptr_dma_capable(const void* p) {
+    return esp_ptr_internal(p);
+}
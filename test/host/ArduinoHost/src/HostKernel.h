@@ -0,0 +1,45 @@
+#ifndef ARDUINO_HOST_KERNEL_H
+#define ARDUINO_HOST_KERNEL_H
+
+// Internal to the stand-ins: the wait rule shared by every blocking call
+
+#include "ArduinoHost.h"
+
+// Runs the idle hook once; false if there is none, it did nothing or it is
+// already running further up the stack
+bool hostRunIdleHook();
+
+// Runs the idle hook until ready() holds or the hook runs out of work
+template <typename Ready>
+bool hostIdleUntil(Ready ready) {
+    while (hostRunIdleHook()) {
+        if (ready()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Waits until ready() holds: a zero timeout only checks, otherwise the
+// idle hook gets to run until it runs out of work, then a finite timeout
+// passes on the virtual clock - with the hook run again at the deadline -
+// and portMAX_DELAY gives up at once
+template <typename Ready>
+bool hostWait(TickType_t ticks, Ready ready) {
+    if (ready()) {
+        return true;
+    }
+    if (ticks == 0) {
+        return false;
+    }
+    if (hostIdleUntil(ready)) {
+        return true;
+    }
+    if (ticks != portMAX_DELAY) {
+        hostAdvanceMillis(ticks);
+        hostIdleUntil(ready);
+    }
+    return ready();
+}
+
+#endif // ARDUINO_HOST_KERNEL_H
@@ -0,0 +1,245 @@
+#include "ArduinoHost.h"
+#include <LittleFS.h>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define HOST_FLASH_BYTES (1536 * 1024)
+
+struct HostFile {
+    std::string path;          // As the firmware named it
+    FILE* stream;
+    bool directory;
+    std::vector<std::string> entries;
+    size_t nextEntry;
+};
+
+LittleFSFS LittleFS;
+
+static std::string flashDirectory;
+static HostFlashStats flashStats;
+static bool failWrites = false;
+
+void hostSetFlashDirectory(const std::string& directory) {
+    flashDirectory = directory;
+}
+
+const HostFlashStats& hostFlashStats() {
+    return flashStats;
+}
+
+void hostResetFlashStats() {
+    memset(&flashStats, 0, sizeof(flashStats));
+}
+
+void hostFailFlashWrites(bool fail) {
+    failWrites = fail;
+}
+
+static fs::path hostPath(const char* path) {
+    if (flashDirectory.empty()) {
+        flashDirectory = hostTempDirectory("littlefs");
+    }
+    return fs::path(flashDirectory) / fs::path(path).relative_path();
+}
+
+File::operator bool() const {
+    return impl && (impl->stream || impl->directory);
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!impl || !impl->stream || failWrites) {
+        return 0;
+    }
+    size_t written = fwrite(buffer, 1, size, impl->stream);
+    if (written > 0) {
+        flashStats.writeCalls++;
+        flashStats.bytesWritten += written;
+    }
+    return written;
+}
+
+int File::available() {
+    return impl && impl->stream ? size() - position() : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!impl || !impl->stream) {
+        return -1;
+    }
+    int c = fgetc(impl->stream);
+    if (c != EOF) {
+        ungetc(c, impl->stream);
+    }
+    return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!impl || !impl->stream) {
+        return 0;
+    }
+    size_t read = fread(buffer, 1, size, impl->stream);
+    if (read > 0) {
+        flashStats.readCalls++;
+        flashStats.bytesRead += read;
+    }
+    return read;
+}
+
+bool File::seek(uint32_t position) {
+    return impl && impl->stream && fseek(impl->stream, position, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    return impl && impl->stream ? ftell(impl->stream) : 0;
+}
+
+size_t File::size() const {
+    if (!impl || !impl->stream) {
+        return 0;
+    }
+    fflush(impl->stream);
+    return fs::file_size(hostPath(impl->path.c_str()));
+}
+
+void File::flush() {
+    if (impl && impl->stream) {
+        fflush(impl->stream);
+    }
+}
+
+void File::close() {
+    if (impl && impl->stream) {
+        fclose(impl->stream);
+        impl->stream = nullptr;
+    }
+    impl.reset();
+}
+
+const char* File::name() const {
+    return impl ? impl->path.c_str() : "";
+}
+
+const char* File::path() const {
+    return name();
+}
+
+bool File::isDirectory() const {
+    return impl && impl->directory;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!isDirectory() || impl->nextEntry >= impl->entries.size()) {
+        return File();
+    }
+    return LittleFS.open(impl->entries[impl->nextEntry++].c_str(), mode);
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles) {
+    fs::create_directories(hostPath("/"));
+    return true;
+}
+
+bool LittleFSFS::format() {
+    fs::path root = hostPath("/");
+    fs::remove_all(root);
+    fs::create_directories(root);
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return HOST_FLASH_BYTES;
+}
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(hostPath("/"))) {
+        if (entry.is_regular_file()) {
+            used += entry.file_size();
+        }
+    }
+    return used;
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    fs::path file = hostPath(path);
+    auto impl = std::make_shared<HostFile>();
+    impl->path = path;
+    impl->stream = nullptr;
+    impl->directory = false;
+    impl->nextEntry = 0;
+
+    if (fs::is_directory(file)) {
+        impl->directory = true;
+        for (const fs::directory_entry& entry : fs::directory_iterator(file)) {
+            std::string child = impl->path;
+            if (child.empty() || child.back() != '/') {
+                child += '/';
+            }
+            impl->entries.push_back(child + entry.path().filename().string());
+        }
+        std::sort(impl->entries.begin(), impl->entries.end());
+        return File(impl);
+    }
+
+    bool writing = strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+');
+    if (writing && failWrites) {
+        return File();
+    }
+    // "r+" needs the file to exist, like LittleFS
+    impl->stream = fopen(file.string().c_str(), (std::string(mode) + "b").c_str());
+    if (!impl->stream) {
+        return File();
+    }
+    if (writing) {
+        flashStats.filesWritten++;
+    }
+    return File(impl);
+}
+
+bool LittleFSFS::exists(const char* path) {
+    return fs::exists(hostPath(path));
+}
+
+bool LittleFSFS::remove(const char* path) {
+    std::error_code error;
+    if (!fs::remove(hostPath(path), error)) {
+        return false;
+    }
+    flashStats.removes++;
+    return true;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    if (failWrites) {
+        return false;
+    }
+    std::error_code error;
+    fs::rename(hostPath(from), hostPath(to), error);
+    if (error) {
+        return false;
+    }
+    flashStats.renames++;
+    return true;
+}
+
+bool LittleFSFS::mkdir(const char* path) {
+    std::error_code error;
+    fs::create_directory(hostPath(path), error);
+    return !error;
+}
+
+bool LittleFSFS::rmdir(const char* path) {
+    std::error_code error;
+    return fs::remove(hostPath(path), error);
+}
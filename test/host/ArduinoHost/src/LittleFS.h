@@ -0,0 +1,79 @@
+#ifndef ARDUINO_HOST_LITTLEFS_H
+#define ARDUINO_HOST_LITTLEFS_H
+
+// Host stand-in for LittleFS_esp32: the file system is a host directory
+// (hostSetFlashDirectory), paths map below it. Like LittleFS_esp32 on the
+// 1.0 core, File::name() of a directory entry is the full path.
+
+#include <Arduino.h>
+#include <memory>
+
+struct HostFile;
+
+class File : public Stream {
+private:
+    std::shared_ptr<HostFile> impl;
+
+public:
+    File() {}
+    explicit File(std::shared_ptr<HostFile> file) : impl(file) {}
+
+    operator bool() const;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buffer, size_t size);
+    bool seek(uint32_t position);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+
+    const char* name() const;
+    const char* path() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = "r");
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10);
+    void end() {}
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+
+    File open(const char* path, const char* mode = "r");
+    File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+};
+
+extern LittleFSFS LittleFS;
+
+// Host only
+struct HostFlashStats {
+    uint32_t writeCalls;       // File::write calls that wrote something
+    uint64_t bytesWritten;
+    uint32_t filesWritten;     // Files opened for writing
+    uint32_t renames;
+    uint32_t removes;
+    uint32_t readCalls;        // File::read calls that read something
+    uint64_t bytesRead;
+};
+
+// Directory holding the files, e.g. from hostTempDirectory()
+void hostSetFlashDirectory(const std::string& directory);
+const HostFlashStats& hostFlashStats();
+void hostResetFlashStats();
+// While set, writes and renames fail as on a full or worn flash
+void hostFailFlashWrites(bool fail);
+
+#endif // ARDUINO_HOST_LITTLEFS_H
@@ -0,0 +1,350 @@
+#include "TFT_eSPI.h"
+#include "ArduinoHost.h"
+#include <esp_heap_caps.h>
+#include <soc/soc_memory_layout.h>
+
+static std::vector<uint16_t> frame(TFT_WIDTH * TFT_HEIGHT);
+static int16_t frameWidth = TFT_WIDTH;
+static HostPanelStats panelStats;
+static uint16_t touchX;
+static uint16_t touchY;
+static uint16_t touchZ;
+static bool panelClock = false;
+static uint64_t clockBits = 0;         // Bus bits not yet a whole microsecond
+
+// Counts bus traffic; with the panel clock on it also takes its bus time
+static void spiTransfer(uint32_t bytes) {
+    panelStats.spiBytes += bytes;
+    if (panelClock) {
+        clockBits += (uint64_t)bytes * 8;
+        uint64_t us = clockBits * 1000000 / HOST_SPI_FREQUENCY;
+        clockBits -= us * HOST_SPI_FREQUENCY / 1000000;
+        hostAdvanceMicros(us);
+    }
+}
+
+// Stand-in GLCD bitmaps: five 7-bit columns per code, blank for the space
+static uint8_t glyphColumn(uint16_t c, uint8_t column) {
+    if (c == ' ') {
+        return 0;
+    }
+    uint32_t h = (c * 2654435761u) ^ (column * 40503u);
+    h ^= h >> 15;
+    return (h * 2246822519u) >> 25;
+}
+
+static uint16_t swap16(uint16_t value) {
+    return (value >> 8) | (value << 8);
+}
+
+const HostPanelStats& hostPanelStats() {
+    return panelStats;
+}
+
+void hostResetPanelStats() {
+    memset(&panelStats, 0, sizeof(panelStats));
+}
+
+uint32_t hostPanelBusMicros(const HostPanelStats& stats) {
+    return stats.spiBytes * 8 * 1000000 / HOST_SPI_FREQUENCY;
+}
+
+uint16_t hostPanelPixel(int16_t x, int16_t y) {
+    return frame[(int32_t)y * frameWidth + x];
+}
+
+void hostSetPanelClock(bool enabled) {
+    panelClock = enabled;
+    clockBits = 0;
+}
+
+void hostSetTouch(uint16_t rawX, uint16_t rawY, uint16_t z) {
+    touchX = rawX;
+    touchY = rawY;
+    touchZ = z;
+}
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h) : widthNow(w), heightNow(h), rotation(0), cursorX(0), cursorY(0),
+    textColor(TFT_WHITE), textBgColor(TFT_WHITE), textSize(1), textDatum(TL_DATUM), swapBytes(false),
+    cp437Enabled(false), utf8Pending(0), utf8Code(0), windowX(0), windowY(0), windowW(0), windowH(0), windowPos(0),
+    DMA_Enabled(false) {}
+
+void TFT_eSPI::init(uint8_t tc) {
+    std::fill(frame.begin(), frame.end(), 0);
+    setRotation(0);
+}
+
+void TFT_eSPI::setRotation(uint8_t r) {
+    rotation = r & 3;
+    widthNow = rotation & 1 ? TFT_HEIGHT : TFT_WIDTH;
+    heightNow = rotation & 1 ? TFT_WIDTH : TFT_HEIGHT;
+    frameWidth = widthNow;
+}
+
+void TFT_eSPI::openWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+    panelStats.windows++;
+    spiTransfer(HOST_WINDOW_OVERHEAD_BYTES);
+    windowX = x;
+    windowY = y;
+    windowW = w;
+    windowH = h;
+    windowPos = 0;
+}
+
+void TFT_eSPI::storePixel(int32_t x, int32_t y, uint16_t color) {
+    panelStats.pixels++;
+    spiTransfer(2);
+    if (x >= 0 && x < widthNow && y >= 0 && y < heightNow) {
+        frame[y * frameWidth + x] = color;
+    }
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    fillRect(x, y, 1, 1, color);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    // Clipped to the screen before the window is opened
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > width()) w = width() - x;
+    if (y + h > height()) h = height() - y;
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    openWindow(x, y, w, h);
+    for (int32_t row = y; row < y + h; row++) {
+        for (int32_t col = x; col < x + w; col++) {
+            storePixel(col, row, color);
+        }
+    }
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y + 1, h - 2, color);
+    drawFastVLine(x + w - 1, y + 1, h - 2, color);
+}
+
+void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) {
+    if (!cp437Enabled && c >= 176) {
+        c++;
+    }
+    drawGlyph(x, y, c & 0xFF, color, bg, size);
+}
+
+void TFT_eSPI::drawGlyph(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) {
+    bool opaque = bg != color;
+
+    // Size 1 with a background streams the 6x8 cell through one window
+    if (size == 1 && opaque) {
+        openWindow(x, y, 6, 8);
+        for (int8_t j = 0; j < 8; j++) {
+            for (int8_t i = 0; i < 6; i++) {
+                uint8_t line = i < 5 ? glyphColumn(c, i) : 0;
+                storePixel(x + i, y + j, (line >> j) & 1 ? color : bg);
+            }
+        }
+        return;
+    }
+
+    // Otherwise one fillRect per font cell
+    for (int8_t i = 0; i < 6; i++) {
+        uint8_t line = i < 5 ? glyphColumn(c, i) : 0;
+        for (int8_t j = 0; j < 8; j++, line >>= 1) {
+            if (line & 1) {
+                fillRect(x + i * size, y + j * size, size, size, color);
+            } else if (opaque) {
+                fillRect(x + i * size, y + j * size, size, size, bg);
+            }
+        }
+    }
+}
+
+size_t TFT_eSPI::write(uint8_t c) {
+    // UTF-8 decoding as in TFT_eSPI::decodeUTF8, two-byte sequences
+    uint16_t code = c;
+    if (utf8Pending > 0 && (c & 0xC0) == 0x80) {
+        code = utf8Code | (c & 0x3F);
+        utf8Pending = 0;
+    } else if ((c & 0xE0) == 0xC0) {
+        utf8Code = (c & 0x1F) << 6;
+        utf8Pending = 1;
+        return 1;
+    } else {
+        utf8Pending = 0;
+    }
+
+    if (code == '\r' || code > 255) {
+        return 1;
+    }
+    if (code == '\n') {
+        cursorY += 8 * textSize;
+        cursorX = 0;
+        return 1;
+    }
+    drawChar(cursorX, cursorY, code, textColor, textBgColor, textSize);
+    cursorX += 6 * textSize;
+    return 1;
+}
+
+int16_t TFT_eSPI::textWidth(const char* text) {
+    int16_t count = 0;
+    for (const uint8_t* p = (const uint8_t*)text; *p; p++) {
+        if ((*p & 0xC0) != 0x80) {
+            count++;
+        }
+    }
+    return count * 6 * textSize;
+}
+
+int16_t TFT_eSPI::drawString(const char* text, int32_t x, int32_t y) {
+    int16_t w = textWidth(text);
+    int16_t h = fontHeight();
+    x -= (textDatum % 3) * w / 2;
+    y -= (textDatum / 3) * h / 2;
+
+    int32_t savedX = cursorX;
+    int32_t savedY = cursorY;
+    setCursor(x, y);
+    print(text);
+    setCursor(savedX, savedY);
+    return w;
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+    openWindow(x, y, w, h);
+}
+
+void TFT_eSPI::pushPixels(const void* data, uint32_t length) {
+    const uint16_t* pixels = (const uint16_t*)data;
+    for (uint32_t i = 0; i < length; i++, windowPos++) {
+        uint16_t color = swapBytes ? pixels[i] : swap16(pixels[i]);
+        storePixel(windowX + windowPos % windowW, windowY + windowPos / windowW, color);
+    }
+}
+
+void TFT_eSPI::pushColor(uint16_t color, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++, windowPos++) {
+        storePixel(windowX + windowPos % windowW, windowY + windowPos / windowW, color);
+    }
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data) {
+    openWindow(x, y, w, h);
+    pushPixels(data, (uint32_t)w * h);
+}
+
+bool TFT_eSPI::initDMA(bool ctrlCs) {
+    DMA_Enabled = true;
+    return true;
+}
+
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data, uint16_t* buffer) {
+    panelStats.dmaTransfers++;
+    if (!esp_ptr_dma_capable(data)) {
+        panelStats.dmaFromExternal++;
+    }
+    pushImage(x, y, w, h, data);
+}
+
+void TFT_eSPI::writecommand(uint8_t c) {
+    panelStats.commands++;
+    spiTransfer(1);
+}
+
+void TFT_eSPI::writedata(uint8_t d) {
+    spiTransfer(1);
+}
+
+uint8_t TFT_eSPI::getTouchRaw(uint16_t* x, uint16_t* y) {
+    *x = touchX;
+    *y = touchY;
+    return 1;
+}
+
+uint16_t TFT_eSPI::getTouchRawZ() {
+    return touchZ;
+}
+
+TFT_eSprite::TFT_eSprite(TFT_eSPI* panel) : TFT_eSPI(0, 0), tft(panel), buffer(nullptr), external(false),
+    psramEnable(true), colorDepth(16) {}
+
+TFT_eSprite::~TFT_eSprite() {
+    deleteSprite();
+}
+
+void TFT_eSprite::setAttribute(uint8_t attribute, uint8_t value) {
+    if (attribute == PSRAM_ENABLE) {
+        psramEnable = value;
+    }
+}
+
+void* TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t frames) {
+    if (buffer) {
+        return buffer;
+    }
+
+    external = psramFound() && psramEnable && !tft->DMA_Enabled;
+    size_t pixels = (size_t)w * h;
+    buffer = (uint16_t*)heap_caps_calloc(pixels, sizeof(uint16_t), external ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+    if (!buffer) {
+        return nullptr;
+    }
+    widthNow = w;
+    heightNow = h;
+    return buffer;
+}
+
+void TFT_eSprite::deleteSprite() {
+    heap_caps_free(buffer);
+    buffer = nullptr;
+    widthNow = 0;
+    heightNow = 0;
+}
+
+void TFT_eSprite::openWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+    windowX = x;
+    windowY = y;
+    windowW = w;
+    windowH = h;
+    windowPos = 0;
+}
+
+void TFT_eSprite::storePixel(int32_t x, int32_t y, uint16_t color) {
+    if (buffer && x >= 0 && x < widthNow && y >= 0 && y < heightNow) {
+        buffer[y * widthNow + x] = swap16(color);
+    }
+}
+
+void TFT_eSprite::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    storePixel(x, y, color);
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > widthNow) w = widthNow - x;
+    if (y + h > heightNow) h = heightNow - y;
+    if (!buffer || w <= 0 || h <= 0) {
+        return;
+    }
+
+    uint16_t value = swap16(color);
+    for (int32_t row = y; row < y + h; row++) {
+        std::fill(buffer + row * widthNow + x, buffer + row * widthNow + x + w, value);
+    }
+}
+
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y) const {
+    return swap16(buffer[y * widthNow + x]);
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y) {
+    bool swap = tft->getSwapBytes();
+    tft->setSwapBytes(false);
+    tft->pushImage(x, y, widthNow, heightNow, buffer);
+    tft->setSwapBytes(swap);
+}
@@ -0,0 +1,177 @@
+#ifndef ARDUINO_HOST_TFT_ESPI_H
+#define ARDUINO_HOST_TFT_ESPI_H
+
+// Host stand-in for TFT_eSPI: a framebuffer panel that counts what would
+// cross the SPI bus, and sprites in host memory.
+//
+// Bus cost follows the model in WidgetSet.h: every address window costs
+// SPI_WINDOW_OVERHEAD_BYTES of commands and parameters, every pixel two
+// bytes. Drawing calls open windows the way TFT_eSPI does - a fillRect is
+// one window, a GLCD character at size > 1 with a background is one
+// window per font cell - so the counters are an independent check of the
+// firmware's own accounting. Glyph bitmaps are stand-ins; only their cell
+// structure matters for the counts.
+
+#include <Arduino.h>
+#include <vector>
+
+#define TFT_WIDTH 320
+#define TFT_HEIGHT 480
+#define HOST_SPI_FREQUENCY 40000000    // lib/TFT_eSPI/User_Setup.h
+#define HOST_WINDOW_OVERHEAD_BYTES 11
+
+#define TFT_BLACK 0x0000
+#define TFT_WHITE 0xFFFF
+#define TFT_GREEN 0x07E0
+#define TFT_RED 0xF800
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+#define PSRAM_ENABLE 3
+
+// What crossed the bus since the last hostResetPanelStats()
+struct HostPanelStats {
+    uint32_t windows;          // Address windows opened
+    uint64_t pixels;           // Pixels written
+    uint64_t spiBytes;         // Window overhead, pixel data and commands
+    uint32_t commands;         // Raw writecommand() calls
+    uint32_t dmaTransfers;
+    uint32_t dmaFromExternal;  // DMA started from a buffer in external RAM
+};
+
+class TFT_eSPI : public Print {
+protected:
+    int16_t widthNow;
+    int16_t heightNow;
+    uint8_t rotation;
+    int32_t cursorX;
+    int32_t cursorY;
+    uint32_t textColor;
+    uint32_t textBgColor;
+    uint8_t textSize;
+    uint8_t textDatum;
+    bool swapBytes;
+    bool cp437Enabled;
+    uint8_t utf8Pending;       // Bytes still expected in a UTF-8 sequence
+    uint16_t utf8Code;
+
+    // Window being streamed by pushPixels()
+    int32_t windowX, windowY, windowW, windowH;
+    int32_t windowPos;
+
+    void drawGlyph(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+    virtual void storePixel(int32_t x, int32_t y, uint16_t color);
+    virtual void openWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+
+public:
+    bool DMA_Enabled;
+
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT);
+    virtual ~TFT_eSPI() {}
+
+    void init(uint8_t tc = 0);
+    void begin(uint8_t tc = 0) { init(tc); }
+    void setRotation(uint8_t r);
+    uint8_t getRotation() const { return rotation; }
+    int16_t width() const { return widthNow; }
+    int16_t height() const { return heightNow; }
+
+    virtual void drawPixel(int32_t x, int32_t y, uint32_t color);
+    virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void fillScreen(uint32_t color) { fillRect(0, 0, widthNow, heightNow, color); }
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) { fillRect(x, y, 1, h, color); }
+
+    // GLCD font (font 1) only
+    void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+    int16_t drawString(const char* text, int32_t x, int32_t y);
+    int16_t drawString(const String& text, int32_t x, int32_t y) { return drawString(text.c_str(), x, y); }
+    int16_t textWidth(const char* text);
+    int16_t fontHeight() const { return 8 * textSize; }
+    void setTextColor(uint16_t color) { textColor = textBgColor = color; }
+    void setTextColor(uint16_t color, uint16_t bg, bool fill = false) { textColor = color; textBgColor = bg; }
+    void setTextSize(uint8_t size) { textSize = size > 0 ? size : 1; }
+    void setTextDatum(uint8_t datum) { textDatum = datum; }
+    void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+    int16_t getCursorX() const { return cursorX; }
+    int16_t getCursorY() const { return cursorY; }
+    void cp437(bool enable = true) { cp437Enabled = enable; }
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    void startWrite() {}
+    void endWrite() {}
+    void setSwapBytes(bool swap) { swapBytes = swap; }
+    bool getSwapBytes() const { return swapBytes; }
+    void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+    void pushPixels(const void* data, uint32_t length);
+    void pushColor(uint16_t color, uint32_t length = 1);
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data);
+
+    bool initDMA(bool ctrlCs = false);
+    void deInitDMA() { DMA_Enabled = false; }
+    bool dmaBusy() { return false; }
+    void dmaWait() {}
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data, uint16_t* buffer = nullptr);
+
+    void writecommand(uint8_t c);
+    void writedata(uint8_t d);
+
+    uint8_t getTouchRaw(uint16_t* x, uint16_t* y);
+    uint16_t getTouchRawZ();
+};
+
+class TFT_eSprite : public TFT_eSPI {
+private:
+    TFT_eSPI* tft;
+    uint16_t* buffer;          // Panel byte order, like the real sprite
+    bool external;             // Buffer came from PSRAM
+    bool psramEnable;
+    uint8_t colorDepth;
+
+protected:
+    void storePixel(int32_t x, int32_t y, uint16_t color) override;
+    void openWindow(int32_t x, int32_t y, int32_t w, int32_t h) override;
+
+public:
+    explicit TFT_eSprite(TFT_eSPI* panel);
+    ~TFT_eSprite();
+
+    void setColorDepth(int8_t depth) { colorDepth = depth; }
+    void setAttribute(uint8_t attribute, uint8_t value);
+    // Like TFT_eSPI: PSRAM if present and enabled, unless the panel has DMA on
+    void* createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+    void deleteSprite();
+    bool created() const { return buffer != nullptr; }
+    void* getPointer() { return buffer; }
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color) override;
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+    void fillSprite(uint32_t color) { fillRect(0, 0, widthNow, heightNow, color); }
+    uint16_t readPixel(int32_t x, int32_t y) const;
+    void pushSprite(int32_t x, int32_t y);
+};
+
+// Host only
+const HostPanelStats& hostPanelStats();
+void hostResetPanelStats();
+// Bus time of the counted traffic at HOST_SPI_FREQUENCY
+uint32_t hostPanelBusMicros(const HostPanelStats& stats);
+// While set, panel traffic moves the virtual clock by its bus time, as the
+// drawing task would block on SPI; off by default
+void hostSetPanelClock(bool enabled);
+// Panel content in the current rotation
+uint16_t hostPanelPixel(int16_t x, int16_t y);
+// Touch controller: raw readings returned until changed, z 0 = pen up
+void hostSetTouch(uint16_t rawX, uint16_t rawY, uint16_t z);
+
+#endif // ARDUINO_HOST_TFT_ESPI_H
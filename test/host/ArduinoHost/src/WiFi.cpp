@@ -0,0 +1,133 @@
+#include <WiFi.h>
+
+WiFiClass WiFi;
+const IPAddress INADDR_NONE((uint32_t)0);
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(text);
+}
+
+WiFiClass::WiFiClass() : callback(nullptr) {
+    hostReset();
+}
+
+void WiFiClass::hostReset() {
+    callback = nullptr;
+    state = WL_IDLE_STATUS;
+    configured = address = gateway = subnet = dns = IPAddress();
+    memset(bssid, 0, sizeof(bssid));
+    channelNow = 0;
+    attempts.clear();
+    networks.clear();
+    found.clear();
+    scanState = WIFI_SCAN_FAILED;
+}
+
+void WiFiClass::raise(arduino_event_id_t id, uint8_t reason) {
+    arduino_event_t event = {};
+    event.event_id = id;
+    event.event_info.wifi_sta_disconnected.reason = reason;
+    if (callback) {
+        callback(&event);
+    }
+}
+
+int WiFiClass::onEvent(WiFiEventSysCb cb, arduino_event_id_t event) {
+    callback = cb;
+    return 1;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gw, IPAddress mask, IPAddress dns1) {
+    configured = local;
+    if (local != INADDR_NONE) {
+        gateway = gw;
+        subnet = mask;
+        dns = dns1;
+    }
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* pinned,
+                             bool connect) {
+    attempts.push_back({millis(), (uint8_t)channel, pinned != nullptr, configured != INADDR_NONE});
+    if (pinned) {
+        memcpy(bssid, pinned, sizeof(bssid));
+    }
+    state = WL_DISCONNECTED;
+    return state;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    bool wasConnected = state == WL_CONNECTED;
+    state = WL_DISCONNECTED;
+    address = IPAddress();
+    if (wasConnected) {
+        // The driver reports its own leave like any other disconnect
+        raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+    return true;
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool showHidden, bool passive, uint32_t maxMsPerChannel,
+                                uint8_t channel) {
+    if (scanState == WIFI_SCAN_RUNNING) {
+        return WIFI_SCAN_FAILED;
+    }
+    found.clear();
+    for (const HostWiFiNetwork& network : networks) {
+        if (channel == 0 || network.channel == channel) {
+            found.push_back(network);
+        }
+    }
+    scanState = WIFI_SCAN_RUNNING;
+    return WIFI_SCAN_RUNNING;
+}
+
+void WiFiClass::scanDelete() {
+    found.clear();
+    scanState = WIFI_SCAN_FAILED;
+}
+
+String WiFiClass::SSID(uint8_t index) const {
+    return index < found.size() ? String(found[index].ssid.c_str()) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t index) const {
+    return index < found.size() ? found[index].rssi : 0;
+}
+
+void WiFiClass::hostConnect(IPAddress ip, uint8_t channel) {
+    state = WL_CONNECTED;
+    channelNow = channel;
+    address = configured != INADDR_NONE ? configured : ip;
+    if (configured == INADDR_NONE) {
+        // DHCP handed out the rest
+        gateway = IPAddress(192, 168, 1, 1);
+        subnet = IPAddress(255, 255, 255, 0);
+        dns = gateway;
+    }
+    if (bssid[0] == 0) {
+        static const uint8_t ap[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+        memcpy(bssid, ap, sizeof(bssid));
+    }
+    raise(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+}
+
+void WiFiClass::hostDisconnect(uint8_t reason) {
+    state = WL_DISCONNECTED;
+    address = IPAddress();
+    raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, reason);
+}
+
+void WiFiClass::hostFinishScan() {
+    if (scanState != WIFI_SCAN_RUNNING) {
+        return;
+    }
+    scanState = found.size();
+    raise(ARDUINO_EVENT_WIFI_SCAN_DONE, 0);
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2,
+                const char* server3) {}
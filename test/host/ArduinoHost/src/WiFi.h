@@ -0,0 +1,161 @@
+#ifndef ARDUINO_HOST_WIFI_H
+#define ARDUINO_HOST_WIFI_H
+
+// Host stand-in for the WiFi station. Nothing happens over the air: a
+// test plays the driver by raising events (got IP, disconnected, scan
+// done) and reads back what the firmware asked for. Like the driver,
+// events reach the onEvent() callback at once, on the caller's thread.
+
+#include <Arduino.h>
+#include <vector>
+
+class IPAddress {
+private:
+    uint32_t address;          // Network byte order, like the core
+
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint32_t value) : address(value) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+
+    operator uint32_t() const { return address; }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+    uint8_t operator[](int index) const { return (address >> (index * 8)) & 0xFF; }
+    String toString() const;
+};
+
+extern const IPAddress INADDR_NONE;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_SCAN_DONE = 1,
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_MAX = 64
+} arduino_event_id_t;
+
+// Disconnect reasons used by the firmware and tests (esp_wifi_types.h)
+#define WIFI_REASON_AUTH_EXPIRE 2
+#define WIFI_REASON_ASSOC_LEAVE 8
+#define WIFI_REASON_BEACON_TIMEOUT 200
+#define WIFI_REASON_NO_AP_FOUND 201
+#define WIFI_REASON_AUTH_FAIL 202
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+typedef struct {
+    uint8_t reason;
+} wifi_event_sta_disconnected_t;
+
+typedef union {
+    wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef struct {
+    arduino_event_id_t event_id;
+    arduino_event_info_t event_info;
+} arduino_event_t;
+
+typedef void (*WiFiEventSysCb)(arduino_event_t* event);
+
+// One WiFi.begin() call, as the firmware made it
+struct HostWiFiAttempt {
+    unsigned long at;          // millis()
+    uint8_t channel;           // 0 = all channels
+    bool bssid;                // Pinned to an AP
+    bool staticIP;             // config() had an address, so no DHCP
+};
+
+struct HostWiFiNetwork {
+    std::string ssid;
+    int32_t rssi;
+    uint8_t channel;
+};
+
+class WiFiClass {
+private:
+    WiFiEventSysCb callback;
+    wl_status_t state;
+    IPAddress configured;
+    IPAddress address;
+    IPAddress gateway;
+    IPAddress subnet;
+    IPAddress dns;
+    uint8_t bssid[6];
+    uint8_t channelNow;
+    std::vector<HostWiFiAttempt> attempts;
+    std::vector<HostWiFiNetwork> networks;
+    std::vector<HostWiFiNetwork> found;
+    int scanState;
+
+    void raise(arduino_event_id_t id, uint8_t reason);
+
+public:
+    WiFiClass();
+
+    void persistent(bool persistent) {}
+    bool setAutoReconnect(bool autoReconnect) { return true; }
+    int onEvent(WiFiEventSysCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    bool mode(wifi_mode_t mode) { return true; }
+
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t)0);
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    wl_status_t status() const { return state; }
+
+    IPAddress localIP() const { return address; }
+    IPAddress gatewayIP() const { return gateway; }
+    IPAddress subnetMask() const { return subnet; }
+    IPAddress dnsIP(uint8_t index = 0) const { return dns; }
+    uint8_t* BSSID() { return bssid; }
+    int32_t channel() const { return channelNow; }
+
+    int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false,
+                         uint32_t maxMsPerChannel = 300, uint8_t channel = 0);
+    int16_t scanComplete() const { return scanState; }
+    void scanDelete();
+    String SSID(uint8_t index) const;
+    int32_t RSSI(uint8_t index) const;
+
+    // Host only - the driver's side
+    // Associates with `channel` and hands out `ip`: raises GOT_IP
+    void hostConnect(IPAddress ip, uint8_t channel = 6);
+    // Link lost or attempt failed: raises STA_DISCONNECTED with `reason`
+    void hostDisconnect(uint8_t reason);
+    // Networks found by scans, each on its own channel
+    void hostSetNetworks(const std::vector<HostWiFiNetwork>& list) { networks = list; }
+    // Finishes a running scan: raises SCAN_DONE
+    void hostFinishScan();
+    const std::vector<HostWiFiAttempt>& hostAttempts() const { return attempts; }
+    void hostReset();
+};
+
+extern WiFiClass WiFi;
+
+// SNTP - the host clock is already set
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2 = nullptr,
+                const char* server3 = nullptr);
+
+#endif // ARDUINO_HOST_WIFI_H
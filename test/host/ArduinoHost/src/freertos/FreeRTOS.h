@@ -0,0 +1,36 @@
+#ifndef ARDUINO_HOST_FREERTOS_H
+#define ARDUINO_HOST_FREERTOS_H
+
+// Host stand-in for the ESP-IDF FreeRTOS API used by the firmware.
+// Objects are plain host structures; nothing is pre-empted. Waits follow
+// the rules in ArduinoHost.h.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+typedef void (*TaskFunction_t)(void*);
+
+struct HostTask;
+struct HostQueue;
+struct HostEventGroup;
+typedef HostTask* TaskHandle_t;
+typedef HostQueue* QueueHandle_t;
+typedef HostQueue* SemaphoreHandle_t;
+typedef HostEventGroup* EventGroupHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+#endif // ARDUINO_HOST_FREERTOS_H
@@ -0,0 +1,13 @@
+#ifndef ARDUINO_HOST_FREERTOS_EVENT_GROUPS_H
+#define ARDUINO_HOST_FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks);
+
+#endif // ARDUINO_HOST_FREERTOS_EVENT_GROUPS_H
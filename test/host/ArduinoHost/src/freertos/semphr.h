@@ -0,0 +1,16 @@
+#ifndef ARDUINO_HOST_FREERTOS_SEMPHR_H
+#define ARDUINO_HOST_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+// Semaphores are counting queues without data; a mutex starts given
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* woken);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
+
+#endif // ARDUINO_HOST_FREERTOS_SEMPHR_H
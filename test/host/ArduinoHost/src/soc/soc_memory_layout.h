@@ -0,0 +1,13 @@
+#ifndef ARDUINO_HOST_SOC_MEMORY_LAYOUT_H
+#define ARDUINO_HOST_SOC_MEMORY_LAYOUT_H
+
+// Host stand-in: external RAM is whatever the host heap handed out for
+// PSRAM (ps_malloc, MALLOC_CAP_SPIRAM); everything else counts as internal
+
+#include <stdbool.h>
+
+bool esp_ptr_external_ram(const void* p);
+bool esp_ptr_internal(const void* p);
+bool esp_ptr_dma_capable(const void* p);
+
+#endif // ARDUINO_HOST_SOC_MEMORY_LAYOUT_H
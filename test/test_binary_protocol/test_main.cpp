@@ -0,0 +1,231 @@
+// Binary link protocol: every message type survives encode and decode,
+// and a damaged frame is rejected without losing the frame after it.
+
+#include <unity.h>
+#include <vector>
+#include "BinaryProtocol.h"
+#include "LineFramer.h"
+
+struct Decoded {
+    uint8_t msgId;
+    uint8_t seq;
+    std::vector<uint8_t> payload;
+};
+
+static void appendFrame(std::vector<uint8_t>& stream, uint8_t msgId, uint8_t seq, const void* payload, size_t length) {
+    uint8_t frame[BINARY_MAX_FRAME];
+    size_t size = encodeFrame(msgId, seq, payload, length, frame);
+    TEST_ASSERT_GREATER_THAN(0, size);
+    TEST_ASSERT_LESS_OR_EQUAL(BINARY_MAX_FRAME, size);
+    TEST_ASSERT_EQUAL_HEX8(0x00, frame[size - 1]);
+    stream.insert(stream.end(), frame, frame + size);
+}
+
+// Receive path of UARTManager in binary mode: zero-delimited framing,
+// then COBS and CRC; returns the good packets, counts the rejected ones
+static std::vector<Decoded> receive(const std::vector<uint8_t>& stream, size_t chunk, uint32_t* rejected) {
+    LineFramer framer(0x00, false);
+    std::vector<Decoded> packets;
+    *rejected = 0;
+
+    size_t offset = 0;
+    while (offset < stream.size()) {
+        size_t space;
+        uint8_t* dest = framer.writePtr(space);
+        size_t count = std::min(std::min(chunk, space), stream.size() - offset);
+        memcpy(dest, stream.data() + offset, count);
+        framer.commit(count);
+        offset += count;
+
+        char* line;
+        size_t length;
+        while (framer.nextLine(line, length)) {
+            BinaryPacket packet;
+            if (!decodeFrame((uint8_t*)line, length, packet)) {
+                (*rejected)++;
+                continue;
+            }
+            packets.push_back({packet.msgId, packet.seq,
+                               std::vector<uint8_t>(packet.payload, packet.payload + packet.payloadLength)});
+        }
+    }
+    return packets;
+}
+
+static void assertPayload(const Decoded& packet, uint8_t msgId, uint8_t seq, const void* payload, size_t length) {
+    TEST_ASSERT_EQUAL_HEX8(msgId, packet.msgId);
+    TEST_ASSERT_EQUAL_UINT8(seq, packet.seq);
+    TEST_ASSERT_EQUAL_size_t(length, packet.payload.size());
+    if (length > 0) {
+        TEST_ASSERT_EQUAL_MEMORY(payload, packet.payload.data(), length);
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_crc_matches_ccitt_false(void) {
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16((const uint8_t*)"123456789", 9));
+}
+
+void test_cobs_round_trip_with_zeros_and_long_runs(void) {
+    // Zeros at both ends and a run longer than one COBS block
+    uint8_t input[300];
+    for (size_t i = 0; i < sizeof(input); i++) {
+        input[i] = i % 97 == 0 ? 0 : (uint8_t)i;
+    }
+    for (size_t i = 1; i < 260; i++) {
+        input[i] = 0x55;
+    }
+    uint8_t encoded[sizeof(input) + sizeof(input) / 254 + 2];
+    uint8_t decoded[sizeof(encoded)];
+
+    size_t length = cobsEncode(input, sizeof(input), encoded);
+    TEST_ASSERT_NULL(memchr(encoded, 0, length));
+    TEST_ASSERT_EQUAL_size_t(sizeof(input), cobsDecode(encoded, length, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(input, decoded, sizeof(input));
+}
+
+void test_every_message_type_round_trips(void) {
+    std::vector<uint8_t> stream;
+
+    ManualPayload manual = {CONTROL_PUMP, 3, 1017};
+    ManualAckPayload ack = {1017, MANUAL_RESULT_OK};
+    SensorPayload sensors = {0x05, {}};
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        sensors.values[i] = i == 1 ? 0.0f : 21.5f + i;  // Zero bytes inside the payload
+    }
+    SubscribePayload subscribe = {10, 4000};
+    SubscribedPayload subscribed = {8};
+    uint8_t update[sizeof(SensorUpdateHeader) + 2 * sizeof(float)];
+    SensorUpdateHeader header = {UPDATE_FLAG_KEYFRAME, 0x03};
+    float changed[2] = {19.25f, -4.0f};
+    memcpy(update, &header, sizeof(header));
+    memcpy(update + sizeof(header), changed, sizeof(changed));
+    uint8_t status[sizeof(StatusPayload) + 4];
+    StatusPayload statusHeader = {STATUS_FLAG_OK | STATUS_FLAG_WIFI_CONNECTED, 4};
+    memcpy(status, &statusHeader, sizeof(statusHeader));
+    memcpy(status + sizeof(statusHeader), "busy", 4);
+    uint8_t largest[BINARY_MAX_PAYLOAD];
+    memset(largest, 0, sizeof(largest));
+
+    appendFrame(stream, MSG_GET_SENSORS, 1, nullptr, 0);
+    appendFrame(stream, MSG_GET_STATUS, 2, nullptr, 0);
+    appendFrame(stream, MSG_MANUAL, 3, &manual, sizeof(manual));
+    appendFrame(stream, MSG_SUBSCRIBE, 4, &subscribe, sizeof(subscribe));
+    appendFrame(stream, MSG_SENSORS, 5, &sensors, sizeof(sensors));
+    appendFrame(stream, MSG_STATUS, 6, status, sizeof(status));
+    appendFrame(stream, MSG_SUBSCRIBED, 7, &subscribed, sizeof(subscribed));
+    appendFrame(stream, MSG_SENSOR_UPDATE, 8, update, sizeof(update));
+    appendFrame(stream, MSG_MANUAL_ACK, 9, &ack, sizeof(ack));
+    appendFrame(stream, MSG_SENSORS, 0, largest, sizeof(largest));
+
+    uint32_t rejected;
+    std::vector<Decoded> packets = receive(stream, 7, &rejected);
+
+    TEST_ASSERT_EQUAL_UINT32(0, rejected);
+    TEST_ASSERT_EQUAL_size_t(10, packets.size());
+    assertPayload(packets[0], MSG_GET_SENSORS, 1, nullptr, 0);
+    assertPayload(packets[1], MSG_GET_STATUS, 2, nullptr, 0);
+    assertPayload(packets[2], MSG_MANUAL, 3, &manual, sizeof(manual));
+    assertPayload(packets[3], MSG_SUBSCRIBE, 4, &subscribe, sizeof(subscribe));
+    assertPayload(packets[4], MSG_SENSORS, 5, &sensors, sizeof(sensors));
+    assertPayload(packets[5], MSG_STATUS, 6, status, sizeof(status));
+    assertPayload(packets[6], MSG_SUBSCRIBED, 7, &subscribed, sizeof(subscribed));
+    assertPayload(packets[7], MSG_SENSOR_UPDATE, 8, update, sizeof(update));
+    assertPayload(packets[8], MSG_MANUAL_ACK, 9, &ack, sizeof(ack));
+    assertPayload(packets[9], MSG_SENSORS, 0, largest, sizeof(largest));
+}
+
+void test_oversize_payload_is_not_encoded(void) {
+    uint8_t payload[BINARY_MAX_PAYLOAD + 1] = {};
+    uint8_t frame[BINARY_MAX_FRAME + 8];
+    TEST_ASSERT_EQUAL_size_t(0, encodeFrame(MSG_SENSORS, 1, payload, sizeof(payload), frame));
+}
+
+// A damaged frame between two good ones: the damaged one is rejected and
+// the next one still decodes
+static void assertResynchronises(void (*damage)(std::vector<uint8_t>& frame), uint32_t expectedRejects) {
+    ManualAckPayload ack = {42, MANUAL_RESULT_OK};
+    SensorPayload sensors = {0x07, {20.5f, 45.0f, 1013.0f}};
+
+    std::vector<uint8_t> stream;
+    appendFrame(stream, MSG_MANUAL_ACK, 1, &ack, sizeof(ack));
+    std::vector<uint8_t> bad;
+    appendFrame(bad, MSG_SENSORS, 2, &sensors, sizeof(sensors));
+    damage(bad);
+    stream.insert(stream.end(), bad.begin(), bad.end());
+    appendFrame(stream, MSG_SENSORS, 3, &sensors, sizeof(sensors));
+
+    // Whole stream at once and byte by byte
+    for (size_t chunk : {stream.size(), (size_t)1}) {
+        uint32_t rejected;
+        std::vector<Decoded> packets = receive(stream, chunk, &rejected);
+
+        TEST_ASSERT_EQUAL_UINT32(expectedRejects, rejected);
+        TEST_ASSERT_EQUAL_size_t(2, packets.size());
+        assertPayload(packets[0], MSG_MANUAL_ACK, 1, &ack, sizeof(ack));
+        assertPayload(packets[1], MSG_SENSORS, 3, &sensors, sizeof(sensors));
+    }
+}
+
+static void flipCrcBit(std::vector<uint8_t>& frame) {
+    // The CRC is the last packet byte before the delimiter; with no zeros
+    // in it, it is also the last encoded byte
+    frame[frame.size() - 2] ^= 0x10;
+}
+
+static void truncate(std::vector<uint8_t>& frame) {
+    frame.erase(frame.end() - 6, frame.end() - 1);
+}
+
+static void zeroInPayload(std::vector<uint8_t>& frame) {
+    // A stray delimiter splits the frame in two; neither half is valid
+    frame[frame.size() / 2] = 0x00;
+}
+
+void test_flipped_crc_bit_is_rejected(void) {
+    assertResynchronises(flipCrcBit, 1);
+}
+
+void test_truncated_frame_is_rejected(void) {
+    assertResynchronises(truncate, 1);
+}
+
+void test_zero_byte_inside_payload_is_rejected(void) {
+    assertResynchronises(zeroInPayload, 2);
+}
+
+void test_every_single_bit_flip_is_rejected(void) {
+    // CRC-16 catches every single-bit error; COBS damage is caught either way
+    SensorPayload sensors = {0x07, {20.5f, 45.0f, 1013.0f}};
+    uint8_t frame[BINARY_MAX_FRAME];
+    size_t size = encodeFrame(MSG_SENSORS, 9, &sensors, sizeof(sensors), frame);
+
+    for (size_t byte = 0; byte < size - 1; byte++) {
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            uint8_t damaged[BINARY_MAX_FRAME];
+            memcpy(damaged, frame, size);
+            damaged[byte] ^= 1 << bit;
+            if (damaged[byte] == 0) {
+                continue;  // Became a delimiter - covered by the resync tests
+            }
+            BinaryPacket packet;
+            TEST_ASSERT_FALSE(decodeFrame(damaged, size - 1, packet));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_matches_ccitt_false);
+    RUN_TEST(test_cobs_round_trip_with_zeros_and_long_runs);
+    RUN_TEST(test_every_message_type_round_trips);
+    RUN_TEST(test_oversize_payload_is_not_encoded);
+    RUN_TEST(test_flipped_crc_bit_is_rejected);
+    RUN_TEST(test_truncated_frame_is_rejected);
+    RUN_TEST(test_zero_byte_inside_payload_is_rejected);
+    RUN_TEST(test_every_single_bit_flip_is_rejected);
+    return UNITY_END();
+}
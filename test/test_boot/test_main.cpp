@@ -0,0 +1,142 @@
+// Boot timeline: the display task puts the splash up while the storage task
+// mounts LittleFS and loads the config, then draws the first frame. Panel
+// traffic takes its bus time on the virtual clock; flash and tft.init
+// delays are not modelled, so the storage phases are timed on the host.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include <chrono>
+#include "BootTimeline.h"
+#include "DisplayManager.h"
+#include "SensorLog.h"
+#include "StorageManager.h"
+
+static TaskHandle_t displayTask;
+static TaskHandle_t storageTask;
+static DisplayManager* display;
+static StorageManager* storage;
+static SensorLog* sensorLog;
+
+static double msAt(BootPhase phase) {
+    return bootMicros(phase) / 1000.0;
+}
+
+// The storage task body up to BOOT_LOG_READY, as in main.cpp
+static double runStorageInit() {
+    hostSetCurrentTask(storageTask);
+    auto start = std::chrono::steady_clock::now();
+    storage->setWriterTask(storageTask);
+    TEST_ASSERT_TRUE(storage->begin());
+    sensorLog->begin(storage->getTotalSpace(), storage->getUsedSpace());
+    bootMark(BOOT_LOG_READY);
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void setUp(void) {
+    hostResetClock(0);
+    hostSetFlashDirectory(hostTempDirectory("boot"));
+    hostResetPanelStats();
+    hostSetPanelClock(true);
+    hostClearConsole();
+    bootBegin();
+    displayTask = hostCreateTask("display");
+    storageTask = hostCreateTask("storage");
+
+    // Every manager exists before any task runs
+    storage = new StorageManager();
+    sensorLog = new SensorLog();
+    display = new DisplayManager();
+    display->setSensorLog(sensorLog);
+    display->setStorageManager(storage);
+}
+
+void tearDown(void) {
+    hostSetPanelClock(false);
+    delete display;
+    delete sensorLog;
+    delete storage;
+    hostSetCurrentTask(nullptr);
+}
+
+void test_splash_goes_up_before_storage_is_ready(void) {
+    // Both tasks start together; the display needs nothing from storage
+    hostSetCurrentTask(displayTask);
+    display->begin();
+    TEST_ASSERT_TRUE(bootReached(BOOT_SPLASH));
+    TEST_ASSERT_FALSE(bootReached(BOOT_CONFIG_LOADED));
+    uint64_t splashBytes = hostPanelStats().spiBytes;
+
+    double storageMicros = runStorageInit();
+
+    // The display task's bootWait returns, then the interface is drawn
+    hostSetCurrentTask(displayTask);
+    hostResetPanelStats();
+    display->setMainColor(storage->getMainColor());
+    display->showInterface();
+    TEST_ASSERT_TRUE(bootReached(BOOT_FIRST_FRAME));
+
+    printf("tft.init %.2f ms, splash %.2f ms (%llu SPI bytes), first frame %.2f ms (%llu SPI bytes)\n",
+           msAt(BOOT_TFT_INIT), msAt(BOOT_SPLASH), (unsigned long long)splashBytes, msAt(BOOT_FIRST_FRAME),
+           (unsigned long long)hostPanelStats().spiBytes);
+    printf("storage mount, config and log on the host: %.0f us\n", storageMicros);
+
+    TEST_ASSERT_LESS_OR_EQUAL(bootMicros(BOOT_SPLASH), bootMicros(BOOT_TFT_INIT));
+    TEST_ASSERT_LESS_THAN(bootMicros(BOOT_FIRST_FRAME), bootMicros(BOOT_SPLASH));
+    // Splash and first frame are bus-bound: one full screen and the tabs,
+    // the interface clears only what the splash drew
+    uint32_t fullScreen = (uint64_t)DISPLAY_WIDTH * DISPLAY_HEIGHT * 2 * 8 * 1000000 / HOST_SPI_FREQUENCY;
+    TEST_ASSERT_LESS_OR_EQUAL(2 * fullScreen, bootMicros(BOOT_FIRST_FRAME));
+    // Composited or not, the first frame is drawn over black and costs less
+    // than repainting the screen
+    TEST_ASSERT_LESS_THAN((uint64_t)DISPLAY_WIDTH * DISPLAY_HEIGHT * 2, hostPanelStats().spiBytes);
+}
+
+void test_splash_text_lies_in_the_band_the_interface_clears(void) {
+    hostSetCurrentTask(displayTask);
+    display->begin();
+
+    // showInterface() clears only these rows of the splash
+    int16_t top = DISPLAY_HEIGHT / 2 - 20;
+    int16_t bottom = DISPLAY_HEIGHT / 2 + 16;
+    uint32_t textPixels = 0;
+    uint32_t outside = 0;
+    for (int16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+        for (int16_t x = 0; x < DISPLAY_WIDTH; x++) {
+            if (hostPanelPixel(x, y) != COLOR_BLACK) {
+                textPixels++;
+                outside += y < top || y >= bottom;
+            }
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0, textPixels);
+    TEST_ASSERT_EQUAL_UINT32(0, outside);
+}
+
+void test_phases_are_stamped_once(void) {
+    hostSetCurrentTask(displayTask);
+    display->begin();
+    runStorageInit();
+    hostSetCurrentTask(displayTask);
+    display->showInterface();
+    uint32_t firstFrame = bootMicros(BOOT_FIRST_FRAME);
+
+    // Later frames and a second mark leave the timeline alone
+    hostAdvanceMillis(1000);
+    display->showInterface();
+    bootMark(BOOT_CONFIG_LOADED);
+    TEST_ASSERT_EQUAL_UINT32(firstFrame, bootMicros(BOOT_FIRST_FRAME));
+    TEST_ASSERT_FALSE(bootReached(BOOT_FIRST_UART_RESPONSE));
+    TEST_ASSERT_EQUAL_UINT32(0, bootMicros(BOOT_WIFI_UP));
+
+    bootReport();
+    TEST_ASSERT_TRUE(hostConsoleContains("first frame"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_splash_goes_up_before_storage_is_ready);
+    RUN_TEST(test_splash_text_lies_in_the_band_the_interface_clears);
+    RUN_TEST(test_phases_are_stamped_once);
+    return UNITY_END();
+}
@@ -0,0 +1,191 @@
+// GlyphCache on the host panel: cached text is pixel-identical to print(),
+// what a character costs on the bus either way, where the sheets are
+// allocated with and without PSRAM, and how often sheets are rendered
+// again for the colour pairs of a sensors-tab frame.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include <chrono>
+#include "GlyphCache.h"
+#include "Layout.h"
+
+static TFT_eSPI* tft;
+static GlyphCache* glyphs;
+
+static const uint16_t MAIN = COLOR_GREEN;
+
+// Colour pairs of a sensors-tab frame, in drawing order: the tab bar, the
+// title, the readings, a stale warning, the status lines
+struct Run {
+    uint16_t fg;
+    uint16_t bg;
+    const char* text;
+};
+static const Run FULL_FRAME[] = {
+    {COLOR_BLACK, MAIN, "SENSORS"},
+    {MAIN, COLOR_BLACK, "MANUAL"},
+    {MAIN, COLOR_BLACK, "SETTINGS"},
+    {MAIN, COLOR_BLACK, "SENSOR READINGS:"},
+    {COLOR_WHITE, COLOR_BLACK, "Temperature: 21.5 \xC2\xB0" "C"},
+    {COLOR_WHITE, COLOR_BLACK, "Humidity: 48.0 %"},
+    {COLOR_RED, COLOR_BLACK, "WARNING: DATA STALE"},
+    {MAIN, COLOR_BLACK, "STATUS:"},
+    {MAIN, COLOR_BLACK, "Main device: connected"},
+};
+
+static void drawRuns(const Run* runs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_GREATER_OR_EQUAL(0, glyphs->draw(*tft, 10, 40 + i * 20, runs[i].text, runs[i].fg, runs[i].bg));
+    }
+}
+
+static void printText(int16_t x, int16_t y, const char* text, uint16_t fg, uint16_t bg) {
+    tft->setTextColor(fg, bg);
+    tft->setTextSize(GLYPH_TEXT_SIZE);
+    tft->setCursor(x, y);
+    tft->print(text);
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetPsram(false);
+    hostClearConsole();
+    tft = new TFT_eSPI();
+    tft->init();
+    tft->setRotation(DISPLAY_ROTATION);
+    tft->fillScreen(COLOR_BLACK);
+    glyphs = new GlyphCache();
+    glyphs->begin(*tft);
+    hostResetPanelStats();
+}
+
+void tearDown(void) {
+    delete glyphs;
+    delete tft;
+    hostSetPsram(false);
+}
+
+void test_cached_text_matches_print(void) {
+    // Every printable ASCII character, a line's worth at a time
+    char line[GLYPH_RUN_MAX + 1];
+    for (int first = ' '; first <= '~'; first += GLYPH_RUN_MAX) {
+        int n = 0;
+        for (int c = first; c <= '~' && n < GLYPH_RUN_MAX; c++) {
+            line[n++] = c;
+        }
+        line[n] = '\0';
+
+        int16_t width = glyphs->draw(*tft, 0, 0, line, MAIN, COLOR_BLACK);
+        printText(0, 40, line, MAIN, COLOR_BLACK);
+        TEST_ASSERT_EQUAL_INT16(GlyphCache::textWidth(line), width);
+        for (int16_t y = 0; y < GLYPH_HEIGHT; y++) {
+            for (int16_t x = 0; x < width; x++) {
+                TEST_ASSERT_EQUAL_HEX16(hostPanelPixel(x, 40 + y), hostPanelPixel(x, y));
+            }
+        }
+    }
+}
+
+void test_panel_cost_per_character(void) {
+    const char* text = "Temperature: 21.5 C";
+    const int runs = 200;
+    uint32_t chars = strlen(text) * runs;
+    glyphs->draw(*tft, 10, 60, text, COLOR_WHITE, COLOR_BLACK);
+
+    hostResetPanelStats();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        glyphs->draw(*tft, 10, 60, text, COLOR_WHITE, COLOR_BLACK);
+    }
+    double cachedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    HostPanelStats cached = hostPanelStats();
+
+    hostResetPanelStats();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        printText(10, 60, text, COLOR_WHITE, COLOR_BLACK);
+    }
+    double printNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    HostPanelStats printed = hostPanelStats();
+
+    printf("per char, print(): %.2f windows, %.0f bus bytes (%.0f us at 40 MHz), %.0f ns host\n",
+           (double)printed.windows / chars, (double)printed.spiBytes / chars,
+           printed.spiBytes * 8.0 / chars / (HOST_SPI_FREQUENCY / 1000000), printNs / chars);
+    printf("per char, cached:  %.2f windows, %.0f bus bytes (%.0f us at 40 MHz), %.0f ns host\n",
+           (double)cached.windows / chars, (double)cached.spiBytes / chars,
+           cached.spiBytes * 8.0 / chars / (HOST_SPI_FREQUENCY / 1000000), cachedNs / chars);
+    TEST_ASSERT_LESS_THAN(printed.spiBytes / 2, cached.spiBytes);
+    TEST_ASSERT_EQUAL_UINT32(runs, cached.windows);
+}
+
+void test_without_psram_sheets_are_capped_in_internal_ram(void) {
+    drawRuns(FULL_FRAME, sizeof(FULL_FRAME) / sizeof(FULL_FRAME[0]));
+
+    // Four pairs drawn, GLYPH_CACHE_INTERNAL_SHEETS allocated, every run drawn
+    TEST_ASSERT_EQUAL_UINT8(GLYPH_CACHE_INTERNAL_SHEETS, glyphs->getInternalSheets());
+    TEST_ASSERT_TRUE(hostConsoleContains("sheets in internal RAM"));
+    TEST_ASSERT_FALSE(hostConsoleContains("allocation failed"));
+}
+
+void test_with_psram_every_sheet_is_kept(void) {
+    hostSetPsram(true);
+    drawRuns(FULL_FRAME, sizeof(FULL_FRAME) / sizeof(FULL_FRAME[0]));
+    drawRuns(FULL_FRAME, sizeof(FULL_FRAME) / sizeof(FULL_FRAME[0]));
+
+    TEST_ASSERT_EQUAL_UINT8(0, glyphs->getInternalSheets());
+    TEST_ASSERT_EQUAL_UINT32(4, glyphs->getRenders());
+}
+
+void test_sheet_renders_per_frame(void) {
+    const size_t fullRuns = sizeof(FULL_FRAME) / sizeof(FULL_FRAME[0]);
+    const int frames = 20;
+
+    // Full redraws, as on a tab switch
+    drawRuns(FULL_FRAME, fullRuns);
+    uint32_t before = glyphs->getRenders();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        drawRuns(FULL_FRAME, fullRuns);
+    }
+    double fullUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    double fullRenders = (double)(glyphs->getRenders() - before) / frames;
+
+    // Sensor updates: the readings and the warning change, nothing else is
+    // redrawn (WidgetSet damage tracking)
+    const Run update[] = {FULL_FRAME[4], FULL_FRAME[5], FULL_FRAME[6]};
+    drawRuns(update, 3);
+    before = glyphs->getRenders();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        drawRuns(update, 3);
+    }
+    double updateUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    uint32_t updateRenders = glyphs->getRenders() - before;
+
+    // One sheet render on its own
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        glyphs->invalidate();
+        glyphs->draw(*tft, 10, 40, "A", MAIN, COLOR_BLACK);
+    }
+    double renderUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    printf("%u internal sheets: full frame %.1f sheet renders (%.0f us host), update %u renders (%.0f us host), "
+           "one render %.0f us host\n", GLYPH_CACHE_INTERNAL_SHEETS, fullRenders, fullUs / frames, updateRenders,
+           updateUs / frames, renderUs);
+
+    // Two pairs per update fit in any cache; a full frame has four
+    TEST_ASSERT_EQUAL_UINT32(0, updateRenders);
+    TEST_ASSERT_LESS_OR_EQUAL(fullRuns, fullRenders);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cached_text_matches_print);
+    RUN_TEST(test_panel_cost_per_character);
+    RUN_TEST(test_without_psram_sheets_are_capped_in_internal_ram);
+    RUN_TEST(test_with_psram_every_sheet_is_kept);
+    RUN_TEST(test_sheet_renders_per_frame);
+    return UNITY_END();
+}
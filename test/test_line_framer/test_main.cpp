@@ -0,0 +1,143 @@
+// LineFramer: lines split across reads, several lines in one read, and
+// lines longer than the receive buffer.
+
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "LineFramer.h"
+
+static LineFramer* framer;
+
+// Feeds `data` in reads of at most `chunk` bytes, draining complete lines
+// after every read the way UARTManager::readAvailable() does
+static std::vector<std::string> feed(const std::string& data, size_t chunk) {
+    std::vector<std::string> lines;
+    size_t offset = 0;
+    while (offset < data.size()) {
+        size_t space;
+        uint8_t* dest = framer->writePtr(space);
+        size_t count = std::min(std::min(chunk, space), data.size() - offset);
+        memcpy(dest, data.data() + offset, count);
+        framer->commit(count);
+        offset += count;
+
+        char* line;
+        size_t length;
+        while (framer->nextLine(line, length)) {
+            TEST_ASSERT_EQUAL_size_t(strlen(line), length);
+            lines.emplace_back(line, length);
+        }
+    }
+    return lines;
+}
+
+void setUp(void) {
+    framer = new LineFramer();
+}
+
+void tearDown(void) {
+    delete framer;
+}
+
+void test_line_split_across_single_byte_reads(void) {
+    std::vector<std::string> lines = feed("SENSORS:21.5,40.2,1013\n", 1);
+
+    TEST_ASSERT_EQUAL_size_t(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("SENSORS:21.5,40.2,1013", lines[0].c_str());
+}
+
+void test_partial_tail_survives_the_next_read(void) {
+    std::vector<std::string> first = feed("one\ntw", 64);
+    std::vector<std::string> second = feed("o\nthree\n", 64);
+
+    TEST_ASSERT_EQUAL_size_t(1, first.size());
+    TEST_ASSERT_EQUAL_STRING("one", first[0].c_str());
+    TEST_ASSERT_EQUAL_size_t(2, second.size());
+    TEST_ASSERT_EQUAL_STRING("two", second[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("three", second[1].c_str());
+}
+
+void test_back_to_back_lines_in_one_read(void) {
+    std::vector<std::string> lines = feed("a\nb\r\n\n  c  \nd\n", 256);
+
+    // CR and surrounding blanks trimmed, the empty line skipped
+    TEST_ASSERT_EQUAL_size_t(4, lines.size());
+    TEST_ASSERT_EQUAL_STRING("a", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("b", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("c", lines[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("d", lines[3].c_str());
+    TEST_ASSERT_EQUAL_UINT32(4, framer->getStats().linesFramed);
+}
+
+void test_many_lines_through_a_small_buffer(void) {
+    // Far more data than the buffer holds, in reads that straddle lines
+    std::string data;
+    for (int i = 0; i < 200; i++) {
+        data += "LINE:" + std::to_string(i) + "\n";
+    }
+    std::vector<std::string> lines = feed(data, 37);
+
+    TEST_ASSERT_EQUAL_size_t(200, lines.size());
+    for (int i = 0; i < 200; i++) {
+        TEST_ASSERT_EQUAL_STRING(("LINE:" + std::to_string(i)).c_str(), lines[i].c_str());
+    }
+    TEST_ASSERT_EQUAL_UINT32(data.size(), framer->getStats().bytesReceived);
+    TEST_ASSERT_EQUAL_UINT32(0, framer->getStats().overflows);
+}
+
+void test_longest_line_that_fits(void) {
+    std::string longest(UART_LINE_BUFFER_SIZE - 1, 'x');
+    std::vector<std::string> lines = feed(longest + "\n", UART_LINE_BUFFER_SIZE);
+
+    TEST_ASSERT_EQUAL_size_t(1, lines.size());
+    TEST_ASSERT_EQUAL_size_t(longest.size(), lines[0].size());
+    TEST_ASSERT_EQUAL_UINT32(0, framer->getStats().overflows);
+}
+
+void test_oversize_line_is_dropped_up_to_its_delimiter(void) {
+    std::string oversize(UART_LINE_BUFFER_SIZE + 100, 'x');
+    std::vector<std::string> lines = feed("before\n" + oversize + "\nafter\n", 64);
+
+    // Neither a truncated head nor the tail of the long line comes out
+    TEST_ASSERT_EQUAL_size_t(2, lines.size());
+    TEST_ASSERT_EQUAL_STRING("before", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("after", lines[1].c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, framer->getStats().overflows);
+}
+
+void test_oversize_line_spanning_several_buffers(void) {
+    std::string oversize(3 * UART_LINE_BUFFER_SIZE, 'y');
+    std::vector<std::string> lines = feed(oversize + "\nnext\n", 100);
+
+    TEST_ASSERT_EQUAL_size_t(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("next", lines[0].c_str());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, framer->getStats().overflows);
+}
+
+void test_binary_delimiter_keeps_payload_bytes(void) {
+    // Binary mode: zero-delimited frames, no trimming
+    framer->setDelimiter(0, false);
+    std::string data("\x01 a \x02", 5);
+    data += '\0';
+    data += std::string(" \x03", 2);
+    data += '\0';
+    std::vector<std::string> lines = feed(data, 3);
+
+    TEST_ASSERT_EQUAL_size_t(2, lines.size());
+    TEST_ASSERT_EQUAL_size_t(5, lines[0].size());
+    TEST_ASSERT_EQUAL_MEMORY("\x01 a \x02", lines[0].data(), 5);
+    TEST_ASSERT_EQUAL_size_t(2, lines[1].size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_line_split_across_single_byte_reads);
+    RUN_TEST(test_partial_tail_survives_the_next_read);
+    RUN_TEST(test_back_to_back_lines_in_one_read);
+    RUN_TEST(test_many_lines_through_a_small_buffer);
+    RUN_TEST(test_longest_line_that_fits);
+    RUN_TEST(test_oversize_line_is_dropped_up_to_its_delimiter);
+    RUN_TEST(test_oversize_line_spanning_several_buffers);
+    RUN_TEST(test_binary_delimiter_keeps_payload_bytes);
+    return UNITY_END();
+}
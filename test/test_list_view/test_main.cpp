@@ -0,0 +1,119 @@
+// ListView scroll steps: what a step leaves on the panel matches a list
+// drawn from scratch at the same position, and what it costs on the bus.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include <stdio.h>
+#include <vector>
+#include "GlyphCache.h"
+#include "Layout.h"
+#include "ListView.h"
+
+static const uint16_t ROWS = 60;
+static const LayoutRect AREA = NETWORK_LAYOUT[NETWORK_LIST];
+
+static TFT_eSPI* tft;
+static GlyphCache* glyphs;
+static ListView* list;
+
+// Network names of mixed length, so a row's text gets shorter and longer
+static void formatRow(uint16_t index, char* text, size_t size, void* context) {
+    static const char* names[] = {"plant-net", "FRITZ!Box 7590 XQ", "guest", "greenhouse-ap-2.4GHz", "iot"};
+    snprintf(text, size, "%s %d dBm", names[index % 5], -40 - index % 50);
+}
+
+static std::vector<uint16_t> captureArea() {
+    std::vector<uint16_t> pixels;
+    for (int16_t y = AREA.y; y < AREA.y + AREA.h; y++) {
+        for (int16_t x = AREA.x; x < AREA.x + AREA.w; x++) {
+            pixels.push_back(hostPanelPixel(x, y));
+        }
+    }
+    return pixels;
+}
+
+// The area as a list opened at `first` with `selected` draws it
+static std::vector<uint16_t> drawnFromScratch(uint16_t first, int32_t selected) {
+    tft->fillRect(AREA.x, AREA.y, AREA.w, AREA.h, COLOR_BLACK);
+    ListView fresh;
+    fresh.setGlyphCache(glyphs);
+    fresh.begin(*tft, AREA, COLOR_GREEN, COLOR_BLACK);
+    fresh.setSource(ROWS, formatRow, nullptr);
+    fresh.select(selected);
+    fresh.scrollBy(first);
+    fresh.draw();
+    return captureArea();
+}
+
+void setUp(void) {
+    tft = new TFT_eSPI();
+    tft->init();
+    tft->setRotation(DISPLAY_ROTATION);
+    tft->fillScreen(COLOR_BLACK);
+    glyphs = new GlyphCache();
+    glyphs->begin(*tft);
+    list = new ListView();
+    list->setGlyphCache(glyphs);
+    list->begin(*tft, AREA, COLOR_GREEN, COLOR_BLACK);
+    list->setSource(ROWS, formatRow, nullptr);
+    hostResetPanelStats();
+}
+
+void tearDown(void) {
+    delete list;
+    delete glyphs;
+    delete tft;
+}
+
+void test_scroll_steps_match_a_full_redraw(void) {
+    const int16_t steps[] = {1, 1, 3, -2, 7, -1, 20, -9};
+    list->select(4);
+    for (int16_t step : steps) {
+        list->scrollBy(step);
+        std::vector<uint16_t> scrolled = captureArea();
+        uint16_t first = list->getFirst();
+
+        TEST_ASSERT_TRUE(scrolled == drawnFromScratch(first, 4));
+        // Back to what the list under test had drawn
+        list->draw();
+    }
+}
+
+void test_scroll_step_cost(void) {
+    // A full redraw fills every row and then draws its text
+    list->draw();
+    uint32_t fullBytes = list->getLastStepStats().spiBytes;
+
+    const int steps = 20;
+    hostResetPanelStats();
+    for (int i = 0; i < steps; i++) {
+        list->scrollBy(1);
+    }
+    uint64_t stepBytes = hostPanelStats().spiBytes / steps;
+    double stepMs = stepBytes * 8 * 1000.0 / HOST_SPI_FREQUENCY;
+
+    printf("list step: %llu SPI bytes (%.1f ms at %u MHz), full redraw %u SPI bytes\n",
+           (unsigned long long)stepBytes, stepMs, HOST_SPI_FREQUENCY / 1000000, fullBytes);
+    TEST_ASSERT_EQUAL_UINT32(steps, list->getFirst());
+    TEST_ASSERT_LESS_THAN(fullBytes / 2, (uint32_t)stepBytes);
+}
+
+void test_selection_change_refills_the_row(void) {
+    list->select(2);
+    std::vector<uint16_t> selected = captureArea();
+    TEST_ASSERT_TRUE(selected == drawnFromScratch(0, 2));
+
+    tft->fillRect(AREA.x, AREA.y, AREA.w, AREA.h, COLOR_BLACK);
+    list->draw();
+    list->select(-1);
+    TEST_ASSERT_TRUE(captureArea() == drawnFromScratch(0, -1));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_scroll_steps_match_a_full_redraw);
+    RUN_TEST(test_scroll_step_cost);
+    RUN_TEST(test_selection_change_refills_the_row);
+    return UNITY_END();
+}
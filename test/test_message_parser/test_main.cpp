@@ -0,0 +1,182 @@
+// MessageParser: every field the main device sends, values that fail to
+// parse without losing the rest of the line, and a throughput benchmark
+// that counts heap allocations against a JsonDocument per line.
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include "MessageParser.h"
+
+// Every allocation in the process passes through here while counting
+static volatile bool counting = false;
+static uint32_t allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    if (counting) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (counting) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    if (counting) allocations++;
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+static bool parse(const char* line, ParsedMessage& message) {
+    return parseMessage(line, strlen(line), message);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_sensor_line_parses_every_field(void) {
+    char line[128];
+    snprintf(line, sizeof(line), "{\"kf\":true,\"%s\":21.5,\"%s\":-0.25,\"%s\":1.0132e3}",
+             SENSOR_1_KEY, SENSOR_2_KEY, SENSOR_3_KEY);
+    ParsedMessage message;
+
+    TEST_ASSERT_TRUE(parse(line, message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_SENSORS | FIELD_KEYFRAME, message.fields);
+    TEST_ASSERT_TRUE(message.keyframe);
+    TEST_ASSERT_EQUAL_FLOAT(21.5f, message.sensorValues[0]);
+    TEST_ASSERT_EQUAL_FLOAT(-0.25f, message.sensorValues[1]);
+    TEST_ASSERT_EQUAL_FLOAT(1013.2f, message.sensorValues[2]);
+}
+
+void test_status_and_link_fields(void) {
+    ParsedMessage message;
+
+    TEST_ASSERT_TRUE(parse("{\"status\":\"ok\",\"wifi_connected\":1,\"error\":\"pump \\\"3\\\" dry\"}", message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_STATUS | FIELD_WIFI | FIELD_ERROR, message.fields);
+    TEST_ASSERT_TRUE(message.wifiConnected);
+    TEST_ASSERT_EQUAL_STRING("ok", message.status);
+    TEST_ASSERT_EQUAL_STRING("pump \"3\" dry", message.error);
+
+    TEST_ASSERT_TRUE(parse("{\"subscribed\":true,\"max_hz\":8}", message));
+    TEST_ASSERT_TRUE(message.subscribed);
+    TEST_ASSERT_EQUAL_INT(8, message.maxRateHz);
+
+    TEST_ASSERT_TRUE(parse("{ \"ack\" : 65535 }", message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_ACK, message.fields);
+    TEST_ASSERT_EQUAL_UINT16(65535, message.ackId);
+}
+
+void test_unknown_and_nested_keys_are_skipped(void) {
+    char line[160];
+    snprintf(line, sizeof(line), "{\"fw\":{\"v\":[1,2,{\"x\":\"}\"}]},\"%s\":7,\"note\":\"a,b\",\"n\":null}",
+             SENSOR_2_KEY);
+    ParsedMessage message;
+
+    TEST_ASSERT_TRUE(parse(line, message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_SENSOR_2, message.fields);
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, message.sensorValues[1]);
+}
+
+void test_unparsable_value_drops_only_its_field(void) {
+    // The parser used to stop inside a value it could not read, which made
+    // the whole line fail at the next delimiter
+    char line[128];
+    ParsedMessage message;
+
+    snprintf(line, sizeof(line), "{\"%s\":-,\"status\":\"ok\"}", SENSOR_1_KEY);
+    TEST_ASSERT_TRUE(parse(line, message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_STATUS, message.fields);
+
+    TEST_ASSERT_TRUE(parse("{\"ack\":70000,\"status\":\"ok\"}", message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_STATUS, message.fields);
+    TEST_ASSERT_EQUAL_UINT16(0, message.ackId);
+
+    TEST_ASSERT_TRUE(parse("{\"ack\":-1,\"wifi_connected\":\"yes\",\"status\":\"ok\"}", message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_STATUS, message.fields);
+
+    snprintf(line, sizeof(line), "{\"%s\":\"21.5\",\"kf\":false}", SENSOR_3_KEY);
+    TEST_ASSERT_TRUE(parse(line, message));
+    TEST_ASSERT_EQUAL_HEX16(FIELD_KEYFRAME, message.fields);
+}
+
+void test_malformed_lines_are_rejected(void) {
+    ParsedMessage message;
+
+    TEST_ASSERT_FALSE(parse("", message));
+    TEST_ASSERT_FALSE(parse("SENSORS:21.5", message));
+    TEST_ASSERT_FALSE(parse("{\"status\":\"ok\"", message));
+    TEST_ASSERT_FALSE(parse("{\"status\" \"ok\"}", message));
+    TEST_ASSERT_FALSE(parse("{\"status\":\"ok}", message));
+    TEST_ASSERT_FALSE(parse("{\"status\":\"ok\"} trailing", message));
+    TEST_ASSERT_FALSE(parse("{\"a\":[[[[[[[[[1]]]]]]]]]}", message));
+    TEST_ASSERT_TRUE(parse("{}", message));
+}
+
+void test_parse_rate_and_allocations(void) {
+    char lines[4][128];
+    snprintf(lines[0], sizeof(lines[0]), "{\"kf\":true,\"%s\":21.53,\"%s\":40.20,\"%s\":1013.25}",
+             SENSOR_1_KEY, SENSOR_2_KEY, SENSOR_3_KEY);
+    snprintf(lines[1], sizeof(lines[1]), "{\"%s\":21.61}", SENSOR_1_KEY);
+    snprintf(lines[2], sizeof(lines[2]), "{\"status\":\"ok\",\"wifi_connected\":true,\"error\":\"\"}");
+    snprintf(lines[3], sizeof(lines[3]), "{\"ack\":1017}");
+    size_t lengths[4];
+    for (int i = 0; i < 4; i++) {
+        lengths[i] = strlen(lines[i]);
+    }
+    const uint32_t messages = 400000;
+
+    ParsedMessage message;
+    uint32_t fields = 0;
+    allocations = 0;
+    counting = true;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < messages; i++) {
+        parseMessage(lines[i % 4], lengths[i % 4], message);
+        fields += message.fields;
+    }
+    auto parserTime = std::chrono::steady_clock::now() - start;
+    counting = false;
+    uint32_t parserAllocations = allocations;
+
+    // The path this replaced: a document per line
+    allocations = 0;
+    counting = true;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < messages; i++) {
+        JsonDocument doc;
+        deserializeJson(doc, lines[i % 4], lengths[i % 4]);
+        fields += doc[SENSOR_1_KEY].as<float>() > 0;
+    }
+    auto documentTime = std::chrono::steady_clock::now() - start;
+    counting = false;
+    uint32_t documentAllocations = allocations;
+
+    double parserSeconds = std::chrono::duration<double>(parserTime).count();
+    double documentSeconds = std::chrono::duration<double>(documentTime).count();
+    printf("parseMessage: %.0f messages/s, %.2f allocations per message\n", messages / parserSeconds,
+           (double)parserAllocations / messages);
+    printf("JsonDocument: %.0f messages/s, %.2f allocations per message\n", messages / documentSeconds,
+           (double)documentAllocations / messages);
+
+    TEST_ASSERT_GREATER_THAN(0, fields);
+#ifdef __GLIBC__
+    TEST_ASSERT_EQUAL_UINT32(0, parserAllocations);
+#endif
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sensor_line_parses_every_field);
+    RUN_TEST(test_status_and_link_fields);
+    RUN_TEST(test_unknown_and_nested_keys_are_skipped);
+    RUN_TEST(test_unparsable_value_drops_only_its_field);
+    RUN_TEST(test_malformed_lines_are_rejected);
+    RUN_TEST(test_parse_rate_and_allocations);
+    return UNITY_END();
+}
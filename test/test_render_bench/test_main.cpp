@@ -0,0 +1,193 @@
+// Render benchmark: drives DisplayManager::update() the way the display
+// task does and counts what reaches the panel - idle wake-ups, sensor
+// updates and tab switches. Runs per device type (native_environment,
+// native_liquid) and composited (native_composited); the numbers are
+// printed for the README.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include "BootTimeline.h"
+#include "DisplayManager.h"
+
+static DisplayManager* display;
+static TaskHandle_t displayTask;
+static TaskHandle_t touchTask;
+static float sensorBase;
+
+struct FrameCost {
+    uint32_t frames;
+    HostPanelStats panel;
+    uint32_t firmwarePixels;   // The widget set's own count of the same frames
+};
+
+// One pass of the display task loop: take the pending events, update
+static uint32_t runDisplayTask() {
+    hostSetCurrentTask(displayTask);
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, 0);
+    display->update(events);
+    return events;
+}
+
+static void publishSensors(float offset) {
+    SensorData data;
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        data.values[i] = sensorBase + offset + i * 10.0f;
+        data.valid[i] = true;
+    }
+    data.lastUpdate = millis();
+    display->updateSensorData(data);
+}
+
+// A tap as the touch task sees it: pen down for one sample, then up
+static void tap(int16_t x, int16_t y) {
+    hostSetCurrentTask(touchTask);
+    uint16_t rawX = TOUCH_RAW_X_MIN + (uint32_t)x * (TOUCH_RAW_X_MAX - TOUCH_RAW_X_MIN) / DISPLAY_WIDTH;
+    uint16_t rawY = TOUCH_RAW_Y_MIN + (uint32_t)y * (TOUCH_RAW_Y_MAX - TOUCH_RAW_Y_MIN) / DISPLAY_HEIGHT;
+    hostSetTouch(rawX, rawY, 1000);
+    display->getTouchInput().process();
+    hostSetTouch(0, 0, 0);
+    display->getTouchInput().process();
+}
+
+static void tapTab(uint8_t tab) {
+    tap(tab * (DISPLAY_WIDTH / TAB_COUNT) + 20, LAYOUT_TAB_BAR_HEIGHT / 2);
+}
+
+static void beginCost(FrameCost& cost) {
+    memset(&cost, 0, sizeof(cost));
+    hostResetPanelStats();
+}
+
+static void addFrame(FrameCost& cost) {
+    cost.frames++;
+    cost.firmwarePixels += display->getLastFramePixels();
+}
+
+static void endCost(FrameCost& cost) {
+    cost.panel = hostPanelStats();
+}
+
+#ifdef DISPLAY_COMPOSITING
+static const char* const RENDER_PATH = "composited";
+#else
+static const char* const RENDER_PATH = "direct";
+#endif
+
+static void report(const char* scenario, const FrameCost& cost) {
+    uint32_t frames = cost.frames > 0 ? cost.frames : 1;
+    printf("%-14s %-10s %s: %3u frames, per frame %6u windows %8llu px %9llu SPI bytes %6.2f ms bus\n",
+           DEVICE_TYPE_STR, RENDER_PATH, scenario, cost.frames, cost.panel.windows / frames,
+           (unsigned long long)(cost.panel.pixels / frames), (unsigned long long)(cost.panel.spiBytes / frames),
+           hostPanelBusMicros(cost.panel) / 1000.0 / frames);
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetPsram(false);
+    hostResetPanelStats();
+    displayTask = hostCreateTask("display");
+    touchTask = hostCreateTask("touch");
+    sensorBase = 20.0f;
+    bootBegin();
+
+    hostSetCurrentTask(displayTask);
+    display = new DisplayManager();
+    display->begin();
+    display->setMainColor(COLOR_GREEN);
+    display->showInterface();
+
+    hostSetCurrentTask(touchTask);
+    display->beginTouch();
+
+    // First data, so the sensors tab shows readings rather than dashes
+    publishSensors(0);
+    runDisplayTask();
+}
+
+void tearDown(void) {
+    delete display;
+    display = nullptr;
+    hostSetCurrentTask(nullptr);
+}
+
+void test_first_frame_reaches_the_panel(void) {
+    // The counting panel agrees with the widget set's own accounting
+    FrameCost cost;
+    beginCost(cost);
+    publishSensors(1.0f);
+    runDisplayTask();
+    addFrame(cost);
+    endCost(cost);
+
+    TEST_ASSERT_GREATER_THAN(0, cost.panel.pixels);
+    TEST_ASSERT_EQUAL_UINT32(cost.firmwarePixels, cost.panel.pixels);
+}
+
+void test_idle_wakeups_draw_nothing(void) {
+    FrameCost cost;
+    beginCost(cost);
+    for (int i = 0; i < 20; i++) {
+        hostAdvanceMillis(100);
+        runDisplayTask();
+        addFrame(cost);
+    }
+    endCost(cost);
+    report("idle", cost);
+
+    TEST_ASSERT_EQUAL_UINT64(0, cost.panel.pixels);
+    TEST_ASSERT_EQUAL_UINT32(0, cost.panel.windows);
+}
+
+void test_sensor_update_redraws_changed_lines_only(void) {
+    FrameCost cost;
+    beginCost(cost);
+    for (int i = 1; i <= 20; i++) {
+        hostAdvanceMillis(1000);
+        publishSensors(i * 0.3f);
+        TEST_ASSERT_EQUAL_UINT32(DISPLAY_EVENT_SENSORS, runDisplayTask());
+        addFrame(cost);
+    }
+    endCost(cost);
+    report("sensor update", cost);
+
+    // Every frame changes the readings, and only those lines and charts -
+    // when composited, the whole strips they fall in
+    uint32_t contentPixels = DISPLAY_WIDTH * (DISPLAY_HEIGHT - LAYOUT_TAB_BAR_HEIGHT);
+    TEST_ASSERT_GREATER_THAN(0, cost.panel.pixels);
+#ifdef DISPLAY_COMPOSITING
+    TEST_ASSERT_LESS_THAN(contentPixels / 2, cost.panel.pixels / cost.frames);
+#else
+    TEST_ASSERT_LESS_THAN(contentPixels / 4, cost.panel.pixels / cost.frames);
+#endif
+    TEST_ASSERT_EQUAL_UINT32(cost.firmwarePixels, cost.panel.pixels);
+}
+
+void test_tab_switch(void) {
+    FrameCost cost;
+    beginCost(cost);
+    const uint8_t tabs[] = {TAB_MANUAL, TAB_SETTINGS, TAB_SENSORS, TAB_SETTINGS, TAB_MANUAL, TAB_SENSORS};
+    for (uint8_t tab : tabs) {
+        tapTab(tab);
+        TEST_ASSERT_EQUAL_UINT32(DISPLAY_EVENT_TOUCH, runDisplayTask());
+        TEST_ASSERT_EQUAL_UINT8(tab, display->getCurrentTab());
+        addFrame(cost);
+    }
+    endCost(cost);
+    report("tab switch", cost);
+
+    // Tab bar, the cleared content area and the new content: each pixel is
+    // written at most twice
+    TEST_ASSERT_GREATER_THAN(0, cost.panel.pixels);
+    TEST_ASSERT_LESS_OR_EQUAL((uint64_t)2 * DISPLAY_WIDTH * DISPLAY_HEIGHT, cost.panel.pixels / cost.frames);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_frame_reaches_the_panel);
+    RUN_TEST(test_idle_wakeups_draw_nothing);
+    RUN_TEST(test_sensor_update_redraws_changed_lines_only);
+    RUN_TEST(test_tab_switch);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+// SensorLog against a host directory: segment roll-over and rotation,
+// reopening an existing log, recovery after a torn tail block and reads
+// that span segments. Reports bytes per sample and append throughput.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+#include "SensorLog.h"
+
+static const uint32_t START_TIME = 1750000000;
+static const size_t SEGMENT_BYTES = (size_t)SENSOR_LOG_SEGMENT_BLOCKS * LOG_BLOCK_SIZE;
+
+static std::string flashDirectory;
+static SensorLog* sensorLog;
+static uint32_t nextSample;
+
+// Sample n is logged at START_TIME + n * SENSOR_LOG_INTERVAL
+static uint32_t sampleTime(uint32_t n) {
+    return START_TIME + n * SENSOR_LOG_INTERVAL;
+}
+
+static void sampleValues(uint32_t n, float* values) {
+    values[0] = 20.0f + (n % 50) * 0.1f;
+    values[1] = 40.0f + (n / 30 % 7);
+    values[2] = 1013.25f;
+}
+
+static void appendSamples(uint32_t count) {
+    float values[SENSOR_COUNT];
+    for (uint32_t i = 0; i < count; i++, nextSample++) {
+        sampleValues(nextSample, values);
+        sensorLog->append(sampleTime(nextSample), values, 0x7);
+        // The background task keeps the pending queue short
+        if (nextSample % 64 == 63) {
+            sensorLog->flush();
+        }
+    }
+    sensorLog->flush();
+}
+
+// The partial block goes out once it has been open for the flush interval
+static void flushOpenBlock() {
+    hostAdvanceMillis(SENSOR_LOG_FLUSH_INTERVAL);
+    sensorLog->flush();
+}
+
+static void appendUntilSegments(uint32_t segments) {
+    while (sensorLog->getStats().blocksWritten < segments * SENSOR_LOG_SEGMENT_BLOCKS) {
+        appendSamples(64);
+    }
+}
+
+// Budget for exactly `segments` segments next to the rollup files
+static bool beginLog(uint32_t segments) {
+    size_t total = SensorRollup::fileBytes() + segments * SEGMENT_BYTES * 100 / SENSOR_LOG_SPACE_PERCENT;
+    return sensorLog->begin(total, 0);
+}
+
+static void reopenLog(uint32_t segments) {
+    delete sensorLog;
+    sensorLog = new SensorLog();
+    TEST_ASSERT_TRUE(beginLog(segments));
+}
+
+static std::string segmentFile(uint32_t sequence) {
+    char name[16];
+    snprintf(name, sizeof(name), "%08x.seg", sequence);
+    return flashDirectory + LOG_DIRECTORY "/" + name;
+}
+
+// Every record read back, checked against the sample it was logged from
+struct ReadResult {
+    std::vector<uint32_t> times;
+    uint32_t mismatches;
+};
+
+static void collect(const LogRecord& record, void* context) {
+    ReadResult* result = (ReadResult*)context;
+    uint32_t n = (record.time - START_TIME) / SENSOR_LOG_INTERVAL;
+    float values[SENSOR_COUNT];
+    sampleValues(n, values);
+    if (record.validMask != 0x7 || memcmp(values, record.values, sizeof(values)) != 0) {
+        result->mismatches++;
+    }
+    result->times.push_back(record.time);
+}
+
+static ReadResult readRange(uint32_t from, uint32_t to) {
+    ReadResult result = {};
+    sensorLog->readRange(from, to, collect, &result);
+    return result;
+}
+
+static void assertConsecutive(const ReadResult& result) {
+    TEST_ASSERT_EQUAL_UINT32(0, result.mismatches);
+    for (size_t i = 1; i < result.times.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(result.times[i - 1] + SENSOR_LOG_INTERVAL, result.times[i]);
+    }
+}
+
+void setUp(void) {
+    hostResetClock();
+    flashDirectory = hostTempDirectory("sensor_log");
+    hostSetFlashDirectory(flashDirectory);
+    hostResetFlashStats();
+    hostClearConsole();
+    sensorLog = new SensorLog();
+    nextSample = 0;
+}
+
+void tearDown(void) {
+    delete sensorLog;
+}
+
+void test_segments_roll_over_inside_the_budget(void) {
+    TEST_ASSERT_TRUE(beginLog(3));
+
+    auto start = std::chrono::steady_clock::now();
+    appendUntilSegments(5);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const SensorLogStats& stats = sensorLog->getStats();
+    printf("%u samples in %u blocks: %.2f bytes per sample, %.0f appends/s\n", stats.samplesLogged,
+           stats.blocksWritten, (double)stats.bytesWritten / stats.samplesLogged, stats.samplesLogged / seconds);
+
+    // The two oldest segments were rotated out
+    TEST_ASSERT_EQUAL_UINT32(3, sensorLog->getSegmentCount());
+    TEST_ASSERT_FALSE(std::filesystem::exists(segmentFile(1)));
+    TEST_ASSERT_TRUE(std::filesystem::exists(segmentFile(2)));
+    TEST_ASSERT_EQUAL_UINT32(SEGMENT_BYTES, std::filesystem::file_size(segmentFile(3)));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.droppedBlocks);
+    // Flash sees whole blocks, each holding many samples
+    TEST_ASSERT_EQUAL_UINT32(stats.blocksWritten * LOG_BLOCK_SIZE, stats.bytesWritten);
+    TEST_ASSERT_GREATER_THAN(50, stats.samplesLogged / stats.blocksWritten);
+
+    // What is left reads back whole, up to the last sample
+    flushOpenBlock();
+    TEST_ASSERT_EQUAL_UINT32(3, sensorLog->getSegmentCount());
+    ReadResult result = readRange(0, UINT32_MAX);
+    assertConsecutive(result);
+    TEST_ASSERT_EQUAL_UINT32(sampleTime(nextSample - 1), result.times.back());
+    TEST_ASSERT_GREATER_THAN(START_TIME, result.times.front());
+}
+
+void test_reopened_log_finds_its_segments(void) {
+    TEST_ASSERT_TRUE(beginLog(8));
+    appendUntilSegments(2);
+    appendSamples(100);
+    flushOpenBlock();
+    uint32_t segments = sensorLog->getSegmentCount();
+    uint32_t records = readRange(0, UINT32_MAX).times.size();
+
+    reopenLog(8);
+
+    TEST_ASSERT_EQUAL_UINT32(segments, sensorLog->getSegmentCount());
+    TEST_ASSERT_EQUAL_UINT32(records, readRange(0, UINT32_MAX).times.size());
+
+    // Appends continue in the tail segment
+    appendSamples(1000);
+    flushOpenBlock();
+    ReadResult result = readRange(0, UINT32_MAX);
+    assertConsecutive(result);
+    TEST_ASSERT_EQUAL_UINT32(segments, sensorLog->getSegmentCount());
+    TEST_ASSERT_EQUAL_UINT32(sampleTime(nextSample - 1), result.times.back());
+}
+
+void test_torn_tail_block_is_recovered(void) {
+    TEST_ASSERT_TRUE(beginLog(8));
+    appendUntilSegments(1);
+    appendSamples(1000);
+    flushOpenBlock();
+    uint32_t tail = sensorLog->getSegmentCount() - 1;
+    ReadResult before = readRange(0, UINT32_MAX);
+
+    // Power lost part way through the last block write
+    uintmax_t size = std::filesystem::file_size(segmentFile(tail));
+    std::filesystem::resize_file(segmentFile(tail), size - LOG_BLOCK_SIZE / 2);
+
+    reopenLog(8);
+    TEST_ASSERT_TRUE(hostConsoleContains("damaged"));
+
+    // Everything before the torn block survives
+    ReadResult after = readRange(0, UINT32_MAX);
+    assertConsecutive(after);
+    TEST_ASSERT_LESS_THAN(before.times.size(), after.times.size());
+    TEST_ASSERT_EQUAL_UINT32(before.times[after.times.size() - 1], after.times.back());
+
+    // New samples go to a fresh segment, never behind the torn block
+    appendSamples(1000);
+    flushOpenBlock();
+    TEST_ASSERT_EQUAL_UINT32(tail + 2, sensorLog->getSegmentCount());
+    TEST_ASSERT_EQUAL_UINT32(size - LOG_BLOCK_SIZE / 2, std::filesystem::file_size(segmentFile(tail)));
+    ReadResult resumed = readRange(0, UINT32_MAX);
+    TEST_ASSERT_EQUAL_UINT32(0, resumed.mismatches);
+    TEST_ASSERT_EQUAL_UINT32(sampleTime(nextSample - 1), resumed.times.back());
+}
+
+void test_read_range_spans_segments(void) {
+    TEST_ASSERT_TRUE(beginLog(8));
+    appendUntilSegments(3);
+
+    // A range from the middle of the first segment into the third
+    ReadResult all = readRange(0, UINT32_MAX);
+    uint32_t from = all.times[all.times.size() / 6] + 1;
+    uint32_t to = all.times[all.times.size() * 5 / 6];
+    ReadResult result = readRange(from, to);
+
+    assertConsecutive(result);
+    TEST_ASSERT_EQUAL_UINT32(from + 1, result.times.front());
+    TEST_ASSERT_EQUAL_UINT32(to, result.times.back());
+    TEST_ASSERT_EQUAL_UINT32((to - from - 1) / SENSOR_LOG_INTERVAL + 1, result.times.size());
+
+    // Ranges outside the log visit nothing
+    TEST_ASSERT_EQUAL_UINT32(0, readRange(0, START_TIME - 1).times.size());
+    TEST_ASSERT_EQUAL_UINT32(0, readRange(sampleTime(nextSample), UINT32_MAX).times.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_segments_roll_over_inside_the_budget);
+    RUN_TEST(test_reopened_log_finds_its_segments);
+    RUN_TEST(test_torn_tail_block_is_recovered);
+    RUN_TEST(test_read_range_spans_segments);
+    return UNITY_END();
+}
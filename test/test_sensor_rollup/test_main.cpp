@@ -0,0 +1,130 @@
+// SensorRollup over 90 days of per-minute samples on a host directory:
+// level choice, min/max per column, and a query benchmark that reports
+// latency and flash reads across span sizes.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <chrono>
+#include <math.h>
+#include "SensorRollup.h"
+#include "SensorLog.h"
+
+static const uint32_t DAY = 86400;
+static const uint32_t END_TIME = 1750000000 / 3600 * 3600;
+static const uint32_t START_TIME = END_TIME - 90 * DAY;
+static const uint32_t SAMPLE_SECONDS = 60;
+
+static SensorRollup* rollup;
+static bool filled = false;
+
+// A daily cycle with a slow drift, so every column has a different range
+static float sampleValue(uint32_t time) {
+    float phase = 2.0f * (float)M_PI * (time % DAY) / DAY;
+    return 20.0f + 5.0f * sinf(phase) + (time - START_TIME) / (float)(30 * DAY);
+}
+
+static void fill() {
+    float values[SENSOR_COUNT] = {};
+    for (uint32_t time = START_TIME; time < END_TIME; time += SAMPLE_SECONDS) {
+        values[0] = sampleValue(time);
+        rollup->add(time, values, 0x1);
+        rollup->flush();
+    }
+    rollup->flush(true);
+}
+
+// The first test writes the level files, the others reuse them
+void setUp(void) {
+    hostResetClock();
+    if (!filled) {
+        hostSetFlashDirectory(hostTempDirectory("sensor_rollup"));
+        LittleFS.mkdir(LOG_DIRECTORY);
+    }
+    rollup = new SensorRollup();
+    bool created;
+    TEST_ASSERT_TRUE(rollup->begin(created));
+    if (!filled) {
+        fill();
+        filled = true;
+        TEST_ASSERT_EQUAL_UINT32(0, rollup->getDroppedRecords());
+    }
+}
+
+void tearDown(void) {
+    delete rollup;
+}
+
+void test_coarsest_level_that_fills_the_width(void) {
+    HistorySeries series;
+
+    // 240 minutes, 240 quarter hours, 240 hours
+    TEST_ASSERT_EQUAL_UINT8(0, rollup->query(0, END_TIME - 4 * 3600, END_TIME, 240, series));
+    TEST_ASSERT_EQUAL_UINT8(1, rollup->query(0, END_TIME - 60 * 3600, END_TIME, 240, series));
+    TEST_ASSERT_EQUAL_UINT8(2, rollup->query(0, END_TIME - 10 * DAY, END_TIME, 240, series));
+    // Fewer slots than columns everywhere - the finest level
+    TEST_ASSERT_EQUAL_UINT8(0, rollup->query(0, END_TIME - 2 * 3600, END_TIME, 240, series));
+    // The minute level only keeps a day
+    TEST_ASSERT_EQUAL_UINT8(1, rollup->query(0, END_TIME - 2 * DAY, END_TIME, 240, series));
+}
+
+void test_columns_hold_the_sample_range(void) {
+    // A week ago, one column per hour
+    uint32_t from = END_TIME - 7 * DAY;
+    HistorySeries series;
+    TEST_ASSERT_EQUAL_UINT8(2, rollup->query(0, from, from + DAY, 24, series));
+    TEST_ASSERT_EQUAL_UINT16(24, series.columns);
+
+    for (uint16_t column = 0; column < 24; column++) {
+        int16_t expectedMin = INT16_MAX;
+        int16_t expectedMax = INT16_MIN;
+        for (uint32_t time = from + column * 3600; time < from + (column + 1) * 3600; time += SAMPLE_SECONDS) {
+            int16_t value = SensorHistory::quantize(0, sampleValue(time));
+            expectedMin = min(expectedMin, value);
+            expectedMax = max(expectedMax, value);
+        }
+        TEST_ASSERT_EQUAL_INT16(expectedMin, series.minValue[column]);
+        TEST_ASSERT_EQUAL_INT16(expectedMax, series.maxValue[column]);
+    }
+
+    // Nothing was logged before the start
+    TEST_ASSERT_EQUAL_UINT8(2, rollup->query(0, START_TIME - DAY, START_TIME, 24, series));
+    TEST_ASSERT_EQUAL_INT16(HISTORY_EMPTY, series.minValue[0]);
+    TEST_ASSERT_EQUAL_INT16(HISTORY_EMPTY, series.maxValue[23]);
+}
+
+void test_query_cost_across_spans(void) {
+    const uint32_t spans[] = {3600, 6 * 3600, DAY, 7 * DAY, 30 * DAY, 90 * DAY};
+    const char* names[] = {"1 h", "6 h", "1 d", "7 d", "30 d", "90 d"};
+    const uint16_t columns = HISTORY_CHART_MAX_COLUMNS;
+    const int runs = 50;
+
+    printf("span   level  records  reads  bytes read  us/query\n");
+    for (int i = 0; i < 6; i++) {
+        HistorySeries series;
+        hostResetFlashStats();
+        uint8_t level = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int run = 0; run < runs; run++) {
+            level = rollup->query(0, END_TIME - spans[i], END_TIME, columns, series);
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+
+        uint32_t bytes = hostFlashStats().bytesRead / runs;
+        uint32_t records = bytes / sizeof(RollupRecord);
+        printf("%-6s %5u  %7u  %5u  %10u  %8.1f\n", names[i], level, records, hostFlashStats().readCalls / runs,
+               bytes, us);
+
+        // Bounded by the width, not the span: a level is picked while its
+        // coarser neighbour has fewer slots than columns
+        TEST_ASSERT_LESS_OR_EQUAL(15 * columns, records);
+        TEST_ASSERT_NOT_EQUAL(HISTORY_EMPTY, series.minValue[0]);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_coarsest_level_that_fills_the_width);
+    RUN_TEST(test_columns_hold_the_sample_range);
+    RUN_TEST(test_query_cost_across_spans);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+// SnapshotChannel under real concurrency: a producer thread publishes
+// numbered snapshots as fast as it can while the consumer thread fetches,
+// and every snapshot the consumer sees must be whole and newer than the
+// last one.
+
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "SnapshotChannel.h"
+
+// Large enough that a copy is many stores - a torn read mixes sequences
+struct Counters {
+    uint32_t sequence;
+    uint32_t words[63];
+};
+
+static const uint32_t PUBLISHES = 2000000;
+
+static void fill(Counters& snapshot, uint32_t sequence) {
+    snapshot.sequence = sequence;
+    for (uint32_t i = 0; i < 63; i++) {
+        snapshot.words[i] = sequence * 63 + i;
+    }
+}
+
+static bool isWhole(const Counters& snapshot) {
+    for (uint32_t i = 0; i < 63; i++) {
+        if (snapshot.words[i] != snapshot.sequence * 63 + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct ConsumerResult {
+    uint32_t fetched;
+    uint32_t torn;
+    uint32_t outOfOrder;
+    uint32_t unstable;         // current() changed without a fetch()
+    uint32_t last;
+};
+
+static SnapshotChannel<Counters>* channel;
+
+void setUp(void) {
+    channel = new SnapshotChannel<Counters>();
+    Counters initial;
+    fill(initial, 0);
+    channel->reset(initial);
+}
+
+void tearDown(void) {
+    delete channel;
+}
+
+void test_concurrent_snapshots_are_whole_and_in_order(void) {
+    std::atomic<bool> done(false);
+    ConsumerResult result = {};
+
+    std::thread consumer([&] {
+        while (true) {
+            bool finished = done.load(std::memory_order_acquire);
+            if (channel->fetch()) {
+                const Counters& snapshot = channel->current();
+                result.fetched++;
+                if (!isWhole(snapshot)) {
+                    result.torn++;
+                }
+                if (snapshot.sequence <= result.last) {
+                    result.outOfOrder++;
+                }
+                result.last = snapshot.sequence;
+            } else if (finished) {
+                break;
+            }
+        }
+    });
+
+    std::thread producer([&] {
+        Counters snapshot;
+        for (uint32_t sequence = 1; sequence <= PUBLISHES; sequence++) {
+            fill(snapshot, sequence);
+            channel->publish(snapshot);
+            // Lets the threads interleave on a single-core host too
+            if (sequence % 256 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    producer.join();
+    consumer.join();
+    printf("%u published, %u fetched\n", PUBLISHES, result.fetched);
+
+    TEST_ASSERT_EQUAL_UINT32(0, result.torn);
+    TEST_ASSERT_EQUAL_UINT32(0, result.outOfOrder);
+    TEST_ASSERT_GREATER_THAN(1, result.fetched);
+    // The consumer always ends up with the latest snapshot
+    TEST_ASSERT_EQUAL_UINT32(PUBLISHES, result.last);
+    TEST_ASSERT_FALSE(channel->hasFresh());
+}
+
+void test_current_is_stable_while_the_producer_runs(void) {
+    std::atomic<bool> done(false);
+    ConsumerResult result = {};
+
+    std::thread consumer([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            if (!channel->fetch()) {
+                continue;
+            }
+            result.fetched++;
+            Counters copy = channel->current();
+            // Re-read the same buffer while the producer keeps publishing
+            for (int i = 0; i < 50; i++) {
+                if (memcmp(&copy, &channel->current(), sizeof(copy)) != 0) {
+                    result.unstable++;
+                    break;
+                }
+            }
+        }
+    });
+
+    std::thread producer([&] {
+        Counters snapshot;
+        for (uint32_t sequence = 1; sequence <= PUBLISHES / 4; sequence++) {
+            fill(snapshot, sequence);
+            channel->publish(snapshot);
+            if (sequence % 256 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    producer.join();
+    consumer.join();
+
+    TEST_ASSERT_GREATER_THAN(0, result.fetched);
+    TEST_ASSERT_EQUAL_UINT32(0, result.unstable);
+}
+
+void test_fetch_without_publish_keeps_the_snapshot(void) {
+    Counters snapshot;
+    fill(snapshot, 7);
+    channel->publish(snapshot);
+
+    TEST_ASSERT_TRUE(channel->hasFresh());
+    TEST_ASSERT_TRUE(channel->fetch());
+    TEST_ASSERT_FALSE(channel->fetch());
+    TEST_ASSERT_EQUAL_UINT32(7, channel->current().sequence);
+    TEST_ASSERT_TRUE(isWhole(channel->current()));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_concurrent_snapshots_are_whole_and_in_order);
+    RUN_TEST(test_current_is_stable_while_the_producer_runs);
+    RUN_TEST(test_fetch_without_publish_keeps_the_snapshot);
+    return UNITY_END();
+}
@@ -0,0 +1,259 @@
+// StorageManager on a host directory: flash writes per user interaction,
+// the debounce bound, a failed write kept for a retry, and the boot load
+// time of the legacy /config.json against the binary journal.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <chrono>
+#include <vector>
+#include "BootTimeline.h"
+#include "StorageManager.h"
+
+// Heap allocations while counting - the JSON path allocates per field
+static volatile bool counting = false;
+static uint32_t allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    if (counting) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (counting) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    if (counting) allocations++;
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+static StorageManager* storage;
+static TaskHandle_t storageTask;
+static TaskHandle_t uiTask;
+
+// UI actions the idle hook plays while the storage task waits
+struct ScheduledAction {
+    unsigned long at;
+    std::function<void()> action;
+};
+static std::vector<ScheduledAction> schedule;
+
+static bool playSchedule() {
+    if (schedule.empty() || (long)(millis() - schedule.front().at) < 0) {
+        return false;
+    }
+    hostSetCurrentTask(uiTask);
+    schedule.front().action();
+    schedule.erase(schedule.begin());
+    hostSetCurrentTask(storageTask);
+    return true;
+}
+
+// `count` actions, `intervalMs` apart, starting now
+static void scheduleTaps(int count, unsigned long intervalMs, std::function<void(int)> action) {
+    for (int i = 0; i < count; i++) {
+        schedule.push_back({millis() + i * intervalMs, [action, i] { action(i); }});
+    }
+}
+
+// The storage task loop until the schedule is played out and nothing is
+// left to write; returns the flash writes it made
+static uint32_t runStorageTask() {
+    uint32_t before = storage->getFlashWrites();
+    hostSetCurrentTask(storageTask);
+    unsigned long idleSince = millis();
+    while (!schedule.empty() || millis() - idleSince < 2 * CONFIG_WRITE_MAX_DELAY_MS) {
+        uint32_t writes = storage->getFlashWrites();
+        unsigned long now = millis();
+        storage->processWrites();
+        if (storage->getFlashWrites() != writes || !schedule.empty()) {
+            idleSince = millis();
+        } else if (millis() == now) {
+            // Nothing pending and nothing to wait for - move the clock
+            hostAdvanceMillis(CONFIG_WRITE_DEBOUNCE_MS);
+        }
+    }
+    return storage->getFlashWrites() - before;
+}
+
+static void restart() {
+    delete storage;
+    storage = new StorageManager();
+    storage->setWriterTask(storageTask);
+    TEST_ASSERT_TRUE(storage->begin());
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetFlashDirectory(hostTempDirectory("storage_manager"));
+    hostFailFlashWrites(false);
+    hostClearConsole();
+    bootBegin();
+    storageTask = hostCreateTask("storage");
+    uiTask = hostCreateTask("ui");
+    hostSetIdleHook(playSchedule);
+    schedule.clear();
+
+    storage = new StorageManager();
+    storage->setWriterTask(storageTask);
+    TEST_ASSERT_TRUE(storage->begin());
+    // The default config of a blank device
+    TEST_ASSERT_EQUAL_UINT32(1, runStorageTask());
+}
+
+void tearDown(void) {
+    hostSetIdleHook(nullptr);
+    delete storage;
+    hostSetCurrentTask(nullptr);
+}
+
+void test_flash_writes_per_interaction(void) {
+    // One color tap
+    scheduleTaps(1, 0, [](int) { storage->setMainColor(COLOR_YELLOW); });
+    uint32_t colorTap = runStorageTask();
+
+    // Re-selecting the current color
+    scheduleTaps(1, 0, [](int) { storage->setMainColor(COLOR_YELLOW); });
+    uint32_t sameColor = runStorageTask();
+
+    // WiFi setup and registration: credentials, then the server's answer
+    scheduleTaps(1, 0, [](int) { storage->setWiFiCredentials("plant-net", "secret"); });
+    schedule.push_back({millis() + 1500, [] { storage->setRegistrationData("Display 2", "token"); }});
+    schedule.push_back({millis() + 1600, [] { storage->setRegistered(true); }});
+    uint32_t setup = runStorageTask();
+
+    // Reconnecting to the same access point hands back the same lease
+    WiFiLease lease = {};
+    lease.channel = 6;
+    lease.ip = 0x0A01A8C0;
+    scheduleTaps(3, 60000, [lease](int) { storage->setWiFiLease(lease); });
+    uint32_t reconnects = runStorageTask();
+
+    // Touch calibration saves the matrix once
+    int32_t matrix[TOUCH_MATRIX_SIZE] = {65536, 0, 0, 0, 65536, 0};
+    scheduleTaps(1, 0, [&matrix](int) { storage->setTouchCalibration(matrix); });
+    uint32_t calibration = runStorageTask();
+
+    printf("flash writes: color tap %u, same color %u, WiFi setup %u, 3 reconnects %u, calibration %u\n",
+           colorTap, sameColor, setup, reconnects, calibration);
+    TEST_ASSERT_EQUAL_UINT32(1, colorTap);
+    TEST_ASSERT_EQUAL_UINT32(0, sameColor);
+    TEST_ASSERT_EQUAL_UINT32(1, setup);
+    TEST_ASSERT_EQUAL_UINT32(1, reconnects);
+    TEST_ASSERT_EQUAL_UINT32(1, calibration);
+
+    // All of it is on flash
+    restart();
+    DisplayConfig config = storage->getConfig();
+    TEST_ASSERT_EQUAL_HEX16(COLOR_YELLOW, config.mainColor);
+    TEST_ASSERT_EQUAL_STRING("plant-net", config.wifiSSID);
+    TEST_ASSERT_TRUE(config.registered);
+    TEST_ASSERT_EQUAL_UINT8(6, config.wifiLease.channel);
+    TEST_ASSERT_EQUAL_INT32(65536, config.touchMatrix[4]);
+}
+
+void test_debounce_is_bounded(void) {
+    // Toggling the color every second for 30 s: changes never settle, so
+    // the write goes out every CONFIG_WRITE_MAX_DELAY_MS
+    scheduleTaps(30, 1000, [](int i) { storage->setMainColor(i % 2 ? COLOR_GREEN : COLOR_YELLOW); });
+    uint32_t writes = runStorageTask();
+
+    printf("30 color taps in 30 s: %u flash writes\n", writes);
+    TEST_ASSERT_INT_WITHIN(1, 30000 / CONFIG_WRITE_MAX_DELAY_MS, writes);
+
+    // The last tap is the one on flash
+    restart();
+    TEST_ASSERT_EQUAL_HEX16(COLOR_GREEN, storage->getConfig().mainColor);
+}
+
+void test_failed_write_is_retried(void) {
+    hostFailFlashWrites(true);
+    scheduleTaps(1, 0, [](int) { storage->setMainColor(COLOR_YELLOW); });
+    hostSetCurrentTask(storageTask);
+    playSchedule();
+    storage->processWrites();
+
+    TEST_ASSERT_EQUAL_UINT32(1, storage->getFlashWrites());
+    TEST_ASSERT_TRUE(hostConsoleContains("Failed to"));
+
+    // The change stays dirty without another setter call
+    hostFailFlashWrites(false);
+    TEST_ASSERT_EQUAL_UINT32(1, runStorageTask());
+    restart();
+    TEST_ASSERT_EQUAL_HEX16(COLOR_YELLOW, storage->getConfig().mainColor);
+}
+
+struct LoadCost {
+    double micros;
+    uint64_t bytesRead;
+    double allocations;
+};
+
+// Mean cost of begin() over `runs` fresh managers
+static LoadCost measureBegin(int runs) {
+    hostResetFlashStats();
+    double total = 0;
+    allocations = 0;
+    for (int i = 0; i < runs; i++) {
+        StorageManager* manager = new StorageManager();
+        auto start = std::chrono::steady_clock::now();
+        counting = true;
+        bool loaded = manager->begin();
+        counting = false;
+        total += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        delete manager;
+        TEST_ASSERT_TRUE(loaded);
+    }
+    return {total / runs, hostFlashStats().bytesRead / runs, (double)allocations / runs};
+}
+
+void test_journal_loads_faster_than_legacy_json(void) {
+    const int runs = 2000;
+    hostSetFlashDirectory(hostTempDirectory("storage_load"));
+
+    // What a pre-journal device has on flash
+    File file = LittleFS.open("/config.json", "w");
+    file.print("{\"wifi_ssid\":\"plant-net\",\"wifi_password\":\"correct horse battery\","
+               "\"device_name\":\"Display 2\",\"user_token\":\"3f9a61c2d07b44e8a1c5e2b97d3f0a6e\","
+               "\"main_color\":65504,\"registered\":true,\"wifi_configured\":true}");
+    file.close();
+
+    LoadCost json = measureBegin(runs);
+
+    // First boot on the new firmware migrates it into the journal
+    restart();
+    TEST_ASSERT_TRUE(hostConsoleContains("migrating to journal"));
+    TEST_ASSERT_EQUAL_UINT32(1, runStorageTask());
+
+    LoadCost journal = measureBegin(runs);
+    printf("begin() from /config.json: %.1f us, %llu bytes read, %.1f allocations\n", json.micros,
+           (unsigned long long)json.bytesRead, json.allocations);
+    printf("begin() from the journal:  %.1f us, %llu bytes read, %.1f allocations\n", journal.micros,
+           (unsigned long long)journal.bytesRead, journal.allocations);
+
+    restart();
+    DisplayConfig config = storage->getConfig();
+    TEST_ASSERT_EQUAL_STRING("plant-net", config.wifiSSID);
+    TEST_ASSERT_EQUAL_STRING("3f9a61c2d07b44e8a1c5e2b97d3f0a6e", config.userToken);
+    TEST_ASSERT_EQUAL_HEX16(COLOR_YELLOW, config.mainColor);
+    TEST_ASSERT_TRUE(config.registered);
+#ifdef __GLIBC__
+    TEST_ASSERT_LESS_THAN(json.allocations, journal.allocations);
+#endif
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_flash_writes_per_interaction);
+    RUN_TEST(test_debounce_is_bounded);
+    RUN_TEST(test_failed_write_is_retried);
+    RUN_TEST(test_journal_loads_faster_than_legacy_json);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+// StripCompositor: strips reach the panel intact and in order, and DMA is
+// only ever started from internal RAM - with PSRAM present too. With
+// RENDER_PIPELINE the panel task runs whenever the display task waits, and
+// events posted to the display task during a frame survive the frame.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include "StripCompositor.h"
+#include "DisplayManager.h"
+
+static TFT_eSPI* tft;
+static StripCompositor* compositor;
+
+#ifdef RENDER_PIPELINE
+static TaskHandle_t displayTask;
+static TaskHandle_t panelTask;
+static int panelPasses;
+static uint32_t postDuringFrame;   // Event bits another task posts mid-frame
+
+// The panel task, for as long as the display task waits on it
+static bool runPanel() {
+    if (postDuringFrame && panelPasses == 1) {
+        xTaskNotify(displayTask, postDuringFrame, eSetBits);
+    }
+    hostSetCurrentTask(panelTask);
+    compositor->processTransfers();
+    hostSetCurrentTask(displayTask);
+    return ++panelPasses < 4 * COMPOSITE_STRIP_BUFFERS;
+}
+#endif
+
+// One frame of `count` strips, strip n filled with colors[n]
+static void renderFrame(const uint16_t* colors, int count) {
+#ifdef RENDER_PIPELINE
+    panelPasses = 0;
+#endif
+    for (int i = 0; i < count; i++) {
+        TFT_eSprite& strip = compositor->beginStrip(*tft);
+        strip.fillRect(0, 0, DISPLAY_WIDTH, COMPOSITE_STRIP_HEIGHT, colors[i]);
+        compositor->pushStrip(*tft, i * COMPOSITE_STRIP_HEIGHT, COMPOSITE_STRIP_HEIGHT);
+    }
+    compositor->endFrame(*tft);
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetPsram(true);
+    tft = new TFT_eSPI();
+    tft->init();
+    tft->setRotation(DISPLAY_ROTATION);
+    compositor = new StripCompositor();
+    hostResetPanelStats();
+#ifdef RENDER_PIPELINE
+    displayTask = hostCreateTask("display");
+    panelTask = hostCreateTask("panel");
+    hostSetCurrentTask(displayTask);
+    postDuringFrame = 0;
+    hostSetIdleHook(runPanel);
+#endif
+}
+
+void tearDown(void) {
+#ifdef RENDER_PIPELINE
+    hostSetIdleHook(nullptr);
+    hostSetCurrentTask(nullptr);
+#endif
+    delete compositor;
+    delete tft;
+    hostSetPsram(false);
+}
+
+void test_strips_reach_the_panel_in_order(void) {
+    TEST_ASSERT_TRUE(compositor->begin(*tft));
+
+    const uint16_t colors[] = {COLOR_RED, COLOR_GREEN, COLOR_WHITE};
+    renderFrame(colors, 3);
+
+    const HostPanelStats& stats = hostPanelStats();
+    TEST_ASSERT_EQUAL_UINT64(3ull * DISPLAY_WIDTH * COMPOSITE_STRIP_HEIGHT, stats.pixels);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_HEX16(colors[i], hostPanelPixel(DISPLAY_WIDTH / 2, i * COMPOSITE_STRIP_HEIGHT + 1));
+        TEST_ASSERT_EQUAL_HEX16(colors[i], hostPanelPixel(DISPLAY_WIDTH - 1, (i + 1) * COMPOSITE_STRIP_HEIGHT - 1));
+    }
+}
+
+void test_dma_only_from_internal_ram(void) {
+    // PSRAM is there, but TFT_eSPI would only use it for sprites with DMA off
+    TEST_ASSERT_TRUE(compositor->begin(*tft));
+
+    const uint16_t colors[] = {COLOR_RED, COLOR_GREEN};
+    renderFrame(colors, 2);
+
+    const HostPanelStats& stats = hostPanelStats();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dmaFromExternal);
+#if COMPOSITE_USE_PSRAM
+    TEST_ASSERT_FALSE(compositor->usesDMA());
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dmaTransfers);
+#else
+    TEST_ASSERT_TRUE(compositor->usesDMA());
+    TEST_ASSERT_EQUAL_UINT32(2, stats.dmaTransfers);
+#endif
+}
+
+void test_without_psram(void) {
+    hostSetPsram(false);
+    TEST_ASSERT_TRUE(compositor->begin(*tft));
+
+    const uint16_t colors[] = {COLOR_GREEN};
+    renderFrame(colors, 1);
+
+#if COMPOSITE_USE_PSRAM
+    TEST_ASSERT_FALSE(compositor->usesDMA());
+#else
+    TEST_ASSERT_TRUE(compositor->usesDMA());
+#endif
+    TEST_ASSERT_EQUAL_UINT32(0, hostPanelStats().dmaFromExternal);
+    TEST_ASSERT_EQUAL_HEX16(COLOR_GREEN, hostPanelPixel(0, 0));
+}
+
+#ifdef RENDER_PIPELINE
+void test_events_during_a_frame_are_kept(void) {
+    TEST_ASSERT_TRUE(compositor->begin(*tft));
+
+    // The UART task posts new sensor data while the strips are on the bus
+    postDuringFrame = DISPLAY_EVENT_SENSORS;
+    const uint16_t colors[] = {COLOR_RED, COLOR_GREEN, COLOR_WHITE, COLOR_RED, COLOR_GREEN};
+    renderFrame(colors, 5);
+
+    // endFrame() returned with the whole frame on the panel...
+    TEST_ASSERT_EQUAL_UINT64(5ull * DISPLAY_WIDTH * COMPOSITE_STRIP_HEIGHT, hostPanelStats().pixels);
+    TEST_ASSERT_EQUAL_HEX16(COLOR_GREEN, hostPanelPixel(0, 5 * COMPOSITE_STRIP_HEIGHT - 1));
+
+    // ...and the event still waiting for the display task, nothing else
+    uint32_t events = 0;
+    TEST_ASSERT_TRUE(xTaskNotifyWait(0, UINT32_MAX, &events, 0));
+    TEST_ASSERT_EQUAL_HEX32(DISPLAY_EVENT_SENSORS, events);
+
+    // A quiet frame leaves no wake-up behind
+    postDuringFrame = 0;
+    renderFrame(colors, 2);
+    TEST_ASSERT_EQUAL_UINT32(0, hostPeekNotification(displayTask));
+}
+#endif
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_strips_reach_the_panel_in_order);
+    RUN_TEST(test_dma_only_from_internal_ram);
+    RUN_TEST(test_without_psram);
+#ifdef RENDER_PIPELINE
+    RUN_TEST(test_events_during_a_frame_are_kept);
+#endif
+    return UNITY_END();
+}
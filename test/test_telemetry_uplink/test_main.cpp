@@ -0,0 +1,257 @@
+// TelemetryUplink against a stand-in server: batches cut while offline are
+// queued on flash and replayed in sequence order, a POST whose answer is
+// lost is sent again and dropped by the server as a repeat, and a reboot
+// replays the queue without reusing a sequence number.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <HTTPClient.h>
+#include <set>
+#include <vector>
+#include "TelemetryUplink.h"
+#include "SensorLog.h"
+
+static const uint32_t START_TIME = 1750000000;
+static const uint32_t BATCH_SECONDS = TELEMETRY_BATCH_SAMPLES * TELEMETRY_SAMPLE_INTERVAL;
+
+// What the server does with the next POSTs
+enum ServerMode {
+    SERVER_UP,
+    SERVER_DOWN,               // Connection refused
+    SERVER_LOSES_ANSWER,       // Stores the batch, then the answer is lost (503 from a proxy)
+    SERVER_REJECTS             // 400 - the batch itself is bad
+};
+
+// Keeps batches by (device, seq) like the real one, so a repeat is dropped
+struct TelemetryServer {
+    ServerMode mode;
+    std::vector<uint32_t> posted;      // Every seq that arrived, repeats included
+    std::vector<uint32_t> stored;      // Seqs kept, in arrival order
+    std::vector<uint32_t> storedT0;
+    std::set<uint32_t> seen;
+    uint32_t repeats;
+};
+
+static TelemetryServer server;
+static TelemetryUplink* uplink;
+static TaskHandle_t uplinkTask;
+static uint32_t sampleTime;
+
+// Unsigned value after text key `key` in a batch - enough CBOR for the test
+static uint32_t cborUnsigned(const std::string& body, const char* key) {
+    std::string pattern(1, (char)(0x60 | strlen(key)));
+    pattern += key;
+    size_t at = body.find(pattern);
+    TEST_ASSERT_TRUE(at != std::string::npos);
+    const uint8_t* head = (const uint8_t*)body.data() + at + pattern.size();
+    uint8_t info = head[0] & 0x1F;
+    if (info < 24) return info;
+    if (info == 24) return head[1];
+    if (info == 25) return (head[1] << 8) | head[2];
+    return ((uint32_t)head[1] << 24) | (head[2] << 16) | (head[3] << 8) | head[4];
+}
+
+static int serve(const HostHttpRequest& request, std::string& response) {
+    if (server.mode == SERVER_DOWN) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    if (server.mode == SERVER_REJECTS) {
+        return 400;
+    }
+
+    uint32_t sequence = cborUnsigned(request.body, "seq");
+    server.posted.push_back(sequence);
+    if (server.seen.insert(sequence).second) {
+        server.stored.push_back(sequence);
+        server.storedT0.push_back(cborUnsigned(request.body, "t0"));
+    } else {
+        server.repeats++;
+    }
+    response = "{}";
+    return server.mode == SERVER_LOSES_ANSWER ? 503 : 200;
+}
+
+// The uplink task, run while something woke it
+static void runUplink() {
+    hostSetCurrentTask(uplinkTask);
+    while (hostPeekNotification(uplinkTask) != 0) {
+        uplink->process();
+    }
+}
+
+// Samples every TELEMETRY_SAMPLE_INTERVAL until `batches` more are cut
+static void feedBatches(int batches) {
+    float values[SENSOR_COUNT] = {21.5f, 48.0f, 1.2f};
+    for (int i = 0; i < batches * TELEMETRY_BATCH_SAMPLES; i++) {
+        hostAdvanceMillis(TELEMETRY_SAMPLE_INTERVAL * 1000);
+        uplink->append(sampleTime, values, 0x7);
+        sampleTime += TELEMETRY_SAMPLE_INTERVAL;
+        runUplink();
+    }
+}
+
+// Waits out the retry backoff until the queue is empty
+static void drainUntilEmpty() {
+    hostSetCurrentTask(uplinkTask);
+    for (int i = 0; i < 20 && uplink->getQueuedBatches() > 0; i++) {
+        uplink->process();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, uplink->getQueuedBatches());
+}
+
+static void startUplink() {
+    uplink = new TelemetryUplink();
+    uplink->setTask(uplinkTask);
+    TEST_ASSERT_TRUE(uplink->begin("Display 2"));
+}
+
+// Stored batches are consecutive, each exactly once, the oldest first
+static void assertStoredInOrder(size_t batches) {
+    TEST_ASSERT_EQUAL_UINT32(batches, server.stored.size());
+    for (size_t i = 1; i < server.stored.size(); i++) {
+        TEST_ASSERT_GREATER_THAN(server.stored[i - 1], server.stored[i]);
+        TEST_ASSERT_EQUAL_UINT32(server.storedT0[i - 1] + BATCH_SECONDS, server.storedT0[i]);
+    }
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetFlashDirectory(hostTempDirectory("telemetry_uplink"));
+    hostClearConsole();
+    server = TelemetryServer();
+    server.mode = SERVER_UP;
+    hostSetHttpServer(serve);
+    uplinkTask = hostCreateTask("uplink");
+    sampleTime = START_TIME;
+    startUplink();
+}
+
+void tearDown(void) {
+    delete uplink;
+    hostSetHttpServer(nullptr);
+    hostSetCurrentTask(nullptr);
+}
+
+void test_online_batches_go_straight_out(void) {
+    uplink->setOnline(true);
+    feedBatches(3);
+
+    assertStoredInOrder(3);
+    TEST_ASSERT_EQUAL_UINT32(0, uplink->getStats().batchesQueued);
+    // One kept-alive connection for all of them
+    TEST_ASSERT_EQUAL_UINT32(1, hostHttpConnections());
+}
+
+void test_offline_batches_replay_in_order(void) {
+    feedBatches(5);
+    TEST_ASSERT_EQUAL_UINT32(5, uplink->getQueuedBatches());
+    TEST_ASSERT_EQUAL_UINT32(0, server.posted.size());
+
+    // WiFi comes up: the queue goes first, then new batches
+    uplink->setOnline(true);
+    runUplink();
+    TEST_ASSERT_EQUAL_UINT32(0, uplink->getQueuedBatches());
+    feedBatches(1);
+
+    assertStoredInOrder(6);
+    TEST_ASSERT_EQUAL_UINT32(0, server.repeats);
+    TEST_ASSERT_EQUAL_UINT32(6 * TELEMETRY_BATCH_SAMPLES, uplink->getStats().samplesBatched);
+    TEST_ASSERT_EQUAL_UINT32(1, hostHttpConnections());
+}
+
+void test_new_batch_waits_behind_a_failed_one(void) {
+    uplink->setOnline(true);
+    feedBatches(1);
+
+    // Two batches cut while the server is down, the second during the backoff
+    server.mode = SERVER_DOWN;
+    feedBatches(2);
+    TEST_ASSERT_EQUAL_UINT32(2, uplink->getQueuedBatches());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, uplink->getStats().postFailures);
+
+    server.mode = SERVER_UP;
+    drainUntilEmpty();
+    feedBatches(1);
+    assertStoredInOrder(4);
+}
+
+void test_lost_answer_is_sent_again_and_deduplicated(void) {
+    uplink->setOnline(true);
+    server.mode = SERVER_LOSES_ANSWER;
+    feedBatches(1);
+    TEST_ASSERT_EQUAL_UINT32(1, uplink->getQueuedBatches());
+
+    // The retry carries the same sequence number - the server drops it
+    server.mode = SERVER_UP;
+    drainUntilEmpty();
+    feedBatches(1);
+
+    printf("posted %u batches, stored %u, repeats %u\n", (unsigned)server.posted.size(),
+           (unsigned)server.stored.size(), server.repeats);
+    TEST_ASSERT_EQUAL_UINT32(3, server.posted.size());
+    TEST_ASSERT_EQUAL_UINT32(server.posted[0], server.posted[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, server.repeats);
+    assertStoredInOrder(2);
+}
+
+void test_rejected_batch_does_not_block_the_queue(void) {
+    feedBatches(3);
+    uplink->setOnline(true);
+    server.mode = SERVER_REJECTS;
+    runUplink();
+
+    // Refused batches are dropped, not retried
+    TEST_ASSERT_EQUAL_UINT32(0, uplink->getQueuedBatches());
+    TEST_ASSERT_EQUAL_UINT32(3, uplink->getStats().batchesDropped);
+    server.mode = SERVER_UP;
+    feedBatches(1);
+    assertStoredInOrder(1);
+}
+
+void test_reboot_replays_the_queue_without_reusing_a_sequence(void) {
+    uplink->setOnline(true);
+    feedBatches(2);
+    uplink->setOnline(false);
+    feedBatches(3);
+    TEST_ASSERT_EQUAL_UINT32(3, uplink->getQueuedBatches());
+
+    // Reset: the queue is found on flash
+    delete uplink;
+    startUplink();
+    TEST_ASSERT_EQUAL_UINT32(3, uplink->getQueuedBatches());
+
+    // A batch cut after the reboot is numbered above the reserved block
+    feedBatches(1);
+    uplink->setOnline(true);
+    runUplink();
+    TEST_ASSERT_EQUAL_UINT32(0, uplink->getQueuedBatches());
+
+    assertStoredInOrder(6);
+    TEST_ASSERT_EQUAL_UINT32(0, server.repeats);
+    TEST_ASSERT_GREATER_OR_EQUAL(TELEMETRY_SEQUENCE_BLOCK, server.stored.back());
+}
+
+void test_full_queue_drops_the_oldest(void) {
+    const int extra = 3;
+    feedBatches(TELEMETRY_QUEUE_BATCHES + extra);
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_QUEUE_BATCHES, uplink->getQueuedBatches());
+    TEST_ASSERT_EQUAL_UINT32(extra, uplink->getStats().batchesDropped);
+
+    uplink->setOnline(true);
+    runUplink();
+    assertStoredInOrder(TELEMETRY_QUEUE_BATCHES);
+    TEST_ASSERT_EQUAL_UINT32(extra, server.stored.front());
+    TEST_ASSERT_EQUAL_UINT32(START_TIME + extra * BATCH_SECONDS, server.storedT0.front());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_online_batches_go_straight_out);
+    RUN_TEST(test_offline_batches_replay_in_order);
+    RUN_TEST(test_new_batch_waits_behind_a_failed_one);
+    RUN_TEST(test_lost_answer_is_sent_again_and_deduplicated);
+    RUN_TEST(test_rejected_batch_does_not_block_the_queue);
+    RUN_TEST(test_reboot_replays_the_queue_without_reusing_a_sequence);
+    RUN_TEST(test_full_queue_drops_the_oldest);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+// Touch-to-action latency: a touch task samples the host touch controller,
+// gestures wake the display task, and the frame that shows the result
+// takes its SPI time on the virtual clock. Reports the latency counters
+// the display task keeps for taps and swipes.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include "BootTimeline.h"
+#include "DisplayManager.h"
+#include "Layout.h"
+
+static TaskHandle_t displayTask;
+static TaskHandle_t touchTask;
+static DisplayManager* display;
+static unsigned long lastFrameDone;
+
+// The display task: runs whenever something notified it while the touch
+// task waits
+static bool runDisplay() {
+    if (hostPeekNotification(displayTask) == 0) {
+        return false;
+    }
+    TaskHandle_t previous = xTaskGetCurrentTaskHandle();
+    hostSetCurrentTask(displayTask);
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, 0);
+    display->update(events);
+    lastFrameDone = micros();
+    hostSetCurrentTask(previous);
+    return true;
+}
+
+static void setPen(int16_t x, int16_t y, bool down) {
+    // Inverse of the default calibration
+    uint16_t rawX = TOUCH_RAW_X_MIN + (int32_t)x * (TOUCH_RAW_X_MAX - TOUCH_RAW_X_MIN) / DISPLAY_WIDTH;
+    uint16_t rawY = TOUCH_RAW_Y_MIN + (int32_t)y * (TOUCH_RAW_Y_MAX - TOUCH_RAW_Y_MIN) / DISPLAY_HEIGHT;
+    hostSetTouch(rawX, rawY, down ? 1000 : 0);
+}
+
+// The touch task loop for `ms` of virtual time
+static void runTouch(unsigned long ms) {
+    hostSetCurrentTask(touchTask);
+    unsigned long end = millis() + ms;
+    while ((long)(millis() - end) < 0) {
+        display->getTouchInput().process();
+    }
+}
+
+// Pen down at (x0, y), moved to (x1, y) over holdMs, then lifted; returns
+// micros from the lift to the frame showing the result
+static uint32_t stroke(int16_t x0, int16_t x1, int16_t y, unsigned long holdMs) {
+    const int steps = 8;
+    setPen(x0, y, true);
+    runTouch(TOUCH_POLL_INTERVAL_MS);
+    for (int i = 1; i <= steps; i++) {
+        setPen(x0 + (x1 - x0) * i / steps, y, true);
+        runTouch(holdMs / steps);
+    }
+    setPen(x1, y, false);
+    unsigned long lifted = micros();
+    lastFrameDone = 0;
+    runTouch(TOUCH_POLL_INTERVAL_MS * 2);
+    return lastFrameDone ? lastFrameDone - lifted : UINT32_MAX;
+}
+
+static uint32_t tap(int16_t x, int16_t y) {
+    return stroke(x, x, y, 80);
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetFlashDirectory(hostTempDirectory("touch"));
+    hostSetTouch(0, 0, 0);
+    bootBegin();
+    displayTask = hostCreateTask("display");
+    touchTask = hostCreateTask("touch");
+
+    hostSetCurrentTask(displayTask);
+    display = new DisplayManager();
+    display->begin();
+    display->showInterface();
+    hostSetCurrentTask(touchTask);
+    display->beginTouch();
+
+    hostSetIdleHook(runDisplay);
+    hostSetPanelClock(true);
+}
+
+void tearDown(void) {
+    hostSetPanelClock(false);
+    hostSetIdleHook(nullptr);
+    delete display;
+    hostSetCurrentTask(nullptr);
+}
+
+void test_tab_tap_latency(void) {
+    int16_t tabWidth = DISPLAY_WIDTH / TAB_COUNT;
+    uint32_t liftToFrame = tap(tabWidth + tabWidth / 2, LAYOUT_TAB_BAR_HEIGHT / 2);
+
+    TEST_ASSERT_EQUAL_UINT8(TAB_MANUAL, display->getCurrentTab());
+    TEST_ASSERT_EQUAL_UINT32(1, display->getTouchActions());
+    printf("tab tap: gesture to frame %.1f ms, pen up to frame %.1f ms\n",
+           display->getTouchLatencyMax() / 1000.0, liftToFrame / 1000.0);
+
+    // Recognised on the first sample after the lift, shown after one frame
+    TEST_ASSERT_LESS_OR_EQUAL(TOUCH_SAMPLE_INTERVAL_MS * 1000 + display->getTouchLatencyMax(), liftToFrame);
+    TEST_ASSERT_LESS_THAN(150000, liftToFrame);
+}
+
+void test_swipe_latency(void) {
+    uint32_t liftToFrame = stroke(400, 200, DISPLAY_HEIGHT / 2, 200);
+
+    TEST_ASSERT_EQUAL_UINT8(TAB_MANUAL, display->getCurrentTab());
+    printf("swipe: gesture to frame %.1f ms, pen up to frame %.1f ms\n",
+           display->getTouchLatencyMax() / 1000.0, liftToFrame / 1000.0);
+    TEST_ASSERT_EQUAL_UINT32(1, display->getTouchActions());
+    TEST_ASSERT_LESS_THAN(150000, liftToFrame);
+}
+
+void test_repeated_taps_average(void) {
+    // Around the tab bar twice, each tap switching to the next tab
+    int16_t tabWidth = DISPLAY_WIDTH / TAB_COUNT;
+    const int taps = 2 * TAB_COUNT;
+    uint32_t worst = 0;
+    for (int i = 0; i < taps; i++) {
+        uint8_t tab = (i + 1) % TAB_COUNT;
+        uint32_t liftToFrame = tap(tab * tabWidth + tabWidth / 2, LAYOUT_TAB_BAR_HEIGHT / 2);
+        TEST_ASSERT_EQUAL_UINT8(tab, display->getCurrentTab());
+        worst = max(worst, liftToFrame);
+        runTouch(300);
+    }
+    hostSetCurrentTask(touchTask);
+    TEST_ASSERT_EQUAL_UINT32(taps, display->getTouchActions());
+    printf("%d tab taps: gesture to frame avg %.1f ms, max %.1f ms; pen up to frame max %.1f ms\n", taps,
+           display->getTouchLatencyAverage() / 1000.0, display->getTouchLatencyMax() / 1000.0, worst / 1000.0);
+    TEST_ASSERT_EQUAL_UINT32(0, display->getTouchInput().getDroppedGestures());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tab_tap_latency);
+    RUN_TEST(test_swipe_latency);
+    RUN_TEST(test_repeated_taps_average);
+    return UNITY_END();
+}
@@ -0,0 +1,314 @@
+#include "main_device_sim.h"
+#include <ArduinoHost.h>
+
+static const char* const sensorKeys[SENSOR_COUNT] = {SENSOR_1_KEY, SENSOR_2_KEY, SENSOR_3_KEY};
+
+// The display's lines are flat objects of fixed keys - a find is enough
+static std::string jsonString(const std::string& line, const char* key) {
+    std::string pattern = std::string("\"") + key + "\":\"";
+    size_t start = line.find(pattern);
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += pattern.size();
+    return line.substr(start, line.find('"', start) - start);
+}
+
+static long jsonNumber(const std::string& line, const char* key, long fallback) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t start = line.find(pattern);
+    return start == std::string::npos ? fallback : strtol(line.c_str() + start + pattern.size(), nullptr, 10);
+}
+
+static uint8_t controlFor(const std::string& cmd) {
+    if (cmd == "manual_lights") return CONTROL_LIGHTS;
+    if (cmd == "manual_spray") return CONTROL_SPRAY;
+    if (cmd == "manual_pump") return CONTROL_PUMP;
+    if (cmd == "manual_probe") return CONTROL_PROBE;
+    return 0;
+}
+
+MainDeviceSim::MainDeviceSim(HardwareSerial& serial, const MainDeviceOptions& opts)
+    : wire(serial), options(opts), validMask(0), changedMask(0), wifiConnected(true), dropIncoming(0),
+      dropAcks(0), keyframes(0), deltas(0), deltaFields(0), framesLost(0), acksLost(0) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        values[i] = 0.0f;
+    }
+    reboot();
+}
+
+void MainDeviceSim::reboot() {
+    rx.clear();
+    binaryRx = false;
+    binaryTx = false;
+    txSeq = 0;
+    subscribed = false;
+    maxRateHz = 0;
+    keyframeMs = 0;
+    lastPush = 0;
+    lastKeyframe = 0;
+    ranIds.clear();
+}
+
+void MainDeviceSim::setSensor(int index, float value) {
+    values[index] = value;
+    validMask |= 1 << index;
+    changedMask |= 1 << index;
+}
+
+void MainDeviceSim::invalidateSensor(int index) {
+    validMask &= ~(1 << index);
+    changedMask |= 1 << index;
+}
+
+void MainDeviceSim::setStatus(bool wifi, const char* lastError) {
+    wifiConnected = wifi;
+    error = lastError;
+}
+
+uint32_t MainDeviceSim::requestCount(const char* cmd) const {
+    auto found = requests.find(cmd);
+    return found == requests.end() ? 0 : found->second;
+}
+
+uint32_t MainDeviceSim::executionsOf(uint16_t id) const {
+    uint32_t count = 0;
+    for (const ManualExecution& execution : executions) {
+        if (execution.id == id) count++;
+    }
+    return count;
+}
+
+bool MainDeviceSim::service() {
+    bool active = false;
+
+    // Everything the display wrote since the last call was sent in one
+    // wire format - the display only switches after reading our hello reply
+    std::string output = wire.takeOutput();
+    if (!output.empty()) {
+        active = true;
+        rx += output;
+        bool framesBinary = binaryRx;
+        char delimiter = framesBinary ? '\0' : '\n';
+        size_t end;
+        while ((end = rx.find(delimiter)) != std::string::npos) {
+            std::string frame = rx.substr(0, end);
+            rx.erase(0, end + 1);
+            if (frame.empty()) continue;
+            if (dropIncoming > 0) {
+                dropIncoming--;
+                framesLost++;
+                continue;
+            }
+            if (framesBinary) {
+                handleFrame((uint8_t*)&frame[0], frame.size());
+            } else {
+                handleLine(frame);
+            }
+        }
+        binaryRx = binaryTx;
+    }
+
+    return pushStream() || active;
+}
+
+bool MainDeviceSim::handleLine(const std::string& line) {
+    std::string cmd = jsonString(line, "cmd");
+    uint8_t control = controlFor(cmd);
+    requests[control ? "manual" : cmd]++;
+
+    if (cmd == "hello") {
+        if (options.binary && jsonString(line, "proto") == BINARY_PROTOCOL_NAME) {
+            sendLine("{\"hello\":\"" BINARY_PROTOCOL_NAME "\"}");
+            binaryTx = true;
+        }
+    } else if (cmd == "subscribe") {
+        if (options.subscribe) {
+            startStream(jsonNumber(line, "max_hz", 10), jsonNumber(line, "keyframe_ms", 4000));
+        }
+    } else if (cmd == "get_sensors") {
+        sendSensors(validMask, false, false);
+    } else if (cmd == "get_status") {
+        sendStatus();
+    } else if (control) {
+        handleManual(jsonNumber(line, "id", 0), control, jsonNumber(line, "pump", 0));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool MainDeviceSim::handleFrame(uint8_t* frame, size_t length) {
+    BinaryPacket packet;
+    if (!decodeFrame(frame, length, packet)) {
+        requests["corrupt"]++;
+        return false;
+    }
+
+    switch (packet.msgId) {
+        case MSG_GET_SENSORS:
+            requests["get_sensors"]++;
+            sendSensors(validMask, false, false);
+            break;
+        case MSG_GET_STATUS:
+            requests["get_status"]++;
+            sendStatus();
+            break;
+        case MSG_SUBSCRIBE: {
+            requests["subscribe"]++;
+            if (!options.subscribe || packet.payloadLength < sizeof(SubscribePayload)) break;
+            SubscribePayload request;
+            memcpy(&request, packet.payload, sizeof(request));
+            startStream(request.maxRateHz, request.keyframeMs);
+            break;
+        }
+        case MSG_MANUAL: {
+            requests["manual"]++;
+            if (packet.payloadLength < sizeof(ManualPayload)) break;
+            ManualPayload request;
+            memcpy(&request, packet.payload, sizeof(request));
+            handleManual(request.id, request.control, request.argument);
+            break;
+        }
+        default:
+            requests["unknown"]++;
+            return false;
+    }
+    return true;
+}
+
+void MainDeviceSim::handleManual(uint16_t id, uint8_t control, uint8_t argument) {
+    // A retransmission of a command already run is acked, not run again
+    if (ranIds.insert(id).second) {
+        executions.push_back({id, control, argument, millis()});
+    }
+    if (options.acks) {
+        sendAck(id, true);
+    }
+}
+
+void MainDeviceSim::startStream(uint8_t rateHz, unsigned long intervalMs) {
+    maxRateHz = rateHz;
+    keyframeMs = intervalMs;
+    subscribed = true;
+
+    // A hello reply may already have switched our side to binary
+    if (binaryTx) {
+        SubscribedPayload reply = {maxRateHz};
+        sendPacket(MSG_SUBSCRIBED, &reply, sizeof(reply));
+    } else {
+        sendLine("{\"subscribed\":true,\"max_hz\":" + std::to_string(maxRateHz) + "}");
+    }
+    sendSensors(validMask, true, true);
+}
+
+bool MainDeviceSim::pushStream() {
+    if (!subscribed) {
+        return false;
+    }
+
+    unsigned long now = millis();
+    if (now - lastKeyframe >= keyframeMs) {
+        sendSensors(validMask, true, true);
+        return true;
+    }
+    if (!changedMask || maxRateHz == 0) {
+        return false;
+    }
+
+    // A change inside the rate limit goes out when the limit runs out -
+    // the display is asleep meanwhile, so the time just passes
+    unsigned long interval = 1000UL / maxRateHz;
+    if (now - lastPush < interval) {
+        hostAdvanceMillis(interval - (now - lastPush));
+    }
+    sendSensors(changedMask & validMask, false, true);
+    return true;
+}
+
+void MainDeviceSim::sendLine(const std::string& line) {
+    std::string framed = line + "\n";
+    wire.inject((const uint8_t*)framed.data(), framed.size());
+}
+
+void MainDeviceSim::sendPacket(uint8_t msgId, const void* payload, size_t length) {
+    uint8_t frame[BINARY_MAX_FRAME];
+    size_t size = encodeFrame(msgId, txSeq++, payload, length, frame);
+    wire.inject(frame, size);
+}
+
+void MainDeviceSim::sendSensors(uint8_t fields, bool keyframe, bool streamed) {
+    if (streamed) {
+        lastPush = millis();
+        changedMask = 0;
+        if (keyframe) {
+            lastKeyframe = lastPush;
+            keyframes++;
+        } else {
+            deltas++;
+            deltaFields += __builtin_popcount(fields);
+        }
+    }
+
+    if (binaryTx) {
+        if (!streamed) {
+            SensorPayload payload = {fields, {}};
+            memcpy(payload.values, values, sizeof(values));
+            sendPacket(MSG_SENSORS, &payload, sizeof(payload));
+            return;
+        }
+        uint8_t payload[sizeof(SensorUpdateHeader) + sizeof(values)];
+        SensorUpdateHeader header = {(uint8_t)(keyframe ? UPDATE_FLAG_KEYFRAME : 0), fields};
+        memcpy(payload, &header, sizeof(header));
+        size_t length = sizeof(header);
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            if (fields & (1 << i)) {
+                memcpy(payload + length, &values[i], sizeof(float));
+                length += sizeof(float);
+            }
+        }
+        sendPacket(MSG_SENSOR_UPDATE, payload, length);
+        return;
+    }
+
+    std::string line = keyframe ? "{\"kf\":true" : "{";
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (!(fields & (1 << i))) continue;
+        char value[24];
+        snprintf(value, sizeof(value), "%.2f", values[i]);
+        line += std::string(line.size() > 1 ? "," : "") + "\"" + sensorKeys[i] + "\":" + value;
+    }
+    sendLine(line + "}");
+}
+
+void MainDeviceSim::sendStatus() {
+    if (binaryTx) {
+        uint8_t payload[sizeof(StatusPayload) + 32];
+        StatusPayload header = {(uint8_t)(STATUS_FLAG_OK | (wifiConnected ? STATUS_FLAG_WIFI_CONNECTED : 0)),
+                                (uint8_t)std::min(error.size(), (size_t)32)};
+        memcpy(payload, &header, sizeof(header));
+        memcpy(payload + sizeof(header), error.data(), header.errorLength);
+        sendPacket(MSG_STATUS, payload, sizeof(header) + header.errorLength);
+        return;
+    }
+
+    std::string line = std::string("{\"status\":\"ok\",\"wifi_connected\":") + (wifiConnected ? "true" : "false");
+    if (!error.empty()) {
+        line += ",\"error\":\"" + error + "\"";
+    }
+    sendLine(line + "}");
+}
+
+void MainDeviceSim::sendAck(uint16_t id, bool accepted) {
+    if (dropAcks > 0) {
+        dropAcks--;
+        acksLost++;
+        return;
+    }
+    if (binaryTx) {
+        ManualAckPayload payload = {id, (uint8_t)(accepted ? MANUAL_RESULT_OK : 1)};
+        sendPacket(MSG_MANUAL_ACK, &payload, sizeof(payload));
+    } else {
+        sendLine("{\"ack\":" + std::to_string(id) + (accepted ? "}" : ",\"error\":\"refused\"}"));
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef MAIN_DEVICE_SIM_H
+#define MAIN_DEVICE_SIM_H
+
+// Host stand-in for the main device at the far end of Serial2.
+// Speaks the link protocol described in BinaryProtocol.h: answers the
+// hello, accepts a subscription and then pushes changed sensor fields and
+// keyframes, answers polls, and runs manual commands once per id. Faults
+// are injected by losing frames in either direction.
+//
+// Runs as the idle hook, so it answers whenever the UART task waits:
+//   hostSetIdleHook([&] { return sim.service(); });
+
+#include <Arduino.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "BinaryProtocol.h"
+
+struct MainDeviceOptions {
+    bool binary = true;        // Answers the hello - false for old firmware
+    bool subscribe = true;     // Accepts subscriptions
+    bool acks = true;          // Acks manual commands
+};
+
+struct ManualExecution {
+    uint16_t id;
+    uint8_t control;
+    uint8_t argument;
+    unsigned long at;
+};
+
+class MainDeviceSim {
+private:
+    HardwareSerial& wire;
+    MainDeviceOptions options;
+    std::string rx;
+    bool binaryRx;             // Display frames arrive COBS encoded
+    bool binaryTx;
+    uint8_t txSeq;
+
+    // Sensor streaming
+    float values[SENSOR_COUNT];
+    uint8_t validMask;
+    uint8_t changedMask;
+    bool subscribed;
+    uint8_t maxRateHz;
+    unsigned long keyframeMs;
+    unsigned long lastPush;
+    unsigned long lastKeyframe;
+
+    bool wifiConnected;
+    std::string error;
+
+    std::set<uint16_t> ranIds;
+    uint32_t dropIncoming;
+    uint32_t dropAcks;
+
+    bool handleLine(const std::string& line);
+    bool handleFrame(uint8_t* frame, size_t length);
+    void handleManual(uint16_t id, uint8_t control, uint8_t argument);
+    void startStream(uint8_t rateHz, unsigned long intervalMs);
+    bool pushStream();
+
+    void sendLine(const std::string& line);
+    void sendPacket(uint8_t msgId, const void* payload, size_t length);
+    void sendSensors(uint8_t fields, bool keyframe, bool streamed);
+    void sendStatus();
+    void sendAck(uint16_t id, bool accepted);
+
+public:
+    // Counters
+    std::map<std::string, uint32_t> requests;   // By JSON command name, binary requests included
+    std::vector<ManualExecution> executions;
+    uint32_t keyframes;
+    uint32_t deltas;
+    uint32_t deltaFields;      // Sensor fields carried by deltas
+    uint32_t framesLost;       // Display frames dropped on request
+    uint32_t acksLost;
+
+    explicit MainDeviceSim(HardwareSerial& serial, const MainDeviceOptions& opts = MainDeviceOptions());
+
+    // Idle hook - true if it read or sent anything
+    bool service();
+
+    // The readings the main device has; changes are pushed while subscribed
+    void setSensor(int index, float value);
+    void invalidateSensor(int index);
+    void setStatus(bool wifi, const char* lastError);
+
+    // Forgets the link state, as after a reset of the main device
+    void reboot();
+    // Stops pushing without telling the display, as firmware that loses a
+    // subscription would
+    void dropSubscription() { subscribed = false; }
+
+    // Loses the next `count` frames from the display, or acks to it
+    void loseIncoming(uint32_t count) { dropIncoming = count; }
+    void loseAcks(uint32_t count) { dropAcks = count; }
+
+    bool isBinary() const { return binaryTx; }
+    bool isSubscribed() const { return subscribed; }
+    uint32_t requestCount(const char* cmd) const;
+    uint32_t executionsOf(uint16_t id) const;
+};
+
+#endif // MAIN_DEVICE_SIM_H
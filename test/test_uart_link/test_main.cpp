@@ -0,0 +1,464 @@
+// UART link against a simulated main device over the loopback Serial2:
+// protocol negotiation, sensor streaming, the fallbacks to polling, what
+// the link hands the display, and manual commands through lost frames.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include "BootTimeline.h"
+#include "DisplayManager.h"
+#include "UARTManager.h"
+#include "main_device_sim.h"
+
+static UARTManager* uart;
+static MainDeviceSim* sim;
+static TaskHandle_t uartTask;
+static DisplayManager* display;
+static TaskHandle_t displayTask;
+static CommandPipeline* commands;
+
+// What the display task did for the UART task's updates
+struct DisplayActivity {
+    uint32_t wakeups;
+    uint32_t statusEvents;
+    uint32_t renderedPixels;
+};
+static DisplayActivity activity;
+
+static void startLink(const MainDeviceOptions& options) {
+    sim = new MainDeviceSim(Serial2, options);
+    hostSetIdleHook([] { return sim->service(); });
+
+    hostSetCurrentTask(uartTask);
+    uart->begin();
+}
+
+// The UART task loop for `ms` of virtual time; each pass returns when the
+// main device answers or the task's own wait runs out
+static void runFor(unsigned long ms) {
+    unsigned long end = millis() + ms;
+    while ((long)(millis() - end) < 0) {
+        hostSetCurrentTask(uartTask);
+        uart->processMessages();
+
+        // The display task takes whatever the pass published
+        uint32_t events;
+        if (display) {
+            hostSetCurrentTask(displayTask);
+            if (xTaskNotifyWait(0, UINT32_MAX, &events, 0)) {
+                activity.wakeups++;
+                if (events & DISPLAY_EVENT_STATUS) {
+                    activity.statusEvents++;
+                }
+                display->update(events);
+                activity.renderedPixels += display->getLastFramePixels();
+            }
+        }
+    }
+}
+
+static void attachDisplay() {
+    displayTask = hostCreateTask("display");
+    hostSetCurrentTask(displayTask);
+    display = new DisplayManager();
+    display->begin();
+    display->showInterface();
+    uart->setDisplayManager(display);
+    memset(&activity, 0, sizeof(activity));
+}
+
+static uint32_t panelPixels(uint16_t color) {
+    uint32_t count = 0;
+    for (int16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+        for (int16_t x = 0; x < DISPLAY_WIDTH; x++) {
+            count += hostPanelPixel(x, y) == color;
+        }
+    }
+    return count;
+}
+
+// Before startLink(): begin() hands the pipeline the UART task
+static void attachCommands() {
+    commands = new CommandPipeline();
+    uart->setCommandPipeline(commands);
+}
+
+// A tap on a manual button, as the display task submits it
+static void press(uint8_t button) {
+    static uint8_t presses = 0;
+    TEST_ASSERT_TRUE(commands->submit(button, ++presses, micros()));
+}
+
+// A press and the UART task pass it wakes, which reads whatever the peer
+// answered so far; the peer reads the command but the task does not wait
+static void tap(uint8_t button) {
+    press(button);
+    hostSetCurrentTask(uartTask);
+    uart->processMessages();
+    sim->service();
+}
+
+static uint8_t buttonState(uint8_t button) {
+    CommandStates states;
+    commands->takeStates(states);
+    return states.buttons[button].state;
+}
+
+static void assertSensor(int index, float value) {
+    TEST_ASSERT_TRUE(uart->getSensorState().valid[index]);
+    TEST_ASSERT_EQUAL_FLOAT(value, uart->getSensorState().values[index]);
+}
+
+void setUp(void) {
+    hostResetClock();
+    Serial2.takeOutput();
+    while (Serial2.read() >= 0) {}
+    bootBegin();
+    uartTask = hostCreateTask("uart");
+    hostSetCurrentTask(uartTask);
+    uart = new UARTManager();
+    sim = nullptr;
+    display = nullptr;
+    commands = nullptr;
+}
+
+void tearDown(void) {
+    hostSetIdleHook(nullptr);
+    delete uart;
+    delete sim;
+    delete display;
+    delete commands;
+    hostSetCurrentTask(nullptr);
+}
+
+void test_negotiates_binary_and_subscribes(void) {
+    startLink(MainDeviceOptions());
+    sim->setSensor(0, 21.5f);
+    sim->setSensor(1, 40.0f);
+    sim->setSensor(2, 1013.0f);
+
+    runFor(1000);
+
+    TEST_ASSERT_EQUAL(PROTOCOL_BINARY, uart->getProtocol());
+    TEST_ASSERT_TRUE(uart->isStreaming());
+    TEST_ASSERT_TRUE(sim->isBinary());
+    TEST_ASSERT_EQUAL_UINT32(1, sim->requestCount("hello"));
+    TEST_ASSERT_EQUAL_UINT32(1, sim->requestCount("subscribe"));
+    assertSensor(0, 21.5f);
+    assertSensor(2, 1013.0f);
+    TEST_ASSERT_EQUAL_UINT32(0, uart->getRxStats().overflows);
+}
+
+void test_streaming_replaces_polling(void) {
+    attachDisplay();
+    startLink(MainDeviceOptions());
+    sim->setSensor(0, 21.5f);
+    sim->setStatus(true, "");
+    runFor(1000);
+    uint32_t sensorPolls = sim->requestCount("get_sensors");
+    uint32_t statusPolls = sim->requestCount("get_status");
+
+    // WiFi drops on the main device while sensors stream
+    runFor(30000);
+    sim->setStatus(false, "wifi lost");
+    runFor(30000);
+
+    // Keyframes keep the subscription and the link alive with no sensor
+    // requests; status is not streamed and is still polled
+    TEST_ASSERT_TRUE(uart->isStreaming());
+    TEST_ASSERT_TRUE(uart->isMainDeviceConnected());
+    TEST_ASSERT_EQUAL_UINT32(sensorPolls, sim->requestCount("get_sensors"));
+    TEST_ASSERT_EQUAL_UINT32(statusPolls + 60000 / 5000, sim->requestCount("get_status"));
+    TEST_ASSERT_GREATER_OR_EQUAL(60000 / 4000 - 1, sim->keyframes);
+    TEST_ASSERT_EQUAL_UINT32(1, sim->requestCount("subscribe"));
+
+    const SystemStatus& shown = display->getSystemStatus();
+    TEST_ASSERT_FALSE(shown.wifiConnected);
+    TEST_ASSERT_EQUAL_STRING("wifi lost", shown.lastError);
+}
+
+void test_deltas_merge_into_sensor_state(void) {
+    startLink(MainDeviceOptions());
+    sim->setSensor(0, 21.5f);
+    sim->setSensor(1, 40.0f);
+    sim->setSensor(2, 1013.0f);
+    runFor(1000);
+
+    // One field changes per step; the others stay as the keyframe left them
+    for (int step = 1; step <= 10; step++) {
+        sim->setSensor(step % SENSOR_COUNT, step * 1.5f);
+        runFor(200);
+        assertSensor(step % SENSOR_COUNT, step * 1.5f);
+    }
+    assertSensor(0, 9 * 1.5f);
+    assertSensor(1, 10 * 1.5f);
+    assertSensor(2, 8 * 1.5f);
+
+    TEST_ASSERT_EQUAL_UINT32(10, sim->deltas);
+    TEST_ASSERT_EQUAL_UINT32(10, sim->deltaFields);
+}
+
+void test_invalid_field_clears_on_keyframe(void) {
+    startLink(MainDeviceOptions());
+    sim->setSensor(0, 21.5f);
+    sim->setSensor(1, 40.0f);
+    runFor(1000);
+    TEST_ASSERT_TRUE(uart->getSensorState().valid[1]);
+
+    // A delta never carries a missing field; the next keyframe drops it
+    sim->invalidateSensor(1);
+    runFor(5000);
+
+    TEST_ASSERT_FALSE(uart->getSensorState().valid[1]);
+    assertSensor(0, 21.5f);
+}
+
+void test_json_stream_lapse_falls_back_to_polling(void) {
+    MainDeviceOptions options;
+    options.binary = false;
+    startLink(options);
+    sim->setSensor(0, 21.5f);
+    runFor(1000);
+    TEST_ASSERT_TRUE(uart->isStreaming());
+    TEST_ASSERT_EQUAL(PROTOCOL_JSON, uart->getProtocol());
+
+    // Pushes stop without notice: the display polls again, then resubscribes
+    sim->dropSubscription();
+    uint32_t polls = sim->requestCount("get_sensors");
+    runFor(3 * 4000 + 1000);
+
+    TEST_ASSERT_GREATER_THAN(polls, sim->requestCount("get_sensors"));
+    TEST_ASSERT_TRUE(uart->isStreaming());
+    TEST_ASSERT_EQUAL_UINT32(2, sim->requestCount("subscribe"));
+}
+
+void test_rebooted_peer_is_renegotiated(void) {
+    startLink(MainDeviceOptions());
+    sim->setSensor(0, 21.5f);
+    runFor(1000);
+    TEST_ASSERT_EQUAL(PROTOCOL_BINARY, uart->getProtocol());
+
+    // The main device comes back in JSON and no longer streams; the silent
+    // binary link falls back and the hello goes out again
+    sim->reboot();
+    runFor(UART_TIMEOUT_MS + 2000);
+    sim->setSensor(0, 23.0f);
+    runFor(1000);
+
+    TEST_ASSERT_EQUAL(PROTOCOL_BINARY, uart->getProtocol());
+    TEST_ASSERT_TRUE(uart->isStreaming());
+    TEST_ASSERT_TRUE(uart->isMainDeviceConnected());
+    TEST_ASSERT_EQUAL_UINT32(2, sim->requestCount("hello"));
+    assertSensor(0, 23.0f);
+}
+
+void test_old_firmware_is_polled_over_json(void) {
+    MainDeviceOptions options;
+    options.binary = false;
+    options.subscribe = false;
+    startLink(options);
+    sim->setSensor(0, 21.5f);
+    sim->setSensor(1, 40.0f);
+
+    runFor(30000);
+
+    // Three hellos and three subscribes go unanswered, then plain polling
+    TEST_ASSERT_EQUAL(PROTOCOL_JSON, uart->getProtocol());
+    TEST_ASSERT_FALSE(uart->isStreaming());
+    TEST_ASSERT_EQUAL_UINT32(3, sim->requestCount("hello"));
+    TEST_ASSERT_EQUAL_UINT32(3, sim->requestCount("subscribe"));
+    TEST_ASSERT_INT_WITHIN(1, 30000 / 2000, sim->requestCount("get_sensors"));
+    TEST_ASSERT_INT_WITHIN(1, 30000 / 5000, sim->requestCount("get_status"));
+    TEST_ASSERT_TRUE(uart->isMainDeviceConnected());
+    assertSensor(1, 40.0f);
+    TEST_ASSERT_FALSE(uart->getSensorState().valid[2]);
+}
+
+void test_status_reaches_the_display_only_on_change(void) {
+    MainDeviceOptions options;
+    options.binary = false;
+    options.subscribe = false;
+    attachDisplay();
+    startLink(options);
+    sim->setSensor(0, 21.5f);
+    sim->setStatus(true, "pump 3 dry");
+
+    // A minute of polling: a status report every 5 s, all the same
+    runFor(60000);
+    printf("polled minute: %u display wakeups, %u for status, %u px\n", activity.wakeups, activity.statusEvents,
+           activity.renderedPixels);
+
+    const SystemStatus& shown = display->getSystemStatus();
+    TEST_ASSERT_TRUE(shown.mainDeviceConnected);
+    TEST_ASSERT_TRUE(shown.wifiConnected);
+    TEST_ASSERT_EQUAL_STRING("pump 3 dry", shown.lastError);
+    TEST_ASSERT_LESS_OR_EQUAL(2, activity.statusEvents);
+
+    // The main device goes quiet: one more status, the error kept
+    sim->loseIncoming(UINT32_MAX);
+    uint32_t before = activity.statusEvents;
+    runFor(UART_TIMEOUT_MS + 5000);
+
+    TEST_ASSERT_FALSE(display->getSystemStatus().mainDeviceConnected);
+    TEST_ASSERT_EQUAL_STRING("pump 3 dry", display->getSystemStatus().lastError);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, activity.statusEvents);
+}
+
+void test_main_device_error_is_drawn_until_cleared(void) {
+    MainDeviceOptions options;
+    options.subscribe = false;
+    attachDisplay();
+    startLink(options);
+    sim->setSensor(0, 21.5f);
+    sim->setStatus(true, "pump 3 dry");
+    runFor(6000);
+    uint32_t withError = panelPixels(COLOR_RED);
+
+    // Red on the sensors tab without the error line: invalid readings and
+    // the display's own WiFi, which is down here
+    sim->setStatus(true, "");
+    runFor(6000);
+    TEST_ASSERT_EQUAL_STRING("", display->getSystemStatus().lastError);
+    TEST_ASSERT_LESS_THAN(withError, panelPixels(COLOR_RED));
+}
+
+void test_lost_command_is_retried_and_runs_once(void) {
+    attachCommands();
+    startLink(MainDeviceOptions());
+    runFor(1000);
+
+    // The first ack tells the pipeline the peer acks, so retries are safe
+    press(0);
+    runFor(1000);
+    TEST_ASSERT_EQUAL_UINT32(1, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT8(COMMAND_ACKED, buttonState(0));
+
+    // The command frame is lost on the wire
+    sim->loseIncoming(1);
+    unsigned long pressedAt = millis();
+    press(1);
+    runFor(2000);
+
+    TEST_ASSERT_EQUAL_UINT32(1, sim->framesLost);
+    TEST_ASSERT_EQUAL_UINT32(2, sim->executions.size());
+    uint16_t id = sim->executions.back().id;
+    TEST_ASSERT_EQUAL_UINT32(1, sim->executionsOf(id));
+    TEST_ASSERT_EQUAL_UINT32(2, sim->requestCount("manual"));
+    TEST_ASSERT_EQUAL_UINT32(1, commands->getStats().retries);
+    TEST_ASSERT_EQUAL_UINT32(2, commands->getStats().acked);
+    TEST_ASSERT_EQUAL_UINT8(COMMAND_ACKED, buttonState(1));
+    // Run by the retry, one ack timeout after the press
+    TEST_ASSERT_EQUAL_UINT32(COMMAND_ACK_TIMEOUT_MS, sim->executions.back().at - pressedAt);
+}
+
+void test_lost_ack_retry_is_not_run_twice(void) {
+    attachCommands();
+    startLink(MainDeviceOptions());
+    runFor(1000);
+    press(0);
+    runFor(1000);
+
+    // The command runs, its ack is lost, and the retry repeats the id
+    sim->loseAcks(1);
+    press(1);
+    runFor(2000);
+
+    uint16_t id = sim->executions.back().id;
+    TEST_ASSERT_EQUAL_UINT32(1, sim->acksLost);
+    TEST_ASSERT_EQUAL_UINT32(3, sim->requestCount("manual"));
+    TEST_ASSERT_EQUAL_UINT32(1, sim->executionsOf(id));
+    TEST_ASSERT_EQUAL_UINT32(2, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT32(1, commands->getStats().retries);
+    TEST_ASSERT_EQUAL_UINT32(0, commands->getStats().lateAcks);
+    TEST_ASSERT_EQUAL_UINT8(COMMAND_ACKED, buttonState(1));
+}
+
+void test_command_fails_after_every_retry_is_lost(void) {
+    attachCommands();
+    startLink(MainDeviceOptions());
+    runFor(1000);
+    press(0);
+    runFor(1000);
+
+    // Status polls go on meanwhile, so everything the display sends is lost
+    sim->loseIncoming(UINT32_MAX);
+    press(0);
+    runFor(10000);
+    sim->loseIncoming(0);
+
+    // Sent once and retried COMMAND_MAX_RETRIES times, never run
+    TEST_ASSERT_GREATER_OR_EQUAL(1 + COMMAND_MAX_RETRIES, sim->framesLost);
+    TEST_ASSERT_EQUAL_UINT32(1, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT32(1, commands->getStats().timedOut);
+    TEST_ASSERT_EQUAL_UINT8(COMMAND_FAILED, buttonState(0));
+}
+
+void test_repeated_presses_are_coalesced(void) {
+    attachCommands();
+    startLink(MainDeviceOptions());
+    runFor(1000);
+
+    // Five taps 100 ms apart: one command
+    for (int i = 0; i < 5; i++) {
+        tap(0);
+        hostAdvanceMillis(100);
+    }
+    runFor(1000);
+    TEST_ASSERT_EQUAL_UINT32(1, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT32(1, sim->requestCount("manual"));
+    TEST_ASSERT_EQUAL_UINT32(4, commands->getStats().coalesced);
+
+    // Presses while the first is still unacked ride on it too
+    sim->loseAcks(1);
+    tap(1);
+    hostAdvanceMillis(50);
+    tap(1);
+    TEST_ASSERT_EQUAL_UINT32(0, commands->getStats().retries);
+    runFor(2000);
+    TEST_ASSERT_EQUAL_UINT32(2, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT32(5, commands->getStats().coalesced);
+
+    // A press after COMMAND_COALESCE_MS is a new command
+    press(0);
+    runFor(1000);
+    TEST_ASSERT_EQUAL_UINT32(3, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT8(sim->executions.front().control, sim->executions.back().control);
+}
+
+void test_peer_without_acks_gets_each_press_once(void) {
+    MainDeviceOptions options;
+    options.acks = false;
+    attachCommands();
+    startLink(options);
+    runFor(1000);
+
+    press(0);
+    runFor(5000);
+    press(1);
+    runFor(5000);
+
+    // No retries to a peer that has never acked - it may have run them
+    TEST_ASSERT_EQUAL_UINT32(2, sim->requestCount("manual"));
+    TEST_ASSERT_EQUAL_UINT32(2, sim->executions.size());
+    TEST_ASSERT_EQUAL_UINT32(0, commands->getStats().retries);
+    TEST_ASSERT_EQUAL_UINT32(2, commands->getStats().unconfirmed);
+    TEST_ASSERT_EQUAL_UINT8(COMMAND_UNCONFIRMED, buttonState(1));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_negotiates_binary_and_subscribes);
+    RUN_TEST(test_streaming_replaces_polling);
+    RUN_TEST(test_deltas_merge_into_sensor_state);
+    RUN_TEST(test_invalid_field_clears_on_keyframe);
+    RUN_TEST(test_json_stream_lapse_falls_back_to_polling);
+    RUN_TEST(test_rebooted_peer_is_renegotiated);
+    RUN_TEST(test_old_firmware_is_polled_over_json);
+    RUN_TEST(test_status_reaches_the_display_only_on_change);
+    RUN_TEST(test_main_device_error_is_drawn_until_cleared);
+    RUN_TEST(test_lost_command_is_retried_and_runs_once);
+    RUN_TEST(test_lost_ack_retry_is_not_run_twice);
+    RUN_TEST(test_command_fails_after_every_retry_is_lost);
+    RUN_TEST(test_repeated_presses_are_coalesced);
+    RUN_TEST(test_peer_without_acks_gets_each_press_once);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+// WidgetSet damage tracking: a frame that declares the same widgets as the
+// last one must not touch the panel, and a change redraws only its widget.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <TFT_eSPI.h>
+#include "Layout.h"
+#include "WidgetSet.h"
+
+static TFT_eSPI* tft;
+static GlyphCache* glyphs;
+static WidgetSet* ui;
+static HistorySeries series;
+
+static void declareFrame(const char* reading, bool pressed) {
+    ui->beginFrame();
+    ui->text(10, 60, "SENSOR READINGS:", COLOR_GREEN, 280);
+    ui->text(10, 100, reading, COLOR_WHITE, 280);
+    ui->button(40, 200, 160, 50, "PUMP", COLOR_GREEN, pressed);
+    ui->chart(300, 96, 170, 24, series, COLOR_GREEN);
+    ui->commit(*tft);
+}
+
+void setUp(void) {
+    hostResetClock();
+    tft = new TFT_eSPI();
+    tft->init();
+    tft->setRotation(DISPLAY_ROTATION);
+    glyphs = new GlyphCache();
+    glyphs->begin(*tft);
+    ui = new WidgetSet();
+    ui->setGlyphCache(glyphs);
+    ui->begin(*tft, LAYOUT_TAB_BAR_HEIGHT, DISPLAY_HEIGHT - LAYOUT_TAB_BAR_HEIGHT);
+
+    series.columns = 170;
+    for (uint16_t i = 0; i < series.columns; i++) {
+        series.minValue[i] = 100 + i % 20;
+        series.maxValue[i] = 140 + i % 20;
+    }
+    hostResetPanelStats();
+}
+
+void tearDown(void) {
+    delete ui;
+    delete glyphs;
+    delete tft;
+}
+
+void test_first_frame_draws_every_widget(void) {
+    declareFrame("Temperature: 21.5 C", false);
+
+    TEST_ASSERT_GREATER_THAN(0, ui->getLastFramePixels());
+    TEST_ASSERT_EQUAL_UINT32(ui->getLastFramePixels(), hostPanelStats().pixels);
+}
+
+void test_same_widgets_twice_draw_nothing(void) {
+    declareFrame("Temperature: 21.5 C", false);
+    hostResetPanelStats();
+
+    declareFrame("Temperature: 21.5 C", false);
+
+    TEST_ASSERT_EQUAL_UINT32(0, ui->getLastFramePixels());
+    TEST_ASSERT_EQUAL_UINT64(0, hostPanelStats().pixels);
+    TEST_ASSERT_EQUAL_UINT32(0, hostPanelStats().windows);
+}
+
+void test_changed_text_redraws_only_that_widget(void) {
+    declareFrame("Temperature: 21.5 C", false);
+    uint32_t full = ui->getLastFramePixels();
+    hostResetPanelStats();
+
+    declareFrame("Temperature: 21.6 C", false);
+
+    // One text line at most: its width by one glyph row, or when composited
+    // the strips it falls in
+    uint32_t pixels = ui->getLastFramePixels();
+    TEST_ASSERT_GREATER_THAN(0, pixels);
+#ifdef DISPLAY_COMPOSITING
+    TEST_ASSERT_LESS_OR_EQUAL(2 * DISPLAY_WIDTH * COMPOSITE_STRIP_HEIGHT, pixels);
+#else
+    TEST_ASSERT_LESS_OR_EQUAL(280 * TEXT_CHAR_HEIGHT, pixels);
+#endif
+    TEST_ASSERT_LESS_THAN(full, pixels);
+    TEST_ASSERT_EQUAL_UINT32(pixels, hostPanelStats().pixels);
+}
+
+void test_chart_redraws_when_its_data_changes(void) {
+    declareFrame("Temperature: 21.5 C", false);
+    series.maxValue[series.columns - 1] += 5;
+    hostResetPanelStats();
+
+    declareFrame("Temperature: 21.5 C", false);
+
+    // Background, then one bar per column over it
+    TEST_ASSERT_GREATER_THAN(0, ui->getLastFramePixels());
+#ifdef DISPLAY_COMPOSITING
+    TEST_ASSERT_LESS_OR_EQUAL(2 * DISPLAY_WIDTH * COMPOSITE_STRIP_HEIGHT, ui->getLastFramePixels());
+#else
+    TEST_ASSERT_LESS_OR_EQUAL(2 * 170 * 24, ui->getLastFramePixels());
+#endif
+}
+
+void test_pressed_button_redraws(void) {
+    declareFrame("Temperature: 21.5 C", false);
+    declareFrame("Temperature: 21.5 C", true);
+    TEST_ASSERT_GREATER_THAN(0, ui->getLastFramePixels());
+
+    declareFrame("Temperature: 21.5 C", true);
+    TEST_ASSERT_EQUAL_UINT32(0, ui->getLastFramePixels());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_frame_draws_every_widget);
+    RUN_TEST(test_same_widgets_twice_draw_nothing);
+    RUN_TEST(test_changed_text_redraws_only_that_widget);
+    RUN_TEST(test_chart_redraws_when_its_data_changes);
+    RUN_TEST(test_pressed_button_redraws);
+    return UNITY_END();
+}
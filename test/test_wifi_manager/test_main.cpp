@@ -0,0 +1,279 @@
+// WiFiManager against the host WiFi driver: the test raises the driver's
+// events (got IP, disconnected) and checks the attempts the state machine
+// makes - the backoff between full attempts, the cached AP and IP after a
+// link loss, and when the lease is not trusted.
+
+#include <unity.h>
+#include <ArduinoHost.h>
+#include <WiFi.h>
+#include <time.h>
+#include <vector>
+#include "BootTimeline.h"
+#include "StorageManager.h"
+#include "WiFiManager.h"
+
+static const IPAddress DHCP_IP(192, 168, 1, 57);
+static const uint8_t AP_CHANNEL = 6;
+
+static WiFiManager* wifi;
+static StorageManager* storage;
+static TaskHandle_t wifiTask;
+
+// One pass of the WiFi task body: waits for an event or the next timer
+static void step() {
+    hostSetCurrentTask(wifiTask);
+    wifi->handleConnection();
+}
+
+static const HostWiFiAttempt& lastAttempt() {
+    return WiFi.hostAttempts().back();
+}
+
+// Attempts fail as soon as they start, until `untilMs` has passed
+static void failAttemptsFor(unsigned long untilMs) {
+    unsigned long end = millis() + untilMs;
+    while ((long)(millis() - end) < 0) {
+        size_t before = WiFi.hostAttempts().size();
+        step();
+        if (WiFi.hostAttempts().size() != before) {
+            WiFi.hostDisconnect(WIFI_REASON_NO_AP_FOUND);
+        }
+    }
+}
+
+// First connection over DHCP; leaves a lease dated by the (host) wall clock
+static void connectOnce() {
+    wifi->begin();
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTING, wifi->getState());
+    WiFi.hostConnect(DHCP_IP, AP_CHANNEL);
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, wifi->getState());
+}
+
+void setUp(void) {
+    hostResetClock();
+    hostSetFlashDirectory(hostTempDirectory("wifi_manager"));
+    hostClearConsole();
+    bootBegin();
+    WiFi.hostReset();
+    wifiTask = hostCreateTask("wifi");
+    hostSetCurrentTask(wifiTask);
+
+    storage = new StorageManager();
+    TEST_ASSERT_TRUE(storage->begin());
+    wifi = new WiFiManager();
+    wifi->setStorageManager(storage);
+    wifi->setCredentials("plant-net", "secret");
+}
+
+void tearDown(void) {
+    delete wifi;
+    delete storage;
+    hostSetCurrentTask(nullptr);
+}
+
+void test_full_attempts_back_off(void) {
+    wifi->begin();
+    failAttemptsFor(120000);
+
+    // No lease yet: every attempt scans all channels, and the gap doubles
+    // from WIFI_BACKOFF_MIN_MS up to WIFI_BACKOFF_MAX_MS
+    const std::vector<HostWiFiAttempt>& attempts = WiFi.hostAttempts();
+    TEST_ASSERT_GREATER_OR_EQUAL(8, attempts.size());
+    unsigned long expected = WIFI_BACKOFF_MIN_MS;
+    printf("full attempt gaps (ms):");
+    for (size_t i = 1; i < attempts.size(); i++) {
+        unsigned long gap = attempts[i].at - attempts[i - 1].at;
+        printf(" %lu", gap);
+        TEST_ASSERT_EQUAL_UINT8(0, attempts[i].channel);
+        TEST_ASSERT_FALSE(attempts[i].bssid);
+        TEST_ASSERT_EQUAL_UINT32(expected, gap);
+        expected = min(expected * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+    }
+    printf("\n");
+
+    // The AP comes up with the next attempt; from now on the AP is cached
+    do {
+        step();
+    } while (wifi->getState() != WIFI_STATE_CONNECTING);
+    WiFi.hostConnect(DHCP_IP, AP_CHANNEL);
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, wifi->getState());
+    WiFi.hostDisconnect(WIFI_REASON_BEACON_TIMEOUT);
+    step();
+    TEST_ASSERT_TRUE(lastAttempt().bssid);
+}
+
+void test_attempt_without_an_answer_times_out(void) {
+    wifi->begin();
+    step();
+    unsigned long started = lastAttempt().at;
+
+    // The driver never reports back
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_BACKOFF, wifi->getState());
+    TEST_ASSERT_EQUAL_UINT32(WIFI_CONNECT_TIMEOUT_MS, millis() - started);
+    step();
+    TEST_ASSERT_EQUAL_UINT32(2, WiFi.hostAttempts().size());
+    TEST_ASSERT_EQUAL_UINT32(WIFI_CONNECT_TIMEOUT_MS + WIFI_BACKOFF_MIN_MS, lastAttempt().at - started);
+}
+
+void test_link_loss_reconnects_with_the_cached_ap_and_ip(void) {
+    connectOnce();
+    TEST_ASSERT_FALSE(lastAttempt().bssid);
+    TEST_ASSERT_FALSE(lastAttempt().staticIP);
+
+    // The lease is saved, dated by NTP
+    WiFiLease saved = storage->getConfig().wifiLease;
+    TEST_ASSERT_EQUAL_UINT8(AP_CHANNEL, saved.channel);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)DHCP_IP, saved.ip);
+    TEST_ASSERT_UINT32_WITHIN(5, time(nullptr), saved.acquiredAt);
+
+    hostAdvanceMillis(60000);
+    WiFi.hostDisconnect(WIFI_REASON_BEACON_TIMEOUT);
+    step();
+
+    // Straight back to the same AP and channel, no DHCP
+    TEST_ASSERT_EQUAL_UINT32(2, WiFi.hostAttempts().size());
+    TEST_ASSERT_EQUAL_UINT8(AP_CHANNEL, lastAttempt().channel);
+    TEST_ASSERT_TRUE(lastAttempt().bssid);
+    TEST_ASSERT_TRUE(lastAttempt().staticIP);
+
+    hostAdvanceMillis(150);
+    WiFi.hostConnect(IPAddress(10, 0, 0, 99), AP_CHANNEL);
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, wifi->getState());
+    TEST_ASSERT_TRUE(WiFi.localIP() == DHCP_IP);
+    TEST_ASSERT_EQUAL_UINT32(150, wifi->getLastReconnectMillis());
+    // Same lease - nothing new to save
+    WiFiLease after = storage->getConfig().wifiLease;
+    TEST_ASSERT_EQUAL_MEMORY(&saved, &after, sizeof(saved));
+}
+
+void test_ap_down_probes_the_cached_ap_between_full_attempts(void) {
+    connectOnce();
+    size_t before = WiFi.hostAttempts().size();
+
+    WiFi.hostDisconnect(WIFI_REASON_BEACON_TIMEOUT);
+    failAttemptsFor(60000);
+
+    // Full attempts keep the doubling backoff; the cached AP is probed
+    // every WIFI_PROBE_INTERVAL_MS in between
+    const std::vector<HostWiFiAttempt>& attempts = WiFi.hostAttempts();
+    const HostWiFiAttempt* lastFast = nullptr;
+    const HostWiFiAttempt* lastFull = nullptr;
+    unsigned long expectedGap = WIFI_BACKOFF_MIN_MS;
+    uint32_t fast = 0;
+    uint32_t full = 0;
+    for (size_t i = before; i < attempts.size(); i++) {
+        if (attempts[i].bssid) {
+            TEST_ASSERT_EQUAL_UINT8(AP_CHANNEL, attempts[i].channel);
+            TEST_ASSERT_TRUE(attempts[i].staticIP);
+            if (lastFast) {
+                TEST_ASSERT_EQUAL_UINT32(WIFI_PROBE_INTERVAL_MS, attempts[i].at - lastFast->at);
+            }
+            lastFast = &attempts[i];
+            fast++;
+        } else {
+            if (lastFull) {
+                TEST_ASSERT_EQUAL_UINT32(expectedGap, attempts[i].at - lastFull->at);
+                expectedGap = min(expectedGap * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+            }
+            lastFull = &attempts[i];
+            full++;
+        }
+    }
+    printf("60 s with the AP down: %u cached AP probes, %u full attempts\n", fast, full);
+    TEST_ASSERT_GREATER_OR_EQUAL(5, full);
+    TEST_ASSERT_GREATER_THAN(full, fast);
+
+    // The AP is back on its old channel: the next probe gets it
+    do {
+        step();
+        if (wifi->getState() == WIFI_STATE_CONNECTING && !lastAttempt().bssid) {
+            WiFi.hostDisconnect(WIFI_REASON_NO_AP_FOUND);
+        }
+    } while (wifi->getState() != WIFI_STATE_CONNECTING || !lastAttempt().bssid);
+    WiFi.hostConnect(DHCP_IP, AP_CHANNEL);
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, wifi->getState());
+    TEST_ASSERT_LESS_OR_EQUAL(60000 + WIFI_PROBE_INTERVAL_MS, wifi->getLastReconnectMillis());
+}
+
+// The first attempt after a reboot with `lease` on flash
+static HostWiFiAttempt bootWithLease(const WiFiLease& lease) {
+    delete wifi;
+    wifi = new WiFiManager();
+    wifi->setStorageManager(storage);
+    wifi->setCredentials("plant-net", "secret");
+    wifi->setLease(lease);
+    wifi->begin();
+    step();
+    return lastAttempt();
+}
+
+void test_lease_age_decides_the_cached_ip(void) {
+    WiFiLease lease = {};
+    lease.channel = AP_CHANNEL;
+    lease.bssid[0] = 0x02;
+    lease.ip = DHCP_IP;
+
+    // Fresh: the AP and the IP
+    lease.acquiredAt = time(nullptr) - 60;
+    HostWiFiAttempt attempt = bootWithLease(lease);
+    TEST_ASSERT_TRUE(attempt.bssid);
+    TEST_ASSERT_EQUAL_UINT8(AP_CHANNEL, attempt.channel);
+    TEST_ASSERT_TRUE(attempt.staticIP);
+
+    // Older than WIFI_LEASE_REUSE_S: the AP, but DHCP runs
+    lease.acquiredAt = time(nullptr) - 2 * WIFI_LEASE_REUSE_S;
+    attempt = bootWithLease(lease);
+    TEST_ASSERT_TRUE(attempt.bssid);
+    TEST_ASSERT_FALSE(attempt.staticIP);
+
+    // Undated (NTP never answered before the reboot): the AP only
+    lease.acquiredAt = 0;
+    attempt = bootWithLease(lease);
+    TEST_ASSERT_TRUE(attempt.bssid);
+    TEST_ASSERT_FALSE(attempt.staticIP);
+
+    // Nothing cached: a full attempt
+    attempt = bootWithLease(WiFiLease{});
+    TEST_ASSERT_FALSE(attempt.bssid);
+    TEST_ASSERT_EQUAL_UINT8(0, attempt.channel);
+}
+
+void test_new_network_drops_the_lease(void) {
+    connectOnce();
+    wifi->setCredentials("other-net", "secret");
+    WiFi.hostDisconnect(WIFI_REASON_AUTH_FAIL);
+    step();
+
+    TEST_ASSERT_FALSE(lastAttempt().bssid);
+    TEST_ASSERT_EQUAL_UINT8(0, lastAttempt().channel);
+    TEST_ASSERT_FALSE(lastAttempt().staticIP);
+}
+
+void test_own_disconnects_are_ignored(void) {
+    connectOnce();
+    size_t attempts = WiFi.hostAttempts().size();
+
+    // The driver reports our own leave like a link loss
+    WiFi.hostDisconnect(WIFI_REASON_ASSOC_LEAVE);
+    step();
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, wifi->getState());
+    TEST_ASSERT_EQUAL_UINT32(attempts, WiFi.hostAttempts().size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_attempts_back_off);
+    RUN_TEST(test_attempt_without_an_answer_times_out);
+    RUN_TEST(test_link_loss_reconnects_with_the_cached_ap_and_ip);
+    RUN_TEST(test_ap_down_probes_the_cached_ap_between_full_attempts);
+    RUN_TEST(test_lease_age_decides_the_cached_ip);
+    RUN_TEST(test_new_network_drops_the_lease);
+    RUN_TEST(test_own_disconnects_are_ignored);
+    return UNITY_END();
+}